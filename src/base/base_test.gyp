@@ -57,6 +57,7 @@
       'sources': [
         'codegen_bytearray_stream_test.cc',
         'cpu_stats_test.cc',
+        'latency_trace_test.cc',
         'process_mutex_test.cc',
         'stopwatch_test.cc',
       ],
@@ -355,6 +356,20 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'flat_trie_test',
+      'type': 'executable',
+      'sources': [
+        'container/flat_trie_test.cc',
+      ],
+      'dependencies': [
+        '<(mozc_oss_src_dir)/testing/testing.gyp:gtest_main',
+        'base.gyp:base',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'multifile_test',
       'type': 'executable',
@@ -468,6 +483,7 @@
         'embedded_file_test',
         'encryptor_test',
         'file_util_test',
+        'flat_trie_test',
         'hash_test',
         'multifile_test',
         'number_util_test',
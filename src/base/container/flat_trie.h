@@ -0,0 +1,230 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Immutable trie compiled into flat arrays.
+
+#ifndef MOZC_BASE_CONTAINER_FLAT_TRIE_H_
+#define MOZC_BASE_CONTAINER_FLAT_TRIE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/log/check.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+
+// FlatTrie provides the lookups of Trie<T> on a trie which is built once and
+// never modified. The states are stored in a single array, and the
+// transitions of each state are a sorted range of bytes, so a lookup touches
+// a few contiguous arrays instead of a hash map per character.
+//
+// The transitions are labeled with bytes, but the results are the same as
+// Trie<T> which is labeled with characters: prefix matches never end in the
+// middle of a UTF-8 character.
+template <typename T>
+class FlatTrie final {
+ public:
+  FlatTrie() : states_(1) {}
+
+  // Builds the trie from the pairs of a key and a value. The keys must be
+  // unique.
+  explicit FlatTrie(std::vector<std::pair<std::string, T>> entries)
+      : FlatTrie() {
+    absl::c_sort(entries, [](const auto &lhs, const auto &rhs) {
+      return lhs.first < rhs.first;
+    });
+    states_.clear();
+    Build(entries, 0, entries.size(), 0);
+  }
+
+  FlatTrie(const FlatTrie &) = default;
+  FlatTrie &operator=(const FlatTrie &) = default;
+  FlatTrie(FlatTrie &&) = default;
+  FlatTrie &operator=(FlatTrie &&) = default;
+
+  bool LookUp(absl::string_view key, T *data) const {
+    const uint32_t state = Traverse(key);
+    if (state == kNoState || !HasValue(state)) {
+      return false;
+    }
+    *data = values_[states_[state].value];
+    return true;
+  }
+
+  // Same as Trie<T>::LookUpPrefix().
+  bool LookUpPrefix(absl::string_view key, T *data, size_t *key_length,
+                    bool *fixed) const {
+    uint32_t state = 0;
+    // The last state and the length at the end of a character.
+    uint32_t matched_state = 0;
+    size_t matched_length = 0;
+    for (size_t i = 0; i < key.size(); ++i) {
+      state = Next(state, key[i]);
+      if (state == kNoState) {
+        break;
+      }
+      if (i + 1 == key.size() || !IsTrailingByte(key[i + 1])) {
+        matched_state = state;
+        matched_length = i + 1;
+      }
+    }
+    *key_length = matched_length;
+    if (!HasValue(matched_state)) {
+      *fixed = true;
+      return false;
+    }
+    *data = values_[states_[matched_state].value];
+    *fixed = states_[matched_state].edges_begin ==
+             states_[matched_state].edges_end;
+    return true;
+  }
+
+  // Same as Trie<T>::LookUpPredictiveAll().
+  void LookUpPredictiveAll(absl::string_view key,
+                           std::vector<T> *data_list) const {
+    DCHECK(data_list);
+    if (const uint32_t state = Traverse(key); state != kNoState) {
+      CollectValues(state, data_list);
+    }
+  }
+
+  // Same as Trie<T>::HasSubTrie().
+  bool HasSubTrie(absl::string_view key) const {
+    return !key.empty() && Traverse(key) != kNoState;
+  }
+
+  size_t states_size() const { return states_.size(); }
+
+ private:
+  static constexpr uint32_t kNoState = UINT32_MAX;
+  static constexpr uint32_t kNoValue = UINT32_MAX;
+
+  struct State {
+    // The range of the transitions in labels_ and targets_.
+    uint32_t edges_begin = 0;
+    uint32_t edges_end = 0;
+    // The index in values_, or kNoValue.
+    uint32_t value = kNoValue;
+  };
+
+  static bool IsTrailingByte(char c) {
+    return (static_cast<uint8_t>(c) & 0xC0) == 0x80;
+  }
+
+  bool HasValue(uint32_t state) const {
+    return states_[state].value != kNoValue;
+  }
+
+  // Builds the state for the keys of entries[begin, end), which share the
+  // first |depth| bytes, and returns its index.
+  uint32_t Build(const std::vector<std::pair<std::string, T>> &entries,
+                 size_t begin, const size_t end, const size_t depth) {
+    const uint32_t index = states_.size();
+    states_.emplace_back();
+    if (begin < end && entries[begin].first.size() == depth) {
+      states_[index].value = values_.size();
+      values_.push_back(entries[begin].second);
+      ++begin;
+    }
+    DCHECK(begin == end || entries[begin].first.size() > depth)
+        << "Duplicated key: " << entries[begin].first;
+
+    // The transitions of a state are reserved before building the children,
+    // so that they are contiguous.
+    std::vector<size_t> group_begins;
+    for (size_t i = begin; i < end; ++i) {
+      const uint8_t label = entries[i].first[depth];
+      if (group_begins.empty() ||
+          label != static_cast<uint8_t>(
+                       entries[group_begins.back()].first[depth])) {
+        group_begins.push_back(i);
+        labels_.push_back(label);
+        targets_.push_back(kNoState);
+      }
+    }
+    const uint32_t edges_begin = labels_.size() - group_begins.size();
+    states_[index].edges_begin = edges_begin;
+    states_[index].edges_end = labels_.size();
+
+    for (size_t i = 0; i < group_begins.size(); ++i) {
+      const size_t group_end =
+          i + 1 < group_begins.size() ? group_begins[i + 1] : end;
+      targets_[edges_begin + i] =
+          Build(entries, group_begins[i], group_end, depth + 1);
+    }
+    return index;
+  }
+
+  uint32_t Next(uint32_t state, char c) const {
+    const uint8_t label = static_cast<uint8_t>(c);
+    const auto begin = labels_.begin() + states_[state].edges_begin;
+    const auto end = labels_.begin() + states_[state].edges_end;
+    const auto it = std::lower_bound(begin, end, label);
+    if (it == end || *it != label) {
+      return kNoState;
+    }
+    return targets_[it - labels_.begin()];
+  }
+
+  uint32_t Traverse(absl::string_view key) const {
+    uint32_t state = 0;
+    for (const char c : key) {
+      state = Next(state, c);
+      if (state == kNoState) {
+        return kNoState;
+      }
+    }
+    return state;
+  }
+
+  void CollectValues(uint32_t state, std::vector<T> *data_list) const {
+    if (HasValue(state)) {
+      data_list->push_back(values_[states_[state].value]);
+    }
+    for (uint32_t i = states_[state].edges_begin; i < states_[state].edges_end;
+         ++i) {
+      CollectValues(targets_[i], data_list);
+    }
+  }
+
+  std::vector<State> states_;
+  std::vector<uint8_t> labels_;
+  std::vector<uint32_t> targets_;
+  std::vector<T> values_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_CONTAINER_FLAT_TRIE_H_
@@ -0,0 +1,160 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/container/flat_trie.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/strings/string_view.h"
+#include "base/container/trie.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAreArray;
+
+TEST(FlatTrieTest, LookUp) {
+  const FlatTrie<std::string> trie({
+      {"abc", "data_abc"},
+      {"abd", "data_abd"},
+      {"abcd", "data_abcd"},
+      {"bcd", "data_bcd"},
+  });
+
+  std::string data;
+  EXPECT_TRUE(trie.LookUp("abc", &data));
+  EXPECT_EQ(data, "data_abc");
+  EXPECT_TRUE(trie.LookUp("abcd", &data));
+  EXPECT_EQ(data, "data_abcd");
+  EXPECT_TRUE(trie.LookUp("bcd", &data));
+  EXPECT_EQ(data, "data_bcd");
+  EXPECT_FALSE(trie.LookUp("ab", &data));
+  EXPECT_FALSE(trie.LookUp("xyz", &data));
+  EXPECT_FALSE(trie.LookUp("abcde", &data));
+  EXPECT_FALSE(trie.LookUp("", &data));
+
+  EXPECT_TRUE(trie.HasSubTrie("ab"));
+  EXPECT_TRUE(trie.HasSubTrie("abcd"));
+  EXPECT_FALSE(trie.HasSubTrie("abcde"));
+  EXPECT_FALSE(trie.HasSubTrie(""));
+}
+
+TEST(FlatTrieTest, Empty) {
+  const FlatTrie<int> trie;
+  int data = 0;
+  size_t key_length = 1;
+  bool fixed = false;
+  EXPECT_FALSE(trie.LookUp("a", &data));
+  EXPECT_FALSE(trie.LookUpPrefix("a", &data, &key_length, &fixed));
+  EXPECT_EQ(key_length, 0);
+  EXPECT_TRUE(fixed);
+  std::vector<int> data_list;
+  trie.LookUpPredictiveAll("", &data_list);
+  EXPECT_THAT(data_list, IsEmpty());
+  EXPECT_EQ(trie.states_size(), 1);
+}
+
+TEST(FlatTrieTest, LookUpPredictiveAll) {
+  const FlatTrie<std::string> trie({
+      {"abc", "[ABC]"},
+      {"abd", "[ABD]"},
+      {"a", "[A]"},
+      {"b", "[B]"},
+  });
+
+  std::vector<std::string> data_list;
+  trie.LookUpPredictiveAll("a", &data_list);
+  EXPECT_THAT(data_list, ElementsAre("[A]", "[ABC]", "[ABD]"));
+
+  data_list.clear();
+  trie.LookUpPredictiveAll("ab", &data_list);
+  EXPECT_THAT(data_list, ElementsAre("[ABC]", "[ABD]"));
+
+  data_list.clear();
+  trie.LookUpPredictiveAll("c", &data_list);
+  EXPECT_THAT(data_list, IsEmpty());
+}
+
+// The results should be the same as Trie, including the keys ending in the
+// middle of a multi-byte character.
+TEST(FlatTrieTest, SameAsTrie) {
+  const std::vector<std::pair<std::string, std::string>> entries = {
+      {"a", "あ"},     {"ka", "か"},   {"kk", "っ"},    {"kya", "きゃ"},
+      {"n", "ん"},     {"nn", "ん"},   {"あ", "[あ]"},  {"あい", "[あい]"},
+      {"aあ", "[aあ]"}, {"い゛", "ゐ"}, {"\t{!}", "[!]"},
+  };
+  Trie<std::string> trie;
+  for (const auto &[key, value] : entries) {
+    trie.AddEntry(key, value);
+  }
+  const FlatTrie<std::string> flat_trie(entries);
+
+  const absl::string_view kQueries[] = {
+      "",   "a",  "k",   "ka",  "kk",  "ky",    "kyo",  "kyaa", "n",
+      "nn", "nx", "あ",  "あい", "あう", "aい",   "aあい", "い",   "い゛",
+      "x",  "\t", "\t{", "\t{!}",
+  };
+  for (const absl::string_view query : kQueries) {
+    SCOPED_TRACE(query);
+    std::string expected_data, actual_data;
+    EXPECT_EQ(flat_trie.LookUp(query, &actual_data),
+              trie.LookUp(query, &expected_data));
+    EXPECT_EQ(actual_data, expected_data);
+
+    size_t expected_length = 0, actual_length = 0;
+    bool expected_fixed = false, actual_fixed = false;
+    expected_data.clear();
+    actual_data.clear();
+    EXPECT_EQ(flat_trie.LookUpPrefix(query, &actual_data, &actual_length,
+                                     &actual_fixed),
+              trie.LookUpPrefix(query, &expected_data, &expected_length,
+                                &expected_fixed));
+    EXPECT_EQ(actual_data, expected_data);
+    EXPECT_EQ(actual_length, expected_length);
+    EXPECT_EQ(actual_fixed, expected_fixed);
+
+    std::vector<std::string> expected_list, actual_list;
+    flat_trie.LookUpPredictiveAll(query, &actual_list);
+    trie.LookUpPredictiveAll(query, &expected_list);
+    EXPECT_THAT(actual_list, UnorderedElementsAreArray(expected_list));
+
+    EXPECT_EQ(flat_trie.HasSubTrie(query), trie.HasSubTrie(query));
+  }
+}
+
+}  // namespace
+}  // namespace mozc
@@ -0,0 +1,163 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/latency_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "base/file_util.h"
+
+namespace mozc {
+namespace {
+
+ABSL_CONST_INIT absl::Mutex g_histograms_mutex(absl::kConstInit);
+
+absl::flat_hash_map<std::string, std::unique_ptr<LatencyHistogram>> &
+GetHistograms() ABSL_EXCLUSIVE_LOCKS_REQUIRED(g_histograms_mutex) {
+  static auto *histograms = new absl::flat_hash_map<
+      std::string, std::unique_ptr<LatencyHistogram>>();
+  return *histograms;
+}
+
+}  // namespace
+
+// static
+int LatencyHistogram::GetBucketIndex(const absl::Duration latency) {
+  const int64_t usec = absl::ToInt64Microseconds(latency);
+  if (usec <= 0) {
+    return 0;
+  }
+  return std::min<int>(std::bit_width(static_cast<uint64_t>(usec)),
+                       kNumBuckets - 1);
+}
+
+void LatencyHistogram::Record(const absl::Duration latency) {
+  const uint64_t usec =
+      std::max<int64_t>(absl::ToInt64Microseconds(latency), 0);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_usec_.fetch_add(usec, std::memory_order_relaxed);
+  buckets_[GetBucketIndex(latency)].fetch_add(1, std::memory_order_relaxed);
+  uint64_t max_usec = max_usec_.load(std::memory_order_relaxed);
+  while (usec > max_usec && !max_usec_.compare_exchange_weak(
+                                max_usec, usec, std::memory_order_relaxed)) {
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::GetSnapshot() const {
+  // The fields are read one by one, so they can be slightly inconsistent while
+  // the stage is being recorded.
+  Snapshot snapshot;
+  snapshot.name = name_;
+  snapshot.count = count_.load(std::memory_order_relaxed);
+  snapshot.total_usec = total_usec_.load(std::memory_order_relaxed);
+  snapshot.max_usec = max_usec_.load(std::memory_order_relaxed);
+  for (int i = 0; i < kNumBuckets; ++i) {
+    snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+void LatencyHistogram::Clear() {
+  count_.store(0, std::memory_order_relaxed);
+  total_usec_.store(0, std::memory_order_relaxed);
+  max_usec_.store(0, std::memory_order_relaxed);
+  for (std::atomic<uint64_t> &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+// static
+LatencyHistogram &LatencyTrace::GetHistogram(const absl::string_view name) {
+  absl::MutexLock lock(&g_histograms_mutex);
+  std::unique_ptr<LatencyHistogram> &histogram =
+      GetHistograms()[std::string(name)];
+  if (histogram == nullptr) {
+    histogram = std::make_unique<LatencyHistogram>(name);
+  }
+  return *histogram;
+}
+
+// static
+std::vector<LatencyHistogram::Snapshot> LatencyTrace::GetSnapshots() {
+  std::vector<LatencyHistogram::Snapshot> snapshots;
+  {
+    absl::MutexLock lock(&g_histograms_mutex);
+    for (const auto &[name, histogram] : GetHistograms()) {
+      snapshots.push_back(histogram->GetSnapshot());
+    }
+  }
+  std::sort(snapshots.begin(), snapshots.end(),
+            [](const LatencyHistogram::Snapshot &lhs,
+               const LatencyHistogram::Snapshot &rhs) {
+              return lhs.name < rhs.name;
+            });
+  return snapshots;
+}
+
+// static
+void LatencyTrace::ClearAll() {
+  absl::MutexLock lock(&g_histograms_mutex);
+  for (auto &[name, histogram] : GetHistograms()) {
+    histogram->Clear();
+  }
+}
+
+// static
+std::string LatencyTrace::GetSummary() {
+  std::string summary;
+  for (const LatencyHistogram::Snapshot &snapshot : GetSnapshots()) {
+    const uint64_t avg_usec =
+        snapshot.count == 0 ? 0 : snapshot.total_usec / snapshot.count;
+    absl::StrAppend(&summary, snapshot.name, "\tcount=", snapshot.count,
+                    "\tavg_usec=", avg_usec, "\tmax_usec=", snapshot.max_usec,
+                    "\tbuckets=", absl::StrJoin(snapshot.buckets, ","), "\n");
+  }
+  return summary;
+}
+
+// static
+absl::Status LatencyTrace::WriteSummaryToFile(const std::string &filename) {
+  return FileUtil::SetContents(filename, GetSummary());
+}
+
+}  // namespace mozc
@@ -0,0 +1,184 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Lightweight per-stage latency tracing of the key event path.
+//
+// MOZC_LATENCY_TRACE(name) records the time until the end of the enclosing
+// scope into the histogram of the stage `name`. The histograms are process
+// wide and can be read with LatencyTrace::GetSnapshots(). A trace costs two
+// reads of the monotonic clock and a few relaxed atomic operations. Defining
+// MOZC_NO_LATENCY_TRACE compiles out all the traces. It is defined by
+// `bazel build --define LATENCY_TRACE=off` and `build_mozc.py gyp
+// --nolatency_trace`.
+//
+// Work off the key event path, like the lattice prefetch and the warmup,
+// runs under a ScopedLatencyTraceSuppressor so that it does not skew the
+// histograms.
+//
+// Usage:
+//   bool ImmutableConverter::ConvertForRequest(...) {
+//     MOZC_LATENCY_TRACE("ImmutableConverter::ConvertForRequest");
+//     ...
+//   }
+
+#ifndef MOZC_BASE_LATENCY_TRACE_H_
+#define MOZC_BASE_LATENCY_TRACE_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+
+// Histogram of the latencies of a stage. Thread-safe.
+class LatencyHistogram {
+ public:
+  // The bucket i > 0 counts the latencies in [2^(i-1), 2^i) microseconds. The
+  // bucket 0 counts the latencies less than 1 microsecond, and the last bucket
+  // counts all the latencies above its lower bound.
+  static constexpr int kNumBuckets = 24;
+
+  struct Snapshot {
+    std::string name;
+    uint64_t count = 0;
+    uint64_t total_usec = 0;
+    uint64_t max_usec = 0;
+    std::array<uint64_t, kNumBuckets> buckets = {};
+  };
+
+  explicit LatencyHistogram(absl::string_view name) : name_(name) {}
+
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  void Record(absl::Duration latency);
+  Snapshot GetSnapshot() const;
+  void Clear();
+
+  static int GetBucketIndex(absl::Duration latency);
+
+ private:
+  const std::string name_;
+  std::atomic<uint64_t> count_ = 0;
+  std::atomic<uint64_t> total_usec_ = 0;
+  std::atomic<uint64_t> max_usec_ = 0;
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_ = {};
+};
+
+class LatencyTrace {
+ public:
+  LatencyTrace() = delete;
+
+  // Returns the histogram of the stage `name`. The histogram is created on the
+  // first call and lives until the process exits.
+  static LatencyHistogram &GetHistogram(absl::string_view name);
+
+  // Returns the snapshots of all the histograms sorted by name.
+  static std::vector<LatencyHistogram::Snapshot> GetSnapshots();
+
+  // Clears all the histograms.
+  static void ClearAll();
+
+  // Returns the snapshots in a human readable text, one stage per line.
+  static std::string GetSummary();
+
+  // Writes GetSummary() to `filename`.
+  static absl::Status WriteSummaryToFile(const std::string &filename);
+};
+
+// Disables the traces started on the current thread while alive.
+class ScopedLatencyTraceSuppressor {
+ public:
+  ScopedLatencyTraceSuppressor() { ++depth_; }
+
+  ScopedLatencyTraceSuppressor(const ScopedLatencyTraceSuppressor &) = delete;
+  ScopedLatencyTraceSuppressor &operator=(
+      const ScopedLatencyTraceSuppressor &) = delete;
+
+  ~ScopedLatencyTraceSuppressor() { --depth_; }
+
+  static bool IsSuppressed() { return depth_ > 0; }
+
+ private:
+  static inline thread_local int depth_ = 0;
+};
+
+// Records the time from the construction to the destruction, unless a
+// ScopedLatencyTraceSuppressor is alive on the thread at the construction.
+class ScopedLatencyTrace {
+ public:
+  explicit ScopedLatencyTrace(LatencyHistogram &histogram)
+      : histogram_(ScopedLatencyTraceSuppressor::IsSuppressed() ? nullptr
+                                                                : &histogram),
+        start_(histogram_ == nullptr ? std::chrono::steady_clock::time_point()
+                                     : std::chrono::steady_clock::now()) {}
+
+  ScopedLatencyTrace(const ScopedLatencyTrace &) = delete;
+  ScopedLatencyTrace &operator=(const ScopedLatencyTrace &) = delete;
+
+  ~ScopedLatencyTrace() {
+    if (histogram_ != nullptr) {
+      histogram_->Record(
+          absl::FromChrono(std::chrono::steady_clock::now() - start_));
+    }
+  }
+
+ private:
+  LatencyHistogram *const histogram_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace mozc
+
+#define MOZC_LATENCY_TRACE_CONCAT_INTERNAL(x, y) x##y
+#define MOZC_LATENCY_TRACE_CONCAT(x, y) MOZC_LATENCY_TRACE_CONCAT_INTERNAL(x, y)
+
+#ifdef MOZC_NO_LATENCY_TRACE
+#define MOZC_LATENCY_TRACE(name) \
+  do {                           \
+  } while (false)
+#else  // MOZC_NO_LATENCY_TRACE
+// The histogram is looked up only once per call site.
+#define MOZC_LATENCY_TRACE(name)                                             \
+  static ::mozc::LatencyHistogram &MOZC_LATENCY_TRACE_CONCAT(                \
+      mozc_latency_histogram_, __LINE__) =                                   \
+      ::mozc::LatencyTrace::GetHistogram(name);                              \
+  const ::mozc::ScopedLatencyTrace MOZC_LATENCY_TRACE_CONCAT(                \
+      mozc_latency_trace_,                                                   \
+      __LINE__)(MOZC_LATENCY_TRACE_CONCAT(mozc_latency_histogram_, __LINE__))
+#endif  // MOZC_NO_LATENCY_TRACE
+
+#endif  // MOZC_BASE_LATENCY_TRACE_H_
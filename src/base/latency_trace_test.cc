@@ -0,0 +1,151 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/latency_trace.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "base/file/temp_dir.h"
+#include "base/file_util.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "testing/mozctest.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+TEST(LatencyHistogramTest, GetBucketIndex) {
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(absl::ZeroDuration()), 0);
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(absl::Nanoseconds(999)), 0);
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(absl::Microseconds(1)), 1);
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(absl::Microseconds(2)), 2);
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(absl::Microseconds(3)), 2);
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(absl::Microseconds(1000)), 10);
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(absl::Hours(1)),
+            LatencyHistogram::kNumBuckets - 1);
+}
+
+TEST(LatencyHistogramTest, Record) {
+  LatencyHistogram histogram("stage");
+  histogram.Record(absl::Microseconds(3));
+  histogram.Record(absl::Microseconds(1000));
+  histogram.Record(absl::Microseconds(2));
+
+  LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.name, "stage");
+  EXPECT_EQ(snapshot.count, 3);
+  EXPECT_EQ(snapshot.total_usec, 1005);
+  EXPECT_EQ(snapshot.max_usec, 1000);
+  EXPECT_EQ(snapshot.buckets[2], 2);
+  EXPECT_EQ(snapshot.buckets[10], 1);
+
+  histogram.Clear();
+  snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 0);
+  EXPECT_EQ(snapshot.total_usec, 0);
+  EXPECT_EQ(snapshot.max_usec, 0);
+  EXPECT_EQ(snapshot.buckets[2], 0);
+}
+
+void TracedFunction() { MOZC_LATENCY_TRACE("LatencyTraceTest::Traced"); }
+
+TEST(LatencyTraceTest, Trace) {
+  LatencyHistogram &histogram =
+      LatencyTrace::GetHistogram("LatencyTraceTest::Traced");
+  EXPECT_EQ(&LatencyTrace::GetHistogram("LatencyTraceTest::Traced"),
+            &histogram);
+  histogram.Clear();
+
+  TracedFunction();
+  TracedFunction();
+#ifdef MOZC_NO_LATENCY_TRACE
+  EXPECT_EQ(histogram.GetSnapshot().count, 0);
+#else   // MOZC_NO_LATENCY_TRACE
+  EXPECT_EQ(histogram.GetSnapshot().count, 2);
+#endif  // MOZC_NO_LATENCY_TRACE
+
+  LatencyTrace::ClearAll();
+  EXPECT_EQ(histogram.GetSnapshot().count, 0);
+}
+
+TEST(LatencyTraceTest, Suppress) {
+  LatencyHistogram histogram("LatencyTraceTest::Suppressed");
+  EXPECT_FALSE(ScopedLatencyTraceSuppressor::IsSuppressed());
+  {
+    const ScopedLatencyTraceSuppressor suppressor;
+    {
+      const ScopedLatencyTraceSuppressor nested_suppressor;
+      const ScopedLatencyTrace trace(histogram);
+    }
+    EXPECT_TRUE(ScopedLatencyTraceSuppressor::IsSuppressed());
+    const ScopedLatencyTrace trace(histogram);
+  }
+  EXPECT_FALSE(ScopedLatencyTraceSuppressor::IsSuppressed());
+  EXPECT_EQ(histogram.GetSnapshot().count, 0);
+
+  { const ScopedLatencyTrace trace(histogram); }
+  EXPECT_EQ(histogram.GetSnapshot().count, 1);
+}
+
+TEST(LatencyTraceTest, Summary) {
+  LatencyTrace::GetHistogram("LatencyTraceTest::B").Record(
+      absl::Microseconds(10));
+  LatencyTrace::GetHistogram("LatencyTraceTest::A").Record(
+      absl::Microseconds(20));
+
+  std::vector<std::string> names;
+  for (const LatencyHistogram::Snapshot &snapshot :
+       LatencyTrace::GetSnapshots()) {
+    if (snapshot.name == "LatencyTraceTest::A" ||
+        snapshot.name == "LatencyTraceTest::B") {
+      names.push_back(snapshot.name);
+    }
+  }
+  EXPECT_THAT(names,
+              ElementsAre("LatencyTraceTest::A", "LatencyTraceTest::B"));
+
+  const std::string summary = LatencyTrace::GetSummary();
+  EXPECT_THAT(summary,
+              HasSubstr("LatencyTraceTest::A\tcount=1\tavg_usec=20\t"));
+
+  const TempFile file = testing::MakeTempFileOrDie();
+  ASSERT_OK(LatencyTrace::WriteSummaryToFile(file.path()));
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(file.path());
+  ASSERT_OK(contents);
+  EXPECT_EQ(*contents, LatencyTrace::GetSummary());
+}
+
+}  // namespace
+}  // namespace mozc
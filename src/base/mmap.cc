@@ -30,6 +30,7 @@
 #include "base/mmap.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <utility>
 
@@ -389,4 +390,41 @@ int Mmap::MaybeMUnlock(const void *addr, size_t len) { return -1; }
 
 #undef MOZC_HAVE_MLOCK
 
+#ifdef _WIN32
+
+int Mmap::MaybeMAdvise(const void *addr, size_t len, Advice advice) {
+  return -1;
+}
+
+#else  // _WIN32
+
+int Mmap::MaybeMAdvise(const void *addr, size_t len, Advice advice) {
+  int native_advice = MADV_NORMAL;
+  switch (advice) {
+    case NORMAL:
+      native_advice = MADV_NORMAL;
+      break;
+    case RANDOM:
+      native_advice = MADV_RANDOM;
+      break;
+    case SEQUENTIAL:
+      native_advice = MADV_SEQUENTIAL;
+      break;
+    case WILL_NEED:
+      native_advice = MADV_WILLNEED;
+      break;
+  }
+  absl::StatusOr<size_t> page_size = GetPageSize();
+  if (!page_size.ok() || len == 0) {
+    return -1;
+  }
+  // madvise() requires the address to be aligned to the page size.
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  const uintptr_t aligned_begin = begin - begin % *page_size;
+  return madvise(reinterpret_cast<void *>(aligned_begin),
+                 len + (begin - aligned_begin), native_advice);
+}
+
+#endif  // _WIN32
+
 }  // namespace mozc
@@ -46,6 +46,14 @@ class Mmap final {
     READ_WRITE,
   };
 
+  // Expected access patterns for MaybeMAdvise().
+  enum Advice {
+    NORMAL,
+    RANDOM,
+    SEQUENTIAL,
+    WILL_NEED,
+  };
+
   // Creates a mapping of an entire file into the address space.
   static absl::StatusOr<Mmap> Map(zstring_view filename,
                                   Mode mode = READ_ONLY) {
@@ -87,6 +95,11 @@ class Mmap final {
   static int MaybeMLock(const void *addr, size_t len);
   static int MaybeMUnlock(const void *addr, size_t len);
 
+  // Advises the kernel of the access pattern of the mapped region `[addr, addr
+  // + len)`, which is extended to the page boundaries. Returns the result of
+  // madvise(), or -1 on Windows, where it is not implemented.
+  static int MaybeMAdvise(const void *addr, size_t len, Advice advice);
+
   constexpr char &operator[](size_t i) { return data_[i]; }
   constexpr char operator[](size_t i) const { return data_[i]; }
   constexpr char *begin() { return data_.begin(); }
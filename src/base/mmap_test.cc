@@ -149,6 +149,29 @@ TEST(MmapTest, MaybeMLockTest) {
   }
 }
 
+TEST(MmapTest, MaybeMAdviseTest) {
+  constexpr size_t kFileSize = 10000;
+  const absl::StatusOr<TempFile> temp_file =
+      TempDirectory::Default().CreateTempFile();
+  ASSERT_OK(temp_file);
+  ASSERT_OK(
+      FileUtil::SetContents(temp_file->path(), std::string(kFileSize, 'a')));
+  absl::StatusOr<Mmap> mmap = Mmap::Map(temp_file->path());
+  ASSERT_OK(mmap);
+
+#ifdef _WIN32
+  EXPECT_EQ(Mmap::MaybeMAdvise(mmap->data(), kFileSize, Mmap::RANDOM), -1);
+#else   // _WIN32
+  for (const Mmap::Advice advice :
+       {Mmap::NORMAL, Mmap::RANDOM, Mmap::SEQUENTIAL, Mmap::WILL_NEED}) {
+    EXPECT_EQ(Mmap::MaybeMAdvise(mmap->data(), kFileSize, advice), 0);
+    // The region doesn't have to be aligned to the page size.
+    EXPECT_EQ(Mmap::MaybeMAdvise(mmap->data() + 123, 4567, advice), 0);
+  }
+#endif  // _WIN32
+  EXPECT_EQ((*mmap)[kFileSize - 1], 'a');
+}
+
 class MmapEntireFileTest : public ::testing::TestWithParam<size_t> {};
 
 TEST_P(MmapEntireFileTest, Read) {
@@ -238,6 +238,9 @@ def ParseGypOptions(args):
   parser.add_option('--gyp_python_path', dest='gyp_python_path',
                     help='File path to Python to execute GYP.')
   parser.add_option('--noqt', action='store_true', dest='noqt', default=False)
+  parser.add_option('--nolatency_trace', action='store_true',
+                    dest='nolatency_trace', default=False,
+                    help='Compiles out the per-stage latency trace.')
   parser.add_option('--version_file', dest='version_file',
                     help='use the specified version template file',
                     default='data/version/mozc_version_template.bzl')
@@ -510,6 +513,9 @@ def GypMain(options, unused_args):
   if version.IsDevChannel():
     gyp_options.extend(['-D', 'channel_dev=1'])
 
+  if options.nolatency_trace:
+    gyp_options.extend(['-D', 'enable_latency_trace=0'])
+
   target_platform_value = target_platform
   gyp_options.extend(['-D', 'target_platform=%s' % target_platform_value])
 
@@ -33,12 +33,12 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "absl/container/btree_set.h"
 #include "absl/hash/hash.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
@@ -53,6 +53,7 @@
 #include "base/strings/unicode.h"
 #include "base/util.h"
 #include "base/vlog.h"
+#include "composer/internal/char_chunk.h"
 #include "composer/internal/composition.h"
 #include "composer/internal/composition_input.h"
 #include "composer/internal/mode_switching_handler.h"
@@ -230,7 +231,7 @@ const ModifierRemovalMap *GetModifierRemovalMap() {
 
 void RemoveExpandedCharsForModifier(absl::string_view asis,
                                     absl::string_view base,
-                                    std::set<std::string> *expanded) {
+                                    absl::btree_set<std::string> *expanded) {
   if (!absl::StartsWith(asis, base)) {
     LOG(DFATAL) << "base is not a prefix of asis.";
     return;
@@ -245,6 +246,54 @@ void RemoveExpandedCharsForModifier(absl::string_view asis,
 
 constexpr size_t kMaxPreeditLength = 256;
 
+// Helpers of SerializeAsString() and ParseFromString(). Integers are stored
+// as base 128 varints and strings are prefixed with their lengths.
+void AppendVarint(uint64_t value, std::string *output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+void AppendString(absl::string_view value, std::string *output) {
+  AppendVarint(value.size(), output);
+  output->append(value);
+}
+
+bool ReadVarint(absl::string_view *input, uint64_t *value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !input->empty(); shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(input->front());
+    input->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+bool ReadInteger(absl::string_view *input, T *value) {
+  uint64_t varint = 0;
+  if (!ReadVarint(input, &varint)) {
+    return false;
+  }
+  *value = static_cast<T>(varint);
+  return true;
+}
+
+bool ReadString(absl::string_view *input, absl::string_view *value) {
+  uint64_t size = 0;
+  if (!ReadVarint(input, &size) || size > input->size()) {
+    return false;
+  }
+  *value = input->substr(0, size);
+  input->remove_prefix(size);
+  return true;
+}
+
 }  // namespace
 
 Composer::Composer()
@@ -715,6 +764,15 @@ void Composer::GetPreedit(std::string *left, std::string *focused,
 }
 
 std::string Composer::GetStringForPreedit() const {
+  ResetQueryCacheIfStale();
+  if (!query_cache_.has_preedit) {
+    query_cache_.preedit = BuildStringForPreedit();
+    query_cache_.has_preedit = true;
+  }
+  return query_cache_.preedit;
+}
+
+std::string Composer::BuildStringForPreedit() const {
   std::string output = composition_.GetString();
   TransformCharactersForNumbers(&output);
   // If the input field type needs half ascii characters,
@@ -748,6 +806,15 @@ std::string Composer::GetStringForSubmission() const {
 }
 
 std::string Composer::GetQueryForConversion() const {
+  ResetQueryCacheIfStale();
+  if (!query_cache_.has_conversion) {
+    query_cache_.conversion = BuildQueryForConversion();
+    query_cache_.has_conversion = true;
+  }
+  return query_cache_.conversion;
+}
+
+std::string Composer::BuildQueryForConversion() const {
   std::string base_output = composition_.GetStringWithTrimMode(FIX);
   TransformCharactersForNumbers(&base_output);
   return japanese_util::FullWidthAsciiToHalfWidthAscii(base_output);
@@ -812,6 +879,15 @@ std::string *GetBaseQueryForPrediction(std::string *asis_query,
 }  // namespace
 
 std::string Composer::GetQueryForPrediction() const {
+  ResetQueryCacheIfStale();
+  if (!query_cache_.has_prediction) {
+    query_cache_.prediction = BuildQueryForPrediction();
+    query_cache_.has_prediction = true;
+  }
+  return query_cache_.prediction;
+}
+
+std::string Composer::BuildQueryForPrediction() const {
   std::string asis_query = composition_.GetStringWithTrimMode(ASIS);
 
   switch (input_mode_) {
@@ -840,32 +916,58 @@ std::string Composer::GetQueryForPrediction() const {
   return japanese_util::FullWidthAsciiToHalfWidthAscii(*base_query);
 }
 
-void Composer::GetQueriesForPrediction(std::string *base,
-                                       std::set<std::string> *expanded) const {
-  DCHECK(base);
-  DCHECK(expanded);
+const Composer::PredictionQueries &Composer::GetQueriesForPrediction() const {
+  ResetQueryCacheIfStale();
+  if (!query_cache_.has_prediction_queries) {
+    BuildQueriesForPrediction(&query_cache_.expansion_prefix,
+                              &query_cache_.prediction_queries);
+    query_cache_.has_prediction_queries = true;
+  }
+  return query_cache_.prediction_queries;
+}
+
+void Composer::BuildQueriesForPrediction(Composition::ExpansionPrefix *prefix,
+                                         PredictionQueries *queries) const {
   // In case of the Latin input modes, we don't perform expansion.
   switch (input_mode_) {
     case transliteration::HALF_ASCII:
     case transliteration::FULL_ASCII: {
-      *base = GetQueryForPrediction();
-      expanded->clear();
+      queries->base = BuildQueryForPrediction();
+      queries->expanded.clear();
       return;
     }
     default: {
     }
   }
-  std::string base_query;
-  composition_.GetExpandedStrings(&base_query, expanded);
-  // The above `GetExpandedStrings` generates expansion for modifier key as
-  // well, e.g., if the composition is "ざ", `expanded` contains "さ" too.
-  // However, "ざ" is usually composed by explicitly hitting the modifier key.
-  // So we don't want to generate prediction from "さ" in this case. The
+  std::string base_query, asis;
+  composition_.GetExpandedStringsWithPrefix(prefix, &base_query, &asis,
+                                            &queries->expanded);
+  // The above `GetExpandedStringsWithPrefix` generates expansion for modifier
+  // key as well, e.g., if the composition is "ざ", `expanded` contains "さ"
+  // too. However, "ざ" is usually composed by explicitly hitting the modifier
+  // key. So we don't want to generate prediction from "さ" in this case. The
   // following code removes such unnecessary expansion.
-  const std::string asis = composition_.GetStringWithTrimMode(ASIS);
-  RemoveExpandedCharsForModifier(asis, base_query, expanded);
+  RemoveExpandedCharsForModifier(asis, base_query, &queries->expanded);
+
+  queries->base = japanese_util::FullWidthAsciiToHalfWidthAscii(base_query);
+}
 
-  *base = japanese_util::FullWidthAsciiToHalfWidthAscii(base_query);
+void Composer::ResetQueryCacheIfStale() const {
+  if (query_cache_.revision == composition_.revision() &&
+      query_cache_.input_mode == input_mode_ &&
+      query_cache_.input_field_type == input_field_type_) {
+    return;
+  }
+  // The prefix depends only on the chunks, which are kept by appending.
+  Composition::ExpansionPrefix expansion_prefix;
+  if (composition_.edit_revision() <= query_cache_.revision) {
+    expansion_prefix = std::move(query_cache_.expansion_prefix);
+  }
+  query_cache_ = QueryCache();
+  query_cache_.expansion_prefix = std::move(expansion_prefix);
+  query_cache_.revision = composition_.revision();
+  query_cache_.input_mode = input_mode_;
+  query_cache_.input_field_type = input_field_type_;
 }
 
 std::string Composer::GetStringForTypeCorrection() const {
@@ -1246,5 +1348,98 @@ void Composer::SetInputFieldType(commands::Context::InputFieldType type) {
 commands::Context::InputFieldType Composer::GetInputFieldType() const {
   return input_field_type_;
 }
+
+std::string Composer::SerializeAsString() const {
+  std::string output;
+  AppendVarint(position_, &output);
+  AppendVarint(input_mode_, &output);
+  AppendVarint(output_mode_, &output);
+  AppendVarint(comeback_input_mode_, &output);
+  AppendVarint(input_field_type_, &output);
+  AppendVarint(shifted_sequence_count_, &output);
+  AppendString(source_text_, &output);
+  AppendVarint(max_length_, &output);
+  AppendVarint(static_cast<uint64_t>(timestamp_msec_), &output);
+  AppendVarint(static_cast<uint32_t>(timeout_threshold_msec_), &output);
+  AppendVarint(is_new_input_, &output);
+  AppendVarint(compositions_for_handwriting_.size(), &output);
+  for (const commands::SessionCommand::CompositionEvent &composition :
+       compositions_for_handwriting_) {
+    AppendString(composition.SerializeAsString(), &output);
+  }
+  AppendVarint(composition_.input_t12r(), &output);
+  AppendVarint(composition_.chunks().size(), &output);
+  for (const CharChunk &chunk : composition_.chunks()) {
+    AppendVarint(chunk.transliterator(), &output);
+    AppendVarint(chunk.attributes(), &output);
+    AppendString(chunk.raw(), &output);
+    AppendString(chunk.conversion(), &output);
+    AppendString(chunk.pending(), &output);
+    AppendString(chunk.ambiguous(), &output);
+  }
+  return output;
+}
+
+bool Composer::ParseFromString(absl::string_view data) {
+  Composer composer(table_, request_, config_);
+  uint64_t size = 0;
+  absl::string_view value;
+  if (!ReadInteger(&data, &composer.position_) ||
+      !ReadInteger(&data, &composer.input_mode_) ||
+      !ReadInteger(&data, &composer.output_mode_) ||
+      !ReadInteger(&data, &composer.comeback_input_mode_) ||
+      !ReadInteger(&data, &composer.input_field_type_) ||
+      !ReadInteger(&data, &composer.shifted_sequence_count_) ||
+      !ReadString(&data, &value)) {
+    return false;
+  }
+  composer.source_text_.assign(value.data(), value.size());
+  uint32_t timeout_threshold_msec = 0;
+  if (!ReadInteger(&data, &composer.max_length_) ||
+      !ReadInteger(&data, &composer.timestamp_msec_) ||
+      !ReadInteger(&data, &timeout_threshold_msec) ||
+      !ReadInteger(&data, &composer.is_new_input_) ||
+      !ReadVarint(&data, &size)) {
+    return false;
+  }
+  composer.timeout_threshold_msec_ = static_cast<int>(timeout_threshold_msec);
+  for (uint64_t i = 0; i < size; ++i) {
+    if (!ReadString(&data, &value) ||
+        !composer.compositions_for_handwriting_.emplace_back().ParseFromArray(
+            value.data(), value.size())) {
+      return false;
+    }
+  }
+
+  Transliterators::Transliterator t12r = Transliterators::CONVERSION_STRING;
+  if (!ReadInteger(&data, &t12r) || !ReadVarint(&data, &size) ||
+      t12r >= Transliterators::NUM_OF_TRANSLITERATOR) {
+    return false;
+  }
+  composer.composition_.SetInputMode(t12r);
+  for (uint64_t i = 0; i < size; ++i) {
+    TableAttributes attributes = NO_TABLE_ATTRIBUTE;
+    absl::string_view raw, conversion, pending, ambiguous;
+    if (!ReadInteger(&data, &t12r) || !ReadInteger(&data, &attributes) ||
+        !ReadString(&data, &raw) || !ReadString(&data, &conversion) ||
+        !ReadString(&data, &pending) || !ReadString(&data, &ambiguous) ||
+        t12r >= Transliterators::LOCAL) {
+      return false;
+    }
+    CharChunk &chunk = *composer.composition_.InsertChunk(
+        composer.composition_.chunks().end());
+    chunk.SetTransliterator(t12r);
+    chunk.set_attributes(attributes);
+    chunk.set_raw(raw);
+    chunk.set_conversion(conversion);
+    chunk.set_pending(pending);
+    chunk.set_ambiguous(ambiguous);
+  }
+  if (!data.empty() || composer.position_ > composer.GetLength()) {
+    return false;
+  }
+  *this = std::move(composer);
+  return true;
+}
 }  // namespace composer
 }  // namespace mozc
@@ -34,10 +34,10 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <set>
 #include <string>
 #include <vector>
 
+#include "absl/container/btree_set.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "composer/internal/composition.h"
@@ -125,9 +125,15 @@ class Composer final {
   // Returns a prediction query trimmed the tail alphabet characters.
   std::string GetQueryForPrediction() const;
 
-  // Returns a expanded prediction query.
-  void GetQueriesForPrediction(std::string *base,
-                               std::set<std::string> *expanded) const;
+  // Expanded prediction queries. For the composition "あk", `base` is "あ"
+  // and `expanded` has "か", "き", etc.
+  struct PredictionQueries {
+    std::string base;
+    absl::btree_set<std::string> expanded;
+  };
+  // Returns the expanded prediction queries. The reference is valid until
+  // this composer is modified.
+  const PredictionQueries &GetQueriesForPrediction() const;
 
   // Returns a string to be used for type correction.
   std::string GetStringForTypeCorrection() const;
@@ -253,6 +259,14 @@ class Composer final {
   int timeout_threshold_msec() const;
   void set_timeout_threshold_msec(int threshold_msec);
 
+  // Serializes the composition and the modes into a compact string. The
+  // table, the request and the config are not included.
+  std::string SerializeAsString() const;
+  // Restores the state serialized by SerializeAsString(), keeping the table,
+  // the request and the config of this composer. Returns false and leaves
+  // this composer unchanged if |data| is malformed.
+  bool ParseFromString(absl::string_view data);
+
  private:
   FRIEND_TEST(ComposerTest, ApplyTemporaryInputMode);
 
@@ -269,6 +283,21 @@ class Composer final {
   std::string GetTransliteratedText(Transliterators::Transliterator t12r,
                                     size_t position, size_t size) const;
 
+  // Build the strings returned by GetStringForPreedit(),
+  // GetQueryForConversion(), GetQueryForPrediction() and
+  // GetQueriesForPrediction() from the composition.
+  std::string BuildStringForPreedit() const;
+  std::string BuildQueryForConversion() const;
+  std::string BuildQueryForPrediction() const;
+  void BuildQueriesForPrediction(Composition::ExpansionPrefix *prefix,
+                                 PredictionQueries *queries) const;
+
+  // Drops the entries of query_cache_ if the composition or the modes are
+  // changed since they were built. Each entry is then rebuilt by its getter
+  // on the first call, so the mutators themselves never build the strings.
+  // The expansion prefix is kept while characters are only appended.
+  void ResetQueryCacheIfStale() const;
+
   size_t position_;
   transliteration::TransliterationType input_mode_;
   transliteration::TransliterationType output_mode_;
@@ -310,6 +339,29 @@ class Composer final {
   // Please refer to commands.proto
   std::vector<commands::SessionCommand::CompositionEvent>
       compositions_for_handwriting_;
+
+  // The strings derived from the composition, which are requested several
+  // times per key event by the session, the converter and the predictors.
+  // The const getters fill it on demand, so Composer is not safe to query
+  // from several threads at once.
+  struct QueryCache {
+    // The state from which the strings below are built.
+    size_t revision = 0;
+    transliteration::TransliterationType input_mode = transliteration::HIRAGANA;
+    commands::Context::InputFieldType input_field_type =
+        commands::Context::NORMAL;
+
+    bool has_preedit = false;
+    bool has_conversion = false;
+    bool has_prediction = false;
+    bool has_prediction_queries = false;
+    std::string preedit;
+    std::string conversion;
+    std::string prediction;
+    PredictionQueries prediction_queries;
+    Composition::ExpansionPrefix expansion_prefix;
+  };
+  mutable QueryCache query_cache_;
 };
 
 }  // namespace composer
@@ -33,7 +33,6 @@
 #include <cstdint>
 #include <iterator>
 #include <memory>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -48,6 +47,7 @@
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "testing/gmock.h"
 #include "testing/gunit.h"
 #include "transliteration/transliteration.h"
 
@@ -59,6 +59,7 @@ using ::mozc::commands::KeyEvent;
 using ::mozc::commands::Request;
 using ::mozc::config::CharacterFormManager;
 using ::mozc::config::Config;
+using ::testing::ElementsAre;
 
 bool InsertKey(const absl::string_view key_string, Composer *composer) {
   commands::KeyEvent key;
@@ -481,11 +482,9 @@ TEST_F(ComposerTest, GetQueriesForPredictionRoman) {
   table_->AddRule("so", "そ", "");
 
   {
-    std::string base;
-    std::set<std::string> expanded;
     composer_->EditErase();
     composer_->InsertCharacter("us");
-    composer_->GetQueriesForPrediction(&base, &expanded);
+    const auto &[base, expanded] = composer_->GetQueriesForPrediction();
     composer_->GetStringForPreedit();
     EXPECT_EQ(base, "う");
     EXPECT_EQ(expanded.size(), 7);
@@ -500,6 +499,74 @@ TEST_F(ComposerTest, GetQueriesForPredictionRoman) {
   }
 }
 
+TEST_F(ComposerTest, QueriesFollowModifications) {
+  table_->AddRule("ka", "か", "");
+  table_->AddRule("ga", "が", "");
+  table_->AddRule("n", "ん", "");
+  table_->AddRule("na", "な", "");
+
+  composer_->InsertCharacter("kan");
+  EXPECT_EQ(composer_->GetStringForPreedit(), "かｎ");
+  EXPECT_EQ(composer_->GetQueryForConversion(), "かん");
+  EXPECT_EQ(composer_->GetQueryForPrediction(), "か");
+
+  // The copy keeps its own queries.
+  Composer copied = *composer_;
+  copied.InsertCharacter("ga");
+  EXPECT_EQ(copied.GetStringForPreedit(), "かんが");
+  EXPECT_EQ(copied.GetQueryForPrediction(), "かんが");
+  EXPECT_EQ(composer_->GetStringForPreedit(), "かｎ");
+  EXPECT_EQ(composer_->GetQueryForPrediction(), "か");
+
+  composer_->Backspace();
+  EXPECT_EQ(composer_->GetStringForPreedit(), "か");
+  EXPECT_EQ(composer_->GetQueryForConversion(), "か");
+
+  composer_->InsertCharacter("g");
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "か");
+  EXPECT_THAT(composer_->GetQueriesForPrediction().expanded,
+              ElementsAre("g", "が"));
+
+  // The input mode and the field type affect the queries too.
+  composer_->SetInputMode(transliteration::HALF_ASCII);
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
+  composer_->SetInputFieldType(commands::Context::PASSWORD);
+  EXPECT_EQ(composer_->GetStringForPreedit(), "かg");
+
+  composer_->EditErase();
+  EXPECT_EQ(composer_->GetStringForPreedit(), "");
+  EXPECT_EQ(composer_->GetQueryForPrediction(), "");
+}
+
+TEST_F(ComposerTest, QueriesForPredictionAfterAppending) {
+  table_->AddRule("ka", "か", "");
+  table_->AddRule("ga", "が", "");
+  table_->AddRule("n", "ん", "");
+  table_->AddRule("na", "な", "");
+
+  composer_->InsertCharacter("ka");
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "か");
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
+
+  composer_->InsertCharacter("ng");
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "かん");
+  EXPECT_THAT(composer_->GetQueriesForPrediction().expanded,
+              ElementsAre("g", "が"));
+
+  composer_->InsertCharacter("a");
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "かんが");
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
+
+  // The insertion before the end is not an append.
+  composer_->MoveCursorToBeginning();
+  composer_->InsertCharacter("ka");
+  composer_->MoveCursorToEnd();
+  composer_->InsertCharacter("g");
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "かかんが");
+  EXPECT_THAT(composer_->GetQueriesForPrediction().expanded,
+              ElementsAre("g", "が"));
+}
+
 TEST_F(ComposerTest, GetQueriesForPredictionMobile) {
   table_->AddRule("_", "", "い");
   table_->AddRule("い*", "", "ぃ");
@@ -513,11 +580,9 @@ TEST_F(ComposerTest, GetQueriesForPredictionMobile) {
   table_->AddRule("づ*", "", "つ");
 
   {
-    std::string base;
-    std::set<std::string> expanded;
     composer_->EditErase();
     composer_->InsertCharacter("_$");
-    composer_->GetQueriesForPrediction(&base, &expanded);
+    const auto &[base, expanded] = composer_->GetQueriesForPrediction();
     composer_->GetStringForPreedit();
     EXPECT_EQ(base, "い");
     EXPECT_EQ(expanded.size(), 2);
@@ -525,22 +590,18 @@ TEST_F(ComposerTest, GetQueriesForPredictionMobile) {
     EXPECT_TRUE(expanded.end() != expanded.find("ど"));
   }
   {
-    std::string base;
-    std::set<std::string> expanded;
     composer_->EditErase();
     composer_->InsertCharacter("_$*");
-    composer_->GetQueriesForPrediction(&base, &expanded);
+    const auto &[base, expanded] = composer_->GetQueriesForPrediction();
     composer_->GetStringForPreedit();
     EXPECT_EQ(base, "い");
     EXPECT_EQ(expanded.size(), 1);
     EXPECT_TRUE(expanded.end() != expanded.find("ど"));
   }
   {
-    std::string base;
-    std::set<std::string> expanded;
     composer_->EditErase();
     composer_->InsertCharacter("_x*");
-    composer_->GetQueriesForPrediction(&base, &expanded);
+    const auto &[base, expanded] = composer_->GetQueriesForPrediction();
     composer_->GetStringForPreedit();
     EXPECT_EQ(base, "い");
     EXPECT_EQ(expanded.size(), 1);
@@ -559,18 +620,17 @@ TEST_F(ComposerTest, Issue277163340) {
   // bug in composer/internal/char_chunk.cc and it
   // caused the process to crash.
   table_->AddRuleWithAttributes("[", "", "", NO_TRANSLITERATION);
-  std::string base, asis, preedit;
-  std::set<std::string> expanded;
   commands::KeyEvent key;
   key.set_key_string("[]");
   key.set_input_style(commands::KeyEvent::AS_IS);
   composer_->InsertCharacterKeyEvent(key);
   composer_->InsertCharacterKeyEvent(key);
   composer_->InsertCommandCharacter(composer::Composer::STOP_KEY_TOGGLING);
-  composer_->GetQueriesForPrediction(&base, &expanded);
+  const Composer::PredictionQueries &queries =
+      composer_->GetQueriesForPrediction();
 
   // Never reached here due to the crash before the fix for b/277163340.
-  EXPECT_EQ(base, "[][]");
+  EXPECT_EQ(queries.base, "[][]");
 }
 
 // Emulates tapping "[]" key twice without enough internval.
@@ -1125,6 +1185,34 @@ TEST_F(ComposerTest, Copy) {
   }
 }
 
+TEST_F(ComposerTest, SerializeAndParse) {
+  table_->AddRule("a", "あ", "");
+  table_->AddRule("n", "ん", "");
+  table_->AddRule("na", "な", "");
+
+  composer_->InsertCharacter("a");
+  composer_->InsertCharacter("n");
+  InsertKey("A", composer_.get());
+  composer_->MoveCursorLeft();
+  composer_->set_source_text("source");
+  EXPECT_EQ(composer_->GetInputMode(), transliteration::HALF_ASCII);
+
+  const std::string data = composer_->SerializeAsString();
+  Composer dest(table_.get(), request_.get(), config_.get());
+  EXPECT_TRUE(dest.ParseFromString(data));
+  ExpectSameComposer(*composer_, dest);
+  EXPECT_EQ(dest.SerializeAsString(), data);
+
+  // The next input continues the restored composition.
+  composer_->InsertCharacter("a");
+  dest.InsertCharacter("a");
+  ExpectSameComposer(*composer_, dest);
+
+  // A truncated string is rejected.
+  EXPECT_FALSE(dest.ParseFromString(data.substr(0, data.size() - 1)));
+  ExpectSameComposer(*composer_, dest);
+}
+
 TEST_F(ComposerTest, ShiftKeyOperation) {
   commands::KeyEvent key;
   table_->AddRule("a", "あ", "");
@@ -2533,13 +2621,11 @@ TEST_F(ComposerTest, InsertCharacterPreedit) {
   constexpr char kTestStr[] = "ああaｋka。";
 
   {
-    std::string base;
-    std::set<std::string> expanded;
     composer_->InsertCharacterPreedit(kTestStr);
     std::string preedit = composer_->GetStringForPreedit();
     std::string conversion_query = composer_->GetQueryForConversion();
     std::string prediction_query = composer_->GetQueryForPrediction();
-    composer_->GetQueriesForPrediction(&base, &expanded);
+    const std::string &base = composer_->GetQueriesForPrediction().base;
     EXPECT_FALSE(preedit.empty());
     EXPECT_FALSE(conversion_query.empty());
     EXPECT_FALSE(prediction_query.empty());
@@ -2547,8 +2633,6 @@ TEST_F(ComposerTest, InsertCharacterPreedit) {
   }
   composer_->Reset();
   {
-    std::string base;
-    std::set<std::string> expanded;
     std::vector<std::string> chars;
     Util::SplitStringToUtf8Chars(kTestStr, &chars);
     for (size_t i = 0; i < chars.size(); ++i) {
@@ -2557,7 +2641,7 @@ TEST_F(ComposerTest, InsertCharacterPreedit) {
     std::string preedit = composer_->GetStringForPreedit();
     std::string conversion_query = composer_->GetQueryForConversion();
     std::string prediction_query = composer_->GetQueryForPrediction();
-    composer_->GetQueriesForPrediction(&base, &expanded);
+    const std::string &base = composer_->GetQueriesForPrediction().base;
     EXPECT_FALSE(preedit.empty());
     EXPECT_FALSE(conversion_query.empty());
     EXPECT_FALSE(prediction_query.empty());
@@ -2587,9 +2671,6 @@ TEST_F(ComposerTest, GetRawString) {
 }
 
 TEST_F(ComposerTest, SetPreeditTextForTestOnly) {
-  std::string output;
-  std::set<std::string> expanded;
-
   composer_->SetPreeditTextForTestOnly("も");
 
   EXPECT_EQ(composer_->GetInputMode(), transliteration::HIRAGANA);
@@ -2598,9 +2679,8 @@ TEST_F(ComposerTest, SetPreeditTextForTestOnly) {
   EXPECT_EQ(composer_->GetQueryForConversion(), "も");
   EXPECT_EQ(composer_->GetQueryForPrediction(), "も");
 
-  composer_->GetQueriesForPrediction(&output, &expanded);
-  EXPECT_EQ(output, "も");
-  EXPECT_TRUE(expanded.empty());
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "も");
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
 
   composer_->Reset();
 
@@ -2612,10 +2692,8 @@ TEST_F(ComposerTest, SetPreeditTextForTestOnly) {
   EXPECT_EQ(composer_->GetQueryForConversion(), "mo");
   EXPECT_EQ(composer_->GetQueryForPrediction(), "mo");
 
-  composer_->GetQueriesForPrediction(&output, &expanded);
-  EXPECT_EQ(output, "mo");
-
-  EXPECT_TRUE(expanded.empty());
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "mo");
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
 
   composer_->Reset();
 
@@ -2627,10 +2705,8 @@ TEST_F(ComposerTest, SetPreeditTextForTestOnly) {
   EXPECT_EQ(composer_->GetQueryForConversion(), "m");
   EXPECT_EQ(composer_->GetQueryForPrediction(), "m");
 
-  composer_->GetQueriesForPrediction(&output, &expanded);
-  EXPECT_EQ(output, "m");
-
-  EXPECT_TRUE(expanded.empty());
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "m");
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
 
   composer_->Reset();
 
@@ -2643,10 +2719,8 @@ TEST_F(ComposerTest, SetPreeditTextForTestOnly) {
   EXPECT_EQ(composer_->GetQueryForConversion(), "もz");
   EXPECT_EQ(composer_->GetQueryForPrediction(), "もz");
 
-  composer_->GetQueriesForPrediction(&output, &expanded);
-  EXPECT_EQ(output, "もz");
-
-  EXPECT_TRUE(expanded.empty());
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "もz");
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
 }
 
 TEST_F(ComposerTest, IsToggleable) {
@@ -2952,10 +3026,7 @@ TEST_F(ComposerTest, NBforeN_WithFullWidth) {
   EXPECT_EQ(focused, "ｎ");
   EXPECT_EQ(right, "");
 
-  std::string queries_base;
-  std::set<std::string> queries_expanded;
-  composer_->GetQueriesForPrediction(&queries_base, &queries_expanded);
-  EXPECT_EQ(queries_base, "あn");
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "あn");
 
   EXPECT_EQ(composer_->GetQueryForPrediction(), "あnn");
 
@@ -2999,10 +3070,7 @@ TEST_F(ComposerTest, NBforeN_WithHalfWidth) {
   EXPECT_EQ(focused, "n");
   EXPECT_EQ(right, "");
 
-  std::string queries_base;
-  std::set<std::string> queries_expanded;
-  composer_->GetQueriesForPrediction(&queries_base, &queries_expanded);
-  EXPECT_EQ(queries_base, "あn");
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "あn");
 
   EXPECT_EQ(composer_->GetQueryForPrediction(), "あnn");
 
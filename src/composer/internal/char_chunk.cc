@@ -30,7 +30,6 @@
 #include "composer/internal/char_chunk.h"
 
 #include <cstddef>
-#include <set>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -224,7 +223,8 @@ void CharChunk::AppendFixedResult(Transliterators::Transliterator t12r,
 //
 // What we want to append here is the 'looped rule' in |kMaxRecursion| lookup.
 // Here, '{*}ぁ' -> '{*}あ' -> '{*}ぁ' is the loop.
-void CharChunk::GetExpandedResults(std::set<std::string> *results) const {
+void CharChunk::GetExpandedResults(
+    absl::btree_set<std::string> *results) const {
   DCHECK(results);
 
   if (pending_.empty()) {
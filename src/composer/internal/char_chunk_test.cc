@@ -30,10 +30,10 @@
 #include "composer/internal/char_chunk.h"
 
 #include <cstddef>
-#include <set>
 #include <string>
 #include <utility>
 
+#include "absl/container/btree_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "composer/internal/composition_input.h"
@@ -1693,7 +1693,8 @@ TEST(CharChunkTest, NoTransliterationAttributeForInputAndConvertedChar) {
 }
 
 namespace {
-bool HasResult(const std::set<std::string> &results, const std::string &value) {
+bool HasResult(const absl::btree_set<std::string> &results,
+               const std::string &value) {
   return (results.find(value) != results.end());
 }
 }  // namespace
@@ -1720,7 +1721,7 @@ TEST(CharChunkTest, RomanGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "か");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 0);  // no ambiguity
   }
@@ -1732,7 +1733,7 @@ TEST(CharChunkTest, RomanGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 12);
     EXPECT_TRUE(HasResult(results, "k"));
@@ -1756,7 +1757,7 @@ TEST(CharChunkTest, RomanGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 6);
     EXPECT_TRUE(HasResult(results, "ky"));
@@ -1774,7 +1775,7 @@ TEST(CharChunkTest, RomanGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "っ");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 11);
     EXPECT_TRUE(HasResult(results, "か"));    // ka
@@ -1805,7 +1806,7 @@ TEST(CharChunkTest, KanaGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 2);
     EXPECT_TRUE(HasResult(results, "か"));
@@ -1819,7 +1820,7 @@ TEST(CharChunkTest, KanaGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 3);
     EXPECT_TRUE(HasResult(results, "は"));
@@ -1842,7 +1843,7 @@ TEST(CharChunkTest, 12KeyGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 2);
     EXPECT_TRUE(HasResult(results, "あ"));
@@ -1856,7 +1857,7 @@ TEST(CharChunkTest, 12KeyGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 2);
     EXPECT_TRUE(HasResult(results, "や"));
@@ -1870,7 +1871,7 @@ TEST(CharChunkTest, 12KeyGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 2);
     EXPECT_TRUE(HasResult(results, "ゆ"));
@@ -1884,7 +1885,7 @@ TEST(CharChunkTest, 12KeyGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 3);
     EXPECT_TRUE(HasResult(results, "は"));
@@ -1907,7 +1908,7 @@ TEST(CharChunkTest, FlickGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 2);
     EXPECT_TRUE(HasResult(results, "あ"));
@@ -1921,7 +1922,7 @@ TEST(CharChunkTest, FlickGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 2);
     EXPECT_TRUE(HasResult(results, "や"));
@@ -1935,7 +1936,7 @@ TEST(CharChunkTest, FlickGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 2);
     EXPECT_TRUE(HasResult(results, "ゆ"));
@@ -1949,7 +1950,7 @@ TEST(CharChunkTest, FlickGetExpandedResults) {
     chunk.AppendTrimedResult(Transliterators::LOCAL, &base);
     EXPECT_EQ(base, "");
 
-    std::set<std::string> results;
+    absl::btree_set<std::string> results;
     chunk.GetExpandedResults(&results);
     EXPECT_EQ(results.size(), 3);
     EXPECT_TRUE(HasResult(results, "は"));
@@ -29,13 +29,14 @@
 
 #include "composer/internal/composition.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <iterator>
-#include <set>
 #include <string>
 #include <utility>
 
 #include "absl/algorithm/container.h"
+#include "absl/container/btree_set.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
@@ -52,7 +53,10 @@
 namespace mozc {
 namespace composer {
 
-void Composition::Erase() { chunks_.clear(); }
+void Composition::Erase() {
+  chunks_.clear();
+  edit_revision_ = ++revision_;
+}
 
 size_t Composition::InsertAt(size_t pos, std::string input) {
   CompositionInput composition_input;
@@ -72,6 +76,9 @@ size_t Composition::InsertInput(size_t pos, CompositionInput input) {
   if (input.Empty()) {
     return pos;
   }
+  const bool is_append = pos >= GetLength();
+  const size_t edit_revision = edit_revision_;
+  ++revision_;
 
   CharChunkList::iterator right_chunk = MaybeSplitChunkAt(pos);
   while (right_chunk != chunks_.end() &&
@@ -79,26 +86,31 @@ size_t Composition::InsertInput(size_t pos, CompositionInput input) {
     ++right_chunk;
   }
 
+  // The insertions and the erasures below invalidate the iterators, but the
+  // right chunk always stays next to the left chunk.
   CharChunkList::iterator left_chunk = GetInsertionChunk(right_chunk);
-
-  CombinePendingChunks(left_chunk, input);
+  left_chunk = CombinePendingChunks(left_chunk, input);
 
   while (true) {
     left_chunk->AddCompositionInput(&input);
     if (input.Empty()) {
       break;
     }
-    left_chunk = InsertChunk(right_chunk);
+    left_chunk = InsertChunk(std::next(left_chunk));
     input.set_is_new_input(false);
   }
 
   // If the chunk is empty as the result of AddCompositionInput above, removes
   // the empty chunk.
+  right_chunk = std::next(left_chunk);
   if (left_chunk->raw().empty() && left_chunk->conversion().empty() &&
       left_chunk->pending().empty()) {
-    chunks_.erase(left_chunk);
+    right_chunk = chunks_.erase(left_chunk);
   }
 
+  // The helpers above mark their modifications as edits, but they only
+  // touched the chunks with pending input at the end.
+  edit_revision_ = is_append ? edit_revision : revision_;
   return GetPosition(Transliterators::LOCAL, right_chunk);
 }
 
@@ -106,6 +118,7 @@ size_t Composition::InsertInput(size_t pos, CompositionInput input) {
 size_t Composition::DeleteAt(const size_t position) {
   const size_t original_size = GetLength();
   size_t new_position = position;
+  edit_revision_ = ++revision_;
   // We have to perform deletion repeatedly because there might be 0-length
   // chunk.
   // For example,
@@ -206,6 +219,7 @@ void Composition::SetTransliterator(
   if (chunks_.empty()) {
     return;
   }
+  edit_revision_ = ++revision_;
 
   size_t inner_position_from;
   auto chunk_it =
@@ -268,14 +282,14 @@ std::string Composition::GetStringWithModes(
   return composition;
 }
 
-void Composition::GetExpandedStrings(std::string *base,
-                                     std::set<std::string> *expanded) const {
+void Composition::GetExpandedStrings(
+    std::string *base, absl::btree_set<std::string> *expanded) const {
   GetExpandedStringsWithTransliterator(Transliterators::LOCAL, base, expanded);
 }
 
 void Composition::GetExpandedStringsWithTransliterator(
     Transliterators::Transliterator transliterator, std::string *base,
-    std::set<std::string> *expanded) const {
+    absl::btree_set<std::string> *expanded) const {
   DCHECK(base);
   DCHECK(expanded);
   base->clear();
@@ -295,6 +309,49 @@ void Composition::GetExpandedStringsWithTransliterator(
   chunks_.back().GetExpandedResults(expanded);
 }
 
+void Composition::GetExpandedStringsWithPrefix(
+    ExpansionPrefix *prefix, std::string *base, std::string *asis,
+    absl::btree_set<std::string> *expanded) const {
+  DCHECK(prefix);
+  DCHECK(base);
+  DCHECK(asis);
+  DCHECK(expanded);
+  base->clear();
+  asis->clear();
+  expanded->clear();
+  if (chunks_.empty()) {
+    *prefix = ExpansionPrefix();
+    return;
+  }
+
+  // The chunks up to the last one without pending input are kept by the
+  // insertions at the end, except the last chunk whose result is trimmed.
+  size_t prefix_size = 0;
+  for (auto it = chunks_.rbegin(); it != chunks_.rend(); ++it) {
+    if (it->pending().empty()) {
+      prefix_size = std::distance(it, chunks_.rend());
+      break;
+    }
+  }
+  prefix_size = std::min(prefix_size, chunks_.size() - 1);
+  if (prefix->size > prefix_size) {
+    *prefix = ExpansionPrefix();
+  }
+
+  auto it = std::next(chunks_.begin(), prefix->size);
+  for (; prefix->size < prefix_size; ++prefix->size, ++it) {
+    it->AppendResult(Transliterators::LOCAL, &prefix->result);
+  }
+  *base = prefix->result;
+  for (; it != std::prev(chunks_.end()); ++it) {
+    it->AppendResult(Transliterators::LOCAL, base);
+  }
+  *asis = *base;
+  chunks_.back().AppendTrimedResult(Transliterators::LOCAL, base);
+  chunks_.back().AppendResult(Transliterators::LOCAL, asis);
+  chunks_.back().GetExpandedResults(expanded);
+}
+
 std::string Composition::GetString() const {
   if (chunks_.empty()) {
     MOZC_VLOG(1) << "The composition size is zero.";
@@ -375,6 +432,7 @@ size_t Composition::GetPosition(Transliterators::Transliterator transliterator,
 // Return the iterator to the right side CharChunk at the `position`.
 // If the `position` is in the middle of a CharChunk, that CharChunk is split.
 CharChunkList::iterator Composition::MaybeSplitChunkAt(const size_t position) {
+  edit_revision_ = ++revision_;
   size_t inner_position;
   CharChunkList::iterator it =
       GetChunkAt(position, Transliterators::LOCAL, &inner_position);
@@ -390,17 +448,18 @@ CharChunkList::iterator Composition::MaybeSplitChunkAt(const size_t position) {
   absl::StatusOr<CharChunk> left_chunk =
       chunk.SplitChunk(Transliterators::LOCAL, inner_position);
   if (left_chunk.ok()) {
-    chunks_.insert(it, *std::move(left_chunk));
+    it = std::next(chunks_.insert(it, *std::move(left_chunk)));
   }
   return it;
 }
 
-void Composition::CombinePendingChunks(CharChunkList::iterator it,
-                                       const CompositionInput &input) {
+CharChunkList::iterator Composition::CombinePendingChunks(
+    CharChunkList::iterator it, const CompositionInput &input) {
   // If the input is asis, pending chunks are not related with this input.
   if (input.is_asis()) {
-    return;
+    return it;
   }
+  edit_revision_ = ++revision_;
   // Combine |**it| and |**(--it)| into |**it| as long as possible.
   const absl::string_view next_input =
       input.conversion().empty() ? input.raw() : input.conversion();
@@ -410,17 +469,20 @@ void Composition::CombinePendingChunks(CharChunkList::iterator it,
     --left_it;
     if (!left_it->IsConvertible(input_t12r_, table_,
                                 absl::StrCat(it->pending(), next_input))) {
-      return;
+      return it;
     }
 
     it->Combine(*left_it);
-    chunks_.erase(left_it);
+    // The combined chunk moves to the position of the erased one.
+    it = chunks_.erase(left_it);
   }
+  return it;
 }
 
 // Insert a chunk to the prev of it.
 CharChunkList::iterator Composition::InsertChunk(
     CharChunkList::const_iterator it) {
+  edit_revision_ = ++revision_;
   return chunks_.insert(it, CharChunk(input_t12r_, table_));
 }
 
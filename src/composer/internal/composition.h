@@ -31,11 +31,11 @@
 #define MOZC_COMPOSER_INTERNAL_COMPOSITION_H_
 
 #include <cstddef>
-#include <list>
-#include <set>
 #include <string>
 #include <tuple>
+#include <vector>
 
+#include "absl/container/btree_set.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "composer/internal/char_chunk.h"
@@ -46,7 +46,10 @@
 namespace mozc {
 namespace composer {
 
-using CharChunkList = std::list<CharChunk>;
+// The chunks are stored contiguously, so that the scan of the chunks on each
+// key event and the copy of the composition are cheap. Note that inserting or
+// erasing a chunk invalidates the iterators at and after it.
+using CharChunkList = std::vector<CharChunk>;
 
 enum TrimMode {
   TRIM,  // "かn" => "か"
@@ -130,10 +133,24 @@ class Composition final {
   std::string GetStringWithTrimMode(TrimMode trim_mode) const;
   // Get string with consideration for ambiguity from pending input
   void GetExpandedStrings(std::string *base,
-                          std::set<std::string> *expanded) const;
+                          absl::btree_set<std::string> *expanded) const;
   void GetExpandedStringsWithTransliterator(
       Transliterators::Transliterator transliterator, std::string *base,
-      std::set<std::string> *expanded) const;
+      absl::btree_set<std::string> *expanded) const;
+
+  // The string of the leading chunks which GetExpandedStrings() can reuse
+  // after insertions at the end of the composition. See edit_revision().
+  struct ExpansionPrefix {
+    size_t size = 0;     // The number of the chunks.
+    std::string result;  // The string of the chunks.
+  };
+  // Same as GetExpandedStrings(), but reuses `prefix` and extends it up to the
+  // last chunk without pending input. `prefix` must have been extended by
+  // this method for the same composition since edit_revision(), or be empty.
+  // `asis` is set to the same string as GetStringWithTrimMode(ASIS).
+  void GetExpandedStringsWithPrefix(
+      ExpansionPrefix *prefix, std::string *base, std::string *asis,
+      absl::btree_set<std::string> *expanded) const;
   void GetPreedit(size_t position, std::string *left, std::string *focused,
                   std::string *right) const;
 
@@ -193,13 +210,22 @@ class Composition final {
   //      into [pending='q']+[pending='ky'] because [pending='ky']+[input='o']
   //      can turn to be a fixed chunk.
   // e.g. [pending='k']+[pending='y']+[input='q'] are not combined.
-  void CombinePendingChunks(CharChunkList::iterator it,
-                            const CompositionInput &input);
+  // Return the iterator to the combined chunk.
+  CharChunkList::iterator CombinePendingChunks(CharChunkList::iterator it,
+                                               const CompositionInput &input);
   const CharChunkList &GetCharChunkList() const;
   const Table *table() const { return table_; }
   const CharChunkList &chunks() const { return chunks_; }
   Transliterators::Transliterator input_t12r() const { return input_t12r_; }
 
+  // Returns a number which is changed whenever the chunks are modified, so
+  // that the strings derived from the composition can be cached.
+  size_t revision() const { return revision_; }
+  // Returns the revision of the last modification other than an insertion at
+  // the end of the composition. Such insertions never change the chunks
+  // without pending input nor the chunks before them.
+  size_t edit_revision() const { return edit_revision_; }
+
   friend bool operator==(const Composition &lhs, const Composition &rhs) {
     return std::tie(lhs.table_, lhs.chunks_, lhs.input_t12r_) ==
            std::tie(rhs.table_, rhs.chunks_, rhs.input_t12r_);
@@ -222,6 +248,8 @@ class Composition final {
   const Table *table_;
   CharChunkList chunks_;
   Transliterators::Transliterator input_t12r_;
+  size_t revision_ = 0;
+  size_t edit_revision_ = 0;
 };
 
 }  // namespace composer
@@ -28,18 +28,63 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cstddef>
+#include <cstdint>
 #include <iostream>  // NOLINT
 #include <ostream>
 #include <sstream>
 #include <string>
 
 #include "absl/flags/flag.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "base/init_mozc.h"
+#include "base/stopwatch.h"
 #include "composer/internal/composition.h"
 #include "composer/table.h"
 
 ABSL_FLAG(std::string, table, "system://romanji-hiragana.tsv",
           "preedit conversion table file.");
+ABSL_FLAG(int32_t, benchmark_keys, 0,
+          "if positive, types this number of keys and shows the latency per "
+          "key event at every 100 keys instead of reading the commands.");
+
+namespace {
+
+void RunBenchmark(const mozc::composer::Table &table, const int32_t num_keys) {
+  constexpr absl::string_view kKeys = "kyouhaiitenkidesunexsa";
+  constexpr int32_t kInterval = 100;
+
+  mozc::composer::Composition composition(&table);
+  composition.SetInputMode(mozc::composer::Transliterators::HIRAGANA);
+  size_t pos = 0;
+  absl::Duration insert_time, copy_time;
+  for (int32_t i = 0; i < num_keys; ++i) {
+    const std::string key(1, kKeys[i % kKeys.size()]);
+    mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+    pos = composition.InsertAt(pos, key);
+    composition.GetString();
+    insert_time += stopwatch.GetElapsed();
+
+    // The composer is copied for the undo on each key event.
+    stopwatch = mozc::Stopwatch::StartNew();
+    const mozc::composer::Composition copied = composition;
+    copy_time += stopwatch.GetElapsed();
+    if (copied != composition) {
+      std::cerr << "The copied composition differs." << std::endl;
+    }
+
+    if ((i + 1) % kInterval == 0) {
+      std::cout << "keys: " << i + 1
+                << " length: " << composition.GetLength()
+                << " insert/key: " << insert_time / kInterval
+                << " copy/key: " << copy_time / kInterval << std::endl;
+      insert_time = absl::ZeroDuration();
+      copy_time = absl::ZeroDuration();
+    }
+  }
+}
+
+}  // namespace
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv);
@@ -47,6 +92,11 @@ int main(int argc, char **argv) {
   mozc::composer::Table table;
   table.LoadFromFile(absl::GetFlag(FLAGS_table).c_str());
 
+  if (absl::GetFlag(FLAGS_benchmark_keys) > 0) {
+    RunBenchmark(table, absl::GetFlag(FLAGS_benchmark_keys));
+    return 0;
+  }
+
   mozc::composer::Composition composition(&table);
 
   std::string command;
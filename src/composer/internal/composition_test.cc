@@ -31,11 +31,11 @@
 
 #include <cstddef>
 #include <iterator>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/btree_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "composer/internal/char_chunk.h"
@@ -97,7 +97,8 @@ static int InitComposition(Composition& comp) {
   CharChunkList::iterator it = comp.MaybeSplitChunkAt(0);
   for (int i = 0; i < test_chunks_size; ++i) {
     const TestCharChunk& data = test_chunks[i];
-    CharChunk& chunk = *comp.InsertChunk(it);
+    it = comp.InsertChunk(it);
+    CharChunk& chunk = *it++;
     chunk.set_conversion(data.conversion);
     chunk.set_pending(data.pending);
     chunk.set_raw(data.raw);
@@ -431,7 +432,8 @@ TEST_F(CompositionTest, DeleteAtInvisibleCharacter) {
     composition.Erase();
     CharChunkList::iterator it = composition.MaybeSplitChunkAt(0);
     for (const auto& item : data) {
-      CharChunk& chunk = *composition.InsertChunk(it);
+      it = composition.InsertChunk(it);
+      CharChunk& chunk = *it++;
       chunk.set_raw(table_.ParseSpecialKey(item.first));
       chunk.set_pending(table_.ParseSpecialKey(item.second));
     }
@@ -580,7 +582,7 @@ TEST_F(CompositionTest, GetExpandedStrings) {
 
   // a ky ki tta tty
   std::string base;
-  std::set<std::string> expanded;
+  absl::btree_set<std::string> expanded;
   composition_.GetExpandedStrings(&base, &expanded);
   EXPECT_EQ(base, "あkyきったっ");
   EXPECT_EQ(expanded.size(), 2);
@@ -592,6 +594,41 @@ TEST_F(CompositionTest, GetExpandedStrings) {
   EXPECT_TRUE(expanded.find("ちゃ") != expanded.end());
 }
 
+TEST_F(CompositionTest, GetExpandedStringsWithPrefix) {
+  table_.AddRule("ka", "か", "");
+  table_.AddRule("ki", "き", "");
+  table_.AddRule("kya", "きゃ", "");
+  table_.AddRule("n", "ん", "");
+  table_.AddRule("na", "な", "");
+  table_.AddRule("nn", "ん", "");
+  composition_.SetInputMode(Transliterators::HIRAGANA);
+
+  // The prefix is extended while the characters are appended.
+  Composition::ExpansionPrefix prefix;
+  size_t pos = 0;
+  for (const char c : std::string("kankyakinna")) {
+    const size_t edit_revision = composition_.edit_revision();
+    pos = composition_.InsertAt(pos, std::string(1, c));
+    EXPECT_EQ(composition_.edit_revision(), edit_revision);
+
+    std::string base, asis, expected_base;
+    absl::btree_set<std::string> expanded, expected_expanded;
+    composition_.GetExpandedStringsWithPrefix(&prefix, &base, &asis,
+                                              &expanded);
+    composition_.GetExpandedStrings(&expected_base, &expected_expanded);
+    EXPECT_EQ(base, expected_base);
+    EXPECT_EQ(asis, composition_.GetStringWithTrimMode(ASIS));
+    EXPECT_EQ(expanded, expected_expanded);
+  }
+  EXPECT_EQ(prefix.result, "かんきゃきん");
+
+  // Other modifications are marked as edits.
+  composition_.DeleteAt(0);
+  EXPECT_EQ(composition_.edit_revision(), composition_.revision());
+  composition_.InsertAt(0, "k");
+  EXPECT_EQ(composition_.edit_revision(), composition_.revision());
+}
+
 TEST_F(CompositionTest, ConvertPosition) {
   // Test against http://b/1550597
 
@@ -1148,7 +1185,7 @@ TEST_F(CompositionTest, CombinePendingChunks) {
 
     CompositionInput input;
     SetInput("n", "", false, &input);
-    comp.CombinePendingChunks(chunk_it, input);
+    chunk_it = comp.CombinePendingChunks(chunk_it, input);
     EXPECT_EQ(chunk_it->pending(), "");
     EXPECT_EQ(chunk_it->conversion(), "");
     EXPECT_EQ(chunk_it->raw(), "");
@@ -1168,7 +1205,7 @@ TEST_F(CompositionTest, CombinePendingChunks) {
     CompositionInput input;
     SetInput("n", "", false, &input);
 
-    comp.CombinePendingChunks(chunk_it, input);
+    chunk_it = comp.CombinePendingChunks(chunk_it, input);
     EXPECT_EQ(chunk_it->pending(), "");
     EXPECT_EQ(chunk_it->conversion(), "");
     EXPECT_EQ(chunk_it->raw(), "");
@@ -1189,7 +1226,7 @@ TEST_F(CompositionTest, CombinePendingChunks) {
     CompositionInput input;
     SetInput("a", "", false, &input);
 
-    comp.CombinePendingChunks(chunk_it, input);
+    chunk_it = comp.CombinePendingChunks(chunk_it, input);
     EXPECT_EQ(chunk_it->pending(), "ny");
     EXPECT_EQ(chunk_it->conversion(), "");
     EXPECT_EQ(chunk_it->raw(), "ny");
@@ -1211,7 +1248,7 @@ TEST_F(CompositionTest, CombinePendingChunks) {
     CompositionInput input;
     SetInput("a", "", false, &input);
 
-    comp.CombinePendingChunks(chunk_it, input);
+    chunk_it = comp.CombinePendingChunks(chunk_it, input);
     EXPECT_EQ(chunk_it->pending(), "ny");
     EXPECT_EQ(chunk_it->conversion(), "");
     EXPECT_EQ(chunk_it->raw(), "ny");
@@ -1235,7 +1272,7 @@ TEST_F(CompositionTest, CombinePendingChunks) {
     CompositionInput input;
     SetInput("x", "a", false, &input);
 
-    comp.CombinePendingChunks(chunk_it, input);
+    chunk_it = comp.CombinePendingChunks(chunk_it, input);
     EXPECT_EQ(chunk_it->pending(), "ny");
     EXPECT_EQ(chunk_it->conversion(), "");
     EXPECT_EQ(chunk_it->raw(), "ny");
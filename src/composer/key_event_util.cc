@@ -32,6 +32,7 @@
 #include <cctype>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 
 #include "absl/log/check.h"
 #include "absl/log/log.h"
@@ -50,6 +51,14 @@ constexpr uint32_t kShiftMask =
     KeyEvent::SHIFT | KeyEvent::LEFT_SHIFT | KeyEvent::RIGHT_SHIFT;
 constexpr uint32_t kCapsMask = KeyEvent::CAPS;
 
+// CTRL (or ALT, SHIFT) should be set on modifier_keys when
+// LEFT (or RIGHT) ctrl is set.
+// LEFT_CTRL (or others) is not handled on Japanese, so we remove these.
+constexpr uint32_t kIgnorableModifierMask =
+    (KeyEvent::CAPS | KeyEvent::LEFT_ALT | KeyEvent::RIGHT_ALT |
+     KeyEvent::LEFT_CTRL | KeyEvent::RIGHT_CTRL | KeyEvent::LEFT_SHIFT |
+     KeyEvent::RIGHT_SHIFT);
+
 uint32_t Ignore(uint32_t modifiers, uint32_t modifiers_to_be_ignored) {
   return modifiers & ~modifiers_to_be_ignored;
 }
@@ -62,6 +71,31 @@ bool None(uint32_t modifiers_to_be_tested, uint32_t modifiers_to_be_queried) {
   return !Any(modifiers_to_be_tested, modifiers_to_be_queried);
 }
 
+bool PackKeyInformation(uint32_t modifiers, uint16_t special_key,
+                        uint32_t key_code, KeyInformation *key) {
+  // Make sure the translation from the obsolete specification.
+  // key_code should no longer contain control characters.
+  if (0 < key_code && key_code <= 32) {
+    return false;
+  }
+
+  *key = (static_cast<KeyInformation>(static_cast<uint16_t>(modifiers)) << 48) |
+         (static_cast<KeyInformation>(special_key) << 32) |
+         (static_cast<KeyInformation>(key_code));
+  return true;
+}
+
+// Reverts the flip of alphabetical key codes caused by CapsLock.
+uint32_t RevertCapsLock(uint32_t key_code) {
+  if ('A' <= key_code && key_code <= 'Z') {
+    return key_code + ('a' - 'A');
+  }
+  if ('a' <= key_code && key_code <= 'z') {
+    return key_code + ('A' - 'a');
+  }
+  return key_code;
+}
+
 }  // namespace
 
 uint32_t KeyEventUtil::GetModifiers(const KeyEvent &key_event) {
@@ -80,22 +114,44 @@ bool KeyEventUtil::GetKeyInformation(const KeyEvent &key_event,
                                      KeyInformation *key) {
   DCHECK(key);
 
-  const uint16_t modifier_keys = static_cast<uint16_t>(GetModifiers(key_event));
   const uint16_t special_key = key_event.has_special_key()
                                    ? key_event.special_key()
                                    : KeyEvent::NO_SPECIALKEY;
   const uint32_t key_code = key_event.has_key_code() ? key_event.key_code() : 0;
+  return PackKeyInformation(GetModifiers(key_event), special_key, key_code,
+                            key);
+}
 
-  // Make sure the translation from the obsolete specification.
-  // key_code should no longer contain control characters.
-  if (0 < key_code && key_code <= 32) {
+bool KeyEventUtil::GetNormalizedKeyInformation(
+    const KeyEvent &key_event, KeyInformation *key,
+    std::optional<KeyInformation> *stub) {
+  DCHECK(key);
+  DCHECK(stub);
+
+  // NormalizeModifiers() removes the ignorable modifiers only from
+  // modifier_keys.
+  const uint32_t original_modifiers = GetModifiers(key_event);
+  const uint32_t modifiers =
+      key_event.has_modifiers()
+          ? original_modifiers
+          : Ignore(original_modifiers, kIgnorableModifierMask);
+  const uint16_t special_key = key_event.has_special_key()
+                                   ? key_event.special_key()
+                                   : KeyEvent::NO_SPECIALKEY;
+  uint32_t key_code = key_event.has_key_code() ? key_event.key_code() : 0;
+  if (original_modifiers & KeyEvent::CAPS) {
+    key_code = RevertCapsLock(key_code);
+  }
+  if (!PackKeyInformation(modifiers, special_key, key_code, key)) {
     return false;
   }
 
-  *key = (static_cast<KeyInformation>(modifier_keys) << 48) |
-         (static_cast<KeyInformation>(special_key) << 32) |
-         (static_cast<KeyInformation>(key_code));
-
+  // Same conditions as MaybeGetKeyStub().
+  stub->reset();
+  if (modifiers == 0 && !key_event.has_special_key() &&
+      (key_code > 32 || !key_event.key_string().empty())) {
+    PackKeyInformation(0, KeyEvent::TEXT_INPUT, 0, &stub->emplace());
+  }
   return true;
 }
 
@@ -103,25 +159,11 @@ void KeyEventUtil::NormalizeModifiers(const KeyEvent &key_event,
                                       KeyEvent *new_key_event) {
   DCHECK(new_key_event);
 
-  // CTRL (or ALT, SHIFT) should be set on modifier_keys when
-  // LEFT (or RIGHT) ctrl is set.
-  // LEFT_CTRL (or others) is not handled on Japanese, so we remove these.
-  constexpr uint32_t kIgnorableModifierMask =
-      (KeyEvent::CAPS | KeyEvent::LEFT_ALT | KeyEvent::RIGHT_ALT |
-       KeyEvent::LEFT_CTRL | KeyEvent::RIGHT_CTRL | KeyEvent::LEFT_SHIFT |
-       KeyEvent::RIGHT_SHIFT);
-
   RemoveModifiers(key_event, kIgnorableModifierMask, new_key_event);
 
-  // Reverts the flip of alphabetical key events caused by CapsLock.
   const uint32_t original_modifiers = GetModifiers(key_event);
   if ((original_modifiers & KeyEvent::CAPS) && key_event.has_key_code()) {
-    const uint32_t key_code = key_event.key_code();
-    if ('A' <= key_code && key_code <= 'Z') {
-      new_key_event->set_key_code(key_code + ('a' - 'A'));
-    } else if ('a' <= key_code && key_code <= 'z') {
-      new_key_event->set_key_code(key_code + ('A' - 'a'));
-    }
+    new_key_event->set_key_code(RevertCapsLock(key_event.key_code()));
   }
 }
 
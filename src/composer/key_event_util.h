@@ -33,6 +33,7 @@
 #define MOZC_COMPOSER_KEY_EVENT_UTIL_H_
 
 #include <cstdint>
+#include <optional>
 
 #include "protocol/commands.pb.h"
 
@@ -61,6 +62,13 @@ class KeyEventUtil {
   static void NormalizeModifiers(const commands::KeyEvent &key_event,
                                  commands::KeyEvent *new_key_event);
 
+  // Same as GetKeyInformation() of the key event normalized by
+  // NormalizeModifiers(), but without copying |key_event|. |stub| is set to
+  // the result of MaybeGetKeyStub() for the normalized key event.
+  static bool GetNormalizedKeyInformation(
+      const commands::KeyEvent &key_event, KeyInformation *key,
+      std::optional<KeyInformation> *stub);
+
   // Normalizes a numpad key to a normal key (e.g. NUMPAD0 => '0')
   static void NormalizeNumpadKey(const commands::KeyEvent &key_event,
                                  commands::KeyEvent *new_key_event);
@@ -32,6 +32,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <optional>
 #include <string>
 
 #include "absl/strings/str_format.h"
@@ -216,6 +217,59 @@ TEST(KeyEventUtilTest, NormalizeModifiers) {
   }
 }
 
+TEST(KeyEventUtilTest, GetNormalizedKeyInformation) {
+  // Same as NormalizeModifiers(), GetKeyInformation() and MaybeGetKeyStub().
+  constexpr absl::string_view kKeys[] = {
+      "a",           "CAPS H",       "CAPS LeftShift H", "LeftShift",
+      "Ctrl a",      "Shift Tab",    "LeftCtrl Enter",   "Escape",
+      "Space",       "Shift Space",  "CAPS 1",           "TextInput",
+      "Alt Shift z", "RightAlt Left"};
+  for (const absl::string_view key_string : kKeys) {
+    SCOPED_TRACE(key_string);
+    KeyEvent key_event;
+    ASSERT_TRUE(KeyParser::ParseKey(key_string, &key_event));
+
+    KeyEvent normalized_key_event;
+    KeyEventUtil::NormalizeModifiers(key_event, &normalized_key_event);
+    KeyInformation expected_key, expected_stub;
+    ASSERT_TRUE(
+        KeyEventUtil::GetKeyInformation(normalized_key_event, &expected_key));
+    const bool has_stub =
+        KeyEventUtil::MaybeGetKeyStub(normalized_key_event, &expected_stub);
+
+    KeyInformation key;
+    std::optional<KeyInformation> stub;
+    ASSERT_TRUE(
+        KeyEventUtil::GetNormalizedKeyInformation(key_event, &key, &stub));
+    EXPECT_EQ(key, expected_key);
+    ASSERT_EQ(stub.has_value(), has_stub);
+    if (has_stub) {
+      EXPECT_EQ(*stub, expected_stub);
+    }
+  }
+
+  {  // Key string without key code.
+    KeyEvent key_event;
+    key_event.set_key_string("あ");
+    KeyInformation key;
+    std::optional<KeyInformation> stub;
+    ASSERT_TRUE(
+        KeyEventUtil::GetNormalizedKeyInformation(key_event, &key, &stub));
+    EXPECT_EQ(key, 0);
+    ASSERT_TRUE(stub.has_value());
+    EXPECT_EQ(*stub, static_cast<KeyInformation>(KeyEvent::TEXT_INPUT) << 32);
+  }
+
+  {  // Control characters are not valid key codes.
+    KeyEvent key_event;
+    key_event.set_key_code(27);
+    KeyInformation key;
+    std::optional<KeyInformation> stub;
+    EXPECT_FALSE(
+        KeyEventUtil::GetNormalizedKeyInformation(key_event, &key, &stub));
+  }
+}
+
 TEST(KeyEventUtilTest, NormalizeNumpadKey) {
   constexpr struct NormalizeNumpadKeyTestData {
     absl::string_view from;
@@ -40,12 +40,16 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/attributes.h"
+#include "absl/base/const_init.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "base/config_file_stream.h"
 #include "base/hash.h"
 #include "base/util.h"
@@ -376,6 +380,7 @@ const Entry *Table::AddRuleWithAttributes(
   if (entries_.LookUp(input, &old_entry)) {
     DeleteEntry(old_entry);
   }
+  compiled_entries_.reset();
 
   auto entry = std::make_unique<Entry>(input, output, pending, attributes);
   Entry *entry_ptr = entry.get();
@@ -411,6 +416,16 @@ void Table::DeleteRule(const absl::string_view input) {
     DeleteEntry(old_entry);
   }
   entries_.DeleteEntry(input);
+  compiled_entries_.reset();
+}
+
+void Table::Compile() {
+  std::vector<std::pair<std::string, const Entry *>> entries;
+  entries.reserve(entry_set_.size());
+  for (const std::unique_ptr<Entry> &entry : entry_set_) {
+    entries.emplace_back(entry->input(), entry.get());
+  }
+  compiled_entries_.emplace(std::move(entries));
 }
 
 bool Table::LoadFromString(const std::string &str) {
@@ -480,39 +495,49 @@ bool Table::LoadFromStream(std::istream *is) {
   return true;
 }
 
+absl::string_view Table::NormalizeInput(const absl::string_view input,
+                                        std::string *buffer) const {
+  if (case_sensitive_) {
+    return input;
+  }
+  *buffer = input;
+  Util::LowerString(buffer);
+  return *buffer;
+}
+
 const Entry *Table::LookUp(const absl::string_view input) const {
+  std::string buffer;
+  const absl::string_view key = NormalizeInput(input, &buffer);
   const Entry *entry = nullptr;
-  if (case_sensitive_) {
-    entries_.LookUp(input, &entry);
+  if (compiled_entries_.has_value()) {
+    compiled_entries_->LookUp(key, &entry);
   } else {
-    std::string normalized_input(input);
-    Util::LowerString(&normalized_input);
-    entries_.LookUp(normalized_input, &entry);
+    entries_.LookUp(key, &entry);
   }
   return entry;
 }
 
 const Entry *Table::LookUpPrefix(const absl::string_view input,
                                  size_t *key_length, bool *fixed) const {
+  std::string buffer;
+  const absl::string_view key = NormalizeInput(input, &buffer);
   const Entry *entry = nullptr;
-  if (case_sensitive_) {
-    entries_.LookUpPrefix(input, &entry, key_length, fixed);
+  if (compiled_entries_.has_value()) {
+    compiled_entries_->LookUpPrefix(key, &entry, key_length, fixed);
   } else {
-    std::string normalized_input(input);
-    Util::LowerString(&normalized_input);
-    entries_.LookUpPrefix(normalized_input, &entry, key_length, fixed);
+    entries_.LookUpPrefix(key, &entry, key_length, fixed);
   }
   return entry;
 }
 
 void Table::LookUpPredictiveAll(const absl::string_view input,
                                 std::vector<const Entry *> *results) const {
-  if (case_sensitive_) {
-    entries_.LookUpPredictiveAll(input, results);
+  std::string buffer;
+  const absl::string_view key = NormalizeInput(input, &buffer);
+  if (compiled_entries_.has_value()) {
+    compiled_entries_->LookUpPredictiveAll(key, results);
   } else {
-    std::string normalized_input(input);
-    Util::LowerString(&normalized_input);
-    entries_.LookUpPredictiveAll(normalized_input, results);
+    entries_.LookUpPredictiveAll(key, results);
   }
 }
 
@@ -533,13 +558,12 @@ bool Table::HasNewChunkEntry(const absl::string_view input) const {
 }
 
 bool Table::HasSubRules(const absl::string_view input) const {
-  if (case_sensitive_) {
-    return entries_.HasSubTrie(input);
-  } else {
-    std::string normalized_input(input);
-    Util::LowerString(&normalized_input);
-    return entries_.HasSubTrie(normalized_input);
+  std::string buffer;
+  const absl::string_view key = NormalizeInput(input, &buffer);
+  if (compiled_entries_.has_value()) {
+    return compiled_entries_->HasSubTrie(key);
   }
+  return entries_.HasSubTrie(key);
 }
 
 void Table::DeleteEntry(const Entry *entry) { entry_set_.erase(entry); }
@@ -562,6 +586,40 @@ const Table &Table::GetDefaultTable() {
 // ========================================
 // TableContainer
 // ========================================
+namespace {
+
+ABSL_CONST_INIT absl::Mutex g_shared_tables_mutex(absl::kConstInit);
+
+}  // namespace
+
+// static
+std::shared_ptr<const Table> TableManager::GetSharedTable(
+    const uint32_t hash, const uint32_t custom_roman_table_fingerprint,
+    const commands::Request &request, const config::Config &config) {
+  // Tables compiled for all the TableManagers. A table is released when no
+  // TableManager refers to it.
+  static auto *shared_tables = new absl::flat_hash_map<
+      std::pair<uint32_t, uint32_t>, std::weak_ptr<const Table>>();
+
+  const std::pair<uint32_t, uint32_t> key(hash, custom_roman_table_fingerprint);
+  absl::MutexLock lock(&g_shared_tables_mutex);
+  if (const auto it = shared_tables->find(key); it != shared_tables->end()) {
+    if (std::shared_ptr<const Table> table = it->second.lock()) {
+      return table;
+    }
+  }
+
+  auto table = std::make_shared<Table>();
+  if (!table->InitializeWithRequestAndConfig(request, config)) {
+    return nullptr;
+  }
+  table->Compile();
+  absl::erase_if(*shared_tables,
+                 [](const auto &pair) { return pair.second.expired(); });
+  (*shared_tables)[key] = table;
+  return table;
+}
+
 TableManager::TableManager()
     : custom_roman_table_fingerprint_(Fingerprint32("")) {}
 
@@ -579,10 +637,13 @@ const Table *TableManager::GetTable(const mozc::commands::Request &request,
 
   // When custom_roman_table is set, force to create new table.
   bool update_custom_roman_table = false;
+  // Fingerprint of the custom table used by the table for |hash|.
+  uint32_t table_fingerprint = Fingerprint32("");
   if ((config.preedit_method() == config::Config::ROMAN) &&
       config.has_custom_roman_table() && !config.custom_roman_table().empty()) {
     const uint32_t custom_roman_table_fingerprint =
         Fingerprint32(config.custom_roman_table());
+    table_fingerprint = custom_roman_table_fingerprint;
     if (custom_roman_table_fingerprint != custom_roman_table_fingerprint_) {
       update_custom_roman_table = true;
       custom_roman_table_fingerprint_ = custom_roman_table_fingerprint;
@@ -599,8 +660,9 @@ const Table *TableManager::GetTable(const mozc::commands::Request &request,
     }
   }
 
-  auto table = std::make_unique<Table>();
-  if (!table->InitializeWithRequestAndConfig(request, config)) {
+  std::shared_ptr<const Table> table =
+      GetSharedTable(hash, table_fingerprint, request, config);
+  if (table == nullptr) {
     return nullptr;
   }
 
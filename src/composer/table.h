@@ -36,12 +36,14 @@
 #include <cstdint>
 #include <istream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
+#include "base/container/flat_trie.h"
 #include "base/container/trie.h"
 #include "composer/internal/special_key.h"
 #include "protocol/commands.pb.h"
@@ -110,6 +112,11 @@ class Table final {
   bool LoadFromString(const std::string &str);
   bool LoadFromFile(const char *filepath);
 
+  // Compiles the rules into a flat trie used by the lookups below. Adding or
+  // deleting a rule after this discards the compiled trie, so this should be
+  // called once the table is ready to be shared.
+  void Compile();
+
   const Entry *LookUp(absl::string_view input) const;
   const Entry *LookUpPrefix(absl::string_view input, size_t *key_length,
                             bool *fixed) const;
@@ -138,9 +145,15 @@ class Table final {
 
   bool LoadFromStream(std::istream *is);
   void DeleteEntry(const Entry *entry);
+  // Returns |input| normalized for the lookups. |buffer| holds the result if
+  // it is different from |input|.
+  absl::string_view NormalizeInput(absl::string_view input,
+                                   std::string *buffer) const;
 
   using EntryTrie = Trie<const Entry *>;
   EntryTrie entries_;
+  // Built by Compile() from entries_ and used instead if available.
+  std::optional<FlatTrie<const Entry *>> compiled_entries_;
   using EntrySet = absl::flat_hash_set<std::unique_ptr<Entry>>;
   EntrySet entry_set_;
 
@@ -163,13 +176,20 @@ class TableManager {
   void ClearCaches();
 
  private:
-  // Table caches.
+  // Returns the compiled table for |hash| and the custom roman table, which is
+  // shared by all the TableManagers while any of them refers to it.
+  static std::shared_ptr<const Table> GetSharedTable(
+      uint32_t hash, uint32_t custom_roman_table_fingerprint,
+      const commands::Request &request, const config::Config &config);
+
+  // Table caches. The tables are compiled and shared with the other
+  // TableManagers.
   // Key uint32_t is calculated hash and unique for
   //  commands::Request::SpecialRomanjiTable
   //  config::Config::PreeditMethod
   //  config::Config::PunctuationMethod
   //  config::Config::SymbolMethod
-  absl::flat_hash_map<uint32_t, std::unique_ptr<const Table>> table_map_;
+  absl::flat_hash_map<uint32_t, std::shared_ptr<const Table>> table_map_;
   // Fingerprint for Config::custom_roman_table;
   uint32_t custom_roman_table_fingerprint_;
 };
@@ -1064,5 +1064,74 @@ TEST_F(TableTest, TableManager) {
   }
 }
 
+TEST_F(TableTest, Compile) {
+  config::Config config;
+  config.set_preedit_method(Config::ROMAN);
+  Table table;
+  ASSERT_TRUE(table.InitializeWithRequestAndConfig(
+      commands::Request::default_instance(), config));
+  Table compiled;
+  ASSERT_TRUE(compiled.InitializeWithRequestAndConfig(
+      commands::Request::default_instance(), config));
+  compiled.Compile();
+
+  for (const absl::string_view input :
+       {"", "a", "k", "ka", "kya", "kyax", "n", "nn", "nk", "xtu", "A", "KA",
+        "-", "z/", "\x80", "あ"}) {
+    SCOPED_TRACE(input);
+    EXPECT_EQ(table.HasSubRules(input), compiled.HasSubRules(input));
+
+    const Entry *entry = table.LookUp(input);
+    const Entry *compiled_entry = compiled.LookUp(input);
+    ASSERT_EQ(entry == nullptr, compiled_entry == nullptr);
+    if (entry != nullptr) {
+      EXPECT_EQ(entry->result(), compiled_entry->result());
+      EXPECT_EQ(entry->pending(), compiled_entry->pending());
+    }
+
+    size_t key_length = 0, compiled_key_length = 0;
+    bool fixed = false, compiled_fixed = false;
+    entry = table.LookUpPrefix(input, &key_length, &fixed);
+    compiled_entry =
+        compiled.LookUpPrefix(input, &compiled_key_length, &compiled_fixed);
+    ASSERT_EQ(entry == nullptr, compiled_entry == nullptr);
+    EXPECT_EQ(key_length, compiled_key_length);
+    EXPECT_EQ(fixed, compiled_fixed);
+    if (entry != nullptr) {
+      EXPECT_EQ(entry->input(), compiled_entry->input());
+    }
+
+    std::vector<const Entry *> results, compiled_results;
+    table.LookUpPredictiveAll(input, &results);
+    compiled.LookUpPredictiveAll(input, &compiled_results);
+    EXPECT_EQ(results.size(), compiled_results.size());
+  }
+
+  // Adding a rule discards the compiled trie.
+  compiled.AddRule("kyax", "[KYAX]", "");
+  const Entry *entry = compiled.LookUp("kyax");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->result(), "[KYAX]");
+}
+
+TEST_F(TableTest, TableManagerSharesTables) {
+  commands::Request request;
+  config::Config config;
+  config.set_preedit_method(Config::ROMAN);
+
+  TableManager table_manager1;
+  TableManager table_manager2;
+  const Table *table = table_manager1.GetTable(request, config);
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table_manager2.GetTable(request, config), table);
+
+  // A different custom table is not shared.
+  config.set_custom_roman_table("a\t[A]\n");
+  const Table *custom_table = table_manager2.GetTable(request, config);
+  ASSERT_NE(custom_table, nullptr);
+  EXPECT_NE(custom_table, table);
+  EXPECT_EQ(table_manager1.GetTable(request, config), custom_table);
+}
+
 }  // namespace
 }  // namespace mozc::composer
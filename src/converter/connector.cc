@@ -29,16 +29,17 @@
 
 #include "converter/connector.h"
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory>
 #include <new>
 #include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include "absl/algorithm/container.h"
 #include "absl/base/attributes.h"
 #include "absl/base/const_init.h"
 #include "absl/status/status.h"
@@ -70,6 +71,10 @@ inline uint32_t EncodeKey(uint16_t rid, uint16_t lid) {
   return (static_cast<uint32_t>(rid) << 16) | lid;
 }
 
+inline uint64_t EncodeCacheEntry(uint32_t key, int value) {
+  return (static_cast<uint64_t>(key) << 32) | static_cast<uint32_t>(value);
+}
+
 absl::Status IsMemoryAligned32(const void *ptr) {
   const auto addr = reinterpret_cast<std::uintptr_t>(ptr);
   const auto alignment = addr % 4;
@@ -204,9 +209,7 @@ absl::Status Connector::Init(const char *connection_data,
     return absl::InvalidArgumentError(absl::StrCat(
         "connector.cc: Cache size must be 2^n: size=", cache_size));
   }
-  cache_hash_mask_ = cache_size - 1;
-  cache_key_.resize(cache_size);
-  cache_value_.resize(cache_size);
+  InitCache(cache_size);
 
   absl::StatusOr<Metadata> metadata =
       ParseMetadata(connection_data, connection_size);
@@ -264,7 +267,7 @@ absl::Status Connector::Init(const char *connection_data,
 
   const size_t chunk_bits_size = metadata->ChunkBitsSize();
   const uint16_t rsize = metadata->rsize;
-  rows_.resize(rsize);
+  auto rows = std::make_shared<std::vector<Row>>(rsize);
   for (size_t i = 0; i < rsize; ++i) {
     // Each row is formatted as follows:
     // +-------------------+-------------+------------+------------+-----------+
@@ -298,10 +301,11 @@ absl::Status Connector::Init(const char *connection_data,
     VALIDATE_ALIGNMENT(values);
     ptr += values_size;
 
-    rows_[i].Init(chunk_bits, chunk_bits_size, compact_bits, compact_bits_size,
-                  values, metadata->Use1ByteValue());
+    (*rows)[i].Init(chunk_bits, chunk_bits_size, compact_bits,
+                    compact_bits_size, values, metadata->Use1ByteValue());
   }
   VALIDATE_SIZE(ptr, 0, "Data end");
+  rows_ = std::move(rows);
   ClearCache();
   return absl::Status();
 
@@ -310,22 +314,55 @@ absl::Status Connector::Init(const char *connection_data,
 }
 
 
+Connector::Connector(const Connector &other)
+    : rows_(other.rows_),
+      default_cost_(other.default_cost_),
+      resolution_(other.resolution_) {
+  if (other.cache_ != nullptr) {
+    InitCache(other.cache_hash_mask_ + 1);
+  }
+}
+
+Connector &Connector::operator=(const Connector &other) {
+  if (this != &other) {
+    *this = Connector(other);
+  }
+  return *this;
+}
+
+void Connector::InitCache(uint32_t cache_size) {
+  cache_hash_mask_ = cache_size - 1;
+  cache_ = std::make_unique<std::atomic<uint64_t>[]>(cache_size);
+  ClearCache();
+}
+
 int Connector::GetTransitionCost(uint16_t rid, uint16_t lid) const {
   const uint32_t index = EncodeKey(rid, lid);
   const uint32_t bucket = GetHashValue(rid, lid, cache_hash_mask_);
-  if (cache_key_[bucket] == index) {
-    return cache_value_[bucket];
+  // The entry is a cache, so the relaxed order is enough. A racing update
+  // only replaces one valid entry with another.
+  const uint64_t entry = cache_[bucket].load(std::memory_order_relaxed);
+  if (static_cast<uint32_t>(entry >> 32) == index) {
+    return static_cast<int32_t>(static_cast<uint32_t>(entry));
   }
   const int value = LookupCost(rid, lid);
-  cache_key_[bucket] = index;
-  cache_value_[bucket] = value;
+  cache_[bucket].store(EncodeCacheEntry(index, value),
+                       std::memory_order_relaxed);
   return value;
 }
 
-void Connector::ClearCache() { absl::c_fill(cache_key_, kInvalidCacheKey); }
+void Connector::ClearCache() {
+  if (cache_ == nullptr) {
+    return;
+  }
+  for (uint32_t i = 0; i <= cache_hash_mask_; ++i) {
+    cache_[i].store(EncodeCacheEntry(kInvalidCacheKey, 0),
+                    std::memory_order_relaxed);
+  }
+}
 
 int Connector::LookupCost(uint16_t rid, uint16_t lid) const {
-  std::optional<uint16_t> value = rows_[rid].GetValue(lid);
+  std::optional<uint16_t> value = (*rows_)[rid].GetValue(lid);
   if (!value.has_value()) {
     return default_cost_[rid];
   }
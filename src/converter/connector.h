@@ -30,8 +30,10 @@
 #ifndef MOZC_CONVERTER_CONNECTOR_H_
 #define MOZC_CONVERTER_CONNECTOR_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -42,10 +44,21 @@
 
 namespace mozc {
 
+// Connector is cheap to copy: copies share the rows decoded from the data
+// set, which are immutable, and only the cost cache is owned by each copy.
+// This lets engines built from the same data share one set of rows while
+// keeping the cache per engine. GetTransitionCost() is thread safe.
 class Connector final {
  public:
   static constexpr int16_t kInvalidCost = 30000;
 
+  Connector() = default;
+  // Copies start with an empty cache of the same size.
+  Connector(const Connector &other);
+  Connector &operator=(const Connector &other);
+  Connector(Connector &&) = default;
+  Connector &operator=(Connector &&) = default;
+
   static absl::StatusOr<Connector> CreateFromDataManager(
       const DataManagerInterface &data_manager);
 
@@ -65,13 +78,15 @@ class Connector final {
                     int cache_size);
 
   int LookupCost(uint16_t rid, uint16_t lid) const;
+  void InitCache(uint32_t cache_size);
 
-  std::vector<Row> rows_;
+  std::shared_ptr<const std::vector<Row>> rows_;
   const uint16_t *default_cost_ = nullptr;
   int resolution_ = 0;
   uint32_t cache_hash_mask_ = 0;
-  mutable std::vector<uint32_t> cache_key_;
-  mutable std::vector<int> cache_value_;
+  // Each entry packs the key and the cost into one word so that the cache
+  // can be read and updated from multiple threads without a lock.
+  std::unique_ptr<std::atomic<uint64_t>[]> cache_;
 };
 
 class Connector::Row final {
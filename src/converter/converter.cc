@@ -464,6 +464,23 @@ bool Converter::StartSuggestion(const ConversionRequest &original_request,
   return Predict(request, prediction_key, segments);
 }
 
+void Converter::PrefetchLattice(const ConversionRequest &request,
+                                const absl::string_view key,
+                                Segments *segments) const {
+  if (request.request_type() != ConversionRequest::SUGGESTION &&
+      request.request_type() != ConversionRequest::PREDICTION) {
+    return;
+  }
+  // Only the immutable converter runs here, as the predictors and the
+  // rewriters are neither thread safe nor free of side effects. The lattice
+  // is cached in the same way as the realtime conversion of
+  // DictionaryPredictor, which looks up the same key.
+  SetKey(segments, key);
+  if (!immutable_converter_->ConvertForRequest(request, segments)) {
+    MOZC_VLOG(1) << "ConvertForRequest failed for prefetch";
+  }
+}
+
 bool Converter::StartPartialSuggestionWithKey(
     Segments *segments, const absl::string_view key) const {
   ConversionRequest default_request;
@@ -803,7 +820,8 @@ bool Converter::ResizeSegment(Segments *segments,
 
   std::string key;
   for (const Segment &segment :
-       segments->all().subrange(start_segment_index, segments_size)) {
+       std::as_const(*segments).all().subrange(start_segment_index,
+                                               segments_size)) {
     key += segment.key();
   }
 
@@ -96,6 +96,8 @@ class Converter final : public ConverterInterface {
   ABSL_MUST_USE_RESULT
   bool StartPartialSuggestionWithKey(Segments *segments,
                                      absl::string_view key) const override;
+  void PrefetchLattice(const ConversionRequest &request, absl::string_view key,
+                       Segments *segments) const override;
 
   void FinishConversion(const ConversionRequest &request,
                         Segments *segments) const override;
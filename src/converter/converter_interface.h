@@ -110,6 +110,15 @@ class ConverterInterface {
   virtual bool StartPartialSuggestionWithKey(Segments *segments,
                                              absl::string_view key) const = 0;
 
+  // Builds the lattice of the realtime conversion for the suggestion or the
+  // prediction of |key| into the lattice cache of |segments|, so that the
+  // following suggestion for a similar key can extend it. The composer of
+  // |request| is not used. Unlike the other methods, this is thread safe and
+  // doesn't touch the user data.
+  virtual void PrefetchLattice(const ConversionRequest &request,
+                               absl::string_view key,
+                               Segments *segments) const {}
+
   // Finish conversion.
   // Segments are cleared. Context is not cleared
   virtual void FinishConversion(const ConversionRequest &request,
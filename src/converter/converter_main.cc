@@ -38,6 +38,11 @@
 #include <utility>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif  // _WIN32
+
+#include "absl/flags/declare.h"
 #include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
@@ -47,12 +52,15 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/init_mozc.h"
 #include "base/number_util.h"
 #include "base/protobuf/text_format.h"
 #include "base/singleton.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
 #include "composer/composer.h"
 #include "composer/table.h"
@@ -65,6 +73,7 @@
 #include "engine/engine.h"
 #include "engine/engine_interface.h"
 #include "engine/supplemental_model_interface.h"
+#include "engine/warmup.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "protocol/engine_builder.pb.h"
@@ -99,6 +108,15 @@ ABSL_FLAG(std::string, id_def, "",
 ABSL_FLAG(std::string, decoder_experiment_params, "",
           "If nonempty, a DecoderExperimentParams is parsed from this text "
           "format and it is merged to the default value.");
+ABSL_FLAG(bool, benchmark_latency, false,
+          "If true, converts the queries of --warmup_queries_file (or the "
+          "built-in ones) twice and reports the latency percentiles of the "
+          "cold and the warm conversions instead of reading commands from "
+          "stdin. Combine with --warmup_engine to see the effect of warmup, "
+          "and with --data_madvise, --data_mlock_hot_sections or "
+          "--data_prefault to see the page faults of each load policy.");
+
+ABSL_DECLARE_FLAG(bool, warmup_engine);
 
 
 namespace mozc {
@@ -426,6 +444,63 @@ std::string SelectIdDefFromName(const std::string &mozc_runfiles_dir,
   return "";
 }
 
+struct PageFaults {
+  int64_t minor = 0;
+  int64_t major = 0;
+};
+
+// Returns the numbers of the page faults of this process so far.
+PageFaults GetPageFaults() {
+#ifdef _WIN32
+  return PageFaults();
+#else   // _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return PageFaults();
+  }
+  return PageFaults{usage.ru_minflt, usage.ru_majflt};
+#endif  // _WIN32
+}
+
+void PrintPageFaults(absl::string_view label, const PageFaults &start) {
+  const PageFaults end = GetPageFaults();
+  std::cout << absl::StreamFormat("%s: minor_faults=%d major_faults=%d", label,
+                                  end.minor - start.minor,
+                                  end.major - start.major)
+            << std::endl;
+}
+
+// Converts each of `queries` once and prints the latency percentiles and the
+// page faults.
+void BenchmarkLatency(const ConverterInterface &converter,
+                      absl::Span<const std::string> queries,
+                      absl::string_view label) {
+  const PageFaults start = GetPageFaults();
+  std::vector<absl::Duration> latencies;
+  latencies.reserve(queries.size());
+  for (const std::string &query : queries) {
+    Segments segments;
+    const Stopwatch stopwatch = Stopwatch::StartNew();
+    if (!converter.StartConversionWithKey(&segments, query)) {
+      LOG(WARNING) << "Failed to convert: " << query;
+    }
+    latencies.push_back(stopwatch.GetElapsed());
+  }
+  if (latencies.empty()) {
+    return;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](size_t p) {
+    return absl::FormatDuration(latencies[(latencies.size() - 1) * p / 100]);
+  };
+  std::cout << absl::StreamFormat("%s: n=%d p50=%s p90=%s p99=%s max=%s",
+                                  label, latencies.size(), percentile(50),
+                                  percentile(90), percentile(99),
+                                  absl::FormatDuration(latencies.back()))
+            << std::endl;
+  PrintPageFaults(label, start);
+}
+
 bool IsConsistentEngineNameAndType(const std::string &engine_name,
                                    const std::string &engine_type) {
   using NameAndTypeSet = std::set<std::pair<std::string, std::string>>;
@@ -475,6 +550,7 @@ int main(int argc, char **argv) {
             << "\nData file: " << absl::GetFlag(FLAGS_engine_data_path)
             << "\nid.def: " << absl::GetFlag(FLAGS_id_def) << std::endl;
 
+  const mozc::PageFaults load_start = mozc::GetPageFaults();
   absl::StatusOr<std::unique_ptr<mozc::DataManager>> data_manager =
       absl::GetFlag(FLAGS_magic).empty()
           ? mozc::DataManager::CreateFromFile(
@@ -486,7 +562,7 @@ int main(int argc, char **argv) {
 
   mozc::config::Config config = mozc::config::ConfigHandler::DefaultConfig();
   mozc::commands::Request request;
-  std::unique_ptr<mozc::EngineInterface> engine;
+  std::unique_ptr<mozc::Engine> engine;
   if (absl::GetFlag(FLAGS_engine_type) == "desktop") {
     engine =
         mozc::Engine::CreateDesktopEngine(*std::move(data_manager)).value();
@@ -518,6 +594,17 @@ int main(int argc, char **argv) {
     LOG(WARNING) << "Engine name and type do not match.";
   }
 
+  if (absl::GetFlag(FLAGS_benchmark_latency)) {
+    mozc::PrintPageFaults("load", load_start);
+    const std::vector<std::string> queries = mozc::engine::GetWarmupQueries();
+    if (absl::GetFlag(FLAGS_warmup_engine)) {
+      mozc::engine::WarmUpConverter(*converter, queries);
+    }
+    mozc::BenchmarkLatency(*converter, queries, "cold");
+    mozc::BenchmarkLatency(*converter, queries, "warm");
+    return 0;
+  }
+
   mozc::Segments segments;
   std::string line;
 
@@ -75,6 +75,10 @@ class StrictMockConverter : public ConverterInterface {
               (const, override));
   MOCK_METHOD(bool, StartPartialSuggestionWithKey,
               (Segments * segments, absl::string_view key), (const, override));
+  MOCK_METHOD(void, PrefetchLattice,
+              (const ConversionRequest &request, absl::string_view key,
+               Segments *segments),
+              (const, override));
   MOCK_METHOD(void, FinishConversion,
               (const ConversionRequest &request, Segments *segments),
               (const, override));
@@ -51,6 +51,7 @@
 #include "absl/types/span.h"
 #include "base/container/trie.h"
 #include "base/japanese_util.h"
+#include "base/latency_trace.h"
 #include "base/strings/unicode.h"
 #include "base/util.h"
 #include "base/vlog.h"
@@ -244,18 +245,18 @@ void NormalizeHistorySegments(Segments *segments) {
   }
 }
 
-Lattice *GetLattice(Segments *segments, bool is_prediction) {
-  Lattice *lattice = segments->mutable_cached_lattice();
+Lattice *GetLattice(const Segments &segments, bool is_prediction) {
+  Lattice *lattice = segments.mutable_cached_lattice();
   if (lattice == nullptr) {
     return nullptr;
   }
 
   std::string history_key = "";
-  for (const Segment &segment : segments->history_segments()) {
+  for (const Segment &segment : segments.history_segments()) {
     history_key.append(segment.key());
   }
   std::string conversion_key = "";
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment : segments.conversion_segments()) {
     conversion_key.append(segment.key());
   }
 
@@ -1430,7 +1431,8 @@ bool ImmutableConverter::MakeLattice(const ConversionRequest &request,
   // In suggestion mode, ImmutableConverter will not accept multiple-segments.
   // The result always consists of one segment.
   if (is_reverse || is_prediction) {
-    const Segments::range conversion_segments = segments->conversion_segments();
+    const Segments::const_range conversion_segments =
+        std::as_const(*segments).conversion_segments();
     if (conversion_segments.size() != 1 ||
         conversion_segments.front().segment_type() != Segment::FREE) {
       LOG(WARNING) << "ImmutableConverter doesn't support constrained requests";
@@ -1440,7 +1442,8 @@ bool ImmutableConverter::MakeLattice(const ConversionRequest &request,
 
   // Make the conversion key.
   std::string conversion_key;
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     DCHECK(!segment.key().empty());
     conversion_key.append(segment.key());
   }
@@ -1453,7 +1456,7 @@ bool ImmutableConverter::MakeLattice(const ConversionRequest &request,
 
   // Make the history key.
   std::string history_key;
-  for (const Segment &segment : segments->history_segments()) {
+  for (const Segment &segment : std::as_const(*segments).history_segments()) {
     DCHECK(!segment.key().empty());
     history_key.append(segment.key());
   }
@@ -1935,7 +1938,8 @@ void ImmutableConverter::InsertCandidates(const ConversionRequest &request,
                                  suggestion_filter_);
 
   std::string original_key;
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     original_key.append(segment.key());
   }
 
@@ -2267,11 +2271,12 @@ void ImmutableConverter::MakeGroup(const Segments &segments,
 
 bool ImmutableConverter::ConvertForRequest(const ConversionRequest &request,
                                            Segments *segments) const {
+  MOZC_LATENCY_TRACE("ImmutableConverter::ConvertForRequest");
   const bool is_prediction =
       (request.request_type() == ConversionRequest::PREDICTION ||
        request.request_type() == ConversionRequest::SUGGESTION);
 
-  Lattice *lattice = GetLattice(segments, is_prediction);
+  Lattice *lattice = GetLattice(*segments, is_prediction);
 
   if (!MakeLattice(request, segments, lattice)) {
     LOG(WARNING) << "could not make lattice";
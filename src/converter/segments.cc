@@ -433,12 +433,10 @@ std::string Segment::DebugString() const {
 Segments::Segments(const Segments &x)
     : max_history_segments_size_(x.max_history_segments_size_),
       resized_(x.resized_),
-      pool_(32),
-      revert_entries_(x.revert_entries_),
-      cached_lattice_() {
+      revert_entries_(x.revert_entries_) {
   // Deep-copy segments.
-  for (const Segment *segment : x.segments_) {
-    *add_segment() = *segment;
+  for (const std::shared_ptr<Segment> &segment : x.segments_) {
+    segments_.push_back(std::make_shared<Segment>(*segment));
   }
   // Note: cached_lattice_ is not copied to follow the old copy policy.
   // TODO(noriyukit): This design is not intuitive. It'd be better to manage
@@ -451,8 +449,8 @@ Segments &Segments::operator=(const Segments &x) {
   max_history_segments_size_ = x.max_history_segments_size_;
   resized_ = x.resized_;
   // Deep-copy segments.
-  for (const Segment *segment : x.segments_) {
-    *add_segment() = *segment;
+  for (const std::shared_ptr<Segment> &segment : x.segments_) {
+    segments_.push_back(std::make_shared<Segment>(*segment));
   }
   revert_entries_ = x.revert_entries_;
   // Note: cached_lattice_ is not copied; see the comment for the copy
@@ -460,25 +458,44 @@ Segments &Segments::operator=(const Segments &x) {
   return *this;
 }
 
+void Segments::ShareSegments(const Segments &other) {
+  if (this == &other) {
+    return;
+  }
+  Clear();
+  max_history_segments_size_ = other.max_history_segments_size_;
+  resized_ = other.resized_;
+  segments_ = other.segments_;
+  revert_entries_ = other.revert_entries_;
+  // Note: cached_lattice_ is not shared; see the comment for the copy
+  // constructor.
+}
+
+// static
+Segment *Segments::Unshare(std::shared_ptr<Segment> &segment) {
+  if (segment.use_count() > 1) {
+    segment = std::make_shared<Segment>(*segment);
+  }
+  return segment.get();
+}
+
+void Segments::UnshareRange(inner_iterator first, inner_iterator last) {
+  for (; first != last; ++first) {
+    Unshare(*first);
+  }
+}
+
 Segment *Segments::insert_segment(size_t i) {
-  Segment *segment = pool_.Alloc();
-  segment->Clear();
-  segments_.insert(segments_.begin() + i, segment);
-  return segment;
+  return segments_.insert(segments_.begin() + i, std::make_shared<Segment>())
+      ->get();
 }
 
 Segment *Segments::push_back_segment() {
-  Segment *segment = pool_.Alloc();
-  segment->Clear();
-  segments_.push_back(segment);
-  return segment;
+  return segments_.emplace_back(std::make_shared<Segment>()).get();
 }
 
 Segment *Segments::push_front_segment() {
-  Segment *segment = pool_.Alloc();
-  segment->Clear();
-  segments_.push_front(segment);
-  return segment;
+  return segments_.emplace_front(std::make_shared<Segment>()).get();
 }
 
 // Returns an `Iterator` for the end of history segments.
@@ -513,7 +530,9 @@ size_t Segments::history_segments_size() const {
 }
 
 Segments::range Segments::history_segments() {
-  return make_range(begin(), history_segments_end());
+  const iterator end = history_segments_end();
+  UnshareRange(segments_.begin(), end.iterator_);
+  return make_range(iterator{segments_.begin()}, end);
 }
 
 Segments::const_range Segments::history_segments() const {
@@ -521,7 +540,9 @@ Segments::const_range Segments::history_segments() const {
 }
 
 Segments::range Segments::conversion_segments() {
-  return make_range(history_segments_end(), end());
+  const iterator first = history_segments_end();
+  UnshareRange(first.iterator_, segments_.end());
+  return make_range(first, end());
 }
 
 Segments::const_range Segments::conversion_segments() const {
@@ -532,11 +553,10 @@ void Segments::erase_segment(size_t i) {
   if (i >= segments_size()) {
     return;
   }
-  erase_segment(begin() + i);
+  segments_.erase(segments_.begin() + i);
 }
 
 Segments::iterator Segments::erase_segment(iterator position) {
-  pool_.Release(&*position);
   return iterator{segments_.erase(position.iterator_)};
 }
 
@@ -545,48 +565,54 @@ void Segments::erase_segments(size_t i, size_t size) {
   if (i >= segments_size() || end > segments_size()) {
     return;
   }
-  erase_segments(begin() + i, begin() + end);
+  segments_.erase(segments_.begin() + i, segments_.begin() + end);
 }
 
 Segments::iterator Segments::erase_segments(iterator first, iterator last) {
-  for (auto it = first; it != last; ++it) {
-    pool_.Release(&*it);
-  }
   return iterator{segments_.erase(first.iterator_, last.iterator_)};
 }
 
 void Segments::pop_front_segment() {
   if (!segments_.empty()) {
-    Segment *seg = segments_.front();
-    pool_.Release(seg);
     segments_.pop_front();
   }
 }
 
 void Segments::pop_back_segment() {
   if (!segments_.empty()) {
-    Segment *seg = segments_.back();
-    pool_.Release(seg);
     segments_.pop_back();
   }
 }
 
+Lattice *Segments::mutable_cached_lattice() const {
+  if (cached_lattice_ == nullptr) {
+    cached_lattice_ = std::make_shared<Lattice>();
+  }
+  return cached_lattice_.get();
+}
+
+void Segments::ShareCachedLattice(const Segments &other) {
+  if (other.cached_lattice_ == nullptr) {
+    other.cached_lattice_ = std::make_shared<Lattice>();
+  }
+  cached_lattice_ = other.cached_lattice_;
+}
+
 void Segments::Clear() {
   clear_segments();
   clear_revert_entries();
 }
 
 void Segments::clear_segments() {
-  pool_.Free();
   resized_ = false;
   segments_.clear();
 }
 
 void Segments::clear_history_segments() {
   while (!segments_.empty()) {
-    Segment *seg = segments_.front();
-    if (seg->segment_type() != Segment::HISTORY &&
-        seg->segment_type() != Segment::SUBMITTED) {
+    const Segment &seg = *segments_.front();
+    if (seg.segment_type() != Segment::HISTORY &&
+        seg.segment_type() != Segment::SUBMITTED) {
       break;
     }
     pop_front_segment();
@@ -43,7 +43,6 @@
 
 #include "absl/log/check.h"
 #include "absl/strings/string_view.h"
-#include "base/container/freelist.h"
 #include "base/number_util.h"
 #include "base/strings/assign.h"
 #include "converter/lattice.h"
@@ -467,21 +466,19 @@ class Segments final {
 
   // This class wraps an iterator as is, except that `operator*` dereferences
   // twice. For example, if `InnnerIterator` is the iterator of
-  // `std::deque<Segment *>`, `operator*` dereferences to `Segment&`.
-  using inner_iterator = std::deque<Segment *>::iterator;
-  using inner_const_iterator = std::deque<Segment *>::const_iterator;
+  // `std::deque<std::shared_ptr<Segment>>`, `operator*` dereferences to
+  // `Segment&`. Iterators never copy shared segments by themselves; the
+  // non-const `begin()` and ranges unshare the segments they cover instead.
+  // See ShareSegments().
+  using inner_iterator = std::deque<std::shared_ptr<Segment>>::iterator;
+  using inner_const_iterator =
+      std::deque<std::shared_ptr<Segment>>::const_iterator;
   template <typename InnerIterator, bool is_const = false>
   class Iterator {
    public:
-    using inner_value_type =
-        typename std::iterator_traits<InnerIterator>::value_type;
-
     using iterator_category =
         typename std::iterator_traits<InnerIterator>::iterator_category;
-    using value_type = std::conditional_t<
-        is_const,
-        typename std::add_const_t<std::remove_pointer_t<inner_value_type>>,
-        typename std::remove_pointer_t<inner_value_type>>;
+    using value_type = std::conditional_t<is_const, const Segment, Segment>;
     using difference_type =
         typename std::iterator_traits<InnerIterator>::difference_type;
     using pointer = value_type *;
@@ -495,8 +492,8 @@ class Segments final {
                  iterator)
         : iterator_(iterator.iterator_) {}
 
-    reference operator*() const { return **iterator_; }
-    pointer operator->() const { return *iterator_; }
+    reference operator*() const { return *operator->(); }
+    pointer operator->() const { return iterator_->get(); }
 
     Iterator &operator++() {
       ++iterator_;
@@ -601,17 +598,18 @@ class Segments final {
   using const_range = Range<const_iterator>;
 
   // constructors
-  Segments()
-      : max_history_segments_size_(0),
-        resized_(false),
-        pool_(32),
-        cached_lattice_() {}
+  Segments() : max_history_segments_size_(0), resized_(false) {}
 
   Segments(const Segments &x);
   Segments &operator=(const Segments &x);
 
   // iterators
-  iterator begin() { return iterator{segments_.begin()}; }
+  // The non-const `begin()` unshares all segments, so prefer the const
+  // overload when only reading.
+  iterator begin() {
+    UnshareRange(segments_.begin(), segments_.end());
+    return iterator{segments_.begin()};
+  }
   iterator end() { return iterator{segments_.end()}; }
   const_iterator begin() const { return const_iterator{segments_.begin()}; }
   const_iterator end() const { return const_iterator{segments_.end()}; }
@@ -623,6 +621,7 @@ class Segments final {
     return Range<Iterator>(begin, end);
   }
 
+  // The non-const ranges unshare the segments they cover.
   range all() { return make_range(begin(), end()); }
   const_range all() const { return make_range(begin(), end()); }
   range history_segments();
@@ -638,11 +637,11 @@ class Segments final {
   const Segment &history_segment(size_t i) const { return *segments_[i]; }
 
   // setter
-  Segment *mutable_segment(size_t i) { return segments_[i]; }
+  Segment *mutable_segment(size_t i) { return Unshare(segments_[i]); }
   Segment *mutable_conversion_segment(size_t i) {
-    return segments_[i + history_segments_size()];
+    return Unshare(segments_[i + history_segments_size()]);
   }
-  Segment *mutable_history_segment(size_t i) { return segments_[i]; }
+  Segment *mutable_history_segment(size_t i) { return Unshare(segments_[i]); }
 
   // push and insert segments
   Segment *push_front_segment();
@@ -704,23 +703,51 @@ class Segments final {
   const RevertEntry &revert_entry(size_t i) const { return revert_entries_[i]; }
   RevertEntry *mutable_revert_entry(size_t i) { return &revert_entries_[i]; }
 
-  // setter
-  Lattice *mutable_cached_lattice() { return &cached_lattice_; }
+  // Returns the lattice cache used by ImmutableConverter. The lattice is
+  // allocated on first use.
+  // This is a const method as the lattice is not a part of the logical state.
+  Lattice *mutable_cached_lattice() const;
+
+  // Makes this instance a copy of `other` that shares the segments with it
+  // until either instance modifies them (copy-on-write). Unlike the copy
+  // assignment, the candidates are not copied, so the cost doesn't depend on
+  // the number of candidates. A segment is copied when it is accessed through
+  // a mutable accessor, the non-const `begin()` or a non-const range of either
+  // instance, so `Segment` pointers and iterators of `other` obtained before
+  // this call must not be used for modification after it. Reading through
+  // const accessors never copies.
+  void ShareSegments(const Segments &other);
+
+  // Makes this instance use the same lattice cache as `other`. The predictor
+  // runs realtime conversion on a temporary copy of the session segments, and
+  // sharing the cache lets the next keystroke extend the previous lattice
+  // (see Lattice::UpdateKey()) instead of rebuilding it from scratch.
+  void ShareCachedLattice(const Segments &other);
+
+  // Releases the lattice cache. A new one is allocated on the next use.
+  void ClearCachedLattice() { cached_lattice_.reset(); }
 
  private:
   FRIEND_TEST(SegmentsTest, BasicTest);
+  FRIEND_TEST(SegmentsTest, ReadOnlyPassKeepsSegmentsShared);
 
   iterator history_segments_end();
   const_iterator history_segments_end() const;
 
+  // Copies the segment if it is shared with another instance, and returns it.
+  static Segment *Unshare(std::shared_ptr<Segment> &segment);
+  static void UnshareRange(inner_iterator first, inner_iterator last);
+
   // LINT.IfChange
   size_t max_history_segments_size_;
   bool resized_;
 
-  ObjectPool<Segment> pool_;
-  std::deque<Segment *> segments_;
+  // Segments may be shared with other instances; see ShareSegments().
+  std::deque<std::shared_ptr<Segment>> segments_;
   std::vector<RevertEntry> revert_entries_;
-  Lattice cached_lattice_;
+  // The lattice is a cache and not a part of the logical state, so it can be
+  // shared from a const instance. See ShareCachedLattice().
+  mutable std::shared_ptr<Lattice> cached_lattice_;
   // LINT.ThenChange(//converter/segments_matchers.h)
 };
 
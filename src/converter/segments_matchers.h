@@ -207,8 +207,7 @@ MATCHER_P(ContainsCandidate, matcher, "") {
 }
 
 // Checks if a segments exactly matches the given segments except for the
-// following three fields:
-//   * pool_
+// following two fields:
 //   * revert_entries_
 //   * cached_lattice_
 // Note: this is more useful than defining operator==() in testing as it can
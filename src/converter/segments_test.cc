@@ -39,6 +39,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "base/number_util.h"
+#include "converter/lattice.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 
@@ -104,19 +105,17 @@ TEST(SegmentsTest, BasicTest) {
   segments.erase_segment(1);
   EXPECT_EQ(segments.mutable_segment(0), seg[0]);
   EXPECT_EQ(segments.mutable_segment(1), seg[2]);
-  EXPECT_EQ(segments.pool_.released_.size(), 1);
+  EXPECT_EQ(segments.segments_size(), 4);
 
   segments.erase_segments(1, 2);
   EXPECT_EQ(segments.mutable_segment(0), seg[0]);
   EXPECT_EQ(segments.mutable_segment(1), seg[4]);
-  EXPECT_EQ(segments.pool_.released_.size(), 3);
 
   EXPECT_EQ(segments.segments_size(), 2);
 
   segments.erase_segments(0, 1);
   EXPECT_EQ(segments.segments_size(), 1);
   EXPECT_EQ(segments.mutable_segment(0), seg[4]);
-  EXPECT_EQ(segments.pool_.released_.size(), 4);
 
   // insert
   seg[1] = segments.insert_segment(1);
@@ -401,6 +400,116 @@ TEST(SegmentsTest, CopyTest) {
   }
 }
 
+TEST(SegmentsTest, ShareSegmentsTest) {
+  Segments src;
+  src.set_max_history_segments_size(1);
+  for (int i = 0; i < 2; ++i) {
+    Segment *segment = src.add_segment();
+    segment->set_key(absl::StrFormat("segment_%d", i));
+    segment->add_candidate()->value = absl::StrFormat("candidate_%d", i);
+  }
+
+  Segments dest;
+  dest.ShareSegments(src);
+  EXPECT_EQ(dest.max_history_segments_size(), 1);
+  ASSERT_EQ(dest.segments_size(), 2);
+  // The segments are shared until modified.
+  EXPECT_EQ(&dest.segment(0), &src.segment(0));
+  EXPECT_EQ(&dest.segment(1), &src.segment(1));
+
+  // Modifying a segment copies only that segment.
+  dest.mutable_segment(0)->mutable_candidate(0)->value = "modified";
+  EXPECT_NE(&dest.segment(0), &src.segment(0));
+  EXPECT_EQ(&dest.segment(1), &src.segment(1));
+  EXPECT_EQ(dest.segment(0).candidate(0).value, "modified");
+  EXPECT_EQ(src.segment(0).candidate(0).value, "candidate_0");
+
+  // So does the non-const iterator of the source.
+  for (Segment &segment : src) {
+    segment.set_key("src");
+  }
+  EXPECT_NE(&dest.segment(1), &src.segment(1));
+  EXPECT_EQ(dest.segment(1).key(), "segment_1");
+
+  // Structural changes don't affect the other instance.
+  src.clear_segments();
+  EXPECT_EQ(dest.segments_size(), 2);
+}
+
+TEST(SegmentsTest, ReadOnlyPassKeepsSegmentsShared) {
+  Segments src;
+  for (int i = 0; i < 2; ++i) {
+    Segment *segment = src.add_segment();
+    segment->set_key(absl::StrFormat("segment_%d", i));
+    segment->add_candidate()->value = absl::StrFormat("candidate_%d", i);
+  }
+  src.mutable_segment(0)->set_segment_type(Segment::HISTORY);
+
+  Segments dest;
+  dest.ShareSegments(src);
+  ASSERT_EQ(dest.segments_[0].use_count(), 2);
+  ASSERT_EQ(dest.segments_[1].use_count(), 2);
+
+  // Reading through the const accessors and ranges of a non-const instance
+  // doesn't copy the segments.
+  const Segments &const_dest = dest;
+  std::string key;
+  for (const Segment &segment : const_dest) {
+    key += segment.key();
+  }
+  for (const Segment &segment : const_dest.history_segments()) {
+    key += segment.candidate(0).value;
+  }
+  for (const Segment &segment : const_dest.conversion_segments()) {
+    key += segment.candidate(0).value;
+  }
+  key += dest.segment(0).key();
+  key += dest.conversion_segment(0).key();
+  EXPECT_FALSE(key.empty());
+  EXPECT_EQ(dest.segments_[0].use_count(), 2);
+  EXPECT_EQ(dest.segments_[1].use_count(), 2);
+
+  // A non-const range unshares only the segments it covers.
+  for (Segment &segment : dest.conversion_segments()) {
+    segment.set_key("modified");
+  }
+  EXPECT_EQ(dest.segments_[0].use_count(), 2);
+  EXPECT_EQ(dest.segments_[1].use_count(), 1);
+  EXPECT_EQ(src.conversion_segment(0).key(), "segment_1");
+
+  // So does a mutable accessor.
+  dest.mutable_history_segment(0)->set_key("modified");
+  EXPECT_EQ(dest.segments_[0].use_count(), 1);
+  EXPECT_EQ(src.history_segment(0).key(), "segment_0");
+}
+
+TEST(SegmentsTest, CachedLatticeTest) {
+  Segments src;
+  Lattice *lattice = src.mutable_cached_lattice();
+  ASSERT_NE(lattice, nullptr);
+  lattice->SetKey("test");
+
+  // The lattice cache is not copied.
+  Segments copied = src;
+  EXPECT_NE(copied.mutable_cached_lattice(), lattice);
+  EXPECT_TRUE(copied.mutable_cached_lattice()->key().empty());
+
+  // The lattice cache can be shared explicitly, even from a const instance.
+  Segments shared;
+  shared.ShareCachedLattice(static_cast<const Segments &>(src));
+  EXPECT_EQ(shared.mutable_cached_lattice(), lattice);
+  shared.mutable_cached_lattice()->AddSuffix("s");
+  EXPECT_EQ(src.mutable_cached_lattice()->key(), "tests");
+
+  // The shared lattice outlives the original instance.
+  {
+    Segments tmp;
+    shared.ShareCachedLattice(tmp);
+  }
+  EXPECT_NE(shared.mutable_cached_lattice(), lattice);
+  EXPECT_TRUE(shared.mutable_cached_lattice()->key().empty());
+}
+
 TEST(CandidateTest, functional_key) {
   Segment::Candidate candidate;
 
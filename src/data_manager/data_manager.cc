@@ -41,21 +41,37 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/flags/flag.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "base/container/serialized_string_array.h"
 #include "base/mmap.h"
+#include "base/thread.h"
 #include "base/version.h"
 #include "base/vlog.h"
 #include "data_manager/dataset_reader.h"
 #include "data_manager/serialized_dictionary.h"
 #include "protocol/segmenter_data.pb.h"
 
+ABSL_FLAG(bool, data_madvise, false,
+          "If true, advises the kernel of the access pattern of each section "
+          "of the data set file.");
+ABSL_FLAG(bool, data_mlock_hot_sections, false,
+          "If true, locks the sections of the data set file used by every "
+          "conversion in memory.");
+ABSL_FLAG(bool, data_prefault, false,
+          "If true, reads every page of the data set file on a background "
+          "thread after loading it.");
+ABSL_FLAG(bool, data_verify_fingerprints, false,
+          "If true, verifies the fingerprints of the data set file sections "
+          "when loading it.");
+
 namespace mozc {
 namespace {
 
@@ -164,6 +180,11 @@ DataManager::Status DataManager::InitFromArray(absl::string_view array,
     LOG(ERROR) << "Binary data of size " << array.size() << " is broken";
     return DataManager::Status::DATA_BROKEN;
   }
+  // The checksum in the footer is not verified here, so the data is identified
+  // by its memory, which doesn't change while this instance is alive.
+  data_checksum_ =
+      absl::StrCat("@", absl::Hex(reinterpret_cast<uintptr_t>(array.data())),
+                   ":", array.size());
   return InitFromReader(reader);
 }
 
@@ -397,6 +418,7 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
                     &usage_conjugation_suffix_data_) ||
         !reader.Get("usage_conjugation_index",
                     &usage_conjugation_index_data_) ||
+        !reader.Get("usage_index", &usage_index_data_) ||
         !reader.Get("usage_string_array", &usage_string_array_data_)) {
       LOG(ERROR) << "Cannot find some usage dictionary data components";
       return Status::DATA_MISSING;
@@ -405,6 +427,10 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
       LOG(ERROR) << "Usage dictionary's string array is broken";
       return Status::DATA_BROKEN;
     }
+    if (usage_index_data_.size() % (2 * sizeof(uint32_t)) != 0) {
+      LOG(ERROR) << "Usage dictionary's index is broken";
+      return Status::DATA_BROKEN;
+    }
   }
 
   if (!reader.Get("version", &data_version_)) {
@@ -434,15 +460,84 @@ DataManager::Status DataManager::InitFromFile(const std::string &path) {
 
 DataManager::Status DataManager::InitFromFile(const std::string &path,
                                               absl::string_view magic) {
+  return InitFromFile(path, magic, LoadPolicy::FromFlags());
+}
+
+DataManager::Status DataManager::InitFromFile(const std::string &path,
+                                              absl::string_view magic,
+                                              const LoadPolicy &policy) {
   absl::StatusOr<Mmap> mmap = Mmap::Map(path, Mmap::READ_ONLY);
   if (!mmap.ok()) {
     LOG(ERROR) << mmap.status();
     return Status::MMAP_FAILURE;
   }
   filename_ = path;
+  prefault_.reset();
   mmap_ = *std::move(mmap);
   const absl::string_view data(mmap_.begin(), mmap_.size());
-  return InitFromArray(data, magic);
+  std::string verified_digest;
+  if (policy.verify_fingerprints) {
+    DataSetReader reader;
+    if (!reader.Init(data, magic) || !reader.VerifyFingerprints()) {
+      LOG(ERROR) << "Data set file " << path << " is broken";
+      return Status::DATA_BROKEN;
+    }
+    verified_digest = reader.GetVerifiedDigest();
+  }
+  const Status status = InitFromArray(data, magic);
+  if (status == Status::OK) {
+    if (!verified_digest.empty()) {
+      // Identifies the content also among the data managers mapping the same
+      // file separately.
+      data_checksum_ = std::move(verified_digest);
+    }
+    load_policy_ = policy;
+    ApplyLoadPolicy();
+  }
+  return status;
+}
+
+DataManager::LoadPolicy DataManager::LoadPolicy::FromFlags() {
+  return LoadPolicy{
+      .madvise = absl::GetFlag(FLAGS_data_madvise),
+      .mlock_hot_sections = absl::GetFlag(FLAGS_data_mlock_hot_sections),
+      .prefault = absl::GetFlag(FLAGS_data_prefault),
+      .verify_fingerprints = absl::GetFlag(FLAGS_data_verify_fingerprints),
+  };
+}
+
+void DataManager::ApplyLoadPolicy() {
+  // The sections read by every conversion.  The others, e.g. the system
+  // dictionary and the rewriter data, are read sparsely.
+  const absl::string_view hot_sections[] = {
+      pos_matcher_data_, connection_data_,  pos_group_data_,
+      boundary_data_,    segmenter_ltable_, segmenter_rtable_,
+      segmenter_bitarray_,
+  };
+  if (load_policy_.madvise) {
+    Mmap::MaybeMAdvise(mmap_.data(), mmap_.size(), Mmap::RANDOM);
+    for (const absl::string_view section : hot_sections) {
+      Mmap::MaybeMAdvise(section.data(), section.size(), Mmap::WILL_NEED);
+    }
+  }
+  if (load_policy_.mlock_hot_sections) {
+    // The pages are unlocked when `mmap_` is closed.  We don't check the
+    // return value because the process doesn't necessarily have the privilege
+    // to mlock.
+    for (const absl::string_view section : hot_sections) {
+      Mmap::MaybeMLock(section.data(), section.size());
+    }
+  }
+  if (load_policy_.prefault) {
+    prefault_.emplace([data = absl::string_view(mmap_.data(), mmap_.size())] {
+      // Reads a byte of every page.  4KB is the smallest page size in use.
+      constexpr size_t kPageSize = 4096;
+      volatile char sink = 0;
+      for (size_t i = 0; i < data.size(); i += kPageSize) {
+        sink = sink + data[i];
+      }
+    });
+  }
 }
 
 DataManager::Status DataManager::InitUserPosManagerDataFromArray(
@@ -466,6 +561,7 @@ DataManager::Status DataManager::InitUserPosManagerDataFromFile(
     LOG(ERROR) << mmap.status();
     return Status::MMAP_FAILURE;
   }
+  prefault_.reset();
   mmap_ = *std::move(mmap);
   const absl::string_view data(mmap_.begin(), mmap_.size());
   return InitUserPosManagerDataFromArray(data, magic);
@@ -604,17 +700,23 @@ void DataManager::GetUsageRewriterData(
     absl::string_view *conjugation_suffix_data,
     absl::string_view *conjugation_index_data,
     absl::string_view *usage_items_data,
+    absl::string_view *usage_index_data,
     absl::string_view *string_array_data) const {
   *base_conjugation_suffix_data = usage_base_conjugation_suffix_data_;
   *conjugation_suffix_data = usage_conjugation_suffix_data_;
   *conjugation_index_data = usage_conjugation_index_data_;
   *usage_items_data = usage_items_data_;
+  *usage_index_data = usage_index_data_;
   *string_array_data = usage_string_array_data_;
 }
 #endif  // NO_USAGE_REWRITER
 
 absl::string_view DataManager::GetDataVersion() const { return data_version_; }
 
+absl::string_view DataManager::GetDataChecksum() const {
+  return data_checksum_;
+}
+
 std::optional<std::pair<size_t, size_t>> DataManager::GetOffsetAndSize(
     absl::string_view name) const {
   if (const auto iter = offset_and_size_.find(name);
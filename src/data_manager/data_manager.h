@@ -44,6 +44,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "base/mmap.h"
+#include "base/thread.h"
 #include "data_manager/data_manager_interface.h"
 
 namespace mozc {
@@ -66,6 +67,30 @@ class DataManager : public DataManagerInterface {
     UNKNOWN = 5,
   };
 
+  // Policies for paging in the data set file mapped by InitFromFile().  They
+  // are all off by default and can be chosen per deployment with the flags
+  // --data_madvise, --data_mlock_hot_sections, --data_prefault and
+  // --data_verify_fingerprints.
+  struct LoadPolicy {
+    // Advises the kernel of the access pattern of each section: the sections
+    // used by every conversion, e.g. the connection matrix and the segmenter,
+    // are read ahead, while the others, e.g. the system dictionary and the
+    // rewriter data, are read randomly.  The system dictionary advises its
+    // tries and token array separately.
+    bool madvise = false;
+    // Locks the pages of the sections used by every conversion in memory.
+    bool mlock_hot_sections = false;
+    // Reads every page of the data set on a background thread, so that the
+    // first conversions don't wait for page faults.
+    bool prefault = false;
+    // Verifies the fingerprint of each section before using it, in parallel for
+    // large sections.  InitFromFile() returns DATA_BROKEN on mismatch.
+    bool verify_fingerprints = false;
+
+    // Returns the policy given by the flags.
+    static LoadPolicy FromFlags();
+  };
+
   static std::string StatusCodeToString(Status code);
   static absl::string_view GetDataSetMagicNumber(absl::string_view type);
 
@@ -87,9 +112,12 @@ class DataManager : public DataManagerInterface {
   Status InitFromArray(absl::string_view array, absl::string_view magic);
 
   // The same as above InitFromArray() but the data is loaded using mmap, which
-  // is owned in this instance.
+  // is owned in this instance.  The load policy is given by the flags unless
+  // specified.
   Status InitFromFile(const std::string &path);
   Status InitFromFile(const std::string &path, absl::string_view magic);
+  Status InitFromFile(const std::string &path, absl::string_view magic,
+                      const LoadPolicy &policy);
 
   // The same as above InitFromArray() but only parses data set for user pos
   // manager.  For mozc runtime modules, use InitFromArray() because this method
@@ -155,10 +183,15 @@ class DataManager : public DataManagerInterface {
       absl::string_view *conjugation_suffix_data,
       absl::string_view *conjugation_index_data,
       absl::string_view *usage_items_data,
+      absl::string_view *usage_index_data,
       absl::string_view *string_array_data) const override;
 #endif  // NO_USAGE_REWRITER
 
   absl::string_view GetDataVersion() const override;
+  absl::string_view GetDataChecksum() const override;
+  bool ShouldAdviseAccessPatterns() const override {
+    return load_policy_.madvise;
+  }
 
   std::optional<std::pair<size_t, size_t>> GetOffsetAndSize(
       absl::string_view name) const override;
@@ -166,6 +199,9 @@ class DataManager : public DataManagerInterface {
  private:
   Status InitFromReader(const DataSetReader &reader);
 
+  // Applies `load_policy_` to the sections of `mmap_`.
+  void ApplyLoadPolicy();
+
   std::optional<std::string> filename_ = std::nullopt;
   Mmap mmap_;
   absl::string_view pos_matcher_data_;
@@ -213,9 +249,14 @@ class DataManager : public DataManagerInterface {
   absl::string_view usage_conjugation_suffix_data_;
   absl::string_view usage_conjugation_index_data_;
   absl::string_view usage_items_data_;
+  absl::string_view usage_index_data_;
   absl::string_view usage_string_array_data_;
   absl::string_view data_version_;
+  std::string data_checksum_;
   absl::flat_hash_map<std::string, std::pair<size_t, size_t>> offset_and_size_;
+  LoadPolicy load_policy_;
+  // Declared after `mmap_` to finish prefaulting before unmapping.
+  std::optional<BackgroundFuture<void>> prefault_;
 };
 
 // Print helper for DataManager::Status.  Logging, e.g., CHECK_EQ(), requires
@@ -88,6 +88,7 @@
       'dependencies': [
         '<(mozc_oss_src_dir)/base/absl.gyp:absl_strings',
         '<(mozc_oss_src_dir)/base/base.gyp:base',
+        '<(mozc_oss_src_dir)/base/base.gyp:hash',
         '<(mozc_oss_src_dir)/base/base.gyp:obfuscator_support',
         'dataset_proto',
       ],
@@ -102,6 +103,7 @@
       'dependencies': [
         '<(mozc_oss_src_dir)/base/absl.gyp:absl_strings',
         '<(mozc_oss_src_dir)/base/base.gyp:base',
+        '<(mozc_oss_src_dir)/base/base.gyp:hash',
         '<(mozc_oss_src_dir)/base/base.gyp:obfuscator_support',
         'dataset_proto',
       ],
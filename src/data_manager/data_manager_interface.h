@@ -135,6 +135,7 @@ class DataManagerInterface {
       absl::string_view *conjugation_suffix_data,
       absl::string_view *conjugation_suffix_index_data,
       absl::string_view *usage_items_data,
+      absl::string_view *usage_index_data,
       absl::string_view *string_array_data) const = 0;
 #endif  // NO_USAGE_REWRITER
 
@@ -152,6 +153,19 @@ class DataManagerInterface {
   // Gets the data version string.
   virtual absl::string_view GetDataVersion() const = 0;
 
+  // Gets the checksum that identifies the content of the data set.  Two data
+  // managers with the same non-empty checksum provide the same data, so it
+  // must not be derived from unverified data, e.g., the checksum stored in a
+  // data set file.  This may be empty if the data manager can't identify its
+  // data.
+  virtual absl::string_view GetDataChecksum() const {
+    return absl::string_view();
+  }
+
+  // Returns true if the modules using the data should advise the kernel of
+  // their access patterns to it.  See DataManager::LoadPolicy.
+  virtual bool ShouldAdviseAccessPatterns() const { return false; }
+
   // Gets the offset and size of the given data section.
   virtual std::optional<std::pair<size_t, size_t>> GetOffsetAndSize(
       absl::string_view name) const {
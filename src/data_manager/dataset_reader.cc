@@ -34,12 +34,17 @@
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/log.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "base/hash.h"
+#include "base/thread.h"
 #include "base/unverified_sha1.h"
 #include "base/util.h"
 #include "data_manager/dataset.pb.h"
@@ -55,6 +60,7 @@ constexpr size_t kFooterSize = 36;
 bool DataSetReader::Init(absl::string_view memblock, absl::string_view magic) {
   memblock_ = memblock;
   name_to_data_map_.clear();
+  name_to_fingerprint_map_.clear();
 
   // Initializes |name_to_data_map_| from |memblock|.  For binary data format,
   // see dataset.proto.
@@ -136,6 +142,9 @@ bool DataSetReader::Init(absl::string_view memblock, absl::string_view magic) {
     }
     name_to_data_map_[e.name()] =
         absl::ClippedSubstr(memblock, e.offset(), e.size());
+    if (e.has_fingerprint()) {
+      name_to_fingerprint_map_[e.name()] = e.fingerprint();
+    }
     prev_chunk_end = e.offset() + e.size();
   }
 
@@ -161,6 +170,53 @@ std::optional<std::pair<size_t, size_t>> DataSetReader::GetOffsetAndSize(
   return std::make_pair(offset, data.size());
 }
 
+bool DataSetReader::VerifyFingerprints() const {
+  if (name_to_fingerprint_map_.size() != name_to_data_map_.size()) {
+    // The data set was written before the fingerprints were added.
+    return VerifyChecksum(memblock_);
+  }
+
+  // Large data, e.g., the system dictionary, are verified on their own threads
+  // and the others on this thread, so the time is bounded by the largest one.
+  constexpr size_t kMinSizeToVerifyInBackground = 1 << 20;
+  const auto verify = [this](absl::string_view name, absl::string_view data) {
+    if (Fingerprint(data) != name_to_fingerprint_map_.at(name)) {
+      LOG(ERROR) << "Broken: fingerprint mismatch: " << name;
+      return false;
+    }
+    return true;
+  };
+  std::vector<BackgroundFuture<bool>> futures;
+  bool result = true;
+  for (const auto& [name, data] : name_to_data_map_) {
+    if (data.size() >= kMinSizeToVerifyInBackground) {
+      futures.emplace_back(verify, name, data);
+    } else if (!verify(name, data)) {
+      result = false;
+    }
+  }
+  for (const BackgroundFuture<bool>& future : futures) {
+    result = future.Get() && result;
+  }
+  return result;
+}
+
+std::string DataSetReader::GetVerifiedDigest() const {
+  if (name_to_fingerprint_map_.size() != name_to_data_map_.size()) {
+    // VerifyFingerprints() verifies the checksum instead.
+    return std::string(GetChecksum(memblock_));
+  }
+  std::vector<std::pair<absl::string_view, uint64_t>> fingerprints(
+      name_to_fingerprint_map_.begin(), name_to_fingerprint_map_.end());
+  absl::c_sort(fingerprints);
+  std::string buffer;
+  for (const auto &[name, fingerprint] : fingerprints) {
+    absl::StrAppend(&buffer, name.size(), ":", name, ":", fingerprint, ";");
+  }
+  const uint64_t digest = Fingerprint(buffer);
+  return std::string(reinterpret_cast<const char *>(&digest), sizeof(digest));
+}
+
 bool DataSetReader::VerifyChecksum(absl::string_view memblock) {
   if (memblock.size() < kFooterSize) {
     return false;
@@ -168,13 +224,16 @@ bool DataSetReader::VerifyChecksum(absl::string_view memblock) {
   // Checksum is computed for all but last 28 bytes.
   const std::string& actual_checksum = internal::UnverifiedSHA1::MakeDigest(
       memblock.substr(0, memblock.size() - 28));
+  return actual_checksum == GetChecksum(memblock);
+}
 
+absl::string_view DataSetReader::GetChecksum(absl::string_view memblock) {
+  if (memblock.size() < kFooterSize) {
+    return absl::string_view();
+  }
   // Extract the stored SHA1; see dataset.proto for file format.
   const std::size_t kSHA1Length = 20;
-  absl::string_view expected_checksum =
-      absl::ClippedSubstr(memblock, memblock.size() - 28, kSHA1Length);
-
-  return actual_checksum == expected_checksum;
+  return absl::ClippedSubstr(memblock, memblock.size() - 28, kSHA1Length);
 }
 
 }  // namespace mozc
@@ -31,6 +31,7 @@
 #define MOZC_DATA_MANAGER_DATASET_READER_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <utility>
@@ -57,9 +58,24 @@ class DataSetReader {
   std::optional<std::pair<size_t, size_t>> GetOffsetAndSize(
       absl::string_view name) const;
 
+  // Verifies the fingerprint of each data in the binary image given to Init().
+  // Large data are verified in parallel.  Falls back to VerifyChecksum() if the
+  // image has no fingerprints, i.e., it was written by an old version.
+  bool VerifyFingerprints() const;
+
+  // Returns a digest of the binary image given to Init(), which identifies its
+  // content once VerifyFingerprints() has succeeded: the fingerprint of the
+  // names and the fingerprints of all the data, or the checksum in the footer
+  // if the image has no fingerprints.
+  std::string GetVerifiedDigest() const;
+
   // Verifies the checksum of binary image.
   static bool VerifyChecksum(absl::string_view memblock);
 
+  // Gets the SHA1 checksum stored in the footer of binary image without
+  // verifying it.  Returns an empty string if the image is too small.
+  static absl::string_view GetChecksum(absl::string_view memblock);
+
   const absl::flat_hash_map<std::string, absl::string_view> &name_to_data_map()
       const {
     return name_to_data_map_;
@@ -70,6 +86,7 @@ class DataSetReader {
 
   // The value points to a block of the specified |memblock|.
   absl::flat_hash_map<std::string, absl::string_view> name_to_data_map_;
+  absl::flat_hash_map<std::string, uint64_t> name_to_fingerprint_map_;
 };
 
 }  // namespace mozc
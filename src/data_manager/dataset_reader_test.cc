@@ -36,12 +36,14 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <utility>
 
 #include "absl/random/distributions.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "base/random.h"
+#include "base/unverified_sha1.h"
 #include "base/util.h"
 #include "data_manager/dataset.pb.h"
 #include "data_manager/dataset_writer.h"
@@ -86,6 +88,117 @@ TEST(DataSetReaderTest, ValidData) {
   EXPECT_EQ(r.GetOffsetAndSize("foo"), std::nullopt);
 }
 
+TEST(DataSetReaderTest, GetChecksum) {
+  std::string image1, image2;
+  {
+    DataSetWriter w(kTestMagicNumber);
+    w.Add("google", 16, "GOOGLE");
+    std::stringstream out;
+    w.Finish(&out);
+    image1 = out.str();
+  }
+  {
+    DataSetWriter w(kTestMagicNumber);
+    w.Add("google", 16, "google");
+    std::stringstream out;
+    w.Finish(&out);
+    image2 = out.str();
+  }
+  EXPECT_EQ(DataSetReader::GetChecksum(image1).size(), 20);
+  EXPECT_EQ(DataSetReader::GetChecksum(image1),
+            DataSetReader::GetChecksum(std::string(image1)));
+  EXPECT_NE(DataSetReader::GetChecksum(image1),
+            DataSetReader::GetChecksum(image2));
+  EXPECT_EQ(DataSetReader::GetChecksum("abc"), "");
+}
+
+TEST(DataSetReaderTest, GetVerifiedDigest) {
+  auto make_image = [](absl::string_view google, int alignment) {
+    DataSetWriter w(kTestMagicNumber);
+    w.Add("google", alignment, std::string(google));
+    w.Add("mozc", 64, "mozc");
+    std::stringstream out;
+    w.Finish(&out);
+    return out.str();
+  };
+  auto get_digest = [](const std::string &image) {
+    DataSetReader r;
+    EXPECT_TRUE(r.Init(image, kTestMagicNumber));
+    EXPECT_TRUE(r.VerifyFingerprints());
+    return r.GetVerifiedDigest();
+  };
+  const std::string digest = get_digest(make_image("GOOGLE", 16));
+  EXPECT_FALSE(digest.empty());
+  EXPECT_EQ(get_digest(make_image("GOOGLE", 16)), digest);
+  // The digest depends only on the content of the data, not on the layout.
+  EXPECT_EQ(get_digest(make_image("GOOGLE", 64)), digest);
+  EXPECT_NE(get_digest(make_image("google", 16)), digest);
+}
+
+TEST(DataSetReaderTest, VerifyFingerprints) {
+  // "large" is large enough to be verified in background.
+  const std::string large(2 << 20, 'x');
+  std::string image;
+  {
+    DataSetWriter w(kTestMagicNumber);
+    w.Add("google", 16, "GOOGLE");
+    w.Add("large", 64, large);
+    w.Add("mozc", 64, "mozc");
+    std::stringstream out;
+    w.Finish(&out);
+    image = out.str();
+  }
+  DataSetReader r;
+  ASSERT_TRUE(r.Init(image, kTestMagicNumber));
+  EXPECT_TRUE(r.VerifyFingerprints());
+
+  // Break the last byte of each data.  Init() doesn't read the data, so only
+  // VerifyFingerprints() fails.
+  for (const absl::string_view name : {"google", "large", "mozc"}) {
+    const std::optional<std::pair<size_t, size_t>> offset_and_size =
+        r.GetOffsetAndSize(name);
+    ASSERT_TRUE(offset_and_size.has_value());
+    const size_t pos = offset_and_size->first + offset_and_size->second - 1;
+    std::string broken = image;
+    broken[pos] ^= 1;
+    DataSetReader broken_reader;
+    ASSERT_TRUE(broken_reader.Init(broken, kTestMagicNumber));
+    EXPECT_FALSE(broken_reader.VerifyFingerprints()) << name;
+  }
+}
+
+TEST(DataSetReaderTest, VerifyFingerprintsWithoutFingerprints) {
+  // Emulates a data set written before the fingerprints were added.
+  std::string content;
+  {
+    DataSetWriter w(kTestMagicNumber);
+    w.Add("google", 16, "GOOGLE");
+    std::stringstream out;
+    w.Finish(&out);
+    content = out.str();
+    content.erase(content.size() - w.metadata().ByteSizeLong() - 36);
+  }
+  DataSetMetadata md;
+  DataSetMetadata::Entry *e = md.add_entries();
+  e->set_name("google");
+  e->set_offset(kTestMagicNumber.size());
+  e->set_size(6);
+  const std::string md_str = md.SerializeAsString();
+  std::string image =
+      absl::StrCat(content, md_str, Util::SerializeUint64(md_str.size()));
+  image.append(internal::UnverifiedSHA1::MakeDigest(image));
+  image.append(Util::SerializeUint64(image.size() + 8));
+
+  DataSetReader r;
+  ASSERT_TRUE(r.Init(image, kTestMagicNumber));
+  EXPECT_TRUE(r.VerifyFingerprints());
+
+  // Falls back to VerifyChecksum().
+  image[kTestMagicNumber.size()] = 'g';
+  ASSERT_TRUE(r.Init(image, kTestMagicNumber));
+  EXPECT_FALSE(r.VerifyFingerprints());
+}
+
 TEST(DataSetReaderTest, InvalidMagicString) {
   DataSetReader r;
   EXPECT_FALSE(r.Init("", kTestMagicNumber));
@@ -39,6 +39,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/unverified_sha1.h"
 #include "base/util.h"
 #include "base/vlog.h"
@@ -62,6 +63,7 @@ void DataSetWriter::Add(const std::string &name, int alignment,
   entry->set_name(name);
   entry->set_offset(image_.size());
   entry->set_size(data.size());
+  entry->set_fingerprint(Fingerprint(data));
   image_.append(data.data(), data.size());
 }
 
@@ -37,6 +37,7 @@
 #include "absl/strings/string_view.h"
 #include "base/file/temp_dir.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/unverified_sha1.h"
 #include "base/util.h"
 #include "data_manager/dataset.pb.h"
@@ -47,11 +48,13 @@
 namespace mozc {
 namespace {
 
-void SetEntry(absl::string_view name, uint64_t offset, uint64_t size,
-              DataSetMetadata::Entry *entry) {
+// Sets the entry for the file data at [offset, offset + size) of `image`.
+void SetEntry(absl::string_view image, absl::string_view name, uint64_t offset,
+              uint64_t size, DataSetMetadata::Entry *entry) {
   entry->set_name(name);
   entry->set_offset(offset);
   entry->set_size(size);
+  entry->set_fingerprint(Fingerprint(image.substr(offset, size)));
 }
 
 TEST(DatasetWriterTest, Write) {
@@ -108,24 +111,25 @@ TEST(DatasetWriterTest, Write) {
       "m\0zc\xEF"                           // offset 144 size 5 (file128)
       "\0\0\0\0\0\0\0\0\0\0\0"              // offset 149, size 11 (padding)
       "m\0zc\xEF";                          // offset 160, size 5 (file256)
+  // Excludes the last '\0'.
+  const absl::string_view image(data_chunk, sizeof(data_chunk) - 1);
   DataSetMetadata metadata;
-  SetEntry("data8", 5, 8, metadata.add_entries());
-  SetEntry("data16", 14, 10, metadata.add_entries());
-  SetEntry("data32", 24, 12, metadata.add_entries());
-  SetEntry("data64", 40, 11, metadata.add_entries());
-  SetEntry("data128", 64, 15, metadata.add_entries());
-  SetEntry("data256", 96, 11, metadata.add_entries());
-  SetEntry("file8", 107, 5, metadata.add_entries());
-  SetEntry("file16", 112, 5, metadata.add_entries());
-  SetEntry("file32", 120, 5, metadata.add_entries());
-  SetEntry("file64", 128, 5, metadata.add_entries());
-  SetEntry("file128", 144, 5, metadata.add_entries());
-  SetEntry("file256", 160, 5, metadata.add_entries());
+  SetEntry(image, "data8", 5, 8, metadata.add_entries());
+  SetEntry(image, "data16", 14, 10, metadata.add_entries());
+  SetEntry(image, "data32", 24, 12, metadata.add_entries());
+  SetEntry(image, "data64", 40, 11, metadata.add_entries());
+  SetEntry(image, "data128", 64, 15, metadata.add_entries());
+  SetEntry(image, "data256", 96, 11, metadata.add_entries());
+  SetEntry(image, "file8", 107, 5, metadata.add_entries());
+  SetEntry(image, "file16", 112, 5, metadata.add_entries());
+  SetEntry(image, "file32", 120, 5, metadata.add_entries());
+  SetEntry(image, "file64", 128, 5, metadata.add_entries());
+  SetEntry(image, "file128", 144, 5, metadata.add_entries());
+  SetEntry(image, "file256", 160, 5, metadata.add_entries());
   const std::string &metadata_chunk = metadata.SerializeAsString();
   const std::string &metadata_size =
       Util::SerializeUint64(metadata_chunk.size());
-  // Append data_chunk except for the last '\0'.
-  std::string expected(data_chunk, sizeof(data_chunk) - 1);
+  std::string expected(image);
   expected.append(metadata_chunk.data(), metadata_chunk.size());
   expected.append(metadata_size.data(), metadata_size.size());
   expected.append(internal::UnverifiedSHA1::MakeDigest(expected));
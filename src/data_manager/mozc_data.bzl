@@ -212,6 +212,7 @@ def mozc_dataset(
             "usage_conjugation_suffix:32:$(@D)/usage_conj_suffix.data " +
             "usage_conjugation_index:32:$(@D)/usage_conj_index.data " +
             "usage_item_array:32:$(@D)/usage_item_array.data " +
+            "usage_index:32:$(@D)/usage_index.data " +
             "usage_string_array:32:$(@D)/usage_string_array.data "
         )
 
@@ -696,6 +697,7 @@ def mozc_dataset(
                 "usage_base_conj_suffix.data",
                 "usage_conj_index.data",
                 "usage_conj_suffix.data",
+                "usage_index.data",
                 "usage_item_array.data",
                 "usage_string_array.data",
             ],
@@ -707,6 +709,7 @@ def mozc_dataset(
                 "--output_conjugation_suffix=$(location :usage_conj_suffix.data) " +
                 "--output_conjugation_index=$(location :usage_conj_index.data) " +
                 "--output_usage_item_array=$(location :usage_item_array.data) " +
+                "--output_usage_index=$(location :usage_index.data) " +
                 "--output_string_array=$(location :usage_string_array.data) "
             ),
             tools = ["//rewriter:gen_usage_rewriter_dictionary_main"],
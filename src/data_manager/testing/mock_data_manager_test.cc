@@ -29,6 +29,11 @@
 
 #include "data_manager/testing/mock_data_manager.h"
 
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "data_manager/data_manager.h"
 #include "data_manager/data_manager_test_base.h"
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
@@ -60,5 +65,41 @@ class MockDataManagerTest : public DataManagerTestBase {
 
 TEST_F(MockDataManagerTest, AllTests) { RunAllTests(); }
 
+TEST(MockDataManagerFileTest, InitFromFileWithLoadPolicy) {
+  const std::string path = mozc::testing::GetSourcePath(
+      {MOZC_SRC_COMPONENTS("data_manager"), "testing", "mock_mozc.data"});
+  const MockDataManager expected;
+  const char *expected_data = nullptr;
+  size_t expected_size = 0;
+  expected.GetConnectorData(&expected_data, &expected_size);
+
+  for (const bool enabled : {false, true}) {
+    const DataManager::LoadPolicy policy = {
+        .madvise = enabled,
+        .mlock_hot_sections = enabled,
+        .prefault = enabled,
+        .verify_fingerprints = enabled,
+    };
+    DataManager data_manager, another_data_manager;
+    ASSERT_EQ(data_manager.InitFromFile(path, "MOCK", policy),
+              DataManager::Status::OK);
+    ASSERT_EQ(another_data_manager.InitFromFile(path, "MOCK", policy),
+              DataManager::Status::OK);
+    EXPECT_EQ(data_manager.ShouldAdviseAccessPatterns(), enabled);
+    // Only the verified data is identified by its content.
+    EXPECT_FALSE(data_manager.GetDataChecksum().empty());
+    EXPECT_EQ(data_manager.GetDataChecksum() ==
+                  another_data_manager.GetDataChecksum(),
+              enabled);
+
+    // The policy doesn't change the contents.
+    const char *data = nullptr;
+    size_t size = 0;
+    data_manager.GetConnectorData(&data, &size);
+    EXPECT_EQ(absl::string_view(data, size),
+              absl::string_view(expected_data, expected_size));
+  }
+}
+
 }  // namespace testing
 }  // namespace mozc
@@ -435,7 +435,8 @@ SystemDictionary::Builder::Build() {
   }
 
   if (!instance->OpenDictionaryFile(
-          (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0)) {
+          (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0,
+          (spec_->options & ADVISE_ACCESS_PATTERNS) != 0)) {
     return absl::UnknownError("Failed to create system dictionary");
   }
 
@@ -451,11 +452,15 @@ SystemDictionary::SystemDictionary(
 
 SystemDictionary::~SystemDictionary() = default;
 
-bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
+bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index,
+                                          bool advise_access_patterns) {
   int len;
 
   const uint8_t *key_image = reinterpret_cast<const uint8_t *>(
       dictionary_file_->GetSection(codec_->GetSectionNameForKey(), &len));
+  if (advise_access_patterns && key_image != nullptr) {
+    Mmap::MaybeMAdvise(key_image, len, Mmap::WILL_NEED);
+  }
   if (!key_trie_.Open(key_image, kKeyTrieLb0CacheSize, kKeyTrieLb1CacheSize,
                       kKeyTrieSelect0CacheSize, kKeyTrieSelect1CacheSize,
                       kKeyTrieTermvecCacheSize)) {
@@ -467,6 +472,9 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
 
   const uint8_t *value_image = reinterpret_cast<const uint8_t *>(
       dictionary_file_->GetSection(codec_->GetSectionNameForValue(), &len));
+  if (advise_access_patterns && value_image != nullptr) {
+    Mmap::MaybeMAdvise(value_image, len, Mmap::WILL_NEED);
+  }
   if (!value_trie_.Open(value_image, kValueTrieLb0CacheSize,
                         kValueTrieLb1CacheSize, kValueTrieSelect0CacheSize,
                         kValueTrieSelect1CacheSize,
@@ -477,6 +485,9 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
 
   const unsigned char *token_image = reinterpret_cast<const unsigned char *>(
       dictionary_file_->GetSection(codec_->GetSectionNameForTokens(), &len));
+  if (advise_access_patterns && token_image != nullptr) {
+    Mmap::MaybeMAdvise(token_image, len, Mmap::RANDOM);
+  }
   token_array_.Open(token_image);
 
   frequent_pos_ = reinterpret_cast<const uint32_t *>(
@@ -60,6 +60,9 @@ class SystemDictionary : public DictionaryInterface {
     // from the id in value trie to the id in key trie.
     // That consumes more memory but we can perform reverse lookup more quickly.
     ENABLE_REVERSE_LOOKUP_INDEX = 1,
+    // If ADVISE_ACCESS_PATTERNS is set, we advise the kernel that the key and
+    // value tries are needed soon and the token array is read randomly.
+    ADVISE_ACCESS_PATTERNS = 2,
   };
 
   // Builder class for system dictionary
@@ -164,7 +167,8 @@ class SystemDictionary : public DictionaryInterface {
   SystemDictionary(const SystemDictionaryCodecInterface *codec,
                    const DictionaryFileCodecInterface *file_codec);
 
-  bool OpenDictionaryFile(bool enable_reverse_lookup_index);
+  bool OpenDictionaryFile(bool enable_reverse_lookup_index,
+                          bool advise_access_patterns);
 
   void RegisterReverseLookupTokensForT13N(absl::string_view value,
                                           Callback *callback) const;
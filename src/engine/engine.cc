@@ -31,14 +31,19 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/base/optimization.h"
+#include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "base/latency_trace.h"
+#include "base/thread.h"
 #include "base/vlog.h"
 #include "converter/converter.h"
 #include "converter/immutable_converter.h"
@@ -47,6 +52,7 @@
 #include "engine/modules.h"
 #include "engine/supplemental_model_interface.h"
 #include "engine/user_data_manager_interface.h"
+#include "engine/warmup.h"
 #include "prediction/dictionary_predictor.h"
 #include "prediction/predictor.h"
 #include "prediction/predictor_interface.h"
@@ -55,6 +61,11 @@
 #include "rewriter/rewriter.h"
 #include "rewriter/rewriter_interface.h"
 
+ABSL_FLAG(bool, warmup_engine, false,
+          "If true, converts common queries with the newly loaded data in the "
+          "background before the engine is reloaded with it, so that the "
+          "first conversions are not slowed down by the cold data and caches");
+
 namespace mozc {
 namespace {
 
@@ -161,16 +172,54 @@ std::unique_ptr<Engine> Engine::CreateEngine() {
 
 Engine::Engine()
     : loader_(std::make_unique<DataLoader>()),
-      modules_(std::make_unique<engine::Modules>()) {}
+      releaser_(std::make_shared<GenerationReleaser>()),
+      generation_(std::make_shared<Generation>()) {
+  generation_->modules = std::make_unique<engine::Modules>();
+}
+
+Engine::GenerationReleaser::~GenerationReleaser() {
+  absl::MutexLock lock(&mutex_);
+  releases_.clear();  // Waits for the releases in progress.
+}
+
+void Engine::GenerationReleaser::Release(Generation *generation) {
+  absl::MutexLock lock(&mutex_);
+  std::erase_if(releases_, [](const BackgroundFuture<void> &release) {
+    return release.Ready();
+  });
+  releases_.emplace_back([generation] { delete generation; });
+}
+
+std::shared_ptr<ConverterInterface> Engine::GetSharedConverter() const {
+  if (!initialized_) {
+    return EngineInterface::GetSharedConverter();
+  }
+  // Shares the ownership of the whole generation, as the converter refers to
+  // its modules and immutable converter.
+  return std::shared_ptr<ConverterInterface>(generation_,
+                                             generation_->converter.get());
+}
 
 absl::Status Engine::ReloadModules(std::unique_ptr<engine::Modules> modules,
                                    bool is_mobile) {
-  ReloadAndWait();
   return Init(std::move(modules), is_mobile);
 }
 
 absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
                           bool is_mobile) {
+  MOZC_LATENCY_TRACE("Engine::Init");
+  absl::StatusOr<std::shared_ptr<Generation>> generation =
+      BuildGeneration(std::move(modules), is_mobile, releaser_);
+  if (!generation.ok()) {
+    return generation.status();
+  }
+  SwapGeneration(*std::move(generation));
+  return absl::Status();
+}
+
+absl::StatusOr<std::shared_ptr<Engine::Generation>> Engine::BuildGeneration(
+    std::unique_ptr<engine::Modules> modules, bool is_mobile,
+    std::shared_ptr<GenerationReleaser> releaser) {
 #define RETURN_IF_NULL(ptr)                                               \
   do {                                                                    \
     if (!(ptr))                                                           \
@@ -179,15 +228,19 @@ absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
 
   RETURN_IF_NULL(modules);
 
-  // Keeps the previous supplemental_model if exists.
-  const engine::SupplementalModelInterface *supplemental_model =
-      modules_->GetSupplementalModel();
-
-  modules_ = std::move(modules);
-  modules_->SetSupplementalModel(supplemental_model);
+  // The releaser outlives all the generations, as each of them shares it.
+  std::shared_ptr<Generation> generation(
+      new Generation(), [releaser = std::move(releaser)](Generation *ptr) {
+        releaser->Release(ptr);
+      });
+  generation->modules = std::move(modules);
+  const engine::Modules &modules_ref = *generation->modules;
 
-  immutable_converter_ = std::make_unique<ImmutableConverter>(*modules_);
-  RETURN_IF_NULL(immutable_converter_);
+  generation->immutable_converter =
+      std::make_unique<ImmutableConverter>(modules_ref);
+  RETURN_IF_NULL(generation->immutable_converter);
+  ImmutableConverterInterface *immutable_converter =
+      generation->immutable_converter.get();
 
   // Since predictor and rewriter require a pointer to a converter instance,
   // allocate it first without initialization. It is initialized at the end of
@@ -195,8 +248,9 @@ absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
   // TODO(noriyukit): This circular dependency is a bad design as careful
   // handling is necessary to avoid infinite loop. Find more beautiful design
   // and fix it!
-  converter_ = std::make_unique<Converter>();
-  RETURN_IF_NULL(converter_);
+  generation->converter = std::make_unique<Converter>();
+  RETURN_IF_NULL(generation->converter);
+  Converter *converter = generation->converter.get();
 
   std::unique_ptr<PredictorInterface> predictor;
   {
@@ -204,49 +258,87 @@ absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
     // history predictor, and extra predictor.
     auto dictionary_predictor =
         std::make_unique<prediction::DictionaryPredictor>(
-            *modules_, converter_.get(), immutable_converter_.get());
+            modules_ref, converter, immutable_converter);
     RETURN_IF_NULL(dictionary_predictor);
 
     const bool enable_content_word_learning = is_mobile;
     auto user_history_predictor =
         std::make_unique<prediction::UserHistoryPredictor>(
-            *modules_, enable_content_word_learning);
+            modules_ref, enable_content_word_learning);
     RETURN_IF_NULL(user_history_predictor);
 
     if (is_mobile) {
       predictor = prediction::MobilePredictor::CreateMobilePredictor(
           std::move(dictionary_predictor), std::move(user_history_predictor),
-          converter_.get());
+          converter);
     } else {
       predictor = prediction::DefaultPredictor::CreateDefaultPredictor(
           std::move(dictionary_predictor), std::move(user_history_predictor),
-          converter_.get());
+          converter);
     }
     RETURN_IF_NULL(predictor);
   }
-  predictor_ = predictor.get();  // Keep the reference
+  generation->predictor = predictor.get();  // Keep the reference
 
-  auto rewriter = std::make_unique<Rewriter>(*modules_, *converter_);
+  auto rewriter = std::make_unique<Rewriter>(modules_ref, *converter);
   RETURN_IF_NULL(rewriter);
-  rewriter_ = rewriter.get();  // Keep the reference
-
-  converter_->Init(*modules_, std::move(predictor), std::move(rewriter),
-                   immutable_converter_.get());
+  generation->rewriter = rewriter.get();  // Keep the reference
 
-  user_data_manager_ = std::make_unique<UserDataManager>(predictor_, rewriter_);
+  converter->Init(modules_ref, std::move(predictor), std::move(rewriter),
+                  immutable_converter);
 
-  initialized_ = true;
-  return absl::Status();
+  generation->user_data_manager = std::make_unique<UserDataManager>(
+      generation->predictor, generation->rewriter);
+  return generation;
 
 #undef RETURN_IF_NULL
 }
 
+absl::StatusOr<std::shared_ptr<Engine::Generation>> Engine::PrepareGeneration(
+    std::unique_ptr<engine::Modules> modules, bool is_mobile,
+    std::shared_ptr<GenerationReleaser> releaser) {
+  absl::StatusOr<std::shared_ptr<Generation>> generation =
+      BuildGeneration(std::move(modules), is_mobile, std::move(releaser));
+  if (!generation.ok()) {
+    return generation;
+  }
+  // Waits for the user data here, as nothing else uses the generation yet.
+  if ((*generation)->modules->GetUserDictionary()) {
+    (*generation)->modules->GetUserDictionary()->WaitForReloader();
+  }
+  (*generation)->user_data_manager->Wait();
+  // Warms up the converter that the sessions will use, so that its own caches
+  // and the rewriters built on first use are also ready.
+  if (absl::GetFlag(FLAGS_warmup_engine)) {
+    engine::WarmUpConverter(*(*generation)->converter,
+                            engine::GetWarmupQueries());
+  }
+  return generation;
+}
+
+void Engine::SwapGeneration(std::shared_ptr<Generation> generation) {
+  // Keeps the previous supplemental_model if exists.
+  generation->modules->SetSupplementalModel(
+      generation_->modules->GetSupplementalModel());
+  if (initialized_) {
+    // Starts saving the user data learned so far. The sessions still using the
+    // previous generation keep learning on it until they switch, and that is
+    // saved when the generation is destroyed. The new generation loaded the
+    // user data before, so it misses what is learned in between.
+    Sync();
+  }
+  // Releases the previous generation here. It is destroyed when the sessions
+  // and the command in progress release it. See GetSharedConverter().
+  generation_ = std::move(generation);
+  initialized_ = true;
+}
+
 bool Engine::Reload() {
-  if (!modules_->GetUserDictionary()) {
+  if (!generation_->modules->GetUserDictionary()) {
     return true;
   }
   MOZC_VLOG(1) << "Reloading user dictionary";
-  bool result_dictionary = modules_->GetUserDictionary()->Reload();
+  bool result_dictionary = generation_->modules->GetUserDictionary()->Reload();
   MOZC_VLOG(1) << "Reloading UserDataManager";
   bool result_user_data = GetUserDataManager()->Reload();
   return result_dictionary && result_user_data;
@@ -254,15 +346,15 @@ bool Engine::Reload() {
 
 bool Engine::Sync() {
   GetUserDataManager()->Sync();
-  if (!modules_->GetUserDictionary()) {
+  if (!generation_->modules->GetUserDictionary()) {
     return true;
   }
-  return modules_->GetUserDictionary()->Sync();
+  return generation_->modules->GetUserDictionary()->Sync();
 }
 
 bool Engine::Wait() {
-  if (modules_->GetUserDictionary()) {
-    modules_->GetUserDictionary()->WaitForReloader();
+  if (generation_->modules->GetUserDictionary()) {
+    generation_->modules->GetUserDictionary()->WaitForReloader();
   }
   return GetUserDataManager()->Wait();
 }
@@ -282,6 +374,39 @@ bool Engine::MaybeReloadEngine(EngineReloadResponse *response) {
 
   // In the while loop, tries to reload the new data. If the new data is broken,
   // tries it again as a next round of this while loop.
+  while (true) {
+    if (!pending_generation_.has_value() && !StartGenerationBuild()) {
+      // No new data is available. The build process is still running.
+      return false;
+    }
+    if (!always_wait_for_generation_for_testing_ &&
+        !pending_generation_->future.Ready()) {
+      // The new generation is still being built.
+      return false;
+    }
+
+    PendingGeneration pending = *std::move(pending_generation_);
+    pending_generation_.reset();
+    absl::StatusOr<std::shared_ptr<Generation>> generation =
+        std::move(pending.future).Get();
+    *response = std::move(pending.response);
+    if (!generation.ok()) {
+      LOG(ERROR) << generation.status();
+
+      // Unregisters the invalid ID and continues to rebuild a new data loader.
+      loader_->ReportLoadFailure(pending.id);
+      continue;
+    }
+
+    SwapGeneration(*std::move(generation));
+    loader_->ReportLoadSuccess(pending.id);
+    response->set_status(EngineReloadResponse::RELOADED);
+    return true;
+  }
+  ABSL_UNREACHABLE();
+}
+
+bool Engine::StartGenerationBuild() {
   while (true) {
     if (!loader_->StartNewDataBuildTask()) {
       // No new build process is running or ready.
@@ -295,41 +420,29 @@ bool Engine::MaybeReloadEngine(EngineReloadResponse *response) {
       return false;
     }
 
-    *response = loader_response->response;
+    const EngineReloadResponse &response = loader_response->response;
     LOG(INFO) << "New data is ready (install_location="
-              << response->request().install_location() << ")";
+              << response.request().install_location() << ")";
 
     if (!loader_response->modules ||
-        response->status() != EngineReloadResponse::RELOAD_READY) {
+        response.status() != EngineReloadResponse::RELOAD_READY) {
       // The loader_response does not contain a valid result.
 
       // This request id causes a critical error.
-      LOG(ERROR) << "Failure in loading response: " << *response;
+      LOG(ERROR) << "Failure in loading response: " << response;
 
       // Unregisters the invalid ID and continues to rebuild a new data loader.
       loader_->ReportLoadFailure(loader_response->id);
       continue;
     }
 
-    if (user_data_manager_) {
-      user_data_manager_->Wait();
-    }
-
-    // Reloads DataManager.
     const bool is_mobile =
-        response->request().engine_type() == EngineReloadRequest::MOBILE;
-    absl::Status reload_status =
-        ReloadModules(std::move(loader_response->modules), is_mobile);
-    if (!reload_status.ok()) {
-      LOG(ERROR) << reload_status;
-
-      // Unregisters the invalid ID and continues to rebuild a new data loader.
-      loader_->ReportLoadFailure(loader_response->id);
-      continue;
-    }
-
-    loader_->ReportLoadSuccess(loader_response->id);
-    response->set_status(EngineReloadResponse::RELOADED);
+        response.request().engine_type() == EngineReloadRequest::MOBILE;
+    pending_generation_.emplace(PendingGeneration{
+        loader_response->id, response,
+        GenerationFuture(&Engine::PrepareGeneration,
+                         std::move(loader_response->modules), is_mobile,
+                         releaser_)});
     return true;
   }
   ABSL_UNREACHABLE();
@@ -56,6 +56,7 @@
       'sources': [
         '<(gen_out_dir)/../dictionary/pos_matcher_impl.inc',
         'engine.cc',
+        'warmup.cc',
       ],
       'dependencies': [
         'minimal_engine',
@@ -30,14 +30,19 @@
 #ifndef MOZC_ENGINE_ENGINE_H_
 #define MOZC_ENGINE_ENGINE_H_
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "base/thread.h"
 #include "converter/converter.h"
 #include "converter/converter_interface.h"
 #include "converter/immutable_converter_interface.h"
@@ -97,18 +102,22 @@ class Engine : public EngineInterface {
   Engine &operator=(const Engine &) = delete;
 
   ConverterInterface *GetConverter() const override {
-    return initialized_ ? converter_.get() : minimal_engine_.GetConverter();
+    return initialized_ ? generation_->converter.get()
+                        : minimal_engine_.GetConverter();
   }
+  std::shared_ptr<ConverterInterface> GetSharedConverter() const override;
   absl::string_view GetPredictorName() const override {
     if (initialized_) {
-      return predictor_ ? predictor_->GetPredictorName() : absl::string_view();
+      return generation_->predictor ? generation_->predictor->GetPredictorName()
+                                    : absl::string_view();
     } else {
       return minimal_engine_.GetPredictorName();
     }
   }
   dictionary::SuppressionDictionary *GetSuppressionDictionary() override {
-    return initialized_ ? modules_->GetMutableSuppressionDictionary()
-                        : minimal_engine_.GetSuppressionDictionary();
+    return initialized_
+               ? generation_->modules->GetMutableSuppressionDictionary()
+               : minimal_engine_.GetSuppressionDictionary();
   }
 
   // Functions for Reload, Sync, Wait return true if successfully operated
@@ -122,7 +131,7 @@ class Engine : public EngineInterface {
                              bool is_mobile) override;
 
   UserDataManagerInterface *GetUserDataManager() override {
-    return initialized_ ? user_data_manager_.get()
+    return initialized_ ? generation_->user_data_manager.get()
                         : minimal_engine_.GetUserDataManager();
   }
 
@@ -131,7 +140,7 @@ class Engine : public EngineInterface {
   }
 
   const DataManagerInterface *GetDataManager() const override {
-    return initialized_ ? &modules_->GetDataManager()
+    return initialized_ ? &generation_->modules->GetDataManager()
                         : minimal_engine_.GetDataManager();
   }
 
@@ -140,19 +149,26 @@ class Engine : public EngineInterface {
   // Since the POS set may differ per LM, this function returns
   // available POS items. In practice, the POS items are rarely changed.
   std::vector<std::string> GetPosList() const override {
-    return initialized_ ? modules_->GetUserDictionary()->GetPosList()
-                        : minimal_engine_.GetPosList();
+    return initialized_
+               ? generation_->modules->GetUserDictionary()->GetPosList()
+               : minimal_engine_.GetPosList();
   }
 
   void SetSupplementalModel(
       const engine::SupplementalModelInterface *supplemental_model) override {
-    modules_->SetSupplementalModel(supplemental_model);
+    generation_->modules->SetSupplementalModel(supplemental_model);
   }
 
   // For testing only.
-  engine::Modules *GetModulesForTesting() const { return modules_.get(); }
+  engine::Modules *GetModulesForTesting() const {
+    return generation_->modules.get();
+  }
 
-  // Maybe reload a new data manager. Returns true if reloaded.
+  // Maybe reload a new data manager. Returns true if reloaded. The new modules
+  // are built into a new generation on a background thread, and this method
+  // only swaps the generation once it is ready. The sessions keep the previous
+  // generation until they switch to the new one, and the previous generation is
+  // freed on a background thread once the last of them releases it.
   bool MaybeReloadEngine(EngineReloadResponse *response) override;
   bool SendEngineReloadRequest(const EngineReloadRequest &request) override;
   void SetDataLoaderForTesting(std::unique_ptr<DataLoader> loader) override {
@@ -160,31 +176,89 @@ class Engine : public EngineInterface {
   }
   void SetAlwaysWaitForLoaderResponseFutureForTesting(bool value) override {
     loader_->SetAlwaysWaitForLoaderResponseFutureForTesting(value);
+    always_wait_for_generation_for_testing_ = value;
   }
 
  private:
+  // The modules and the converters built from them. A reload replaces the
+  // whole generation, while the sessions and the command in progress keep the
+  // previous one alive through GetSharedConverter() until they are done.
+  struct Generation {
+    std::unique_ptr<engine::Modules> modules;
+    std::unique_ptr<ImmutableConverterInterface> immutable_converter;
+    std::unique_ptr<Converter> converter;
+    // TODO(noriyukit): Currently predictor and rewriter are created by this
+    // class but owned by the converter. Since this class creates these two,
+    // it'd be better if Engine class owns these two instances.
+    prediction::PredictorInterface *predictor = nullptr;
+    RewriterInterface *rewriter = nullptr;
+    std::unique_ptr<UserDataManagerInterface> user_data_manager;
+  };
+
+  // Destroys the released generations on background threads, as the user
+  // history predictor saves its data to the disk in its destructor.
+  class GenerationReleaser {
+   public:
+    GenerationReleaser() = default;
+    GenerationReleaser(const GenerationReleaser &) = delete;
+    GenerationReleaser &operator=(const GenerationReleaser &) = delete;
+    ~GenerationReleaser();
+
+    void Release(Generation *generation) ABSL_LOCKS_EXCLUDED(mutex_);
+
+   private:
+    absl::Mutex mutex_;
+    std::vector<BackgroundFuture<void>> releases_ ABSL_GUARDED_BY(mutex_);
+  };
+
+  using GenerationFuture =
+      BackgroundFuture<absl::StatusOr<std::shared_ptr<Generation>>>;
+
+  // The generation being built from the data loader response `id`.
+  struct PendingGeneration {
+    uint64_t id = 0;
+    EngineReloadResponse response;
+    GenerationFuture future;
+  };
+
   Engine();
 
   // Initializes the engine object by the given modules and is_mobile flag.
   // The is_mobile flag is used to select DefaultPredictor and MobilePredictor.
   absl::Status Init(std::unique_ptr<engine::Modules> modules, bool is_mobile);
 
+  // Builds a generation from the given modules. The generation is destroyed
+  // by `releaser`.
+  static absl::StatusOr<std::shared_ptr<Generation>> BuildGeneration(
+      std::unique_ptr<engine::Modules> modules, bool is_mobile,
+      std::shared_ptr<GenerationReleaser> releaser);
+
+  // Builds a generation and waits for its user data to be loaded, so that it
+  // is ready to serve. With --warmup_engine, also warms up the converter of
+  // the generation. Runs on a background thread, as it doesn't touch the
+  // engine.
+  static absl::StatusOr<std::shared_ptr<Generation>> PrepareGeneration(
+      std::unique_ptr<engine::Modules> modules, bool is_mobile,
+      std::shared_ptr<GenerationReleaser> releaser);
+
+  // Starts building a generation from the next valid data loader response.
+  // Returns false if no response is available yet.
+  bool StartGenerationBuild();
+
+  // Makes `generation` the current one.
+  void SwapGeneration(std::shared_ptr<Generation> generation);
+
   // If initialized_ is false, minimal_engine_ is used as a fallback engine.
   bool initialized_ = false;
   MinimalEngine minimal_engine_;
 
   std::unique_ptr<DataLoader> loader_;
-  std::unique_ptr<engine::Modules> modules_;
-  std::unique_ptr<ImmutableConverterInterface> immutable_converter_;
-
-  // TODO(noriyukit): Currently predictor and rewriter are created by this class
-  // but owned by converter_. Since this class creates these two, it'd be better
-  // if Engine class owns these two instances.
-  prediction::PredictorInterface *predictor_ = nullptr;
-  RewriterInterface *rewriter_ = nullptr;
-
-  std::unique_ptr<Converter> converter_;
-  std::unique_ptr<UserDataManagerInterface> user_data_manager_;
+  // Declared before the generations, so that it waits for their release.
+  std::shared_ptr<GenerationReleaser> releaser_;
+  std::shared_ptr<Generation> generation_;
+  std::optional<PendingGeneration> pending_generation_;
+  // Used only in unittest to perform blocking behavior.
+  bool always_wait_for_generation_for_testing_ = false;
 };
 
 }  // namespace mozc
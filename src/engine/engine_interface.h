@@ -62,6 +62,15 @@ class EngineInterface {
   // engine class and should not be deleted by callers.
   virtual ConverterInterface *GetConverter() const = 0;
 
+  // Returns the converter sharing the ownership of the data it uses, so that
+  // it stays valid after the engine is reloaded until the last reference is
+  // released. The default implementation doesn't own the converter, which is
+  // then valid only while the engine is alive and not reloaded.
+  virtual std::shared_ptr<ConverterInterface> GetSharedConverter() const {
+    return std::shared_ptr<ConverterInterface>(std::shared_ptr<void>(),
+                                               GetConverter());
+  }
+
   // Returns the predictor name.
   virtual absl::string_view GetPredictorName() const = 0;
 
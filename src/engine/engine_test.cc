@@ -35,6 +35,10 @@
 
 #include "absl/log/check.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
 #include "data_manager/data_manager.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "engine/modules.h"
@@ -128,6 +132,32 @@ TEST_F(EngineTest, ReloadModulesTest) {
             &supplemental_model);
 }
 
+TEST_F(EngineTest, SharedConverterOutlivesReload) {
+  auto modules = std::make_unique<engine::Modules>();
+  CHECK_OK(modules->Init(std::make_unique<testing::MockDataManager>()));
+  const bool is_mobile = true;
+  CHECK_OK(engine_->ReloadModules(std::move(modules), is_mobile));
+
+  std::shared_ptr<ConverterInterface> old_converter =
+      engine_->GetSharedConverter();
+  ASSERT_NE(old_converter, nullptr);
+  EXPECT_EQ(old_converter.get(), engine_->GetConverter());
+  std::weak_ptr<ConverterInterface> weak_converter = old_converter;
+
+  modules = std::make_unique<engine::Modules>();
+  CHECK_OK(modules->Init(std::make_unique<testing::MockDataManager>()));
+  CHECK_OK(engine_->ReloadModules(std::move(modules), is_mobile));
+  EXPECT_NE(engine_->GetConverter(), old_converter.get());
+
+  // The previous converter and its modules are still usable.
+  Segments segments;
+  EXPECT_TRUE(old_converter->StartConversionWithKey(&segments, "わたし"));
+  EXPECT_GT(segments.conversion_segments_size(), 0);
+
+  old_converter.reset();
+  EXPECT_TRUE(weak_converter.expired());
+}
+
 // Tests the interaction with DataLoader for successful Engine
 // reload event.
 TEST_F(EngineTest, DataLoadSuccessfulScenarioTest) {
@@ -147,6 +177,27 @@ TEST_F(EngineTest, DataLoadSuccessfulScenarioTest) {
   EXPECT_EQ(engine_->GetDataVersion(), mock_version_);
 }
 
+// Tests that the engine keeps serving the current data while the new data is
+// loaded and built in background.
+TEST_F(EngineTest, DataLoadInBackgroundTest) {
+  engine_->SetAlwaysWaitForLoaderResponseFutureForTesting(false);
+  const std::string initial_version(engine_->GetDataVersion());
+
+  EXPECT_TRUE(engine_->SendEngineReloadRequest(mock_request_));
+  EngineReloadResponse response;
+  bool reloaded = false;
+  for (int i = 0; i < 1000 && !reloaded; ++i) {
+    reloaded = engine_->MaybeReloadEngine(&response);
+    if (!reloaded) {
+      EXPECT_EQ(engine_->GetDataVersion(), initial_version);
+      absl::SleepFor(absl::Milliseconds(10));
+    }
+  }
+  EXPECT_TRUE(reloaded);
+  EXPECT_EQ(response.status(), EngineReloadResponse::RELOADED);
+  EXPECT_EQ(engine_->GetDataVersion(), mock_version_);
+}
+
 // Tests situations to handle multiple new requests.
 TEST_F(EngineTest, DataUpdateSuccessfulScenarioTest) {
   EngineReloadResponse response;
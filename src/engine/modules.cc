@@ -36,11 +36,15 @@
 #include <string>
 #include <utility>
 
+#include "absl/base/const_init.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "base/latency_trace.h"
 #include "converter/connector.h"
 #include "converter/segmenter.h"
 #include "data_manager/data_manager_interface.h"
@@ -58,7 +62,6 @@
 #include "prediction/suggestion_filter.h"
 
 using ::mozc::dictionary::DictionaryImpl;
-using ::mozc::dictionary::PosGroup;
 using ::mozc::dictionary::SuffixDictionary;
 using ::mozc::dictionary::SuppressionDictionary;
 using ::mozc::dictionary::SystemDictionary;
@@ -68,6 +71,114 @@ using ::mozc::dictionary::ValueDictionary;
 
 namespace mozc {
 namespace engine {
+namespace {
+
+// The entry of a data set in the registry of SharedModules. `loading` is true
+// while a thread builds the modules without holding the mutex, so that the
+// other threads wait only for the data set they need.
+struct SharedModulesEntry {
+  bool IsIdle() const { return !loading; }
+
+  std::weak_ptr<const SharedModules> modules;
+  bool loading = false;
+};
+
+ABSL_CONST_INIT absl::Mutex g_shared_modules_mutex(absl::kConstInit);
+
+}  // namespace
+
+// static
+absl::StatusOr<std::shared_ptr<const SharedModules>> SharedModules::Get(
+    std::shared_ptr<const DataManagerInterface> data_manager) {
+  // Modules built for all the data sets in use. They are released when no
+  // Modules refers to them.
+  static auto *shared_modules = new absl::flat_hash_map<
+      std::string, std::shared_ptr<SharedModulesEntry>>();
+
+  const std::string checksum(data_manager->GetDataChecksum());
+  std::shared_ptr<SharedModulesEntry> entry;
+  if (!checksum.empty()) {
+    absl::MutexLock lock(&g_shared_modules_mutex);
+    std::shared_ptr<SharedModulesEntry> &slot = (*shared_modules)[checksum];
+    if (slot == nullptr) {
+      slot = std::make_shared<SharedModulesEntry>();
+    }
+    entry = slot;
+    // Releases the mutex while another thread builds the same data set.
+    g_shared_modules_mutex.Await(
+        absl::Condition(entry.get(), &SharedModulesEntry::IsIdle));
+    if (std::shared_ptr<const SharedModules> modules = entry->modules.lock()) {
+      return modules;
+    }
+    entry->loading = true;
+  }
+
+  // Init() loads the data set, so it runs without holding the mutex.
+  std::shared_ptr<SharedModules> modules(
+      new SharedModules(std::move(data_manager)));
+  const absl::Status status = modules->Init();
+  if (entry == nullptr) {
+    if (!status.ok()) {
+      return status;
+    }
+    return modules;
+  }
+
+  absl::MutexLock lock(&g_shared_modules_mutex);
+  entry->loading = false;
+  if (!status.ok()) {
+    return status;
+  }
+  entry->modules = modules;
+  // The entries which another thread is looking up are kept.
+  absl::erase_if(*shared_modules, [](const auto &pair) {
+    return pair.second.use_count() == 1 && pair.second->modules.expired();
+  });
+  return modules;
+}
+
+SharedModules::SharedModules(
+    std::shared_ptr<const DataManagerInterface> data_manager)
+    : data_manager_(std::move(data_manager)),
+      pos_matcher_(data_manager_->GetPosMatcherData()),
+      pos_group_(data_manager_->GetPosGroupData()),
+      single_kanji_prediction_aggregator_(*data_manager_) {}
+
+absl::Status SharedModules::Init() {
+  MOZC_LATENCY_TRACE("SharedModules::Init");
+  absl::StatusOr<Connector> status_or_connector =
+      Connector::CreateFromDataManager(*data_manager_);
+  if (!status_or_connector.ok()) {
+    return std::move(status_or_connector).status();
+  }
+  connector_ = *std::move(status_or_connector);
+
+  segmenter_ = Segmenter::CreateFromDataManager(*data_manager_);
+  if (!segmenter_) {
+    return absl::ResourceExhaustedError("modules.cc: segmenter_ is null");
+  }
+
+  absl::StatusOr<SuggestionFilter> status_or_suggestion_filter =
+      SuggestionFilter::Create(data_manager_->GetSuggestionFilterData());
+  if (!status_or_suggestion_filter.ok()) {
+    return std::move(status_or_suggestion_filter).status();
+  }
+  suggestion_filter_ = *std::move(status_or_suggestion_filter);
+
+  absl::string_view zero_query_token_array_data;
+  absl::string_view zero_query_string_array_data;
+  absl::string_view zero_query_number_token_array_data;
+  absl::string_view zero_query_number_string_array_data;
+  data_manager_->GetZeroQueryData(&zero_query_token_array_data,
+                                  &zero_query_string_array_data,
+                                  &zero_query_number_token_array_data,
+                                  &zero_query_number_string_array_data);
+  zero_query_dict_.Init(zero_query_token_array_data,
+                        zero_query_string_array_data);
+  zero_query_number_dict_.Init(zero_query_number_token_array_data,
+                               zero_query_number_string_array_data);
+  return absl::OkStatus();
+}
 
 absl::Status Modules::Init(
     std::unique_ptr<const DataManagerInterface> data_manager) {
@@ -77,29 +188,36 @@ absl::Status Modules::Init(
       return absl::ResourceExhaustedError("modules.cc: " #ptr " is null"); \
   } while (false)
 
+  MOZC_LATENCY_TRACE("Modules::Init");
   DCHECK(!initialized_) << "Modules already initialized";
   DCHECK(data_manager) << "data_manager is null";
   RETURN_IF_NULL(data_manager);
   data_manager_ = std::move(data_manager);
 
+  {
+    absl::StatusOr<std::shared_ptr<const SharedModules>> status_or_shared =
+        SharedModules::Get(data_manager_);
+    if (!status_or_shared.ok()) {
+      return std::move(status_or_shared).status();
+    }
+    shared_ = *std::move(status_or_shared);
+  }
+  // The copy shares the connection data but not the cache.
+  connector_ = shared_->GetConnector();
+
   if (!suppression_dictionary_) {
     suppression_dictionary_ = std::make_unique<SuppressionDictionary>();
     RETURN_IF_NULL(suppression_dictionary_);
   }
 
-  if (!pos_matcher_) {
-    pos_matcher_ = std::make_unique<dictionary::PosMatcher>(
-        data_manager_->GetPosMatcherData());
-    RETURN_IF_NULL(pos_matcher_);
-  }
-
+  const dictionary::PosMatcher *pos_matcher = GetPosMatcher();
   if (!user_dictionary_) {
     std::unique_ptr<UserPos> user_pos =
         UserPos::CreateFromDataManager(*data_manager_);
     RETURN_IF_NULL(user_pos);
 
     user_dictionary_ = std::make_unique<UserDictionary>(
-        std::move(user_pos), *pos_matcher_, suppression_dictionary_.get());
+        std::move(user_pos), *pos_matcher, suppression_dictionary_.get());
     RETURN_IF_NULL(user_dictionary_);
   }
 
@@ -109,15 +227,19 @@ absl::Status Modules::Init(
     data_manager_->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
 
     absl::StatusOr<std::unique_ptr<SystemDictionary>> sysdic =
-        SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
+        SystemDictionary::Builder(dictionary_data, dictionary_size)
+            .SetOptions(data_manager_->ShouldAdviseAccessPatterns()
+                            ? SystemDictionary::ADVISE_ACCESS_PATTERNS
+                            : SystemDictionary::NONE)
+            .Build();
     if (!sysdic.ok()) {
       return std::move(sysdic).status();
     }
     auto value_dic = std::make_unique<ValueDictionary>(
-        *pos_matcher_, &(*sysdic)->value_trie());
+        *pos_matcher, &(*sysdic)->value_trie());
     dictionary_ = std::make_unique<DictionaryImpl>(
         *std::move(sysdic), std::move(value_dic), user_dictionary_.get(),
-        suppression_dictionary_.get(), pos_matcher_.get());
+        suppression_dictionary_.get(), pos_matcher);
     RETURN_IF_NULL(dictionary_);
   }
 
@@ -131,50 +253,24 @@ absl::Status Modules::Init(
     RETURN_IF_NULL(suffix_dictionary_);
   }
 
-  auto status_or_connector = Connector::CreateFromDataManager(*data_manager_);
-  if (!status_or_connector.ok()) {
-    return std::move(status_or_connector).status();
-  }
-  connector_ = *std::move(status_or_connector);
-
-  segmenter_ = Segmenter::CreateFromDataManager(*data_manager_);
-  RETURN_IF_NULL(segmenter_);
-
-  pos_group_ = std::make_unique<PosGroup>(data_manager_->GetPosGroupData());
-  RETURN_IF_NULL(pos_group_);
+  initialized_ = true;
+  return absl::Status();
+#undef RETURN_IF_NULL
+}
 
-  {
-    absl::StatusOr<SuggestionFilter> status_or_suggestion_filter =
-        SuggestionFilter::Create(data_manager_->GetSuggestionFilterData());
-    if (!status_or_suggestion_filter.ok()) {
-      return std::move(status_or_suggestion_filter).status();
-    }
-    suggestion_filter_ = *std::move(status_or_suggestion_filter);
+const dictionary::PosMatcher *Modules::GetPosMatcher() const {
+  if (pos_matcher_) {
+    return pos_matcher_.get();
   }
+  return shared_ ? &shared_->GetPosMatcher() : nullptr;
+}
 
-  if (!single_kanji_prediction_aggregator_) {
-    single_kanji_prediction_aggregator_ =
-        std::make_unique<prediction::SingleKanjiPredictionAggregator>(
-            *data_manager_);
-    RETURN_IF_NULL(single_kanji_prediction_aggregator_);
+const prediction::SingleKanjiPredictionAggregator *
+Modules::GetSingleKanjiPredictionAggregator() const {
+  if (single_kanji_prediction_aggregator_) {
+    return single_kanji_prediction_aggregator_.get();
   }
-
-  absl::string_view zero_query_token_array_data;
-  absl::string_view zero_query_string_array_data;
-  absl::string_view zero_query_number_token_array_data;
-  absl::string_view zero_query_number_string_array_data;
-  data_manager_->GetZeroQueryData(&zero_query_token_array_data,
-                                  &zero_query_string_array_data,
-                                  &zero_query_number_token_array_data,
-                                  &zero_query_number_string_array_data);
-  zero_query_dict_.Init(zero_query_token_array_data,
-                        zero_query_string_array_data);
-  zero_query_number_dict_.Init(zero_query_number_token_array_data,
-                               zero_query_number_string_array_data);
-
-  initialized_ = true;
-  return absl::Status();
-#undef RETURN_IF_NULL
+  return shared_ ? &shared_->GetSingleKanjiPredictionAggregator() : nullptr;
 }
 
 void Modules::PresetPosMatcher(
@@ -35,6 +35,7 @@
 
 #include "absl/log/check.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "converter/connector.h"
 #include "converter/segmenter.h"
 #include "data_manager/data_manager_interface.h"
@@ -50,6 +51,60 @@
 namespace mozc {
 namespace engine {
 
+// Read-only modules built from a data set.  They don't depend on any user data
+// and are shared by all the Modules initialized from data sets with the same
+// checksum, so that the engines in one process build them only once.  The
+// instance keeps its data manager alive as the modules point into its data.
+class SharedModules {
+ public:
+  // Returns the shared modules for the data set of `data_manager`.  They are
+  // built if no Modules refers to them.  Data managers without checksum get
+  // their own instance.
+  static absl::StatusOr<std::shared_ptr<const SharedModules>> Get(
+      std::shared_ptr<const DataManagerInterface> data_manager);
+
+  SharedModules(const SharedModules &) = delete;
+  SharedModules &operator=(const SharedModules &) = delete;
+
+  const dictionary::PosMatcher &GetPosMatcher() const { return pos_matcher_; }
+  // Modules should hold a copy of the connector, which shares the connection
+  // data with this instance but has its own cache.
+  const Connector &GetConnector() const { return connector_; }
+  const Segmenter &GetSegmenter() const { return *segmenter_; }
+  const dictionary::PosGroup &GetPosGroup() const { return pos_group_; }
+  const SuggestionFilter &GetSuggestionFilter() const {
+    return suggestion_filter_;
+  }
+  const prediction::SingleKanjiPredictionAggregator &
+  GetSingleKanjiPredictionAggregator() const {
+    return single_kanji_prediction_aggregator_;
+  }
+  const ZeroQueryDict &GetZeroQueryDict() const { return zero_query_dict_; }
+  const ZeroQueryDict &GetZeroQueryNumberDict() const {
+    return zero_query_number_dict_;
+  }
+
+ private:
+  explicit SharedModules(
+      std::shared_ptr<const DataManagerInterface> data_manager);
+
+  absl::Status Init();
+
+  const std::shared_ptr<const DataManagerInterface> data_manager_;
+  const dictionary::PosMatcher pos_matcher_;
+  Connector connector_;
+  std::unique_ptr<const Segmenter> segmenter_;
+  const dictionary::PosGroup pos_group_;
+  SuggestionFilter suggestion_filter_;
+  const prediction::SingleKanjiPredictionAggregator
+      single_kanji_prediction_aggregator_;
+  ZeroQueryDict zero_query_dict_;
+  ZeroQueryDict zero_query_number_dict_;
+};
+
+// Modules used by an engine.  The modules derived only from the data set are
+// borrowed from SharedModules, and the others, e.g. the dictionaries which
+// refer to the user dictionary, are owned by each instance.
 class Modules {
  public:
   Modules() = default;
@@ -80,9 +135,7 @@ class Modules {
     return *data_manager_;
   }
 
-  const dictionary::PosMatcher *GetPosMatcher() const {
-    return pos_matcher_.get();
-  }
+  const dictionary::PosMatcher *GetPosMatcher() const;
   const dictionary::SuppressionDictionary *GetSuppressionDictionary() const {
     return suppression_dictionary_.get();
   }
@@ -90,7 +143,9 @@ class Modules {
     return suppression_dictionary_.get();
   }
   const Connector &GetConnector() const { return connector_; }
-  const Segmenter *GetSegmenter() const { return segmenter_.get(); }
+  const Segmenter *GetSegmenter() const {
+    return shared_ ? &shared_->GetSegmenter() : nullptr;
+  }
   dictionary::UserDictionaryInterface *GetUserDictionary() const {
     return user_dictionary_.get();
   }
@@ -100,17 +155,22 @@ class Modules {
   const dictionary::DictionaryInterface *GetDictionary() const {
     return dictionary_.get();
   }
-  const dictionary::PosGroup *GetPosGroup() const { return pos_group_.get(); }
+  const dictionary::PosGroup *GetPosGroup() const {
+    return shared_ ? &shared_->GetPosGroup() : nullptr;
+  }
   const SuggestionFilter &GetSuggestionFilter() const {
-    return suggestion_filter_;
+    DCHECK(shared_);
+    return shared_->GetSuggestionFilter();
   }
   const prediction::SingleKanjiPredictionAggregator *
-  GetSingleKanjiPredictionAggregator() const {
-    return single_kanji_prediction_aggregator_.get();
+  GetSingleKanjiPredictionAggregator() const;
+  const ZeroQueryDict &GetZeroQueryDict() const {
+    DCHECK(shared_);
+    return shared_->GetZeroQueryDict();
   }
-  const ZeroQueryDict &GetZeroQueryDict() const { return zero_query_dict_; }
   const ZeroQueryDict &GetZeroQueryNumberDict() const {
-    return zero_query_number_dict_;
+    DCHECK(shared_);
+    return shared_->GetZeroQueryNumberDict();
   }
 
   const engine::SupplementalModelInterface *GetSupplementalModel() const {
@@ -123,20 +183,17 @@ class Modules {
 
  private:
   bool initialized_ = false;
-  std::unique_ptr<const DataManagerInterface> data_manager_;
+  std::shared_ptr<const DataManagerInterface> data_manager_;
+  std::shared_ptr<const SharedModules> shared_;
+  // Preset modules, which take precedence over the shared ones.
   std::unique_ptr<const dictionary::PosMatcher> pos_matcher_;
+  std::unique_ptr<const prediction::SingleKanjiPredictionAggregator>
+      single_kanji_prediction_aggregator_;
   std::unique_ptr<dictionary::SuppressionDictionary> suppression_dictionary_;
   Connector connector_;
-  std::unique_ptr<const Segmenter> segmenter_;
   std::unique_ptr<dictionary::UserDictionaryInterface> user_dictionary_;
   std::unique_ptr<dictionary::DictionaryInterface> suffix_dictionary_;
   std::unique_ptr<dictionary::DictionaryInterface> dictionary_;
-  std::unique_ptr<const dictionary::PosGroup> pos_group_;
-  SuggestionFilter suggestion_filter_;
-  std::unique_ptr<const prediction::SingleKanjiPredictionAggregator>
-      single_kanji_prediction_aggregator_;
-  ZeroQueryDict zero_query_dict_;
-  ZeroQueryDict zero_query_number_dict_;
 
   // SupplementalModel used for homonym correction.
   // Module doesn't have the ownership of supplemental_model_,
@@ -31,7 +31,10 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "absl/status/statusor.h"
+#include "base/thread.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/dictionary_mock.h"
@@ -110,5 +113,57 @@ TEST(ModulesTest, Preset) {
   EXPECT_EQ(modules.GetDictionary(), dictionary_ptr);
 }
 
+TEST(ModulesTest, ShareReadOnlyModules) {
+  Modules modules1, modules2;
+  ASSERT_OK(modules1.Init(std::make_unique<testing::MockDataManager>()));
+  ASSERT_OK(modules2.Init(std::make_unique<testing::MockDataManager>()));
+
+  // The modules derived only from the data set are shared.
+  EXPECT_EQ(modules1.GetPosMatcher(), modules2.GetPosMatcher());
+  EXPECT_EQ(modules1.GetSegmenter(), modules2.GetSegmenter());
+  EXPECT_EQ(modules1.GetPosGroup(), modules2.GetPosGroup());
+  EXPECT_EQ(&modules1.GetSuggestionFilter(), &modules2.GetSuggestionFilter());
+  EXPECT_EQ(modules1.GetSingleKanjiPredictionAggregator(),
+            modules2.GetSingleKanjiPredictionAggregator());
+  EXPECT_EQ(&modules1.GetZeroQueryDict(), &modules2.GetZeroQueryDict());
+
+  // The others are owned by each instance.
+  EXPECT_NE(&modules1.GetDataManager(), &modules2.GetDataManager());
+  EXPECT_NE(&modules1.GetConnector(), &modules2.GetConnector());
+  EXPECT_NE(modules1.GetUserDictionary(), modules2.GetUserDictionary());
+  EXPECT_NE(modules1.GetDictionary(), modules2.GetDictionary());
+  EXPECT_NE(modules1.GetSuppressionDictionary(),
+            modules2.GetSuppressionDictionary());
+  EXPECT_EQ(modules1.GetConnector().GetTransitionCost(0, 0),
+            modules2.GetConnector().GetTransitionCost(0, 0));
+}
+
+TEST(SharedModulesTest, Get) {
+  absl::StatusOr<std::shared_ptr<const SharedModules>> shared1 =
+      SharedModules::Get(std::make_shared<testing::MockDataManager>());
+  ASSERT_OK(shared1);
+  absl::StatusOr<std::shared_ptr<const SharedModules>> shared2 =
+      SharedModules::Get(std::make_shared<testing::MockDataManager>());
+  ASSERT_OK(shared2);
+  EXPECT_EQ(*shared1, *shared2);
+}
+
+TEST(SharedModulesTest, GetConcurrently) {
+  using SharedModulesOr = absl::StatusOr<std::shared_ptr<const SharedModules>>;
+  std::vector<BackgroundFuture<SharedModulesOr>> futures;
+  for (int i = 0; i < 4; ++i) {
+    futures.emplace_back([] {
+      return SharedModules::Get(std::make_shared<testing::MockDataManager>());
+    });
+  }
+  // The data set is built once, and all the threads get the same instance.
+  const SharedModulesOr &shared = futures[0].Get();
+  ASSERT_OK(shared);
+  for (const BackgroundFuture<SharedModulesOr> &future : futures) {
+    ASSERT_OK(future.Get());
+    EXPECT_EQ(*future.Get(), *shared);
+  }
+}
+
 }  // namespace engine
 }  // namespace mozc
@@ -0,0 +1,138 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/warmup.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/log/log.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/file_util.h"
+#include "base/latency_trace.h"
+#include "composer/composer.h"
+#include "config/config_handler.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "request/conversion_request.h"
+
+ABSL_FLAG(std::string, warmup_queries_file, "",
+          "File of the queries to warm up the engine, one query per line or "
+          "in the TSV format of data/test/quality_regression_test. The "
+          "built-in queries are used if empty.");
+
+namespace mozc {
+namespace engine {
+
+std::vector<std::string> GetBuiltinWarmupQueries() {
+  return {
+      "わたし",
+      "ありがとう",
+      "よろしくおねがいします",
+      "おつかれさまです",
+      "きょうはいいてんきですね",
+      "あしたのかいぎはなんじからですか",
+      "しょうしょうおまちください",
+      "わかりました",
+      "にほんご",
+      "へんかん",
+      "とうきょう",
+      "いま",
+  };
+}
+
+absl::StatusOr<std::vector<std::string>> ReadWarmupQueries(
+    const std::string &path) {
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(path);
+  if (!contents.ok()) {
+    return std::move(contents).status();
+  }
+  std::vector<std::string> queries;
+  for (const absl::string_view line :
+       absl::StrSplit(*contents, '\n', absl::SkipEmpty())) {
+    if (absl::StartsWith(line, "#")) {
+      continue;
+    }
+    const std::vector<absl::string_view> fields = absl::StrSplit(line, '\t');
+    const absl::string_view query = fields.size() >= 2 ? fields[1] : fields[0];
+    if (!query.empty()) {
+      queries.emplace_back(query);
+    }
+  }
+  return queries;
+}
+
+std::vector<std::string> GetWarmupQueries() {
+  const std::string path = absl::GetFlag(FLAGS_warmup_queries_file);
+  if (path.empty()) {
+    return GetBuiltinWarmupQueries();
+  }
+  absl::StatusOr<std::vector<std::string>> queries = ReadWarmupQueries(path);
+  if (!queries.ok()) {
+    LOG(ERROR) << "Failed to read the warmup queries: " << queries.status();
+    return GetBuiltinWarmupQueries();
+  }
+  return *std::move(queries);
+}
+
+void WarmUpConverter(const ConverterInterface &converter,
+                     absl::Span<const std::string> queries) {
+  MOZC_LATENCY_TRACE("WarmUpConverter");
+  // Only the total is recorded. The stages run by the warmup would skew the
+  // histograms of the key event path.
+  const ScopedLatencyTraceSuppressor suppressor;
+
+  for (const std::string &query : queries) {
+    composer::Composer composer;
+    composer.InsertCharacterPreedit(query);
+    const ConversionRequest request(
+        &composer, &commands::Request::default_instance(),
+        &commands::Context::default_instance(),
+        &config::ConfigHandler::DefaultConfig());
+    // The suggestion and the conversion of the whole query, as typed.
+    Segments suggestion_segments;
+    if (!converter.StartSuggestion(request, &suggestion_segments)) {
+      LOG(WARNING) << "Failed to suggest for the warmup query: " << query;
+    }
+    Segments conversion_segments;
+    if (!converter.StartConversion(request, &conversion_segments)) {
+      LOG(WARNING) << "Failed to convert the warmup query: " << query;
+    }
+  }
+}
+
+}  // namespace engine
+}  // namespace mozc
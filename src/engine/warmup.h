@@ -0,0 +1,70 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_ENGINE_WARMUP_H_
+#define MOZC_ENGINE_WARMUP_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "converter/converter_interface.h"
+
+namespace mozc {
+namespace engine {
+
+// Returns the built-in queries to warm up the modules, which are readings of
+// common phrases.
+std::vector<std::string> GetBuiltinWarmupQueries();
+
+// Reads the queries to warm up the modules from `path`. Each line is a query,
+// or a TSV line whose second column is the query, as in the files of
+// data/test/quality_regression_test. Empty lines and the lines starting with
+// '#' are skipped.
+absl::StatusOr<std::vector<std::string>> ReadWarmupQueries(
+    const std::string &path);
+
+// Returns the queries of --warmup_queries_file, or the built-in queries if the
+// flag is empty or the file can't be read.
+std::vector<std::string> GetWarmupQueries();
+
+// Runs the suggestion and the conversion of `queries` through `converter` and
+// discards the results. This pages in the data of the dictionaries, the
+// predictors and the rewriters and fills the cost cache of the connector and
+// the caches built on first use by `converter` itself, so that its first key
+// events are not slow. Should be called before `converter` is published to
+// the sessions.
+void WarmUpConverter(const ConverterInterface &converter,
+                     absl::Span<const std::string> queries);
+
+}  // namespace engine
+}  // namespace mozc
+
+#endif  // MOZC_ENGINE_WARMUP_H_
@@ -0,0 +1,90 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/warmup.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "base/file/temp_dir.h"
+#include "base/file_util.h"
+#include "converter/converter_mock.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "testing/mozctest.h"
+
+namespace mozc {
+namespace engine {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Return;
+
+TEST(WarmupTest, GetBuiltinWarmupQueries) {
+  const std::vector<std::string> queries = GetBuiltinWarmupQueries();
+  EXPECT_FALSE(queries.empty());
+  for (const std::string &query : queries) {
+    EXPECT_FALSE(query.empty());
+  }
+}
+
+TEST(WarmupTest, ReadWarmupQueries) {
+  const TempFile file = testing::MakeTempFileOrDie();
+  ASSERT_OK(FileUtil::SetContents(file.path(),
+                                  "# comment\n"
+                                  "わたし\n"
+                                  "\n"
+                                  "Conversion Expected\tへんかん\t変換\tAt top\n"
+                                  "いま\n"));
+  absl::StatusOr<std::vector<std::string>> queries =
+      ReadWarmupQueries(file.path());
+  ASSERT_OK(queries);
+  EXPECT_THAT(*queries, ElementsAre("わたし", "へんかん", "いま"));
+
+  EXPECT_FALSE(ReadWarmupQueries(FileUtil::JoinPath(file.path(), "missing"))
+                   .ok());
+}
+
+TEST(WarmupTest, WarmUpConverter) {
+  StrictMockConverter converter;
+  EXPECT_CALL(converter, StartSuggestion(_, _))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(converter, StartConversion(_, _))
+      .Times(2)
+      .WillRepeatedly(Return(false));
+  WarmUpConverter(converter, {"わたし", "いま"});
+  WarmUpConverter(converter, {});
+}
+
+}  // namespace
+}  // namespace engine
+}  // namespace mozc
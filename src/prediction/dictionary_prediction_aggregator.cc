@@ -34,12 +34,13 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <memory>
 #include <optional>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/btree_set.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/match.h"
@@ -212,10 +213,21 @@ ConversionRequest GetConversionRequestForRealtimeCandidates(
 
 Segments GetSegmentsForRealtimeCandidatesGeneration(
     const Segments &original_segments) {
-  Segments segments = original_segments;
+  Segments segments;
+  segments.set_max_history_segments_size(
+      original_segments.max_history_segments_size());
+  segments.set_resized(original_segments.resized());
+  for (const Segment &segment : original_segments.history_segments()) {
+    *segments.add_segment() = segment;
+  }
   // Other predictors (i.e. user_history_predictor) can add candidates
-  // before this predictor.
-  segments.mutable_conversion_segment(0)->clear_candidates();
+  // before this predictor, so only the key of the conversion segment is copied
+  // instead of copying all the candidates and then clearing them.
+  for (const Segment &segment : original_segments.conversion_segments()) {
+    Segment *new_segment = segments.add_segment();
+    new_segment->set_key(segment.key());
+    new_segment->set_segment_type(segment.segment_type());
+  }
   return segments;
 }
 
@@ -245,10 +257,11 @@ class DictionaryPredictionAggregator::PredictiveLookupCallback
  public:
   PredictiveLookupCallback(PredictionTypes types, size_t limit,
                            size_t original_key_len,
-                           const std::set<std::string> *subsequent_chars,
+                           const absl::btree_set<std::string> *subsequent_chars,
                            Segment::Candidate::SourceInfo source_info,
                            int zip_code_id, int unknown_id,
-                           absl::string_view non_expanded_original_key,
+                           std::shared_ptr<const std::string>
+                               non_expanded_original_key,
                            std::vector<Result> *results)
       : penalty_(0),
         types_(types),
@@ -258,7 +271,7 @@ class DictionaryPredictionAggregator::PredictiveLookupCallback
         source_info_(source_info),
         zip_code_id_(zip_code_id),
         unknown_id_(unknown_id),
-        non_expanded_original_key_(non_expanded_original_key),
+        non_expanded_original_key_(std::move(non_expanded_original_key)),
         results_(results) {}
 
   PredictiveLookupCallback(const PredictiveLookupCallback &) = delete;
@@ -321,8 +334,7 @@ class DictionaryPredictionAggregator::PredictiveLookupCallback
     results_->back().InitializeByTokenAndTypes(token, types_);
     results_->back().wcost += penalty_;
     results_->back().source_info |= source_info_;
-    results_->back().non_expanded_original_key =
-        std::string(non_expanded_original_key_);
+    results_->back().non_expanded_original_key = non_expanded_original_key_;
     return (results_->size() < limit_) ? TRAVERSE_CONTINUE : TRAVERSE_DONE;
   }
 
@@ -331,11 +343,12 @@ class DictionaryPredictionAggregator::PredictiveLookupCallback
   const PredictionTypes types_;
   const size_t limit_;
   const size_t original_key_len_;
-  const std::set<std::string> *subsequent_chars_ = nullptr;
+  const absl::btree_set<std::string> *subsequent_chars_ = nullptr;
   const Segment::Candidate::SourceInfo source_info_;
   const int zip_code_id_;
   const int unknown_id_;
-  absl::string_view non_expanded_original_key_;
+  // Shared by all the results of this lookup.
+  const std::shared_ptr<const std::string> non_expanded_original_key_;
   std::vector<Result> *results_ = nullptr;
 
  private:
@@ -378,17 +391,18 @@ class DictionaryPredictionAggregator::PredictiveLookupCallback
 class DictionaryPredictionAggregator::PredictiveBigramLookupCallback
     : public PredictiveLookupCallback {
  public:
-  PredictiveBigramLookupCallback(PredictionTypes types, size_t limit,
-                                 size_t original_key_len,
-                                 const std::set<std::string> *subsequent_chars,
-                                 absl::string_view history_value,
-                                 Segment::Candidate::SourceInfo source_info,
-                                 int zip_code_id, int unknown_id,
-                                 absl::string_view non_expanded_original_key,
-                                 std::vector<Result> *results)
-      : PredictiveLookupCallback(
-            types, limit, original_key_len, subsequent_chars, source_info,
-            zip_code_id, unknown_id, non_expanded_original_key, results),
+  PredictiveBigramLookupCallback(
+      PredictionTypes types, size_t limit, size_t original_key_len,
+      const absl::btree_set<std::string> *subsequent_chars,
+      absl::string_view history_value,
+      Segment::Candidate::SourceInfo source_info, int zip_code_id,
+      int unknown_id,
+      std::shared_ptr<const std::string> non_expanded_original_key,
+      std::vector<Result> *results)
+      : PredictiveLookupCallback(types, limit, original_key_len,
+                                 subsequent_chars, source_info, zip_code_id,
+                                 unknown_id,
+                                 std::move(non_expanded_original_key), results),
         history_value_(history_value) {}
 
   PredictiveBigramLookupCallback(const PredictiveBigramLookupCallback &) =
@@ -463,7 +477,7 @@ class DictionaryPredictionAggregator::PrefixLookupCallback
       result.candidate_attributes |= Segment::Candidate::PARTIALLY_KEY_CONSUMED;
       result.consumed_key_size = key_len;
     }
-    results_->emplace_back(result);
+    results_->emplace_back(std::move(result));
     return (results_->size() < limit_) ? TRAVERSE_CONTINUE : TRAVERSE_DONE;
   }
 
@@ -505,7 +519,7 @@ class DictionaryPredictionAggregator::HandwritingLookupCallback
     Result result;
     result.InitializeByTokenAndTypes(token, UNIGRAM);
     result.wcost += penalty_;
-    results_->emplace_back(result);
+    results_->emplace_back(std::move(result));
     return (results_->size() < limit_) ? TRAVERSE_CONTINUE : TRAVERSE_DONE;
   }
 
@@ -540,6 +554,20 @@ std::vector<Result> DictionaryPredictionAggregator::AggregateResults(
   return results;
 }
 
+std::vector<Result> DictionaryPredictionAggregator::AggregateResults(
+    const ConversionRequest &request, const Segments &segments,
+    const bool skip_base_results, size_t *base_size) const {
+  DCHECK(base_size);
+  const bool is_mixed_conversion = IsMixedConversionEnabled(request.request());
+  const size_t realtime_max_size =
+      GetRealtimeCandidateMaxSize(request, segments, is_mixed_conversion);
+  *base_size = 0;
+  std::vector<Result> results;
+  AggregatePrediction(request, realtime_max_size, GetUnigramConfig(request),
+                      segments, skip_base_results, base_size, &results);
+  return results;
+}
+
 std::vector<Result>
 DictionaryPredictionAggregator::AggregateTypingCorrectedResults(
     const ConversionRequest &request, const Segments &segments) const {
@@ -559,7 +587,8 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePredictionForTesting(
   const auto &unigram_config = GetUnigramConfig(request);
 
   return AggregatePrediction(request, realtime_max_size, unigram_config,
-                             segments, results);
+                             segments, /*skip_base_results=*/false,
+                             /*base_size=*/nullptr, results);
 }
 
 DictionaryPredictionAggregator::UnigramConfig
@@ -605,6 +634,7 @@ DictionaryPredictionAggregator::GetUnigramConfig(
 PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     const ConversionRequest &request, size_t realtime_max_size,
     const UnigramConfig &unigram_config, const Segments &segments,
+    const bool skip_base_results, size_t *base_size,
     std::vector<Result> *results) const {
   DCHECK(results);
 
@@ -630,7 +660,8 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     }
   }
   PredictionTypes selected_types = NO_PREDICTION;
-  if (ShouldAggregateRealTimeConversionResults(request, segments)) {
+  if (!skip_base_results &&
+      ShouldAggregateRealTimeConversionResults(request, segments)) {
     AggregateRealtimeConversion(
         request, realtime_max_size,
         /* insert_realtime_top_from_actual_converter= */
@@ -642,16 +673,22 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
   // In partial suggestion or prediction, only realtime candidates are used.
   if (request.request_type() == ConversionRequest::PARTIAL_SUGGESTION ||
       request.request_type() == ConversionRequest::PARTIAL_PREDICTION) {
+    if (base_size != nullptr) {
+      *base_size = results->size();
+    }
     return selected_types;
   }
 
   // Add unigram candidates.
   const size_t min_unigram_key_len = unigram_config.min_key_len;
-  if (key_len >= min_unigram_key_len) {
+  if (!skip_base_results && key_len >= min_unigram_key_len) {
     const auto &unigram_fn = unigram_config.unigram_fn;
     PredictionType type = (this->*unigram_fn)(request, segments, results);
     selected_types |= type;
   }
+  if (base_size != nullptr) {
+    *base_size = results->size();
+  }
 
   if (IsMixedConversionEnabled(request.request()) && key_len > 0 &&
       AggregateNumberCandidates(request, segments, results)) {
@@ -682,12 +719,13 @@ PredictionTypes DictionaryPredictionAggregator::AggregatePrediction(
     // We do not want to add single kanji results for non mixed conversion
     // (i.e., Desktop, or Hardware Keyboard in Mobile), since they contain
     // partial results.
-    const std::vector<Result> single_kanji_results =
+    std::vector<Result> single_kanji_results =
         modules_.GetSingleKanjiPredictionAggregator()->AggregateResults(
             request, segments);
     if (!single_kanji_results.empty()) {
-      results->insert(results->end(), single_kanji_results.begin(),
-                      single_kanji_results.end());
+      results->insert(results->end(),
+                      std::make_move_iterator(single_kanji_results.begin()),
+                      std::make_move_iterator(single_kanji_results.end()));
       selected_types |= SINGLE_KANJI;
     }
   }
@@ -897,6 +935,10 @@ void DictionaryPredictionAggregator::AggregateRealtimeConversion(
       GetConversionRequestForRealtimeCandidates(request,
                                                 realtime_candidates_size);
   Segments tmp_segments = GetSegmentsForRealtimeCandidatesGeneration(segments);
+  // Reuse the lattice built for the previous keystroke of this session. When
+  // one character is appended, ImmutableConverter only adds the new suffix to
+  // the cached lattice.
+  tmp_segments.ShareCachedLattice(segments);
 
   if (!immutable_converter_->ConvertForRequest(request_for_realtime,
                                                &tmp_segments) ||
@@ -906,29 +948,33 @@ void DictionaryPredictionAggregator::AggregateRealtimeConversion(
     return;
   }
 
-  // Copy candidates into the array of Results.
-  const Segment segment = tmp_segments.conversion_segment(0);
-  for (size_t i = 0; i < segment.candidates_size(); ++i) {
-    const Segment::Candidate &candidate = segment.candidate(i);
+  // Move candidates into the array of Results. `tmp_segments` is discarded
+  // after this loop, so the strings don't need to be copied.
+  Segment *segment = tmp_segments.mutable_conversion_segment(0);
+  results->reserve(results->size() + segment->candidates_size());
+  for (size_t i = 0; i < segment->candidates_size(); ++i) {
+    Segment::Candidate *candidate = segment->mutable_candidate(i);
     results->push_back(Result());
     Result *result = &results->back();
-    result->key = candidate.key;
-    result->value = candidate.value;
+    result->key = std::move(candidate->key);
+    result->value = std::move(candidate->value);
     // TODO(toshiyuki): Fix the cost.
     // This should be |candidate.wcost + candidate.structure_cost|.
     // |wcost| does not include transition cost between internal nodes.
-    result->wcost = candidate.wcost;
-    result->lid = candidate.lid;
-    result->rid = candidate.rid;
-    result->inner_segment_boundary = candidate.inner_segment_boundary;
+    result->wcost = candidate->wcost;
+    result->lid = candidate->lid;
+    result->rid = candidate->rid;
+    result->inner_segment_boundary.assign(
+        candidate->inner_segment_boundary.begin(),
+        candidate->inner_segment_boundary.end());
     result->SetTypesAndTokenAttributes(REALTIME, Token::NONE);
     result->candidate_attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
-    if (candidate.key.size() < segment.key().size()) {
+    if (result->key.size() < segment->key().size()) {
       result->candidate_attributes |=
           Segment::Candidate::PARTIALLY_KEY_CONSUMED;
-      result->consumed_key_size = Util::CharsLen(candidate.key);
+      result->consumed_key_size = Util::CharsLen(result->key);
     }
-    result->candidate_attributes |= candidate.attributes;
+    result->candidate_attributes |= candidate->attributes;
   }
 }
 
@@ -1343,7 +1389,7 @@ void DictionaryPredictionAggregator::GetPredictiveResults(
     input_key.append(segments.conversion_segment(0).key());
     PredictiveLookupCallback callback(types, lookup_limit, input_key.size(),
                                       nullptr, source_info, zip_code_id,
-                                      unknown_id, "", results);
+                                      unknown_id, nullptr, results);
     dictionary.LookupPredictive(input_key, request, &callback);
     return;
   }
@@ -1353,15 +1399,13 @@ void DictionaryPredictionAggregator::GetPredictiveResults(
   // "か", "き", etc
   // Example2 kana input: for "あか", we will get |base|, "あ" and |expanded|,
   // "か", and "が".
-  std::string base;
-  std::set<std::string> expanded;
-  request.composer().GetQueriesForPrediction(&base, &expanded);
+  const auto &[base, expanded] = request.composer().GetQueriesForPrediction();
   std::string input_key;
   if (expanded.empty()) {
     input_key = absl::StrCat(history_key, base);
     PredictiveLookupCallback callback(types, lookup_limit, input_key.size(),
                                       nullptr, source_info, zip_code_id,
-                                      unknown_id, "", results);
+                                      unknown_id, nullptr, results);
     dictionary.LookupPredictive(input_key, request, &callback);
     return;
   }
@@ -1369,8 +1413,8 @@ void DictionaryPredictionAggregator::GetPredictiveResults(
   // `non_expanded_original_key` keeps the original key request before
   // key expansions. This key is passed to the callback so that it can
   // identify whether the key is actually expanded or not.
-  const std::string non_expanded_original_key =
-      absl::StrCat(history_key, segments.conversion_segment(0).key());
+  const auto non_expanded_original_key = std::make_shared<const std::string>(
+      absl::StrCat(history_key, segments.conversion_segment(0).key()));
 
   // |expanded| is a very small set, so calling LookupPredictive multiple
   // times is not so expensive.  Also, the number of lookup results is limited
@@ -1395,7 +1439,7 @@ void DictionaryPredictionAggregator::GetPredictiveResultsForBigram(
     input_key.append(segments.conversion_segment(0).key());
     PredictiveBigramLookupCallback callback(
         types, lookup_limit, input_key.size(), nullptr, history_value,
-        source_info, zip_code_id_, unknown_id_, "", results);
+        source_info, zip_code_id_, unknown_id_, nullptr, results);
     dictionary.LookupPredictive(input_key, request, &callback);
     return;
   }
@@ -1405,12 +1449,10 @@ void DictionaryPredictionAggregator::GetPredictiveResultsForBigram(
   // "か", "き", etc
   // Example2 kana input: for "あか", we will get |base|, "あ" and |expanded|,
   // "か", and "が".
-  std::string base;
-  std::set<std::string> expanded;
-  request.composer().GetQueriesForPrediction(&base, &expanded);
+  const auto &[base, expanded] = request.composer().GetQueriesForPrediction();
   const std::string input_key = absl::StrCat(history_key, base);
-  const std::string non_expanded_original_key =
-      absl::StrCat(history_key, segments.conversion_segment(0).key());
+  const auto non_expanded_original_key = std::make_shared<const std::string>(
+      absl::StrCat(history_key, segments.conversion_segment(0).key()));
 
   PredictiveBigramLookupCallback callback(
       types, lookup_limit, input_key.size(),
@@ -1429,9 +1471,10 @@ void DictionaryPredictionAggregator::GetPredictiveResultsForEnglishKey(
     // the results to upper case.
     std::string key(input_key);
     Util::LowerString(&key);
-    PredictiveLookupCallback callback(types, lookup_limit, key.size(), nullptr,
-                                      Segment::Candidate::SOURCE_INFO_NONE,
-                                      zip_code_id_, unknown_id_, "", results);
+    PredictiveLookupCallback callback(
+        types, lookup_limit, key.size(), nullptr,
+        Segment::Candidate::SOURCE_INFO_NONE, zip_code_id_, unknown_id_,
+        nullptr, results);
     dictionary.LookupPredictive(key, request, &callback);
     for (size_t i = prev_results_size; i < results->size(); ++i) {
       Util::UpperString(&(*results)[i].value);
@@ -1441,19 +1484,20 @@ void DictionaryPredictionAggregator::GetPredictiveResultsForEnglishKey(
     // the results to capital.
     std::string key(input_key);
     Util::LowerString(&key);
-    PredictiveLookupCallback callback(types, lookup_limit, key.size(), nullptr,
-                                      Segment::Candidate::SOURCE_INFO_NONE,
-                                      zip_code_id_, unknown_id_, "", results);
+    PredictiveLookupCallback callback(
+        types, lookup_limit, key.size(), nullptr,
+        Segment::Candidate::SOURCE_INFO_NONE, zip_code_id_, unknown_id_,
+        nullptr, results);
     dictionary.LookupPredictive(key, request, &callback);
     for (size_t i = prev_results_size; i < results->size(); ++i) {
       Util::CapitalizeString(&(*results)[i].value);
     }
   } else {
     // For other cases (lower and as-is), just look up directly.
-    PredictiveLookupCallback callback(types, lookup_limit, input_key.size(),
-                                      nullptr,
-                                      Segment::Candidate::SOURCE_INFO_NONE,
-                                      zip_code_id_, unknown_id_, "", results);
+    PredictiveLookupCallback callback(
+        types, lookup_limit, input_key.size(), nullptr,
+        Segment::Candidate::SOURCE_INFO_NONE, zip_code_id_, unknown_id_,
+        nullptr, results);
     dictionary.LookupPredictive(input_key, request, &callback);
   }
   // If input mode is FULL_ASCII, then convert the results to full-width.
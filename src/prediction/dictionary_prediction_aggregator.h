@@ -68,6 +68,10 @@ class DictionaryPredictionAggregator : public PredictionAggregatorInterface {
 
   std::vector<Result> AggregateResults(const ConversionRequest &request,
                                        const Segments &segments) const override;
+  std::vector<Result> AggregateResults(const ConversionRequest &request,
+                                       const Segments &segments,
+                                       bool skip_base_results,
+                                       size_t *base_size) const override;
 
   std::vector<Result> AggregateTypingCorrectedResults(
       const ConversionRequest &request,
@@ -104,10 +108,14 @@ class DictionaryPredictionAggregator : public PredictionAggregatorInterface {
       const ConversionRequest &request, const Segments &segments,
       std::vector<Result> *results) const;
 
+  // When `skip_base_results` is true, the realtime conversion and unigram
+  // entries are not aggregated. Otherwise, their number is stored in
+  // `base_size` if it is not null.
   PredictionTypes AggregatePrediction(const ConversionRequest &request,
                                       size_t realtime_max_size,
                                       const UnigramConfig &unigram_config,
                                       const Segments &segments,
+                                      bool skip_base_results, size_t *base_size,
                                       std::vector<Result> *results) const;
 
   // Looks up the given range and appends zero query candidate list for |key|
@@ -97,6 +97,14 @@ class DictionaryPredictionAggregatorTestPeer {
                                                      results);
   }
 
+  std::vector<Result> AggregateResults(const ConversionRequest &request,
+                                       const Segments &segments,
+                                       bool skip_base_results,
+                                       size_t *base_size) const {
+    return aggregator_.AggregateResults(request, segments, skip_base_results,
+                                        base_size);
+  }
+
   size_t GetCandidateCutoffThreshold(
       ConversionRequest::RequestType request_type) const {
     return aggregator_.GetCandidateCutoffThreshold(request_type);
@@ -645,6 +653,35 @@ TEST_F(DictionaryPredictionAggregatorTest, BigramTest) {
                            *suggestion_convreq_, segments, &results));
 }
 
+TEST_F(DictionaryPredictionAggregatorTest, SkipBaseResults) {
+  std::unique_ptr<MockDataAndAggregator> data_and_aggregator =
+      CreateAggregatorWithMockData();
+  const DictionaryPredictionAggregatorTestPeer &aggregator =
+      data_and_aggregator->aggregator();
+
+  Segments segments;
+  config_->set_use_dictionary_suggest(true);
+
+  InitSegmentsWithKey("あどせんす", &segments);
+  PrependHistorySegments("ぐーぐる", "グーグル", &segments);
+
+  size_t base_size = 0;
+  const std::vector<Result> results = aggregator.AggregateResults(
+      *suggestion_convreq_, segments, /*skip_base_results=*/false, &base_size);
+  ASSERT_LE(base_size, results.size());
+
+  // Only the results after the base ones are aggregated.
+  size_t skipped_base_size = 1;
+  const std::vector<Result> rest = aggregator.AggregateResults(
+      *suggestion_convreq_, segments, /*skip_base_results=*/true,
+      &skipped_base_size);
+  EXPECT_EQ(skipped_base_size, 0);
+  ASSERT_EQ(rest.size(), results.size() - base_size);
+  for (size_t i = 0; i < rest.size(); ++i) {
+    EXPECT_EQ(rest[i].value, results[base_size + i].value);
+  }
+}
+
 TEST_F(DictionaryPredictionAggregatorTest, BigramTestWithZeroQuery) {
   std::unique_ptr<MockDataAndAggregator> data_and_aggregator =
       CreateAggregatorWithMockData();
@@ -2376,6 +2413,48 @@ TEST_F(DictionaryPredictionAggregatorTest,
   EXPECT_EQ(results[1].value, kExpectedSuggestionValues[1]);
 }
 
+TEST_F(DictionaryPredictionAggregatorTest,
+       RealtimeConversionReusesCachedLattice) {
+  std::unique_ptr<MockDataAndAggregator> data_and_aggregator =
+      CreateAggregatorWithMockData();
+  const DictionaryPredictionAggregatorTestPeer &aggregator =
+      data_and_aggregator->aggregator();
+
+  config_->set_use_dictionary_suggest(false);
+  config_->set_use_realtime_conversion(true);
+
+  std::vector<const Lattice *> lattices;
+  {
+    MockImmutableConverter *immutable_converter =
+        data_and_aggregator->mutable_immutable_converter();
+    ::testing::Mock::VerifyAndClearExpectations(immutable_converter);
+    EXPECT_CALL(*immutable_converter, ConvertForRequest(_, _))
+        .WillRepeatedly(
+            [&lattices](const ConversionRequest &request, Segments *segments) {
+              lattices.push_back(segments->mutable_cached_lattice());
+              return MockImmutableConverter::ConvertForRequestImpl(request,
+                                                                   segments);
+            });
+  }
+
+  Segments segments;
+  std::vector<Result> results;
+  SetUpInputForSuggestion("わたしの", composer_.get(), &segments);
+  aggregator.AggregateRealtimeConversion(*suggestion_convreq_, 10, false,
+                                         segments, &results);
+  SetUpInputForSuggestion("わたしのな", composer_.get(), &segments);
+  aggregator.AggregateRealtimeConversion(*suggestion_convreq_, 10, false,
+                                         segments, &results);
+
+  // Both keystrokes are converted on the lattice cached in `segments`.
+  ASSERT_EQ(lattices.size(), 2);
+  EXPECT_EQ(lattices[0], segments.mutable_cached_lattice());
+  EXPECT_EQ(lattices[1], segments.mutable_cached_lattice());
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[0].value, "わたしの");
+  EXPECT_EQ(results[1].value, "わたしのな");
+}
+
 TEST_F(DictionaryPredictionAggregatorTest,
        RealtimeConversionWithSpellingCorrection) {
   std::unique_ptr<MockDataAndAggregator> data_and_aggregator =
@@ -34,6 +34,7 @@
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
@@ -49,6 +50,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "base/latency_trace.h"
 #include "base/strings/assign.h"
 #include "base/strings/japanese.h"
 #include "base/util.h"
@@ -130,11 +132,12 @@ absl::string_view GetCandidateOriginalLookupKey(
     absl::string_view input_key ABSL_ATTRIBUTE_LIFETIME_BOUND,
     const Result &result ABSL_ATTRIBUTE_LIFETIME_BOUND,
     absl::string_view history_key) {
-  if (result.non_expanded_original_key.empty()) {
+  if (result.non_expanded_original_key == nullptr ||
+      result.non_expanded_original_key->empty()) {
     return input_key;
   }
 
-  absl::string_view lookup_key = result.non_expanded_original_key;
+  absl::string_view lookup_key = *result.non_expanded_original_key;
   if (result.types & PredictionType::BIGRAM) {
     lookup_key.remove_prefix(history_key.size());
   }
@@ -291,6 +294,7 @@ void DictionaryPredictor::MaybeRecordUsageStats(
 
 bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
                                             Segments *segments) const {
+  MOZC_LATENCY_TRACE("DictionaryPredictor::PredictForRequest");
   if (segments == nullptr) {
     return false;
   }
@@ -303,8 +307,7 @@ bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
     return false;
   }
 
-  std::vector<Result> results =
-      aggregator_->AggregateResults(request, *segments);
+  std::vector<Result> results = AggregateResults(request, *segments);
   RewriteResultsForPrediction(request, *segments, &results);
 
   // Explicitly populate the typing corrected results.
@@ -318,6 +321,63 @@ bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
                                    absl::MakeSpan(results));
 }
 
+std::vector<Result> DictionaryPredictor::AggregateResults(
+    const ConversionRequest &request, const Segments &segments) const {
+  if (!request.request().fill_incognito_candidate_words()) {
+    return aggregator_->AggregateResults(request, segments);
+  }
+
+  AggregationKey key;
+  key.request = request.request().SerializeAsString();
+  key.request_type = request.request_type();
+  key.key = segments.conversion_segment(0).key();
+  key.history_key = segments.history_key();
+  key.history_value = segments.history_value();
+  if (request.has_composer()) {
+    key.raw_string = request.composer().GetRawString();
+  }
+  key.create_partial_candidates = request.create_partial_candidates();
+  key.use_actual_converter_for_realtime_conversion =
+      request.use_actual_converter_for_realtime_conversion();
+
+  // The user dictionary is disabled in incognito mode, and the top realtime
+  // result comes from the actual converter whose rewriters learn from the
+  // user. The other base results can be shared.
+  auto is_reusable = [](const Result &result) {
+    return !result.IsUserDictionaryResult() && !(result.types & REALTIME_TOP);
+  };
+
+  size_t base_size = 0;
+  if (!request.config().incognito_mode()) {
+    std::vector<Result> results = aggregator_->AggregateResults(
+        request, segments, /*skip_base_results=*/false, &base_size);
+    // Only the base results are kept. The rest is aggregated again for the
+    // incognito request.
+    auto aggregated = std::make_shared<AggregatedResults>();
+    aggregated->key = std::move(key);
+    aggregated->results.reserve(base_size);
+    std::copy_if(results.begin(), results.begin() + base_size,
+                 std::back_inserter(aggregated->results), is_reusable);
+    std::atomic_store(&aggregated_results_, std::move(aggregated));
+    return results;
+  }
+
+  // The incognito request is issued right after the normal one, so the
+  // aggregated results are consumed at most once and can be moved out.
+  std::shared_ptr<AggregatedResults> aggregated =
+      std::atomic_exchange(&aggregated_results_,
+                           std::shared_ptr<AggregatedResults>());
+  if (aggregated == nullptr || aggregated->key != key) {
+    return aggregator_->AggregateResults(request, segments);
+  }
+  std::vector<Result> results = std::move(aggregated->results);
+  std::vector<Result> rest = aggregator_->AggregateResults(
+      request, segments, /*skip_base_results=*/true, &base_size);
+  results.insert(results.end(), std::make_move_iterator(rest.begin()),
+                 std::make_move_iterator(rest.end()));
+  return results;
+}
+
 void DictionaryPredictor::RewriteResultsForPrediction(
     const ConversionRequest &request, const Segments &segments,
     std::vector<Result> *results) const {
@@ -388,9 +448,17 @@ bool DictionaryPredictor::AddPredictionToCandidates(
   DCHECK(segment);
 
   // This pointer array is used to perform heap operations efficiently.
+  // Results with the infinite cost are never shown, as the loop below stops at
+  // the first such result, so they are excluded from the heap up front. With
+  // mixed conversion and typing correction, this often leaves only a fraction
+  // of the aggregated results.
   std::vector<const Result *> result_ptrs;
   result_ptrs.reserve(results.size());
-  for (const auto &r : results) result_ptrs.push_back(&r);
+  for (const auto &r : results) {
+    if (r.cost < kInfinity) {
+      result_ptrs.push_back(&r);
+    }
+  }
 
   // Instead of sorting all the results, we construct a heap.
   // This is done in linear time and
@@ -439,13 +507,11 @@ bool DictionaryPredictor::AddPredictionToCandidates(
   std::shared_ptr<Result> prev_top_result;
 
   for (size_t i = 0; i < result_ptrs.size(); ++i) {
-    std::pop_heap(result_ptrs.begin(), result_ptrs.end() - i, min_heap_cmp);
-    const Result &result = *result_ptrs[result_ptrs.size() - i - 1];
-
-    if (final_results_ptrs.size() >= max_candidates_size ||
-        result.cost >= kInfinity) {
+    if (final_results_ptrs.size() >= max_candidates_size) {
       break;
     }
+    std::pop_heap(result_ptrs.begin(), result_ptrs.end() - i, min_heap_cmp);
+    const Result &result = *result_ptrs[result_ptrs.size() - i - 1];
 
     if (i == 0 && (prev_top_result = MaybeGetPreviousTopResult(
                        result, request, *segments)) != nullptr) {
@@ -814,6 +880,7 @@ bool DictionaryPredictor::ResultFilter::CheckDupAndReturn(
     *log_message = "Duplicated";
     return true;
   }
+  // `value` points to the result which outlives this filter.
   seen_.emplace(value);
   return false;
 }
@@ -860,7 +927,9 @@ void DictionaryPredictor::FillCandidate(
   }
   candidate->source_info = result.source_info;
   if (result.types & PredictionType::REALTIME) {
-    candidate->inner_segment_boundary = result.inner_segment_boundary;
+    candidate->inner_segment_boundary.assign(
+        result.inner_segment_boundary.begin(),
+        result.inner_segment_boundary.end());
   }
   if (result.types & PredictionType::TYPING_CORRECTION) {
     candidate->attributes |= Segment::Candidate::TYPING_CORRECTION;
@@ -142,8 +142,9 @@ class DictionaryPredictor : public PredictorInterface {
     int prefix_tc_count_;
     int tc_count_;
 
-    // Seen set for dup value check.
-    absl::flat_hash_set<std::string> seen_;
+    // Seen set for dup value check. The values refer to the results being
+    // filtered, so no string is copied per accepted result.
+    absl::flat_hash_set<absl::string_view> seen_;
   };
 
   // pair: <rid, key_length>
@@ -156,6 +157,14 @@ class DictionaryPredictor : public PredictorInterface {
           aggregator,
       const ImmutableConverterInterface *immutable_converter);
 
+  // Aggregates the results for `request`. When
+  // Request::fill_incognito_candidate_words is set, the incognito request
+  // following the normal one for the same input reuses the realtime
+  // conversion and unigram results of the normal request instead of
+  // aggregating them again.
+  std::vector<Result> AggregateResults(const ConversionRequest &request,
+                                       const Segments &segments) const;
+
   bool AddPredictionToCandidates(
       const ConversionRequest &request, Segments *segments,
       const TypingCorrectionMixingParams &typing_correction_mixing_params,
@@ -331,6 +340,30 @@ class DictionaryPredictor : public PredictorInterface {
   mutable std::shared_ptr<Result> prev_top_result_;
   mutable std::atomic<int32_t> prev_top_key_length_ = 0;
 
+  // Inputs of the aggregation compared to decide whether the incognito
+  // request can reuse the results of the preceding normal request. The
+  // history is included as the realtime conversion connects to it.
+  struct AggregationKey {
+    std::string request;  // Serialized commands::Request.
+    ConversionRequest::RequestType request_type = ConversionRequest::CONVERSION;
+    std::string key;
+    std::string history_key;
+    std::string history_value;
+    std::string raw_string;
+    bool create_partial_candidates = false;
+    bool use_actual_converter_for_realtime_conversion = false;
+
+    bool operator==(const AggregationKey &other) const = default;
+  };
+
+  // Reusable base results aggregated for the last non-incognito request with
+  // Request::fill_incognito_candidate_words. See AggregateResults().
+  struct AggregatedResults {
+    AggregationKey key;
+    std::vector<Result> results;
+  };
+  mutable std::shared_ptr<AggregatedResults> aggregated_results_;
+
   const ImmutableConverterInterface *immutable_converter_;
   const Connector &connector_;
   const Segmenter *segmenter_;
@@ -309,6 +309,10 @@ class MockAggregator : public prediction::PredictionAggregatorInterface {
   MOCK_METHOD(std::vector<prediction::Result>, AggregateResults,
               (const ConversionRequest &request, const Segments &segments),
               (const override));
+  MOCK_METHOD(std::vector<prediction::Result>, AggregateResults,
+              (const ConversionRequest &request, const Segments &segments,
+               bool skip_base_results, size_t *base_size),
+              (const override));
   MOCK_METHOD(std::vector<prediction::Result>, AggregateTypingCorrectedResults,
               (const ConversionRequest &request, const Segments &segments),
               (const override));
@@ -673,6 +677,96 @@ TEST_F(DictionaryPredictorTest, DoNotSuggestSpellingCorrectionBeforeMismatch) {
       FindCandidateByValue(segments.conversion_segment(0), "アボカド"));
 }
 
+TEST_F(DictionaryPredictorTest, DeriveIncognitoResults) {
+  auto data_and_predictor = std::make_unique<MockDataAndPredictor>();
+  const DictionaryPredictorTestPeer &predictor =
+      data_and_predictor->predictor();
+  MockAggregator *aggregator = data_and_predictor->mutable_aggregator();
+
+  // The base results are aggregated only once for the normal request and the
+  // following incognito one.
+  EXPECT_CALL(*aggregator, AggregateResults(_, _, false, _))
+      .WillOnce(DoAll(SetArgPointee<3>(2),
+                      Return(std::vector<Result>{
+                          CreateResult5("てすとちゅう", "テスト中", 500,
+                                        prediction::UNIGRAM, Token::NONE),
+                          CreateResult5("てすとでーた", "テストデータ", 500,
+                                        prediction::UNIGRAM,
+                                        Token::USER_DICTIONARY),
+                          CreateResult5("てすとだい", "テスト台", 500,
+                                        prediction::BIGRAM, Token::NONE),
+                      })));
+  EXPECT_CALL(*aggregator, AggregateResults(_, _, true, _))
+      .WillOnce(DoAll(SetArgPointee<3>(0),
+                      Return(std::vector<Result>{
+                          CreateResult5("てすとだい", "テスト題", 500,
+                                        prediction::BIGRAM, Token::NONE),
+                      })));
+
+  request_->set_fill_incognito_candidate_words(true);
+  Segments segments;
+  InitSegmentsWithKey("てすと", &segments);
+  predictor.PredictForRequest(*convreq_for_suggestion_, &segments);
+  EXPECT_TRUE(FindCandidateByValue(segments.conversion_segment(0), "テスト中"));
+  EXPECT_TRUE(
+      FindCandidateByValue(segments.conversion_segment(0), "テストデータ"));
+
+  config::Config incognito_config = *config_;
+  incognito_config.set_incognito_mode(true);
+  const commands::Context context;
+  ConversionRequest incognito_convreq(composer_.get(), request_.get(),
+                                      &context, &incognito_config);
+  incognito_convreq.set_request_type(ConversionRequest::SUGGESTION);
+  Segments incognito_segments;
+  InitSegmentsWithKey("てすと", &incognito_segments);
+  predictor.PredictForRequest(incognito_convreq, &incognito_segments);
+  EXPECT_TRUE(FindCandidateByValue(incognito_segments.conversion_segment(0),
+                                   "テスト中"));
+  // The results other than the base ones are aggregated again.
+  EXPECT_TRUE(FindCandidateByValue(incognito_segments.conversion_segment(0),
+                                   "テスト題"));
+  EXPECT_FALSE(FindCandidateByValue(incognito_segments.conversion_segment(0),
+                                    "テスト台"));
+  // The user dictionary is not used in incognito mode.
+  EXPECT_FALSE(FindCandidateByValue(incognito_segments.conversion_segment(0),
+                                    "テストデータ"));
+}
+
+TEST_F(DictionaryPredictorTest,
+       DoNotDeriveIncognitoResultsForDifferentRequestType) {
+  auto data_and_predictor = std::make_unique<MockDataAndPredictor>();
+  const DictionaryPredictorTestPeer &predictor =
+      data_and_predictor->predictor();
+  MockAggregator *aggregator = data_and_predictor->mutable_aggregator();
+
+  EXPECT_CALL(*aggregator, AggregateResults(_, _, false, _))
+      .WillOnce(DoAll(SetArgPointee<3>(1),
+                      Return(std::vector<Result>{
+                          CreateResult5("てすとちゅう", "テスト中", 500,
+                                        prediction::UNIGRAM, Token::NONE),
+                      })));
+  EXPECT_CALL(*aggregator, AggregateResults(_, _))
+      .WillOnce(Return(std::vector<Result>{
+          CreateResult5("てすとちゅう", "テスト中", 500, prediction::UNIGRAM,
+                        Token::NONE),
+      }));
+
+  request_->set_fill_incognito_candidate_words(true);
+  Segments segments;
+  InitSegmentsWithKey("てすと", &segments);
+  predictor.PredictForRequest(*convreq_for_prediction_, &segments);
+
+  config::Config incognito_config = *config_;
+  incognito_config.set_incognito_mode(true);
+  const commands::Context context;
+  ConversionRequest incognito_convreq(composer_.get(), request_.get(),
+                                      &context, &incognito_config);
+  incognito_convreq.set_request_type(ConversionRequest::SUGGESTION);
+  Segments incognito_segments;
+  InitSegmentsWithKey("てすと", &incognito_segments);
+  predictor.PredictForRequest(incognito_convreq, &incognito_segments);
+}
+
 TEST_F(DictionaryPredictorTest, MobileZeroQuery) {
   auto data_and_predictor = std::make_unique<MockDataAndPredictor>();
   const DictionaryPredictorTestPeer &predictor =
@@ -1470,6 +1564,54 @@ TEST_F(DictionaryPredictorTest, Dedup) {
   }
 }
 
+TEST_F(DictionaryPredictorTest, SelectTopResultsFromManyResults) {
+  auto data_and_predictor = std::make_unique<MockDataAndPredictor>();
+  const DictionaryPredictorTestPeer &predictor =
+      data_and_predictor->predictor();
+
+  constexpr int kTotalResultsSize = 10000;
+  constexpr int kValuesSize = 100;
+  constexpr int kMaxCandidatesSize = 10;
+  std::vector<Result> results;
+  results.reserve(kTotalResultsSize);
+  for (int i = 0; i < kTotalResultsSize; ++i) {
+    // Distinct costs in a shuffled order. Every 3rd result is never shown.
+    const int cost = i % 3 == 0 ? kInfinity : 1000 + (i * 7919) % 10007;
+    results.push_back(CreateResult6("test",
+                                    absl::StrCat("value", i % kValuesSize), 0,
+                                    cost, prediction::UNIGRAM, Token::NONE));
+  }
+
+  // The expected values are the cheapest distinct values.
+  std::vector<Result> sorted = results;
+  std::sort(sorted.begin(), sorted.end(), ResultCostLess());
+  std::vector<std::string> expected;
+  for (const Result &result : sorted) {
+    if (expected.size() >= kMaxCandidatesSize || result.cost >= kInfinity) {
+      break;
+    }
+    if (std::find(expected.begin(), expected.end(), result.value) ==
+        expected.end()) {
+      expected.push_back(result.value);
+    }
+  }
+
+  Segments segments;
+  InitSegmentsWithKey("test", &segments);
+  convreq_for_suggestion_->set_max_dictionary_prediction_candidates_size(
+      kMaxCandidatesSize);
+  predictor.AddPredictionToCandidates(*convreq_for_suggestion_, &segments,
+                                      typing_correction_mixing_params_,
+                                      absl::MakeSpan(results));
+
+  ASSERT_EQ(segments.conversion_segments_size(), 1);
+  const Segment &segment = segments.conversion_segment(0);
+  ASSERT_EQ(segment.candidates_size(), expected.size());
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    EXPECT_EQ(segment.candidate(i).value, expected[i]);
+  }
+}
+
 TEST_F(DictionaryPredictorTest, TypingCorrectionResultsLimit) {
   auto data_and_predictor = std::make_unique<MockDataAndPredictor>();
   const DictionaryPredictorTestPeer &predictor =
@@ -1494,7 +1636,8 @@ TEST_F(DictionaryPredictorTest, TypingCorrectionResultsLimit) {
                     Token::NONE),
   };
   for (auto &result : results) {
-    result.non_expanded_original_key = result.key;
+    result.non_expanded_original_key =
+        std::make_shared<const std::string>(result.key);
   }
 
   Segments segments;
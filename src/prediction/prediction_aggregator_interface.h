@@ -30,6 +30,7 @@
 #ifndef MOZC_PREDICTION_PREDICTION_AGGREGATOR_INTERFACE_H_
 #define MOZC_PREDICTION_PREDICTION_AGGREGATOR_INTERFACE_H_
 
+#include <cstddef>
 #include <vector>
 
 #include "converter/segments.h"
@@ -51,6 +52,20 @@ class PredictionAggregatorInterface {
   virtual std::vector<Result> AggregateResults(
       const ConversionRequest &request, const Segments &segments) const = 0;
 
+  // Same as above, but the realtime conversion and unigram entries come first
+  // and their number is stored in `base_size`. They do not depend on the
+  // user's data other than the user dictionary, so they can be reused for
+  // another request with the same input. When `skip_base_results` is true,
+  // they are not aggregated at all and only the other entries are returned.
+  // The default implementation has no such entries.
+  virtual std::vector<Result> AggregateResults(const ConversionRequest &request,
+                                               const Segments &segments,
+                                               bool skip_base_results,
+                                               size_t *base_size) const {
+    *base_size = 0;
+    return AggregateResults(request, segments);
+  }
+
   // Returns the typing corrected result entries for the `request` and
   // `segments`.
   virtual std::vector<Result> AggregateTypingCorrectedResults(
@@ -32,10 +32,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
@@ -119,13 +121,16 @@ struct Result {
   // If the candidate key and value are
   // "わたしの|なまえは|なかのです", " 私の|名前は|中野です",
   // |inner_segment_boundary| have [(4,2), (4, 3), (5, 4)].
-  std::vector<uint32_t> inner_segment_boundary;
+  // Most results have a few inner segments, which are stored inline.
+  absl::InlinedVector<uint32_t, 4> inner_segment_boundary;
   // Segment::Candidate::SourceInfo.
   // Will be used for usage stats.
   uint32_t source_info = 0;
-  // Lookup key without expansion.
+  // Lookup key without expansion. Nullptr if the key is not expanded.
   // Please refer to Composer for query expansion.
-  std::string non_expanded_original_key;
+  // The key is shared by all the results of the same lookup instead of being
+  // copied to each result.
+  std::shared_ptr<const std::string> non_expanded_original_key;
   size_t consumed_key_size = 0;
   // The total penalty added to this result.
   int penalty = 0;
@@ -153,8 +158,9 @@ struct Result {
         r.key, r.value, r.types, r.wcost, r.cost, r.cost_before_rescoring,
         r.lid, r.rid, r.candidate_attributes,
         absl::StrJoin(r.inner_segment_boundary, ","), r.source_info,
-        r.non_expanded_original_key, r.consumed_key_size, r.penalty,
-        r.typing_correction_adjustment, r.removed);
+        r.non_expanded_original_key ? *r.non_expanded_original_key : "",
+        r.consumed_key_size, r.penalty, r.typing_correction_adjustment,
+        r.removed);
 #ifndef NDEBUG
     sink.Append(", log:\n");
     for (absl::string_view line : absl::StrSplit(r.log, '\n')) {
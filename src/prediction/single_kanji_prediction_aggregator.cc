@@ -32,6 +32,7 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/string_view.h"
@@ -92,11 +93,19 @@ SingleKanjiPredictionAggregator::~SingleKanjiPredictionAggregator() = default;
 
 std::vector<Result> SingleKanjiPredictionAggregator::AggregateResults(
     const ConversionRequest &request, const Segments &segments) const {
-  std::vector<Result> results;
   constexpr int kMinSingleKanjiSize = 5;
 
   const bool use_svs = UseSvs(request);
 
+  // Looks up all the keys first to allocate the results at once.
+  struct KanjiEntries {
+    std::string key;
+    std::vector<std::string> kanji_list;
+    int offset;
+  };
+  std::vector<KanjiEntries> entries_list;
+  size_t results_size = 0;
+
   std::string original_input_key = GetKey(request, segments);
   int offset = 0;
   for (std::string key = original_input_key; !key.empty();
@@ -111,15 +120,23 @@ std::vector<Result> SingleKanjiPredictionAggregator::AggregateResults(
                                                       &kanji_list)) {
       continue;
     }
-    AppendResults(key, original_input_key, kanji_list, offset, &results);
+    results_size += kanji_list.size();
+    entries_list.push_back({key, std::move(kanji_list), offset});
     // Make sure that single kanji entries for shorter key should be
     // ranked lower than the entries for longer key.
     constexpr int kShorterKeyOffst = 3450;  // 500 * log(1000)
     offset += kShorterKeyOffst;
-    if (results.size() > kMinSingleKanjiSize) {
+    if (results_size > kMinSingleKanjiSize) {
       break;
     }
   }
+
+  std::vector<Result> results;
+  results.reserve(results_size);
+  for (const KanjiEntries &entries : entries_list) {
+    AppendResults(entries.key, original_input_key, entries.kanji_list,
+                  entries.offset, &results);
+  }
   return results;
 }
 
@@ -141,7 +158,7 @@ void SingleKanjiPredictionAggregator::AppendResults(
       result.consumed_key_size = Util::CharsLen(kanji_key);
     }
 
-    results->push_back(result);
+    results->push_back(std::move(result));
   }
 }
 
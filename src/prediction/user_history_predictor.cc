@@ -38,7 +38,6 @@
 #include <limits>
 #include <memory>
 #include <optional>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -1339,14 +1338,14 @@ void UserHistoryPredictor::GetInputKeyFromSegments(
   }
 
   *input_key = request.composer().GetStringForPreedit();
-  std::set<std::string> expanded_set;
-  request.composer().GetQueriesForPrediction(base, &expanded_set);
-  if (!expanded_set.empty()) {
+  const composer::Composer::PredictionQueries &queries =
+      request.composer().GetQueriesForPrediction();
+  *base = queries.base;
+  if (!queries.expanded.empty()) {
     *expanded = std::make_unique<Trie<std::string>>();
-    for (std::set<std::string>::const_iterator itr = expanded_set.begin();
-         itr != expanded_set.end(); ++itr) {
+    for (const std::string &key : queries.expanded) {
       // For getting matched key, insert values
-      (*expanded)->AddEntry(*itr, *itr);
+      (*expanded)->AddEntry(key, key);
     }
   }
 }
@@ -1749,14 +1748,18 @@ void UserHistoryPredictor::Finish(const ConversionRequest &request,
       segments->conversion_segment(0).candidates_size() > 0 &&
       IsPunctuation(segments->conversion_segment(0).candidate(0).value) &&
       // Check if the previous value looks like a sentence.
-      !segments->history_segments().empty() &&
-      segments->history_segments().back().candidates_size() > 0 &&
+      segments->history_segments_size() > 0 &&
+      segments->history_segment(segments->history_segments_size() - 1)
+              .candidates_size() > 0 &&
       IsSentenceLikeCandidate(
-          segments->history_segments().back().candidate(0))) {
+          segments->history_segment(segments->history_segments_size() - 1)
+              .candidate(0))) {
     const Entry *entry = &(dic_->Head()->value);
     DCHECK(entry);
     const std::string &last_value =
-        segments->history_segments().back().candidate(0).value;
+        segments->history_segment(segments->history_segments_size() - 1)
+            .candidate(0)
+            .value;
     // Check if the head value in LRU ends with the candidate value in history
     // segments.
     if (absl::EndsWith(entry->value(), last_value)) {
@@ -1772,7 +1775,8 @@ void UserHistoryPredictor::Finish(const ConversionRequest &request,
   }
 
   // Checks every segment is valid.
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     if (segment.candidates_size() < 1) {
       MOZC_VLOG(2) << "candidates size < 1";
       return;
@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <string>
+#include <utility>
 
 #include "absl/log/check.h"
 #include "absl/log/log.h"
@@ -102,7 +103,8 @@ bool CalculatorRewriter::Rewrite(const ConversionRequest &request,
 
   // Merge keys of all conversion segments and try calculation.
   std::string merged_key;
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     merged_key += segment.key();
   }
   // The decision to calculate and calculation itself are both done by the
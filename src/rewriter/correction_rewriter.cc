@@ -75,6 +75,13 @@ bool CorrectionRewriter::LookupCorrection(
   return !results->empty();
 }
 
+void CorrectionRewriter::AddTriggerKeys(
+    absl::FunctionRef<void(absl::string_view)> add_key) const {
+  for (const absl::string_view error : error_array_) {
+    add_key(error);
+  }
+}
+
 CorrectionRewriter::CorrectionRewriter(
     absl::string_view value_array_data, absl::string_view error_array_data,
     absl::string_view correction_array_data) {
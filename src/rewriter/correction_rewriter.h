@@ -33,6 +33,7 @@
 #include <memory>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
 #include "base/container/serialized_string_array.h"
 #include "converter/segments.h"
@@ -61,6 +62,10 @@ class CorrectionRewriter : public RewriterInterface {
     return RewriterInterface::ALL;
   }
 
+  int triggers() const override { return CANDIDATE_CONTENT_KEY; }
+  void AddTriggerKeys(
+      absl::FunctionRef<void(absl::string_view)> add_key) const override;
+
  private:
   struct ReadingCorrectionItem {
     ReadingCorrectionItem(absl::string_view v, absl::string_view e,
@@ -1159,7 +1159,8 @@ bool DateRewriter::ResizeSegments(const ConversionRequest &request,
   const absl::string_view key0 = segments_begin->key();
   DCHECK_NE(key.size(), key0.size());
   const int diff = Util::CharsLen(key) - Util::CharsLen(key0);
-  const size_t segment_index = segments_begin - segments->all().begin();
+  const size_t segment_index =
+      segments_begin - std::as_const(*segments).begin();
   if (!parent_converter_->ResizeSegment(segments, request, segment_index,
                                         diff)) {
     LOG(ERROR) << "Failed to merge conversion segments";
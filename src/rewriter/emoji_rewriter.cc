@@ -167,6 +167,16 @@ bool EmojiRewriter::Rewrite(const ConversionRequest &request,
   return RewriteCandidates(segments);
 }
 
+void EmojiRewriter::AddTriggerKeys(
+    absl::FunctionRef<void(absl::string_view)> add_key) const {
+  // The string array also has the other strings than the readings, which
+  // doesn't matter for the filter.
+  for (const absl::string_view str : string_array_) {
+    add_key(str);
+  }
+  add_key(kEmojiKey);
+}
+
 void EmojiRewriter::Finish(const ConversionRequest &request,
                            Segments *segments) {
   if (!request.config().use_emoji_conversion()) {
@@ -174,7 +184,8 @@ void EmojiRewriter::Finish(const ConversionRequest &request,
   }
 
   // Update usage stats
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     // Ignores segments which are not converted or not committed.
     if (segment.candidates_size() == 0 ||
         segment.segment_type() != Segment::FIXED_VALUE) {
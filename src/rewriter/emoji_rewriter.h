@@ -33,6 +33,7 @@
 #include <cstddef>
 #include <utility>
 
+#include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
 #include "base/container/serialized_string_array.h"
 #include "converter/segments.h"
@@ -76,6 +77,9 @@ class EmojiRewriter : public RewriterInterface {
   EmojiRewriter &operator=(const EmojiRewriter &) = delete;
 
   int capability(const ConversionRequest &request) const override;
+  int triggers() const override { return HALF_WIDTH_SEGMENT_KEY; }
+  void AddTriggerKeys(
+      absl::FunctionRef<void(absl::string_view)> add_key) const override;
 
   // Returns true if emoji candidates are added.  When user settings are set
   // not to use EmojiRewriter, does nothing other than returning false.
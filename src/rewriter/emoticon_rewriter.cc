@@ -228,6 +228,16 @@ EmoticonRewriter::EmoticonRewriter(absl::string_view token_array_data,
                                    absl::string_view string_array_data)
     : dic_(token_array_data, string_array_data) {}
 
+void EmoticonRewriter::AddTriggerKeys(
+    absl::FunctionRef<void(absl::string_view)> add_key) const {
+  for (auto it = dic_.begin(); it != dic_.end(); ++it) {
+    add_key(it.key());
+  }
+  for (const absl::string_view key : {"かおもじ", "かお", "ふくわらい"}) {
+    add_key(key);
+  }
+}
+
 int EmoticonRewriter::capability(const ConversionRequest &request) const {
   if (request.request().mixed_conversion()) {
     return RewriterInterface::ALL;
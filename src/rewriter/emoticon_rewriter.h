@@ -32,6 +32,7 @@
 
 #include <memory>
 
+#include "absl/functional/function_ref.h"
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
 #include "converter/segments.h"
@@ -51,6 +52,9 @@ class EmoticonRewriter : public RewriterInterface {
                    absl::string_view string_array_data);
 
   int capability(const ConversionRequest &request) const override;
+  int triggers() const override { return SEGMENT_KEY; }
+  void AddTriggerKeys(
+      absl::FunctionRef<void(absl::string_view)> add_key) const override;
 
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
@@ -40,11 +40,13 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/string_view.h"
 #include "base/container/serialized_string_array.h"
+#include "base/latency_trace.h"
 #include "base/text_normalizer.h"
 #include "base/util.h"
 #include "converter/segments.h"
@@ -365,15 +367,28 @@ int EnvironmentalFilterRewriter::capability(
 
 EnvironmentalFilterRewriter::EnvironmentalFilterRewriter(
     const DataManagerInterface &data_manager) {
-  absl::string_view token_array_data;
-  absl::string_view string_array_data;
-
   // TODO(mozc-team):
   // Currently, this rewriter uses data from emoji_data.tsv, which is for Emoji
   // conversion, as a source of Emoji version information. However,
   // emoji_data.tsv lacks some Emoji, including Emoji with skin-tones and
   // family/couple Emojis. As a future work, the data source should be refined.
-  data_manager.GetEmojiRewriterData(&token_array_data, &string_array_data);
+  data_manager.GetEmojiRewriterData(&emoji_token_array_data_,
+                                    &emoji_string_array_data_);
+}
+
+const EnvironmentalFilterRewriter::EmojiVersionFinders &
+EnvironmentalFilterRewriter::GetEmojiVersionFinders() const {
+  absl::call_once(emoji_version_finders_once_, [this]() {
+    emoji_version_finders_ = BuildEmojiVersionFinders(
+        emoji_token_array_data_, emoji_string_array_data_);
+  });
+  return emoji_version_finders_;
+}
+
+EnvironmentalFilterRewriter::EmojiVersionFinders
+EnvironmentalFilterRewriter::BuildEmojiVersionFinders(
+    absl::string_view token_array_data, absl::string_view string_array_data) {
+  MOZC_LATENCY_TRACE("EnvironmentalFilterRewriter::BuildEmojiVersionFinders");
   SerializedStringArray string_array;
   string_array.Set(string_array_data);
   std::pair<EmojiDataIterator, EmojiDataIterator> range =
@@ -383,12 +398,14 @@ EnvironmentalFilterRewriter::EnvironmentalFilterRewriter(
           {EmojiVersion::E12_1, EmojiVersion::E13_0, EmojiVersion::E13_1,
            EmojiVersion::E14_0, EmojiVersion::E15_0, EmojiVersion::E15_1},
           range, string_array);
-  finder_e12_1_.Initialize(version_to_targets.at(EmojiVersion::E12_1));
-  finder_e13_0_.Initialize(version_to_targets.at(EmojiVersion::E13_0));
-  finder_e13_1_.Initialize(version_to_targets.at(EmojiVersion::E13_1));
-  finder_e14_0_.Initialize(version_to_targets.at(EmojiVersion::E14_0));
-  finder_e15_0_.Initialize(version_to_targets.at(EmojiVersion::E15_0));
-  finder_e15_1_.Initialize(version_to_targets.at(EmojiVersion::E15_1));
+  EmojiVersionFinders finders;
+  finders.e12_1.Initialize(version_to_targets.at(EmojiVersion::E12_1));
+  finders.e13_0.Initialize(version_to_targets.at(EmojiVersion::E13_0));
+  finders.e13_1.Initialize(version_to_targets.at(EmojiVersion::E13_1));
+  finders.e14_0.Initialize(version_to_targets.at(EmojiVersion::E14_0));
+  finders.e15_0.Initialize(version_to_targets.at(EmojiVersion::E15_0));
+  finders.e15_1.Initialize(version_to_targets.at(EmojiVersion::E15_1));
+  return finders;
 }
 
 bool EnvironmentalFilterRewriter::Rewrite(const ConversionRequest &request,
@@ -470,22 +487,28 @@ bool EnvironmentalFilterRewriter::Rewrite(const ConversionRequest &request,
                 FindCodepointsInClosedRange(codepoints, 0x1B11F, 0x1B122);
             break;
           case commands::Request::EMOJI_12_1:
-            found_nonrenderable = finder_e12_1_.FindMatch(codepoints);
+            found_nonrenderable =
+                GetEmojiVersionFinders().e12_1.FindMatch(codepoints);
             break;
           case commands::Request::EMOJI_13_0:
-            found_nonrenderable = finder_e13_0_.FindMatch(codepoints);
+            found_nonrenderable =
+                GetEmojiVersionFinders().e13_0.FindMatch(codepoints);
             break;
           case commands::Request::EMOJI_13_1:
-            found_nonrenderable = finder_e13_1_.FindMatch(codepoints);
+            found_nonrenderable =
+                GetEmojiVersionFinders().e13_1.FindMatch(codepoints);
             break;
           case commands::Request::EMOJI_14_0:
-            found_nonrenderable = finder_e14_0_.FindMatch(codepoints);
+            found_nonrenderable =
+                GetEmojiVersionFinders().e14_0.FindMatch(codepoints);
             break;
           case commands::Request::EMOJI_15_0:
-            found_nonrenderable = finder_e15_0_.FindMatch(codepoints);
+            found_nonrenderable =
+                GetEmojiVersionFinders().e15_0.FindMatch(codepoints);
             break;
           case commands::Request::EMOJI_15_1:
-            found_nonrenderable = finder_e15_1_.FindMatch(codepoints);
+            found_nonrenderable =
+                GetEmojiVersionFinders().e15_1.FindMatch(codepoints);
             break;
           case commands::Request::EGYPTIAN_HIEROGLYPH_5_2:
             found_nonrenderable =
@@ -56,6 +56,8 @@
 #include <string_view>
 #include <vector>
 
+#include "absl/base/call_once.h"
+#include "absl/strings/string_view.h"
 #include "base/text_normalizer.h"
 #include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
@@ -112,12 +114,28 @@ class EnvironmentalFilterRewriter : public RewriterInterface {
   TextNormalizer::Flag flag_ = TextNormalizer::kDefault;
 
   // Filters for filtering target Emoji versions.
-  CharacterGroupFinder finder_e12_1_;
-  CharacterGroupFinder finder_e13_0_;
-  CharacterGroupFinder finder_e13_1_;
-  CharacterGroupFinder finder_e14_0_;
-  CharacterGroupFinder finder_e15_0_;
-  CharacterGroupFinder finder_e15_1_;
+  struct EmojiVersionFinders {
+    CharacterGroupFinder e12_1;
+    CharacterGroupFinder e13_0;
+    CharacterGroupFinder e13_1;
+    CharacterGroupFinder e14_0;
+    CharacterGroupFinder e15_0;
+    CharacterGroupFinder e15_1;
+  };
+
+  // Builds the finders from the Emoji data.
+  static EmojiVersionFinders BuildEmojiVersionFinders(
+      absl::string_view token_array_data, absl::string_view string_array_data);
+
+  // Returns the finders, building them on the first call. Scanning all the
+  // Emoji data is deferred to the first candidate which needs it, so
+  // constructing the rewriter stays cheap. Thread-safe.
+  const EmojiVersionFinders &GetEmojiVersionFinders() const;
+
+  absl::string_view emoji_token_array_data_;
+  absl::string_view emoji_string_array_data_;
+  mutable absl::once_flag emoji_version_finders_once_;
+  mutable EmojiVersionFinders emoji_version_finders_;
 };
 }  // namespace mozc
 #endif  // MOZC_REWRITER_ENVIRONMENTAL_FILTER_REWRITER_H_
@@ -35,13 +35,14 @@
 //    --output_conjugation_suffix=conj_suffix.data
 //    --output_conjugation_index=conj_index.data
 //    --output_usage_item_array=usage_item_array.data
+//    --output_usage_index=usage_index.data
 //    --output_string_array=string_array.data
 //
 // * Prerequisite
 // Little endian is assumed.
 //
 // * Output file format
-// The output data consists of five files:
+// The output data consists of six files:
 //
 // ** String array
 // All the strings (e.g., usage of word) are stored in this array and are
@@ -91,6 +92,25 @@
 // index is the conjugation type of this key value pair, and its conjugation
 // suffix types are retrieved using conjugation suffix index and conjugation
 // suffix array.
+//
+// ** Usage index
+//
+// This is an array of (key, value) pairs of all the conjugated forms of usage
+// items, sorted by key and then by value so that the rewriter can find a usage
+// item by binary search.  Each entry consists of 2 uint32_t values:
+//
+// +=======================================+
+// | Usage item index (4 byte)             |
+// +---------------------------------------+
+// | Conjugation suffix index (4 byte)     |
+// +=======================================+
+//
+// The key is the key of the usage item followed by the key suffix of the
+// conjugation, and the value is the value followed by the value suffix.  Every
+// conjugated form is also indexed with the empty key for the lookup by value
+// only.  Such entries have kUsageIndexEmptyKey set in their usage item index.
+// When the same (key, value) pair comes from two usage items, the entry points
+// to the latter one.
 
 #include <algorithm>
 #include <cstddef>
@@ -108,6 +128,7 @@
 #include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
@@ -125,10 +146,17 @@ ABSL_FLAG(std::string, output_conjugation_index, "",
           "output conjugation index array");
 ABSL_FLAG(std::string, output_usage_item_array, "",
           "output array of usage items");
+ABSL_FLAG(std::string, output_usage_index, "",
+          "output sorted index of conjugated keys and values");
 ABSL_FLAG(std::string, output_string_array, "", "output string array");
 
 namespace mozc {
 namespace {
+
+// Flag of the usage item index in the usage index for the entries with the
+// empty key.  Keep in sync with usage_rewriter.h.
+constexpr uint32_t kUsageIndexEmptyKey = 1u << 31;
+
 struct ConjugationType {
   std::string form;
   std::string value_suffix;
@@ -321,6 +349,8 @@ void Convert() {
 
   // Output conjugation suffix data.
   std::vector<int> conjugation_index(conjugation_list.size() + 1);
+  // Pairs of value and key suffixes in the output order.
+  std::vector<std::pair<std::string, std::string>> conjugation_suffixes;
   {
     OutputFileStream ostream(absl::GetFlag(FLAGS_output_conjugation_suffix),
                              std::ios_base::out | std::ios_base::binary);
@@ -333,6 +363,7 @@ void Convert() {
         const uint32_t index = Lookup(string_index, "");
         ostream.write(reinterpret_cast<const char *>(&index), 4);
         ostream.write(reinterpret_cast<const char *>(&index), 4);
+        conjugation_suffixes.emplace_back("", "");
         ++out_count;
       } else {
         using StrPair = std::pair<std::string, std::string>;
@@ -346,6 +377,7 @@ void Convert() {
           const uint32_t key_suffix_index = Lookup(string_index, kv.second);
           ostream.write(reinterpret_cast<const char *>(&value_suffix_index), 4);
           ostream.write(reinterpret_cast<const char *>(&key_suffix_index), 4);
+          conjugation_suffixes.push_back(kv);
           ++out_count;
         }
       }
@@ -379,6 +411,30 @@ void Convert() {
     }
   }
 
+  // Output usage index.
+  {
+    absl::btree_map<std::pair<std::string, std::string>,
+                    std::pair<uint32_t, uint32_t>>
+        index;
+    for (uint32_t i = 0; i < usage_entries.size(); ++i) {
+      const UsageItem &item = usage_entries[i];
+      for (uint32_t j = conjugation_index[item.conjugation_id];
+           j < conjugation_index[item.conjugation_id + 1]; ++j) {
+        const auto &[value_suffix, key_suffix] = conjugation_suffixes[j];
+        std::string key = absl::StrCat(item.key, key_suffix);
+        std::string value = absl::StrCat(item.value, value_suffix);
+        index[{std::move(key), value}] = {i, j};
+        index[{"", std::move(value)}] = {i | kUsageIndexEmptyKey, j};
+      }
+    }
+    OutputFileStream ostream(absl::GetFlag(FLAGS_output_usage_index),
+                             std::ios_base::out | std::ios_base::binary);
+    for (const auto &[key_value, entry] : index) {
+      ostream.write(reinterpret_cast<const char *>(&entry.first), 4);
+      ostream.write(reinterpret_cast<const char *>(&entry.second), 4);
+    }
+  }
+
   // Output string array.
   {
     std::vector<absl::string_view> strs;
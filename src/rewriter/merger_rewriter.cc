@@ -0,0 +1,290 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/merger_rewriter.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/call_once.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/hash.h"
+#include "base/japanese_util.h"
+#include "base/latency_trace.h"
+#include "base/util.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "rewriter/rewriter_interface.h"
+#include "storage/existence_filter.h"
+
+namespace mozc {
+namespace {
+
+using ::mozc::storage::ExistenceFilter;
+using ::mozc::storage::ExistenceFilterBuilder;
+
+constexpr float kTriggerFilterErrorRate = 0.01;
+// The bits of a small filter are too correlated to reach the error rate above.
+constexpr size_t kMinTriggerFilterSizeInBytes = 1024;
+constexpr int kKeyTriggers = RewriterInterface::SEGMENT_KEY |
+                             RewriterInterface::CONCATENATED_SEGMENT_KEY |
+                             RewriterInterface::HALF_WIDTH_SEGMENT_KEY |
+                             RewriterInterface::CANDIDATE_CONTENT_KEY;
+
+// Returns the hash of a trigger key for the `index`-th rewriter, so one
+// filter can tell the trigger keys of the rewriters apart.
+uint64_t GetTriggerKeyHash(uint64_t key_hash, size_t index) {
+  return key_hash ^ Fingerprint(static_cast<uint32_t>(index));
+}
+
+// The triggers of the segments, computed on demand and shared by the
+// rewriters until the segments are modified.
+class SegmentsTriggers {
+ public:
+  explicit SegmentsTriggers(const Segments &segments) : segments_(segments) {}
+
+  SegmentsTriggers(const SegmentsTriggers &) = delete;
+  SegmentsTriggers &operator=(const SegmentsTriggers &) = delete;
+
+  // Returns the hashes of the keys for the key based trigger `type`.
+  absl::Span<const uint64_t> GetKeyHashes(RewriterInterface::TriggerType type);
+
+  bool HasNumberInSegmentKey() {
+    if (!has_number_in_segment_key_.has_value()) {
+      has_number_in_segment_key_ = absl::c_any_of(
+          segments_.conversion_segments(), [](const Segment &segment) {
+            return Util::ContainsScriptType(segment.key(), Util::NUMBER);
+          });
+    }
+    return *has_number_in_segment_key_;
+  }
+
+  // Discards the triggers after the segments are modified.
+  void Clear() {
+    for (std::optional<std::vector<uint64_t>> &hashes : key_hashes_) {
+      hashes.reset();
+    }
+    has_number_in_segment_key_.reset();
+  }
+
+ private:
+  const Segments &segments_;
+  // Indexed by the bit position of the key based trigger.
+  std::array<std::optional<std::vector<uint64_t>>, 4> key_hashes_;
+  std::optional<bool> has_number_in_segment_key_;
+};
+
+absl::Span<const uint64_t> SegmentsTriggers::GetKeyHashes(
+    RewriterInterface::TriggerType type) {
+  DCHECK_NE(type & kKeyTriggers, 0);
+  std::optional<std::vector<uint64_t>> &hashes =
+      key_hashes_[std::countr_zero(static_cast<unsigned int>(type))];
+  if (hashes.has_value()) {
+    return *hashes;
+  }
+  hashes.emplace();
+  switch (type) {
+    case RewriterInterface::SEGMENT_KEY:
+      for (const Segment &segment : segments_.conversion_segments()) {
+        hashes->push_back(Fingerprint(segment.key()));
+      }
+      break;
+    case RewriterInterface::CONCATENATED_SEGMENT_KEY: {
+      std::string key;
+      for (const Segment &segment : segments_.conversion_segments()) {
+        key.append(segment.key());
+      }
+      hashes->push_back(Fingerprint(key));
+      break;
+    }
+    case RewriterInterface::HALF_WIDTH_SEGMENT_KEY:
+      for (const Segment &segment : segments_.conversion_segments()) {
+        hashes->push_back(Fingerprint(
+            japanese_util::FullWidthAsciiToHalfWidthAscii(segment.key())));
+      }
+      break;
+    case RewriterInterface::CANDIDATE_CONTENT_KEY:
+      for (const Segment &segment : segments_.conversion_segments()) {
+        for (size_t i = 0; i < segment.candidates_size(); ++i) {
+          hashes->push_back(Fingerprint(segment.candidate(i).content_key));
+        }
+      }
+      break;
+    default:
+      LOG(DFATAL) << "Not a key based trigger: " << type;
+      break;
+  }
+  return *hashes;
+}
+
+// Returns false if the `index`-th rewriter doesn't need to be run.
+bool MayTrigger(const RewriterInterface &rewriter, size_t index,
+                const std::optional<ExistenceFilter> &filter,
+                SegmentsTriggers &segments_triggers) {
+  const int triggers = rewriter.triggers();
+  if (triggers == RewriterInterface::ANY_TRIGGER) {
+    return true;
+  }
+  if ((triggers & RewriterInterface::NUMBER_IN_SEGMENT_KEY) &&
+      segments_triggers.HasNumberInSegmentKey()) {
+    return true;
+  }
+  if (!filter.has_value()) {
+    return false;
+  }
+  for (const RewriterInterface::TriggerType type :
+       {RewriterInterface::SEGMENT_KEY,
+        RewriterInterface::CONCATENATED_SEGMENT_KEY,
+        RewriterInterface::HALF_WIDTH_SEGMENT_KEY,
+        RewriterInterface::CANDIDATE_CONTENT_KEY}) {
+    if ((triggers & type) == 0) {
+      continue;
+    }
+    for (const uint64_t key_hash : segments_triggers.GetKeyHashes(type)) {
+      if (filter->Exists(GetTriggerKeyHash(key_hash, index))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+void MergerRewriter::AddRewriter(std::unique_ptr<RewriterInterface> rewriter,
+                                 absl::string_view name) {
+  DCHECK(rewriter);
+  rewriters_.push_back(std::move(rewriter));
+  LatencyHistogram *histogram = nullptr;
+#ifndef MOZC_NO_LATENCY_TRACE
+  if (!name.empty()) {
+    histogram = &LatencyTrace::GetHistogram(absl::StrCat(name, "::Rewrite"));
+  }
+#endif  // MOZC_NO_LATENCY_TRACE
+  histograms_.push_back(histogram);
+  if (rewriters_.back()->triggers() & kKeyTriggers) {
+    trigger_filter_once_.emplace();
+  }
+}
+
+void MergerRewriter::BuildTriggerFilter() const {
+  MOZC_LATENCY_TRACE("MergerRewriter::BuildTriggerFilter");
+  std::vector<uint64_t> hashes;
+  for (size_t i = 0; i < rewriters_.size(); ++i) {
+    if ((rewriters_[i]->triggers() & kKeyTriggers) == 0) {
+      continue;
+    }
+    rewriters_[i]->AddTriggerKeys([&hashes, i](absl::string_view key) {
+      hashes.push_back(GetTriggerKeyHash(Fingerprint(key), i));
+    });
+  }
+  trigger_filter_.reset();
+  trigger_filter_builder_.reset();
+  if (hashes.empty()) {
+    return;
+  }
+  const size_t num_bytes = std::max(
+      kMinTriggerFilterSizeInBytes,
+      ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
+          kTriggerFilterErrorRate, hashes.size()));
+  trigger_filter_builder_.emplace(
+      ExistenceFilterBuilder::CreateOptimal(num_bytes, hashes.size()));
+  for (const uint64_t hash : hashes) {
+    trigger_filter_builder_->Insert(hash);
+  }
+  trigger_filter_ = trigger_filter_builder_->Build();
+}
+
+bool MergerRewriter::Rewrite(const ConversionRequest &request,
+                             Segments *segments) const {
+  MOZC_LATENCY_TRACE("MergerRewriter::Rewrite");
+  if (trigger_filter_once_.has_value()) {
+    absl::call_once(*trigger_filter_once_, &MergerRewriter::BuildTriggerFilter,
+                    this);
+  }
+  bool result = false;
+  std::optional<SegmentsTriggers> segments_triggers;
+  for (size_t i = 0; i < rewriters_.size(); ++i) {
+    const RewriterInterface &rewriter = *rewriters_[i];
+    if (!CheckCapability(request, segments, rewriter)) {
+      continue;
+    }
+    if (!segments_triggers.has_value()) {
+      segments_triggers.emplace(*segments);
+    }
+    if (!MayTrigger(rewriter, i, trigger_filter_, *segments_triggers)) {
+      continue;
+    }
+    if (RewriteWith(i, request, segments)) {
+      result = true;
+      segments_triggers->Clear();
+    }
+  }
+
+  if (request.request_type() == ConversionRequest::SUGGESTION &&
+      segments->conversion_segments_size() == 1 &&
+      !request.request().mixed_conversion()) {
+    const size_t max_suggestions = request.config().suggestions_size();
+    Segment *segment = segments->mutable_conversion_segment(0);
+    const size_t candidate_size = segment->candidates_size();
+    if (candidate_size > max_suggestions) {
+      segment->erase_candidates(max_suggestions,
+                                candidate_size - max_suggestions);
+    }
+  }
+  return result;
+}
+
+bool MergerRewriter::RewriteWith(size_t index,
+                                 const ConversionRequest &request,
+                                 Segments *segments) const {
+  const RewriterInterface &rewriter = *rewriters_[index];
+  if (histograms_[index] == nullptr) {
+    return rewriter.Rewrite(request, segments);
+  }
+  const ScopedLatencyTrace trace(*histograms_[index]);
+  return rewriter.Rewrite(request, segments);
+}
+
+}  // namespace mozc
@@ -32,15 +32,16 @@
 
 #include <cstddef>
 #include <memory>
-#include <utility>
+#include <optional>
 #include <vector>
 
-#include "absl/log/check.h"
+#include "absl/base/call_once.h"
+#include "absl/strings/string_view.h"
+#include "base/latency_trace.h"
 #include "converter/segments.h"
-#include "protocol/commands.pb.h"
-#include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
+#include "storage/existence_filter.h"
 
 namespace mozc {
 
@@ -80,33 +81,21 @@ class MergerRewriter : public RewriterInterface {
     }
   }
 
-  void AddRewriter(std::unique_ptr<RewriterInterface> rewriter) {
-    DCHECK(rewriter);
-    rewriters_.push_back(std::move(rewriter));
-  }
-
+  // Adds a rewriter. If `name` is not empty, the latencies of the rewriter
+  // are recorded in the stage "<name>::Rewrite" of LatencyTrace. The trigger
+  // keys of the rewriter are added to the Bloom filter which tests whether
+  // the rewriter needs to be run (see RewriterInterface::triggers()). The
+  // filter is built on the first Rewrite() after the last AddRewriter(), so
+  // constructing a MergerRewriter doesn't scan the data of the rewriters.
+  void AddRewriter(std::unique_ptr<RewriterInterface> rewriter,
+                   absl::string_view name = "");
+
+  // Runs the rewriters in the order of addition, skipping the ones whose
+  // triggers are not in the segments. The rewriters run one by one on the
+  // calling thread: most of them read the candidates added by the earlier
+  // ones, and several keep state which is not thread-safe.
   bool Rewrite(const ConversionRequest &request,
-               Segments *segments) const override {
-    bool result = false;
-    for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters_) {
-      if (CheckCapability(request, segments, *rewriter)) {
-        result |= rewriter->Rewrite(request, segments);
-      }
-    }
-
-    if (request.request_type() == ConversionRequest::SUGGESTION &&
-        segments->conversion_segments_size() == 1 &&
-        !request.request().mixed_conversion()) {
-      const size_t max_suggestions = request.config().suggestions_size();
-      Segment *segment = segments->mutable_conversion_segment(0);
-      const size_t candidate_size = segment->candidates_size();
-      if (candidate_size > max_suggestions) {
-        segment->erase_candidates(max_suggestions,
-                                  candidate_size - max_suggestions);
-      }
-    }
-    return result;
-  }
+               Segments *segments) const override;
 
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
@@ -155,7 +144,25 @@ class MergerRewriter : public RewriterInterface {
   }
 
  private:
+  // Builds `trigger_filter_` from the trigger keys of all the rewriters.
+  // Called once through `trigger_filter_once_`.
+  void BuildTriggerFilter() const;
+
+  // Runs the `index`-th rewriter, recording its latency.
+  bool RewriteWith(size_t index, const ConversionRequest &request,
+                   Segments *segments) const;
+
   std::vector<std::unique_ptr<RewriterInterface>> rewriters_;
+  // Parallel to `rewriters_`. nullptr if the latency is not recorded.
+  std::vector<LatencyHistogram *> histograms_;
+  // The trigger keys of all the rewriters, each hashed with the index of the
+  // rewriter. Empty if no rewriter has trigger keys.
+  mutable std::optional<storage::ExistenceFilterBuilder>
+      trigger_filter_builder_;
+  mutable std::optional<storage::ExistenceFilter> trigger_filter_;
+  // Reset by AddRewriter() when a rewriter with key based triggers is added,
+  // so that the next Rewrite() rebuilds the filter.
+  mutable std::optional<absl::once_flag> trigger_filter_once_;
 };
 
 }  // namespace mozc
@@ -32,8 +32,12 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
+#include "base/latency_trace.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
@@ -104,6 +108,57 @@ class TestRewriter : public RewriterInterface {
   int capability_;
 };
 
+// Records the calls of Rewrite() with the given triggers.
+class TriggerRewriter : public RewriterInterface {
+ public:
+  TriggerRewriter(std::string *buffer, const absl::string_view name,
+                  int triggers, std::vector<std::string> trigger_keys)
+      : buffer_(buffer),
+        name_(name),
+        triggers_(triggers),
+        trigger_keys_(std::move(trigger_keys)) {}
+
+  int triggers() const override { return triggers_; }
+
+  void AddTriggerKeys(
+      absl::FunctionRef<void(absl::string_view)> add_key) const override {
+    for (const std::string &key : trigger_keys_) {
+      add_key(key);
+    }
+  }
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    buffer_->append(name_ + ".Rewrite();");
+    return false;
+  }
+
+ private:
+  std::string *buffer_;
+  const std::string name_;
+  const int triggers_;
+  const std::vector<std::string> trigger_keys_;
+};
+
+// Adds a candidate of `content_key` to the first conversion segment.
+class AddCandidateRewriter : public RewriterInterface {
+ public:
+  explicit AddCandidateRewriter(const absl::string_view content_key)
+      : content_key_(content_key) {}
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    Segment::Candidate *candidate =
+        segments->mutable_conversion_segment(0)->add_candidate();
+    candidate->key = content_key_;
+    candidate->content_key = content_key_;
+    return true;
+  }
+
+ private:
+  const std::string content_key_;
+};
+
 class MergerRewriterTest : public testing::TestWithTempUserProfile {};
 
 TEST_F(MergerRewriterTest, Rewrite) {
@@ -130,6 +185,111 @@ TEST_F(MergerRewriterTest, Rewrite) {
             "d.Rewrite();");
 }
 
+TEST_F(MergerRewriterTest, RecordLatencyOfNamedRewriter) {
+  std::string call_result;
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  merger.AddRewriter(std::make_unique<TestRewriter>(&call_result, "a", false),
+                     "MergerRewriterTest.a");
+  LatencyTrace::ClearAll();
+  merger.Rewrite(request, &segments);
+  EXPECT_EQ(call_result, "a.Rewrite();");
+#ifndef MOZC_NO_LATENCY_TRACE
+  EXPECT_EQ(LatencyTrace::GetHistogram("MergerRewriterTest.a::Rewrite")
+                .GetSnapshot()
+                .count,
+            1);
+#endif  // MOZC_NO_LATENCY_TRACE
+}
+
+TEST_F(MergerRewriterTest, RewriteWithTriggers) {
+  std::string call_result;
+  MergerRewriter merger;
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "any", RewriterInterface::ANY_TRIGGER,
+      std::vector<std::string>()));
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "segment", RewriterInterface::SEGMENT_KEY,
+      std::vector<std::string>{"えもじ"}));
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "concat", RewriterInterface::CONCATENATED_SEGMENT_KEY,
+      std::vector<std::string>{"えもじ"}));
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "half", RewriterInterface::HALF_WIDTH_SEGMENT_KEY,
+      std::vector<std::string>{"abc"}));
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "content", RewriterInterface::CANDIDATE_CONTENT_KEY,
+      std::vector<std::string>{"かお"}));
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "number", RewriterInterface::NUMBER_IN_SEGMENT_KEY,
+      std::vector<std::string>()));
+  const ConversionRequest request;
+
+  auto rewrite = [&](std::vector<std::string> keys) {
+    Segments segments;
+    for (const std::string &key : keys) {
+      Segment *segment = segments.add_segment();
+      segment->set_key(key);
+      Segment::Candidate *candidate = segment->add_candidate();
+      candidate->key = key;
+      candidate->content_key = key;
+    }
+    call_result.clear();
+    merger.Rewrite(request, &segments);
+    return call_result;
+  };
+
+  EXPECT_EQ(rewrite({"ふつう"}), "any.Rewrite();");
+  EXPECT_EQ(rewrite({"えもじ"}),
+            "any.Rewrite();segment.Rewrite();concat.Rewrite();");
+  EXPECT_EQ(rewrite({"え", "もじ"}), "any.Rewrite();concat.Rewrite();");
+  EXPECT_EQ(rewrite({"ａｂｃ"}), "any.Rewrite();half.Rewrite();");
+  EXPECT_EQ(rewrite({"かお"}), "any.Rewrite();content.Rewrite();");
+  EXPECT_EQ(rewrite({"１２"}), "any.Rewrite();number.Rewrite();");
+}
+
+TEST_F(MergerRewriterTest, RewriteWithTriggersAfterModification) {
+  std::string call_result;
+  MergerRewriter merger;
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "before", RewriterInterface::CANDIDATE_CONTENT_KEY,
+      std::vector<std::string>{"かお"}));
+  merger.AddRewriter(std::make_unique<AddCandidateRewriter>("かお"));
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "after", RewriterInterface::CANDIDATE_CONTENT_KEY,
+      std::vector<std::string>{"かお"}));
+  const ConversionRequest request;
+
+  Segments segments;
+  segments.add_segment()->set_key("かおもじ");
+  merger.Rewrite(request, &segments);
+  // The triggers are tested again for the modified segments.
+  EXPECT_EQ(call_result, "after.Rewrite();");
+}
+
+TEST_F(MergerRewriterTest, RewriteWithTriggersAddedAfterRewrite) {
+  std::string call_result;
+  MergerRewriter merger;
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "first", RewriterInterface::SEGMENT_KEY,
+      std::vector<std::string>{"えもじ"}));
+  const ConversionRequest request;
+
+  Segments segments;
+  segments.add_segment()->set_key("かお");
+  merger.Rewrite(request, &segments);
+  EXPECT_EQ(call_result, "");
+
+  // The filter is rebuilt with the keys of the added rewriter.
+  merger.AddRewriter(std::make_unique<TriggerRewriter>(
+      &call_result, "second", RewriterInterface::SEGMENT_KEY,
+      std::vector<std::string>{"かお"}));
+  merger.Rewrite(request, &segments);
+  EXPECT_EQ(call_result, "second.Rewrite();");
+}
+
 TEST_F(MergerRewriterTest, RewriteSuggestion) {
   std::string call_result;
   MergerRewriter merger;
@@ -637,7 +637,8 @@ void NumberRewriter::Finish(const ConversionRequest &request,
     return;
   }
 
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     if (segment.candidates_size() <= 0 ||
         segment.segment_type() != Segment::FIXED_VALUE ||
         segment.candidate(0).attributes &
@@ -32,6 +32,8 @@
 
 #include <cstddef>  // for size_t
 
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
 
@@ -56,6 +58,36 @@ class RewriterInterface {
     return CONVERSION;
   }
 
+  // What can make Rewrite() modify the segments. MergerRewriter skips the
+  // rewriter when none of its triggers is in the segments.
+  enum TriggerType {
+    // Rewrite() may modify any segments.
+    ANY_TRIGGER = 0,
+    // The key of a conversion segment is one of the trigger keys.
+    SEGMENT_KEY = 1,
+    // The concatenated key of all the conversion segments is one of the
+    // trigger keys.
+    CONCATENATED_SEGMENT_KEY = 2,
+    // The key of a conversion segment, with full-width ASCII characters
+    // converted to half-width, is one of the trigger keys.
+    HALF_WIDTH_SEGMENT_KEY = 4,
+    // The content key of a candidate in the conversion segments is one of the
+    // trigger keys.
+    CANDIDATE_CONTENT_KEY = 8,
+    // The key of a conversion segment contains a number.
+    NUMBER_IN_SEGMENT_KEY = 16,
+  };
+
+  // Returns the bitwise OR of TriggerType. Rewrite() must do nothing unless
+  // one of them is satisfied.
+  virtual int triggers() const { return ANY_TRIGGER; }
+
+  // Gives all the trigger keys to `add_key`. Called by MergerRewriter when it
+  // builds its trigger filter on the first Rewrite(), only if triggers() has a
+  // key based trigger. May be called again if more rewriters are added later.
+  virtual void AddTriggerKeys(
+      absl::FunctionRef<void(absl::string_view)> add_key) const {}
+
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const = 0;
 
@@ -256,7 +256,8 @@ int SmallLetterRewriter::capability(const ConversionRequest &request) const {
 bool SmallLetterRewriter::Rewrite(const ConversionRequest &request,
                                   Segments *segments) const {
   std::string key;
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     key += segment.key();
   }
 
@@ -320,7 +320,8 @@ bool SymbolRewriter::RewriteEntireCandidate(const ConversionRequest &request,
   }
 
   std::string key;
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     key += segment.key();
   }
 
@@ -373,6 +374,13 @@ int SymbolRewriter::capability(const ConversionRequest &request) const {
   return RewriterInterface::CONVERSION;
 }
 
+void SymbolRewriter::AddTriggerKeys(
+    absl::FunctionRef<void(absl::string_view)> add_key) const {
+  for (auto it = dictionary_->begin(); it != dictionary_->end(); ++it) {
+    add_key(it.key());
+  }
+}
+
 bool SymbolRewriter::Rewrite(const ConversionRequest &request,
                              Segments *segments) const {
   if (!request.config().use_symbol_conversion()) {
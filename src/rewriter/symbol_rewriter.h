@@ -34,6 +34,7 @@
 #include <memory>
 #include <string>
 
+#include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
 #include "data_manager/serialized_dictionary.h"
 #include "rewriter/rewriter_interface.h"
@@ -54,6 +55,11 @@ class SymbolRewriter : public RewriterInterface {
   ~SymbolRewriter() override = default;
 
   int capability(const ConversionRequest &request) const override;
+  int triggers() const override {
+    return SEGMENT_KEY | CONCATENATED_SEGMENT_KEY;
+  }
+  void AddTriggerKeys(
+      absl::FunctionRef<void(absl::string_view)> add_key) const override;
 
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
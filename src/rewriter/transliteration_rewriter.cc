@@ -34,6 +34,7 @@
 #include <iterator>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "absl/log/check.h"
@@ -75,7 +76,8 @@ bool IsComposerApplicable(const ConversionRequest &request,
   }
 
   std::string segments_key;
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     segments_key.append(segment.key());
   }
   if (conversion_query != segments_key) {
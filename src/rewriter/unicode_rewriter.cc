@@ -131,7 +131,8 @@ bool UnicodeRewriter::RewriteToUnicodeCharFormat(
 bool UnicodeRewriter::RewriteFromUnicodeCharFormat(
     const ConversionRequest &request, Segments *segments) const {
   std::string key;
-  for (const Segment &segment : segments->conversion_segments()) {
+  for (const Segment &segment :
+       std::as_const(*segments).conversion_segments()) {
     key += segment.key();
   }
 
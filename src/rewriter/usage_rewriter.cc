@@ -37,7 +37,6 @@
 
 #include "absl/log/check.h"
 #include "absl/strings/match.h"
-#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "base/container/serialized_string_array.h"
 #include "base/util.h"
@@ -57,47 +56,90 @@ UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
                              const DictionaryInterface *dictionary)
     : pos_matcher_(data_manager->GetPosMatcherData()),
       dictionary_(dictionary),
-      base_conjugation_suffix_(nullptr) {
+      base_conjugation_suffix_(nullptr),
+      conjugation_suffix_(nullptr),
+      usage_items_(nullptr) {
   absl::string_view base_conjugation_suffix_data;
   absl::string_view conjugation_suffix_data;
   absl::string_view conjugation_suffix_index_data;
   absl::string_view usage_items_data;
+  absl::string_view usage_index_data;
   absl::string_view string_array_data;
   data_manager->GetUsageRewriterData(
       &base_conjugation_suffix_data, &conjugation_suffix_data,
-      &conjugation_suffix_index_data, &usage_items_data, &string_array_data);
+      &conjugation_suffix_index_data, &usage_items_data, &usage_index_data,
+      &string_array_data);
   base_conjugation_suffix_ =
       reinterpret_cast<const uint32_t *>(base_conjugation_suffix_data.data());
-  const uint32_t *conjugation_suffix =
+  conjugation_suffix_ =
       reinterpret_cast<const uint32_t *>(conjugation_suffix_data.data());
-  const uint32_t *conjugation_suffix_data_index =
-      reinterpret_cast<const uint32_t *>(conjugation_suffix_index_data.data());
+  usage_items_ = usage_items_data.data();
+  usage_index_ = absl::MakeSpan(
+      reinterpret_cast<const uint32_t *>(usage_index_data.data()),
+      usage_index_data.size() / sizeof(uint32_t));
 
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   string_array_.Set(string_array_data);
+}
+
+namespace {
+
+// Compares the concatenation of `prefix` and `suffix` with `target` without
+// building the concatenated string.
+int CompareConcatenation(const absl::string_view prefix,
+                         const absl::string_view suffix,
+                         const absl::string_view target) {
+  if (const int result = prefix.compare(target.substr(0, prefix.size()));
+      result != 0) {
+    return result;
+  }
+  return suffix.compare(target.substr(prefix.size()));
+}
 
-  UsageDictItemIterator begin(usage_items_data.data());
-  UsageDictItemIterator end(usage_items_data.data() + usage_items_data.size());
+}  // namespace
 
-  // TODO(taku): To reduce memory footprint, better to replace it with
-  // binary search over the conjugation_suffix_data directly.
-  for (; begin != end; ++begin) {
-    for (size_t i = conjugation_suffix_data_index[begin.conjugation_id()];
-         i < conjugation_suffix_data_index[begin.conjugation_id() + 1]; ++i) {
-      const absl::string_view key = string_array_[begin.key_index()];
-      const absl::string_view value = string_array_[begin.value_index()];
-      const absl::string_view key_suffix =
-          string_array_[conjugation_suffix[2 * i + 1]];
-      const absl::string_view value_suffix =
-          string_array_[conjugation_suffix[2 * i]];
-      const StrPair key_value1(absl::StrCat(key, key_suffix),
-                               absl::StrCat(value, value_suffix));
-      key_value_usageitem_map_[key_value1] = begin;
+int UsageRewriter::CompareUsageIndexEntry(const size_t i,
+                                          const absl::string_view key,
+                                          const absl::string_view value) const {
+  const uint32_t item_index = usage_index_[kUsageIndexEntrySize * i];
+  const uint32_t suffix_index = usage_index_[kUsageIndexEntrySize * i + 1];
+  const UsageDictItemIterator item(
+      usage_items_ + (item_index & ~kUsageIndexEmptyKey) * kUsageItemSize *
+                         sizeof(uint32_t));
+  if (item_index & kUsageIndexEmptyKey) {
+    if (!key.empty()) {
+      return -1;
+    }
+  } else if (const int result = CompareConcatenation(
+                 string_array_[item.key_index()],
+                 string_array_[conjugation_suffix_[2 * suffix_index + 1]], key);
+             result != 0) {
+    return result;
+  }
+  return CompareConcatenation(
+      string_array_[item.value_index()],
+      string_array_[conjugation_suffix_[2 * suffix_index]], value);
+}
 
-      const StrPair key_value2("", key_value1.second);
-      key_value_usageitem_map_[key_value2] = begin;
+UsageRewriter::UsageDictItemIterator UsageRewriter::LookupUsageIndex(
+    const absl::string_view key, const absl::string_view value) const {
+  size_t begin = 0;
+  size_t end = usage_index_size();
+  while (begin < end) {
+    const size_t mid = begin + (end - begin) / 2;
+    const int result = CompareUsageIndexEntry(mid, key, value);
+    if (result < 0) {
+      begin = mid + 1;
+    } else if (result > 0) {
+      end = mid;
+    } else {
+      const uint32_t item_index =
+          usage_index_[kUsageIndexEntrySize * mid] & ~kUsageIndexEmptyKey;
+      return UsageDictItemIterator(usage_items_ + item_index * kUsageItemSize *
+                                                      sizeof(uint32_t));
     }
   }
+  return UsageDictItemIterator();
 }
 
 // static
@@ -153,15 +195,14 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
   }
 
   // key is empty;
-  StrPair key_value("", value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr == key_value_usageitem_map_.end()) {
+  const UsageDictItemIterator iter = LookupUsageIndex("", value);
+  if (!iter.IsValid()) {
     return UsageDictItemIterator();
   }
   // Check result key part is a prefix of the content_key.
-  const absl::string_view key = string_array_[itr->second.key_index()];
+  const absl::string_view key = string_array_[iter.key_index()];
   if (absl::StartsWith(candidate.content_key, key)) {
-    return itr->second;
+    return iter;
   }
 
   return UsageDictItemIterator();
@@ -169,12 +210,10 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
 
 UsageRewriter::UsageDictItemIterator UsageRewriter::LookupUsage(
     const Segment::Candidate &candidate) const {
-  const absl::string_view key = candidate.content_key;
-  const absl::string_view value = candidate.content_value;
-  StrPair key_value(key, value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr != key_value_usageitem_map_.end()) {
-    return itr->second;
+  if (const UsageDictItemIterator iter =
+          LookupUsageIndex(candidate.content_key, candidate.content_value);
+      iter.IsValid()) {
+    return iter;
   }
 
   return LookupUnmatchedUsageHeuristically(candidate);
@@ -201,7 +240,7 @@ bool UsageRewriter::Rewrite(const ConversionRequest &request,
   // dictionary.  Since just the uniqueness in one Segments is sufficient, for
   // usage from the user dictionary, we simply assign sequential numbers larger
   // than the maximum ID of the embedded usage dictionary.
-  int32_t usage_id_for_user_comment = key_value_usageitem_map_.size();
+  int32_t usage_id_for_user_comment = usage_index_size();
   std::string comment;  // LookupComment rarely returns true.
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
     Segment *segment = segments->mutable_conversion_segment(i);
@@ -36,10 +36,9 @@
 #include <iterator>
 #include <new>
 #include <string>
-#include <utility>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/container/serialized_string_array.h"
 #include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
@@ -68,6 +67,10 @@ class UsageRewriter : public RewriterInterface {
   FRIEND_TEST(UsageRewriterTest, GetKanjiPrefixAndOneHiragana);
 
   static constexpr size_t kUsageItemSize = 5;
+  static constexpr size_t kUsageIndexEntrySize = 2;
+  // Flag of the usage item index in the usage index for the entries with the
+  // empty key.  Keep in sync with gen_usage_rewriter_dictionary_main.cc.
+  static constexpr uint32_t kUsageIndexEmptyKey = 1u << 31;
 
   class UsageDictItemIterator {
    public:
@@ -103,17 +106,33 @@ class UsageRewriter : public RewriterInterface {
     const uint32_t *ptr_;
   };
 
-  using StrPair = std::pair<std::string, std::string>;
   static std::string GetKanjiPrefixAndOneHiragana(absl::string_view word);
 
+  size_t usage_index_size() const {
+    return usage_index_.size() / kUsageIndexEntrySize;
+  }
+
+  // Compares the key and value of the i-th entry of the usage index with the
+  // given key and value, returning a negative number, zero or a positive
+  // number like absl::string_view::compare.
+  int CompareUsageIndexEntry(size_t i, absl::string_view key,
+                             absl::string_view value) const;
+  // Binary-searches the usage index for the (key, value) pair.  The empty key
+  // matches the entries indexed for the lookup by value only.
+  UsageDictItemIterator LookupUsageIndex(absl::string_view key,
+                                         absl::string_view value) const;
   UsageDictItemIterator LookupUnmatchedUsageHeuristically(
       const Segment::Candidate &candidate) const;
   UsageDictItemIterator LookupUsage(const Segment::Candidate &candidate) const;
 
-  absl::flat_hash_map<StrPair, UsageDictItemIterator> key_value_usageitem_map_;
   const dictionary::PosMatcher pos_matcher_;
   const dictionary::DictionaryInterface *dictionary_;
   const uint32_t *base_conjugation_suffix_;
+  const uint32_t *conjugation_suffix_;
+  const char *usage_items_;
+  // Sorted array of (usage item index, conjugation suffix index), generated
+  // by gen_usage_rewriter_dictionary_main.
+  absl::Span<const uint32_t> usage_index_;
   SerializedStringArray string_array_;
 };
 
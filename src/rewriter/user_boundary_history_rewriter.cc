@@ -240,7 +240,8 @@ bool UserBoundaryHistoryRewriter::ResizeOrInsert(
   // Get the prefix of segments having FIXED_VALUE state.
   if (type == INSERT) {
     target_segments_size = history_segments_size;
-    for (const Segment &segment : segments->all().drop(history_segments_size)) {
+    for (const Segment &segment :
+         std::as_const(*segments).all().drop(history_segments_size)) {
       if (segment.segment_type() == Segment::FIXED_VALUE) {
         ++target_segments_size;
       }
@@ -46,6 +46,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/config_file_stream.h"
 #include "base/file_util.h"
 #include "base/number_util.h"
@@ -155,149 +156,242 @@ std::string StrJoinWithTabs(const Strings &...strings) {
   return absl::StrJoin({static_cast<absl::string_view>(strings)...}, "\t");
 }
 
+// Writes the strings joined with tabs to |output|, reusing its buffer.
+template <typename... Strings>
+void StrJoinWithTabsTo(std::string *output, const Strings &...strings) {
+  output->clear();
+  bool first = true;
+  for (const absl::string_view str :
+       {static_cast<absl::string_view>(strings)...}) {
+    if (!first) {
+      output->push_back('\t');
+    }
+    first = false;
+    output->append(str.data(), str.size());
+  }
+}
+
+bool IsNumberCandidate(const PosMatcher &pos_matcher, const uint16_t id,
+                       const Segment::Candidate &candidate) {
+  return pos_matcher.IsNumber(id) || pos_matcher.IsKanjiNumber(id) ||
+         Util::GetScriptType(candidate.value) == Util::NUMBER;
+}
+
 class FeatureKey {
  public:
+  enum Type {
+    LEFT_RIGHT,
+    LEFT_LEFT,
+    RIGHT_RIGHT,
+    LEFT,
+    RIGHT,
+    CURRENT,
+    SINGLE,
+    LEFT_NUMBER,
+    RIGHT_NUMBER,
+  };
+
+  // The contexts of the segment, which are shared by all of its candidates,
+  // are computed here.
   FeatureKey(const Segments &segments, const PosMatcher &pos_matcher,
-             size_t index)
-      : segments_(segments), pos_matcher_(pos_matcher), index_(index) {}
+             size_t index);
+
+  // Writes the feature key of |type| to |output|.  Returns false if the
+  // feature doesn't apply to the segment.
+  bool Build(Type type, absl::string_view base_key,
+             absl::string_view base_value, std::string *output) const;
 
   std::string LeftRight(absl::string_view base_key,
-                        absl::string_view base_value) const;
+                        absl::string_view base_value) const {
+    return Get(LEFT_RIGHT, base_key, base_value);
+  }
   std::string LeftLeft(absl::string_view base_key,
-                       absl::string_view base_value) const;
+                       absl::string_view base_value) const {
+    return Get(LEFT_LEFT, base_key, base_value);
+  }
   std::string RightRight(absl::string_view base_key,
-                         absl::string_view base_value) const;
+                         absl::string_view base_value) const {
+    return Get(RIGHT_RIGHT, base_key, base_value);
+  }
   std::string Left(absl::string_view base_key,
-                   absl::string_view base_value) const;
+                   absl::string_view base_value) const {
+    return Get(LEFT, base_key, base_value);
+  }
   std::string Right(absl::string_view base_key,
-                    absl::string_view base_value) const;
+                    absl::string_view base_value) const {
+    return Get(RIGHT, base_key, base_value);
+  }
   std::string Current(absl::string_view base_key,
-                      absl::string_view base_value) const;
+                      absl::string_view base_value) const {
+    return Get(CURRENT, base_key, base_value);
+  }
   std::string Single(absl::string_view base_key,
-                     absl::string_view base_value) const;
+                     absl::string_view base_value) const {
+    return Get(SINGLE, base_key, base_value);
+  }
   std::string LeftNumber(absl::string_view base_key,
-                         absl::string_view base_value) const;
+                         absl::string_view base_value) const {
+    return Get(LEFT_NUMBER, base_key, base_value);
+  }
   std::string RightNumber(absl::string_view base_key,
-                          absl::string_view base_value) const;
+                          absl::string_view base_value) const {
+    return Get(RIGHT_NUMBER, base_key, base_value);
+  }
 
   static std::string Number(uint16_t type);
 
  private:
-  const Segments &segments_;
-  const PosMatcher &pos_matcher_;
-  const size_t index_;
+  std::string Get(Type type, absl::string_view base_key,
+                  absl::string_view base_value) const {
+    std::string output;
+    Build(type, base_key, base_value, &output);
+    return output;
+  }
+
+  // The default candidates of the neighbor segments, or nullptr if the
+  // segments don't exist.
+  const Segment::Candidate *left_left_ = nullptr;
+  const Segment::Candidate *left_ = nullptr;
+  const Segment::Candidate *right_ = nullptr;
+  const Segment::Candidate *right_right_ = nullptr;
+  bool left_number_ = false;
+  bool right_number_ = false;
+  bool single_ = false;
 };
 
-// Feature "Left Right"
-std::string FeatureKey::LeftRight(absl::string_view base_key,
-                                  absl::string_view base_value) const {
-  if (index_ + 1 >= segments_.segments_size() || index_ <= 0) {
-    return "";
+FeatureKey::FeatureKey(const Segments &segments, const PosMatcher &pos_matcher,
+                       const size_t index)
+    : single_(segments.segments_size() - segments.history_segments_size() ==
+              1) {
+  auto get_default_candidate = [&segments](size_t i) {
+    const Segment &segment = segments.segment(i);
+    return &segment.candidate(GetDefaultCandidateIndex(segment));
+  };
+  if (index >= 2) {
+    left_left_ = get_default_candidate(index - 2);
   }
-  const int j1 = GetDefaultCandidateIndex(segments_.segment(index_ - 1));
-  const int j2 = GetDefaultCandidateIndex(segments_.segment(index_ + 1));
-  return StrJoinWithTabs(
-      "LR", base_key, segments_.segment(index_ - 1).candidate(j1).value,
-      base_value, segments_.segment(index_ + 1).candidate(j2).value);
-}
-
-// Feature "Left Left"
-std::string FeatureKey::LeftLeft(absl::string_view base_key,
-                                 absl::string_view base_value) const {
-  if (index_ < 2) {
-    return "";
+  if (index >= 1) {
+    left_ = get_default_candidate(index - 1);
+    left_number_ = IsNumberCandidate(pos_matcher, left_->rid, *left_);
   }
-  const int j1 = GetDefaultCandidateIndex(segments_.segment(index_ - 2));
-  const int j2 = GetDefaultCandidateIndex(segments_.segment(index_ - 1));
-  return StrJoinWithTabs(
-      "LL", base_key, segments_.segment(index_ - 2).candidate(j1).value,
-      segments_.segment(index_ - 1).candidate(j2).value, base_value);
-}
-
-// Feature "Right Right"
-std::string FeatureKey::RightRight(absl::string_view base_key,
-                                   absl::string_view base_value) const {
-  if (index_ + 2 >= segments_.segments_size()) {
-    return "";
+  if (index + 1 < segments.segments_size()) {
+    right_ = get_default_candidate(index + 1);
+    right_number_ = IsNumberCandidate(pos_matcher, right_->lid, *right_);
   }
-  const int j1 = GetDefaultCandidateIndex(segments_.segment(index_ + 1));
-  const int j2 = GetDefaultCandidateIndex(segments_.segment(index_ + 2));
-  return StrJoinWithTabs("RR", base_key, base_value,
-                         segments_.segment(index_ + 1).candidate(j1).value,
-                         segments_.segment(index_ + 2).candidate(j2).value);
-}
-
-// Feature "Left"
-std::string FeatureKey::Left(absl::string_view base_key,
-                             absl::string_view base_value) const {
-  if (index_ < 1) {
-    return "";
+  if (index + 2 < segments.segments_size()) {
+    right_right_ = get_default_candidate(index + 2);
   }
-  const int j = GetDefaultCandidateIndex(segments_.segment(index_ - 1));
-  return StrJoinWithTabs("L", base_key,
-                         segments_.segment(index_ - 1).candidate(j).value,
-                         base_value);
 }
 
-// Feature "Right"
-std::string FeatureKey::Right(absl::string_view base_key,
-                              absl::string_view base_value) const {
-  if (index_ + 1 >= segments_.segments_size()) {
-    return "";
+bool FeatureKey::Build(const Type type, const absl::string_view base_key,
+                       const absl::string_view base_value,
+                       std::string *output) const {
+  switch (type) {
+    case LEFT_RIGHT:
+      if (left_ == nullptr || right_ == nullptr) {
+        return false;
+      }
+      StrJoinWithTabsTo(output, "LR", base_key, left_->value, base_value,
+                        right_->value);
+      return true;
+    case LEFT_LEFT:
+      if (left_left_ == nullptr) {
+        return false;
+      }
+      StrJoinWithTabsTo(output, "LL", base_key, left_left_->value,
+                        left_->value, base_value);
+      return true;
+    case RIGHT_RIGHT:
+      if (right_right_ == nullptr) {
+        return false;
+      }
+      StrJoinWithTabsTo(output, "RR", base_key, base_value, right_->value,
+                        right_right_->value);
+      return true;
+    case LEFT:
+      if (left_ == nullptr) {
+        return false;
+      }
+      StrJoinWithTabsTo(output, "L", base_key, left_->value, base_value);
+      return true;
+    case RIGHT:
+      if (right_ == nullptr) {
+        return false;
+      }
+      StrJoinWithTabsTo(output, "R", base_key, base_value, right_->value);
+      return true;
+    case CURRENT:
+      StrJoinWithTabsTo(output, "C", base_key, base_value);
+      return true;
+    case SINGLE:
+      if (!single_) {
+        return false;
+      }
+      StrJoinWithTabsTo(output, "S", base_key, base_value);
+      return true;
+    case LEFT_NUMBER:
+      if (!left_number_) {
+        return false;
+      }
+      StrJoinWithTabsTo(output, "LN", base_key, base_value);
+      return true;
+    case RIGHT_NUMBER:
+      if (!right_number_) {
+        return false;
+      }
+      StrJoinWithTabsTo(output, "RN", base_key, base_value);
+      return true;
   }
-  const int j = GetDefaultCandidateIndex(segments_.segment(index_ + 1));
-  return StrJoinWithTabs("R", base_key, base_value,
-                         segments_.segment(index_ + 1).candidate(j).value);
-}
-
-// Feature "Current"
-std::string FeatureKey::Current(absl::string_view base_key,
-                                absl::string_view base_value) const {
-  return StrJoinWithTabs("C", base_key, base_value);
+  return false;
 }
 
-// Feature "Single"
-std::string FeatureKey::Single(absl::string_view base_key,
-                               absl::string_view base_value) const {
-  if (segments_.segments_size() - segments_.history_segments_size() != 1) {
-    return "";
+// Builds the feature keys of the candidates of a segment into a reused buffer
+// and looks up their fingerprints in the storage in one batch.
+class FeatureBatch {
+ public:
+  FeatureBatch(const FeatureKey &fkey, const LruStorage &storage)
+      : fkey_(fkey), storage_(storage) {}
+
+  void Add(const size_t slot, const FeatureKey::Type type,
+           const absl::string_view base_key,
+           const absl::string_view base_value, const uint32_t weight) {
+    if (fkey_.Build(type, base_key, base_value, &buffer_)) {
+      fingerprints_.push_back(storage_.GetFingerprint(buffer_));
+      features_.push_back({slot, weight});
+    }
   }
-  return StrJoinWithTabs("S", base_key, base_value);
-}
 
-// Feature "Left Number"
-std::string FeatureKey::LeftNumber(absl::string_view base_key,
-                                   absl::string_view base_value) const {
-  if (index_ < 1) {
-    return "";
-  }
-  const int j = GetDefaultCandidateIndex(segments_.segment(index_ - 1));
-  const Segment::Candidate &candidate =
-      segments_.segment(index_ - 1).candidate(j);
-  if (pos_matcher_.IsNumber(candidate.rid) ||
-      pos_matcher_.IsKanjiNumber(candidate.rid) ||
-      Util::GetScriptType(candidate.value) == Util::NUMBER) {
-    return StrJoinWithTabs("LN", base_key, base_value);
+  // Calls |found(slot, weight, last_access_time)| for each feature found in
+  // the storage.
+  template <typename Callback>
+  void Lookup(Callback found) {
+    values_.resize(fingerprints_.size());
+    last_access_times_.resize(fingerprints_.size());
+    storage_.LookupFingerprints(fingerprints_, absl::MakeSpan(values_),
+                                absl::MakeSpan(last_access_times_));
+    for (size_t i = 0; i < features_.size(); ++i) {
+      const FeatureValue *v =
+          std::launder(reinterpret_cast<const FeatureValue *>(values_[i]));
+      if (v != nullptr && v->IsValid()) {
+        found(features_[i].slot, features_[i].weight, last_access_times_[i]);
+      }
+    }
   }
-  return "";
-}
 
-// Feature "Right Number"
-std::string FeatureKey::RightNumber(absl::string_view base_key,
-                                    absl::string_view base_value) const {
-  if (index_ + 1 >= segments_.segments_size()) {
-    return "";
-  }
-  const int j = GetDefaultCandidateIndex(segments_.segment(index_ + 1));
-  const Segment::Candidate &candidate =
-      segments_.segment(index_ + 1).candidate(j);
-  if (pos_matcher_.IsNumber(candidate.lid) ||
-      pos_matcher_.IsKanjiNumber(candidate.lid) ||
-      Util::GetScriptType(candidate.value) == Util::NUMBER) {
-    return StrJoinWithTabs("RN", base_key, base_value);
-  }
-  return "";
-}
+ private:
+  struct Feature {
+    size_t slot;
+    uint32_t weight;
+  };
+
+  const FeatureKey &fkey_;
+  const LruStorage &storage_;
+  std::string buffer_;
+  std::vector<uint64_t> fingerprints_;
+  std::vector<Feature> features_;
+  std::vector<const char *> values_;
+  std::vector<uint32_t> last_access_times_;
+};
 
 // Feature "Number"
 // used for number rewrite
@@ -514,26 +608,14 @@ UserSegmentHistoryRewriter::UserSegmentHistoryRewriter(
   CHECK_EQ(sizeof(uint32_t), sizeof(KeyTriggerValue));
 }
 
-UserSegmentHistoryRewriter::Score UserSegmentHistoryRewriter::GetScore(
-    const ConversionRequest &request, const Segments &segments,
-    size_t segment_index, int candidate_index) const {
+std::vector<UserSegmentHistoryRewriter::ScoreCandidate>
+UserSegmentHistoryRewriter::GetScores(const ConversionRequest &request,
+                                      const Segments &segments,
+                                      size_t segment_index) const {
   const size_t segments_size = segments.conversion_segments_size();
-  const Segment::Candidate &top_candidate =
-      segments.segment(segment_index).candidate(0);
-  const Segment::Candidate &candidate =
-      segments.segment(segment_index).candidate(candidate_index);
-  const std::string &all_value = candidate.value;
-  const std::string &content_value = candidate.content_value;
-  const std::string &all_key = segments.segment(segment_index).key();
-  const std::string &content_key = candidate.content_key;
-  // if the segments are resized by user OR
-  // either top/target candidate has CONTEXT_SENSITIVE flags,
-  // don't apply UNIGRAM model
-  const bool context_sensitive =
-      segments.resized() ||
-      (candidate.attributes & Segment::Candidate::CONTEXT_SENSITIVE) ||
-      (segments.segment(segment_index).candidate(0).attributes &
-       Segment::Candidate::CONTEXT_SENSITIVE);
+  const Segment &segment = segments.segment(segment_index);
+  const Segment::Candidate &top_candidate = segment.candidate(0);
+  const std::string &all_key = segment.key();
 
   const uint32_t trigram_weight = (segments_size == 3) ? 180 : 30;
   const uint32_t bigram_weight = (segments_size == 2) ? 60 : 10;
@@ -541,50 +623,90 @@ UserSegmentHistoryRewriter::Score UserSegmentHistoryRewriter::GetScore(
   const uint32_t unigram_weight = (segments_size == 1) ? 36 : 6;
   const uint32_t single_weight = (segments_size == 1) ? 90 : 15;
 
-  Score score = {0, 0};
+  // The features of all the candidates, expanded with the meta candidates,
+  // are collected first and looked up at once.
+  const size_t candidates_size =
+      segment.candidates_size() + segment.meta_candidates_size();
+  std::vector<int> candidate_indices(candidates_size);
   FeatureKey fkey(segments, *pos_matcher_, segment_index);
-  score.Update(Fetch(fkey.LeftRight(all_key, all_value), trigram_weight));
-  score.Update(Fetch(fkey.LeftLeft(all_key, all_value), trigram_weight));
-  score.Update(Fetch(fkey.RightRight(all_key, all_value), trigram_weight));
-  score.Update(Fetch(fkey.Left(all_key, all_value), bigram_weight));
-  score.Update(Fetch(fkey.Right(all_key, all_value), bigram_weight));
-  score.Update(Fetch(fkey.Single(all_key, all_value), single_weight));
-  score.Update(
-      Fetch(fkey.LeftNumber(content_key, content_value), bigram_number_weight));
-  score.Update(Fetch(fkey.RightNumber(content_key, content_value),
-                     bigram_number_weight));
-
-  const bool is_replaceable = Replaceable(request, top_candidate, candidate);
-  if (!context_sensitive && is_replaceable) {
-    score.Update(Fetch(fkey.Current(all_key, all_value), unigram_weight));
-  }
+  FeatureBatch batch(fkey, *storage_);
+  for (size_t l = 0; l < candidates_size; ++l) {
+    int j = static_cast<int>(l);
+    if (j >= static_cast<int>(segment.candidates_size())) {
+      j -= static_cast<int>(segment.candidates_size() +
+                            transliteration::NUM_T13N_TYPES);
+    }
+    candidate_indices[l] = j;
+
+    const Segment::Candidate &candidate = segment.candidate(j);
+    const std::string &all_value = candidate.value;
+    const std::string &content_value = candidate.content_value;
+    const std::string &content_key = candidate.content_key;
+    // if the segments are resized by user OR
+    // either top/target candidate has CONTEXT_SENSITIVE flags,
+    // don't apply UNIGRAM model
+    const bool context_sensitive =
+        segments.resized() ||
+        (candidate.attributes & Segment::Candidate::CONTEXT_SENSITIVE) ||
+        (top_candidate.attributes & Segment::Candidate::CONTEXT_SENSITIVE);
+
+    batch.Add(l, FeatureKey::LEFT_RIGHT, all_key, all_value, trigram_weight);
+    batch.Add(l, FeatureKey::LEFT_LEFT, all_key, all_value, trigram_weight);
+    batch.Add(l, FeatureKey::RIGHT_RIGHT, all_key, all_value, trigram_weight);
+    batch.Add(l, FeatureKey::LEFT, all_key, all_value, bigram_weight);
+    batch.Add(l, FeatureKey::RIGHT, all_key, all_value, bigram_weight);
+    batch.Add(l, FeatureKey::SINGLE, all_key, all_value, single_weight);
+    batch.Add(l, FeatureKey::LEFT_NUMBER, content_key, content_value,
+              bigram_number_weight);
+    batch.Add(l, FeatureKey::RIGHT_NUMBER, content_key, content_value,
+              bigram_number_weight);
+
+    const bool is_replaceable = Replaceable(request, top_candidate, candidate);
+    if (!context_sensitive && is_replaceable) {
+      batch.Add(l, FeatureKey::CURRENT, all_key, all_value, unigram_weight);
+    }
 
-  if (!is_replaceable) {
-    return score;
-  }
+    // The features of the content key and value score half of the above.
+    // They are skipped when they are the same keys as the above, as the
+    // scores only take the maximum.  So are the number features, which
+    // always use the content key and value.
+    if (!is_replaceable ||
+        (all_key == content_key && all_value == content_value)) {
+      continue;
+    }
+
+    batch.Add(l, FeatureKey::LEFT_RIGHT, content_key, content_value,
+              trigram_weight / 2);
+    batch.Add(l, FeatureKey::LEFT_LEFT, content_key, content_value,
+              trigram_weight / 2);
+    batch.Add(l, FeatureKey::RIGHT_RIGHT, content_key, content_value,
+              trigram_weight / 2);
+    batch.Add(l, FeatureKey::LEFT, content_key, content_value,
+              bigram_weight / 2);
+    batch.Add(l, FeatureKey::RIGHT, content_key, content_value,
+              bigram_weight / 2);
+    batch.Add(l, FeatureKey::SINGLE, content_key, content_value,
+              single_weight / 2);
 
-  score.Update(
-      Fetch(fkey.LeftRight(content_key, content_value), trigram_weight / 2));
-  score.Update(
-      Fetch(fkey.LeftLeft(content_key, content_value), trigram_weight / 2));
-  score.Update(
-      Fetch(fkey.RightRight(content_key, content_value), trigram_weight / 2));
-  score.Update(Fetch(fkey.Left(content_key, content_value), bigram_weight / 2));
-  score.Update(
-      Fetch(fkey.Right(content_key, content_value), bigram_weight / 2));
-  score.Update(
-      Fetch(fkey.Single(content_key, content_value), single_weight / 2));
-  score.Update(Fetch(fkey.LeftNumber(content_key, content_value),
-                     bigram_number_weight / 2));
-  score.Update(Fetch(fkey.RightNumber(content_key, content_value),
-                     bigram_number_weight / 2));
-
-  if (!context_sensitive) {
-    score.Update(
-        Fetch(fkey.Current(content_key, content_value), unigram_weight / 2));
+    if (!context_sensitive) {
+      batch.Add(l, FeatureKey::CURRENT, content_key, content_value,
+                unigram_weight / 2);
+    }
   }
 
-  return score;
+  std::vector<Score> scores(candidates_size, Score{0, 0});
+  batch.Lookup([&scores](size_t slot, uint32_t weight, uint32_t atime) {
+    scores[slot].Update({weight, atime});
+  });
+
+  std::vector<ScoreCandidate> score_candidates;
+  for (size_t l = 0; l < candidates_size; ++l) {
+    if (scores[l].score > 0) {
+      score_candidates.emplace_back(scores[l],
+                                    &segment.candidate(candidate_indices[l]));
+    }
+  }
+  return score_candidates;
 }
 
 // Returns true if |lhs| candidate can be replaceable with |rhs|.
@@ -992,22 +1114,7 @@ bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
     }
 
     // for each all candidates expanded
-    std::vector<ScoreCandidate> scores;
-    for (size_t l = 0;
-         l < segment->candidates_size() + segment->meta_candidates_size();
-         ++l) {
-      int j = static_cast<int>(l);
-      if (j >= static_cast<int>(segment->candidates_size())) {
-        j -= static_cast<int>(segment->candidates_size() +
-                              transliteration::NUM_T13N_TYPES);
-      }
-
-      const Score score = GetScore(request, *segments, i, j);
-      if (score.score > 0) {
-        scores.emplace_back(score, &segment->candidate(j));
-      }
-    }
-
+    std::vector<ScoreCandidate> scores = GetScores(request, *segments, i);
     if (scores.empty()) {
       continue;
     }
@@ -90,8 +90,11 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
 
   bool IsAvailable(const ConversionRequest &request,
                    const Segments &segments) const;
-  Score GetScore(const ConversionRequest &request, const Segments &segments,
-                 size_t segment_index, int candidate_index) const;
+  // Returns the scores of the candidates of the segment which have any
+  // learned feature.
+  std::vector<ScoreCandidate> GetScores(const ConversionRequest &request,
+                                        const Segments &segments,
+                                        size_t segment_index) const;
   bool Replaceable(const ConversionRequest &request,
                    const Segment::Candidate &lhs,
                    const Segment::Candidate &rhs) const;
@@ -45,6 +45,9 @@ class ZipcodeRewriter : public RewriterInterface {
   explicit ZipcodeRewriter(const dictionary::PosMatcher pos_matcher)
       : pos_matcher_(pos_matcher) {}
 
+  // The keys of the zip codes are numbers like "100-0001".
+  int triggers() const override { return NUMBER_IN_SEGMENT_KEY; }
+
   bool Rewrite(const ConversionRequest &request,
                Segments *segments) const override;
 
@@ -0,0 +1,82 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/internal/command_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "base/protobuf/arena.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+// Arena blocks are allocated with 8-byte alignment.
+constexpr size_t kBlockAlignment = 8;
+
+size_t RoundUpBlockSize(uint64_t size) {
+  return (size + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment;
+}
+
+}  // namespace
+
+CommandArena::CommandArena(size_t initial_block_size) {
+  Init(std::min(RoundUpBlockSize(initial_block_size), kMaxInitialBlockSize));
+}
+
+void CommandArena::Init(size_t initial_block_size) {
+  // The arena must be destroyed before its initial block.
+  arena_.reset();
+  initial_block_size_ = initial_block_size;
+  initial_block_ = std::make_unique<char[]>(initial_block_size_);
+  arena_.emplace(initial_block_.get(), initial_block_size_);
+}
+
+commands::Command *CommandArena::NewCommand() {
+  return protobuf::Arena::Create<commands::Command>(&*arena_);
+}
+
+void CommandArena::Reset() {
+  const uint64_t allocated = arena_->SpaceAllocated();
+  if (allocated > initial_block_size_ &&
+      initial_block_size_ < kMaxInitialBlockSize) {
+    // The command didn't fit in the initial block. Grows the block so that
+    // the next command of the same size is served without heap allocations.
+    Init(std::min(RoundUpBlockSize(allocated), kMaxInitialBlockSize));
+    return;
+  }
+  arena_->Reset();
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,94 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Reusable protobuf arena for the commands evaluated by a serving thread.
+
+#ifndef MOZC_SESSION_INTERNAL_COMMAND_ARENA_H_
+#define MOZC_SESSION_INTERNAL_COMMAND_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "base/protobuf/arena.h"
+#include "base/protobuf/protobuf.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace session {
+
+// Allocates commands::Command on a protobuf arena whose memory is kept across
+// the commands. A command with hundreds of candidate words then costs a few
+// arena blocks instead of one heap allocation per message and string.
+//
+// The arena keeps an initial block which grows to the space used by the
+// largest command so far (up to kMaxInitialBlockSize), so the steady state
+// does no heap allocation for the messages. Not thread-safe; each serving
+// thread should own its CommandArena.
+//
+// Usage:
+//   commands::Command *command = arena.NewCommand();
+//   ...  // Parse, evaluate and serialize.
+//   arena.Reset();  // |command| is no longer valid.
+class CommandArena final {
+ public:
+  static constexpr size_t kDefaultInitialBlockSize = 16 * 1024;
+  static constexpr size_t kMaxInitialBlockSize = 1024 * 1024;
+
+  CommandArena() : CommandArena(kDefaultInitialBlockSize) {}
+  explicit CommandArena(size_t initial_block_size);
+
+  CommandArena(const CommandArena &) = delete;
+  CommandArena &operator=(const CommandArena &) = delete;
+
+  // Returns an empty command owned by the arena. It is valid until Reset().
+  commands::Command *NewCommand();
+
+  // Destroys all the commands returned by NewCommand().
+  void Reset();
+
+  size_t initial_block_size() const { return initial_block_size_; }
+
+  // Returns the bytes allocated by the arena since the last Reset(), including
+  // the initial block.
+  uint64_t SpaceAllocated() const { return arena_->SpaceAllocated(); }
+
+ private:
+  void Init(size_t initial_block_size);
+
+  size_t initial_block_size_ = 0;
+  std::unique_ptr<char[]> initial_block_;
+  std::optional<protobuf::Arena> arena_;
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_INTERNAL_COMMAND_ARENA_H_
@@ -0,0 +1,99 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/internal/command_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "protocol/commands.pb.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+void FillCandidates(commands::Command *command, int num_candidates) {
+  command->mutable_input()->set_type(commands::Input::SEND_KEY);
+  commands::CandidateList *list =
+      command->mutable_output()->mutable_all_candidate_words();
+  for (int i = 0; i < num_candidates; ++i) {
+    commands::CandidateWord *word = list->add_candidates();
+    word->set_id(i);
+    word->set_index(i);
+    word->set_key("こうほ");
+    word->set_value("候補の値はSSOに収まらない長さの文字列");
+  }
+}
+
+TEST(CommandArenaTest, NewCommand) {
+  CommandArena arena;
+  commands::Command *command = arena.NewCommand();
+  ASSERT_NE(command, nullptr);
+  EXPECT_FALSE(command->has_input());
+  EXPECT_FALSE(command->has_output());
+
+  FillCandidates(command, 3);
+  const std::string serialized = command->SerializeAsString();
+  arena.Reset();
+
+  command = arena.NewCommand();
+  EXPECT_FALSE(command->has_output());
+  EXPECT_TRUE(command->ParseFromString(serialized));
+  EXPECT_EQ(command->output().all_candidate_words().candidates_size(), 3);
+  arena.Reset();
+}
+
+TEST(CommandArenaTest, InitialBlockGrows) {
+  CommandArena arena(1024);
+  EXPECT_EQ(arena.initial_block_size(), 1024);
+
+  FillCandidates(arena.NewCommand(), 500);
+  const uint64_t allocated = arena.SpaceAllocated();
+  EXPECT_GT(allocated, 1024);
+  arena.Reset();
+  EXPECT_GE(arena.initial_block_size(), allocated);
+
+  // The command of the same size fits in the initial block.
+  const size_t initial_block_size = arena.initial_block_size();
+  FillCandidates(arena.NewCommand(), 500);
+  EXPECT_LE(arena.SpaceAllocated(), initial_block_size);
+  arena.Reset();
+  EXPECT_EQ(arena.initial_block_size(), initial_block_size);
+}
+
+TEST(CommandArenaTest, InitialBlockIsCapped) {
+  CommandArena arena(CommandArena::kMaxInitialBlockSize * 2);
+  EXPECT_EQ(arena.initial_block_size(), CommandArena::kMaxInitialBlockSize);
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
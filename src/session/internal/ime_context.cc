@@ -32,6 +32,9 @@
 
 #include "session/internal/ime_context.h"
 
+#include <cstddef>
+#include <memory>
+
 #include "absl/log/check.h"
 #include "composer/composer.h"
 #include "protocol/commands.pb.h"
@@ -48,13 +51,18 @@ const composer::Composer &ImeContext::composer() const {
 
 composer::Composer *ImeContext::mutable_composer() {
   DCHECK(composer_.get());
+  if (composer_.use_count() > 1) {
+    composer_ = std::make_shared<composer::Composer>(*composer_);
+  }
+  dirty_output_fields_ |= OUTPUT_PREEDIT;
   return composer_.get();
 }
 
 void ImeContext::SetRequest(const commands::Request *request) {
   request_ = request;
   converter_->SetRequest(request_);
-  composer_->SetRequest(request_);
+  dirty_output_fields_ |= OUTPUT_PREEDIT | OUTPUT_CANDIDATES;
+  mutable_composer()->SetRequest(request_);
 }
 
 const commands::Request &ImeContext::GetRequest() const {
@@ -67,9 +75,10 @@ void ImeContext::SetConfig(const config::Config *config) {
 
   DCHECK(converter_.get());
   converter_->SetConfig(config_);
+  dirty_output_fields_ |= OUTPUT_PREEDIT | OUTPUT_CANDIDATES;
 
   DCHECK(composer_.get());
-  composer_->SetConfig(config_);
+  mutable_composer()->SetConfig(config_);
 
   key_event_transformer_.ReloadConfig(*config_);
 }
@@ -85,6 +94,14 @@ void ImeContext::SetKeyMapManager(
   key_map_manager_ = key_map_manager;
 }
 
+size_t ImeContext::EstimateMemoryUsage() const {
+  if (!memory_usage_.has_value()) {
+    memory_usage_ = (converter_ ? converter_->EstimateMemoryUsage() : 0) +
+                    client_context_.ByteSizeLong() + output_.ByteSizeLong();
+  }
+  return *memory_usage_;
+}
+
 const keymap::KeyMapManager &ImeContext::GetKeyMapManager() const {
   if (key_map_manager_) {
     return *key_map_manager_;
@@ -101,14 +118,18 @@ void ImeContext::CopyContext(const ImeContext &src, ImeContext *dest) {
   dest->set_create_time(src.create_time());
   dest->set_last_command_time(src.last_command_time());
 
-  *dest->mutable_composer() = src.composer();
+  dest->composer_ = src.composer_;
   dest->converter_.reset(src.converter().Clone());
   dest->key_event_transformer_ = src.key_event_transformer_;
+  // The copy has never been output.
+  dest->dirty_output_fields_ = OUTPUT_PREEDIT | OUTPUT_CANDIDATES;
 
   dest->set_state(src.state());
 
-  dest->SetRequest(src.request_);
-  dest->SetConfig(src.config_);
+  // The shared composer and the cloned converter already refer to the same
+  // request and config, so they are not set again not to unshare the composer.
+  dest->request_ = src.request_;
+  dest->config_ = src.config_;
   dest->SetKeyMapManager(&src.GetKeyMapManager());
 
   *dest->mutable_client_capability() = src.client_capability();
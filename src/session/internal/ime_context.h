@@ -33,7 +33,10 @@
 #ifndef MOZC_SESSION_INTERNAL_IME_CONTEXT_H_
 #define MOZC_SESSION_INTERNAL_IME_CONTEXT_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <utility>
 
 #include "absl/time/time.h"
@@ -68,17 +71,40 @@ class ImeContext final {
 
   // Note that before using getter methods,
   // |composer_| must be set non-null value.
+  // The composer may be shared with the copies made by CopyContext(), and
+  // mutable_composer() copies it before returning if so (copy-on-write).
   const composer::Composer &composer() const;
   composer::Composer *mutable_composer();
   void set_composer(std::unique_ptr<composer::Composer> composer) {
     composer_ = std::move(composer);
+    dirty_output_fields_ |= OUTPUT_PREEDIT;
   }
 
   const SessionConverterInterface &converter() const { return *converter_; }
-  SessionConverterInterface *mutable_converter() { return converter_.get(); }
+  SessionConverterInterface *mutable_converter() {
+    dirty_output_fields_ |= OUTPUT_PREEDIT | OUTPUT_CANDIDATES;
+    memory_usage_.reset();
+    return converter_.get();
+  }
   void set_converter(std::unique_ptr<SessionConverterInterface> converter) {
     converter_ = std::move(converter);
+    dirty_output_fields_ |= OUTPUT_PREEDIT | OUTPUT_CANDIDATES;
+    memory_usage_.reset();
+  }
+
+  // The output fields which may have changed since they were last built. The
+  // mutable accessors of the composer and the converter mark the fields built
+  // from them, so that the unchanged ones need not be built again for the
+  // clients with Capability.output_delta.
+  enum OutputField {
+    OUTPUT_PREEDIT = 1,
+    // The candidate window and the candidate word lists.
+    OUTPUT_CANDIDATES = 2,
+  };
+  bool IsOutputFieldDirty(OutputField field) const {
+    return (dirty_output_fields_ & field) != 0;
   }
+  void ClearDirtyOutputFields() { dirty_output_fields_ = 0; }
 
   const KeyEventTransformer &key_event_transformer() const {
     return key_event_transformer_;
@@ -121,12 +147,26 @@ class ImeContext final {
   // of during the precomposition state and may not be updated during
   // composition/conversion state.
   const commands::Context &client_context() const { return client_context_; }
-  commands::Context *mutable_client_context() { return &client_context_; }
+  commands::Context *mutable_client_context() {
+    memory_usage_.reset();
+    return &client_context_;
+  }
 
   const commands::Output &output() const { return output_; }
-  commands::Output *mutable_output() { return &output_; }
+  commands::Output *mutable_output() {
+    memory_usage_.reset();
+    return &output_;
+  }
 
-  // Copy |source| context to |destination| context.
+  // Returns the approximate size in bytes of the memory held by the converter,
+  // the client context and the output. It walks the segments and the protos,
+  // so the value is kept until they are modified through the mutable
+  // accessors above.
+  size_t EstimateMemoryUsage() const;
+
+  // Copy |source| context to |destination| context. The composer and the
+  // segments of the converter are shared until either context modifies them,
+  // so the copy doesn't depend on the length of the composition.
   // TODO(hsumita): Renames it as CopyFrom and make it non-static to keep
   // consistency with other classes.
   static void CopyContext(const ImeContext &src, ImeContext *dest);
@@ -139,7 +179,7 @@ class ImeContext final {
   absl::Time create_time_ = absl::InfinitePast();
   absl::Time last_command_time_ = absl::InfinitePast();
 
-  std::unique_ptr<composer::Composer> composer_;
+  std::shared_ptr<composer::Composer> composer_;
   std::unique_ptr<SessionConverterInterface> converter_;
   KeyEventTransformer key_event_transformer_;
 
@@ -148,6 +188,8 @@ class ImeContext final {
   const keymap::KeyMapManager *key_map_manager_;
 
   State state_ = NONE;
+  // Bitmap of OutputField.
+  uint32_t dirty_output_fields_ = OUTPUT_PREEDIT | OUTPUT_CANDIDATES;
   commands::Capability client_capability_;
   commands::ApplicationInfo application_info_;
   commands::Context client_context_;
@@ -155,6 +197,10 @@ class ImeContext final {
   // Storing the last output consisting of the last result and the
   // last performed command.
   commands::Output output_;
+
+  // The last value of EstimateMemoryUsage(). Reset when the converter, the
+  // client context or the output may be modified.
+  mutable std::optional<size_t> memory_usage_;
 };
 
 }  // namespace session
@@ -29,6 +29,7 @@
 
 #include "session/internal/ime_context.h"
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -99,6 +100,77 @@ TEST(ImeContextTest, BasicTest) {
   EXPECT_EQ(context.output().id(), 1414);
 }
 
+TEST(ImeContextTest, DirtyOutputFields) {
+  const commands::Request request;
+  const config::Config config;
+  MockConverter converter;
+
+  ImeContext context;
+  context.set_composer(std::make_unique<Composer>(nullptr, &request, &config));
+  context.set_converter(
+      std::make_unique<SessionConverter>(&converter, &request, &config));
+  // A new context has never been output.
+  EXPECT_TRUE(context.IsOutputFieldDirty(ImeContext::OUTPUT_PREEDIT));
+  EXPECT_TRUE(context.IsOutputFieldDirty(ImeContext::OUTPUT_CANDIDATES));
+
+  context.ClearDirtyOutputFields();
+  EXPECT_FALSE(context.IsOutputFieldDirty(ImeContext::OUTPUT_PREEDIT));
+  EXPECT_FALSE(context.IsOutputFieldDirty(ImeContext::OUTPUT_CANDIDATES));
+
+  // Reading doesn't make the fields dirty.
+  EXPECT_TRUE(context.composer().Empty());
+  EXPECT_FALSE(context.converter().IsActive());
+  EXPECT_FALSE(context.IsOutputFieldDirty(ImeContext::OUTPUT_PREEDIT));
+  EXPECT_FALSE(context.IsOutputFieldDirty(ImeContext::OUTPUT_CANDIDATES));
+
+  context.mutable_composer()->InsertCharacter("a");
+  EXPECT_TRUE(context.IsOutputFieldDirty(ImeContext::OUTPUT_PREEDIT));
+  EXPECT_FALSE(context.IsOutputFieldDirty(ImeContext::OUTPUT_CANDIDATES));
+
+  context.ClearDirtyOutputFields();
+  context.mutable_converter()->SetCandidateListVisible(true);
+  EXPECT_TRUE(context.IsOutputFieldDirty(ImeContext::OUTPUT_PREEDIT));
+  EXPECT_TRUE(context.IsOutputFieldDirty(ImeContext::OUTPUT_CANDIDATES));
+
+  // A copy has never been output either.
+  context.ClearDirtyOutputFields();
+  ImeContext copy;
+  ImeContext::CopyContext(context, &copy);
+  copy.ClearDirtyOutputFields();
+  ImeContext::CopyContext(context, &copy);
+  EXPECT_TRUE(copy.IsOutputFieldDirty(ImeContext::OUTPUT_PREEDIT));
+  EXPECT_TRUE(copy.IsOutputFieldDirty(ImeContext::OUTPUT_CANDIDATES));
+  EXPECT_FALSE(context.IsOutputFieldDirty(ImeContext::OUTPUT_PREEDIT));
+}
+
+TEST(ImeContextTest, EstimateMemoryUsage) {
+  const commands::Request request;
+  const config::Config config;
+  MockConverter converter;
+
+  ImeContext context;
+  context.set_composer(std::make_unique<Composer>(nullptr, &request, &config));
+  context.set_converter(
+      std::make_unique<SessionConverter>(&converter, &request, &config));
+  const size_t initial_usage = context.EstimateMemoryUsage();
+
+  commands::Output *output = context.mutable_output();
+  output->mutable_result()->set_value(std::string(1000, 'a'));
+  const size_t usage = context.EstimateMemoryUsage();
+  EXPECT_GT(usage, initial_usage);
+
+  // The estimate is kept while the context is not modified through the
+  // mutable accessors.
+  output->mutable_result()->set_value(std::string(2000, 'a'));
+  EXPECT_EQ(context.EstimateMemoryUsage(), usage);
+
+  context.mutable_output();
+  EXPECT_GT(context.EstimateMemoryUsage(), usage);
+
+  context.mutable_output()->Clear();
+  EXPECT_EQ(context.EstimateMemoryUsage(), initial_usage);
+}
+
 TEST(ImeContextTest, CopyContext) {
   composer::Table table;
   table.AddRule("a", "あ", "");
@@ -190,6 +262,24 @@ TEST(ImeContextTest, CopyContext) {
 
     EXPECT_EQ(destination.composer().source_text(), kQuick);
   }
+
+  {
+    // The composer is shared until either context modifies it.
+    ImeContext source;
+    source.set_composer(std::make_unique<Composer>(&table, &request, &config));
+    source.set_converter(
+        std::make_unique<SessionConverter>(&converter, &request, &config));
+    source.mutable_composer()->InsertCharacter("a");
+
+    ImeContext destination;
+    ImeContext::CopyContext(source, &destination);
+    EXPECT_EQ(&destination.composer(), &source.composer());
+
+    source.mutable_composer()->InsertCharacter("n");
+    EXPECT_NE(&destination.composer(), &source.composer());
+    EXPECT_EQ(source.composer().GetStringForSubmission(), "あｎ");
+    EXPECT_EQ(destination.composer().GetStringForSubmission(), "あ");
+  }
 }
 
 }  // namespace session
@@ -34,6 +34,7 @@
 #include <algorithm>
 #include <istream>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -43,10 +44,15 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "base/config_file_stream.h"
 #include "base/file_stream.h"
 #include "base/util.h"
+#include "composer/key_event_util.h"
 #include "composer/key_parser.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
@@ -88,6 +94,46 @@ bool KeyMapManager::IsSameKeyMapManagerApplicable(
   return true;
 }
 
+namespace {
+
+ABSL_CONST_INIT absl::Mutex g_shared_key_map_managers_mutex(absl::kConstInit);
+
+// Returns the fields of |config| checked by IsSameKeyMapManagerApplicable().
+std::string GetKeyMapSignature(const config::Config &config) {
+  absl::string_view custom_keymap_table;
+  if (config.session_keymap() == config::Config::CUSTOM) {
+    custom_keymap_table = config.custom_keymap_table();
+  }
+  return absl::StrCat(config.session_keymap(), ";",
+                      absl::StrJoin(config.overlay_keymaps(), ","), ";",
+                      custom_keymap_table);
+}
+
+}  // namespace
+
+// static
+std::shared_ptr<const KeyMapManager> KeyMapManager::GetSharedKeyMapManager(
+    const config::Config &config) {
+  // A KeyMapManager is released when no caller refers to it.
+  static auto *shared_key_map_managers = new absl::flat_hash_map<
+      std::string, std::weak_ptr<const KeyMapManager>>();
+
+  std::string signature = GetKeyMapSignature(config);
+  absl::MutexLock lock(&g_shared_key_map_managers_mutex);
+  if (const auto it = shared_key_map_managers->find(signature);
+      it != shared_key_map_managers->end()) {
+    if (std::shared_ptr<const KeyMapManager> manager = it->second.lock()) {
+      return manager;
+    }
+  }
+
+  auto manager = std::make_shared<const KeyMapManager>(config);
+  absl::erase_if(*shared_key_map_managers,
+                 [](const auto &pair) { return pair.second.expired(); });
+  (*shared_key_map_managers)[std::move(signature)] = manager;
+  return manager;
+}
+
 KeyMapManager::KeyMapManager() {
   InitCommandData();
   ApplyPrimarySessionKeymap(config::ConfigHandler::GetDefaultKeyMap(), "");
@@ -684,23 +730,35 @@ bool KeyMapManager::GetCommandComposition(
 bool KeyMapManager::GetCommandZeroQuerySuggestion(
     const commands::KeyEvent &key_event,
     PrecompositionState::Commands *command) const {
+  // Normalizes the key event once for both of the keymaps.
+  KeyInformation key;
+  std::optional<KeyInformation> stub;
+  if (!KeyEventUtil::GetNormalizedKeyInformation(key_event, &key, &stub)) {
+    return false;
+  }
   // try zero query suggestion rule first
-  if (keymap_zero_query_suggestion_.GetCommand(key_event, command)) {
+  if (keymap_zero_query_suggestion_.GetCommand(key, stub, command)) {
     return true;
   }
   // use precomposition rule
-  return keymap_precomposition_.GetCommand(key_event, command);
+  return keymap_precomposition_.GetCommand(key, stub, command);
 }
 
 bool KeyMapManager::GetCommandSuggestion(
     const commands::KeyEvent &key_event,
     CompositionState::Commands *command) const {
+  // Normalizes the key event once for both of the keymaps.
+  KeyInformation key;
+  std::optional<KeyInformation> stub;
+  if (!KeyEventUtil::GetNormalizedKeyInformation(key_event, &key, &stub)) {
+    return false;
+  }
   // try suggestion rule first
-  if (keymap_suggestion_.GetCommand(key_event, command)) {
+  if (keymap_suggestion_.GetCommand(key, stub, command)) {
     return true;
   }
   // use composition rule
-  return keymap_composition_.GetCommand(key_event, command);
+  return keymap_composition_.GetCommand(key, stub, command);
 }
 
 bool KeyMapManager::GetCommandConversion(
@@ -712,12 +770,18 @@ bool KeyMapManager::GetCommandConversion(
 bool KeyMapManager::GetCommandPrediction(
     const commands::KeyEvent &key_event,
     ConversionState::Commands *command) const {
+  // Normalizes the key event once for both of the keymaps.
+  KeyInformation key;
+  std::optional<KeyInformation> stub;
+  if (!KeyEventUtil::GetNormalizedKeyInformation(key_event, &key, &stub)) {
+    return false;
+  }
   // try prediction rule first
-  if (keymap_prediction_.GetCommand(key_event, command)) {
+  if (keymap_prediction_.GetCommand(key, stub, command)) {
     return true;
   }
   // use conversion rule
-  return keymap_conversion_.GetCommand(key_event, command);
+  return keymap_conversion_.GetCommand(key, stub, command);
 }
 
 bool KeyMapManager::ParseCommandDirect(
@@ -32,12 +32,18 @@
 #ifndef MOZC_SESSION_INTERNAL_KEYMAP_H_
 #define MOZC_SESSION_INTERNAL_KEYMAP_H_
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <istream>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/log/check.h"
 #include "base/protobuf/repeated_field.h"
 #include "composer/key_event_util.h"
 #include "protocol/commands.pb.h"
@@ -203,14 +209,35 @@ class KeyMap {
  public:
   using CommandsType = typename T::Commands;
 
+  KeyMap() { Clear(); }
+
   bool GetCommand(const commands::KeyEvent &key_event,
                   CommandsType *command) const;
+  // Same as above, for the key and the key stub returned by
+  // KeyEventUtil::GetNormalizedKeyInformation().
+  bool GetCommand(KeyInformation key, std::optional<KeyInformation> stub,
+                  CommandsType *command) const;
   bool AddRule(const commands::KeyEvent &key_event, CommandsType command);
   void Clear();
 
  private:
-  using KeyToCommandMap = absl::flat_hash_map<KeyInformation, CommandsType>;
-  KeyToCommandMap keymap_;
+  // The keys with only CTRL, ALT and SHIFT as modifiers and either an ASCII
+  // key code or a special key are looked up by the index into |dense_keymap_|.
+  // The other keys are looked up in |sparse_keymap_|.
+  static constexpr uint32_t kDenseModifierMask =
+      commands::KeyEvent::CTRL | commands::KeyEvent::ALT |
+      commands::KeyEvent::SHIFT;
+  static constexpr size_t kDenseKeySize = 256;
+  static constexpr size_t kDenseKeyMapSize =
+      (kDenseModifierMask + 1) * kDenseKeySize;
+  // Value of |dense_keymap_| for the keys without a rule.
+  static constexpr uint8_t kNoCommand = 0xFF;
+
+  static std::optional<size_t> GetDenseIndex(KeyInformation key);
+  bool Find(KeyInformation key, CommandsType *command) const;
+
+  std::array<uint8_t, kDenseKeyMapSize> dense_keymap_;
+  absl::flat_hash_map<KeyInformation, CommandsType> sparse_keymap_;
 };
 
 // A manager of key mapping rule for a Config.
@@ -276,6 +303,11 @@ class KeyMapManager {
   // Return the file name bound with the keymap enum.
   static const char *GetKeyMapFileName(config::Config::SessionKeymap keymap);
 
+  // Returns the KeyMapManager for `config`, which is shared by all the callers
+  // with the same keymap settings while any of them refers to it.
+  static std::shared_ptr<const KeyMapManager> GetSharedKeyMapManager(
+      const config::Config &config);
+
   // Returns true if both `new_config` and `old_config`
   // can use the same KeyMapManager.
   static bool IsSameKeyMapManagerApplicable(const config::Config &old_config,
@@ -375,27 +407,22 @@ bool KeyMap<T>::GetCommand(const commands::KeyEvent &key_event,
                            CommandsType *command) const {
   // Shortcut keys should be available as if CapsLock was not enabled like
   // other IMEs such as MS-IME or ATOK. b/5627459
-  commands::KeyEvent normalized_key_event;
-  KeyEventUtil::NormalizeModifiers(key_event, &normalized_key_event);
   KeyInformation key;
-  if (!KeyEventUtil::GetKeyInformation(normalized_key_event, &key)) {
+  std::optional<KeyInformation> stub;
+  if (!KeyEventUtil::GetNormalizedKeyInformation(key_event, &key, &stub)) {
     return false;
   }
+  return GetCommand(key, stub, command);
+}
 
-  if (const auto it = keymap_.find(key); it != keymap_.end()) {
-    *command = it->second;
+template <typename T>
+bool KeyMap<T>::GetCommand(const KeyInformation key,
+                           const std::optional<KeyInformation> stub,
+                           CommandsType *command) const {
+  if (Find(key, command)) {
     return true;
   }
-
-  if (KeyEventUtil::MaybeGetKeyStub(normalized_key_event, &key)) {
-    const auto it = keymap_.find(key);
-    if (it != keymap_.end()) {
-      *command = it->second;
-      return true;
-    }
-  }
-
-  return false;
+  return stub.has_value() && Find(*stub, command);
 }
 
 template <typename T>
@@ -406,13 +433,56 @@ bool KeyMap<T>::AddRule(const commands::KeyEvent &key_event,
     return false;
   }
 
-  keymap_[key] = command;
+  DCHECK_LT(command, kNoCommand);
+  if (const std::optional<size_t> index = GetDenseIndex(key);
+      index.has_value()) {
+    dense_keymap_[*index] = static_cast<uint8_t>(command);
+  } else {
+    sparse_keymap_[key] = command;
+  }
   return true;
 }
 
 template <typename T>
 void KeyMap<T>::Clear() {
-  keymap_.clear();
+  dense_keymap_.fill(kNoCommand);
+  sparse_keymap_.clear();
+}
+
+// static
+template <typename T>
+std::optional<size_t> KeyMap<T>::GetDenseIndex(const KeyInformation key) {
+  // See KeyEventUtil::GetKeyInformation() for the layout of |key|.
+  const uint32_t modifiers = static_cast<uint16_t>(key >> 48);
+  const uint32_t special_key = static_cast<uint16_t>(key >> 32);
+  const uint32_t key_code = static_cast<uint32_t>(key);
+  if ((modifiers & ~kDenseModifierMask) != 0) {
+    return std::nullopt;
+  }
+  if (special_key == 0 && key_code < 128) {
+    return modifiers * kDenseKeySize + key_code;
+  }
+  if (key_code == 0 && special_key < kDenseKeySize - 128) {
+    return modifiers * kDenseKeySize + 128 + special_key;
+  }
+  return std::nullopt;
+}
+
+template <typename T>
+bool KeyMap<T>::Find(const KeyInformation key, CommandsType *command) const {
+  if (const std::optional<size_t> index = GetDenseIndex(key);
+      index.has_value()) {
+    if (dense_keymap_[*index] == kNoCommand) {
+      return false;
+    }
+    *command = static_cast<CommandsType>(dense_keymap_[*index]);
+    return true;
+  }
+  if (const auto it = sparse_keymap_.find(key); it != sparse_keymap_.end()) {
+    *command = it->second;
+    return true;
+  }
+  return false;
 }
 
 }  // namespace keymap
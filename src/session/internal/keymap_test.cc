@@ -259,6 +259,53 @@ TEST_F(KeyMapTest, GetCommandKeyStub) {
   EXPECT_EQ(command, PrecompositionState::INSERT_CHARACTER);
 }
 
+TEST_F(KeyMapTest, GetCommandDenseAndSparseKeys) {
+  // The keys in the dense table.
+  constexpr const char *kKeys[] = {
+      "a", "Shift Ctrl Alt z", "Henkan", "Ctrl Tab", "Shift Right",
+      "Hiragana", "Ctrl Shift TextInput",
+  };
+  KeyMap<ConversionState> keymap;
+  for (const char *key : kKeys) {
+    commands::KeyEvent key_event;
+    ASSERT_TRUE(KeyParser::ParseKey(key, &key_event));
+    EXPECT_TRUE(keymap.AddRule(key_event, ConversionState::CONVERT_NEXT));
+  }
+  commands::KeyEvent key_event;
+  key_event.set_key_code(0x3042);  // "あ"
+  EXPECT_TRUE(keymap.AddRule(key_event, ConversionState::COMMIT));
+  key_event.add_modifier_keys(commands::KeyEvent::KEY_DOWN);
+  key_event.set_key_code('b');
+  EXPECT_TRUE(keymap.AddRule(key_event, ConversionState::CANCEL));
+
+  ConversionState::Commands command;
+  for (const char *key : kKeys) {
+    SCOPED_TRACE(key);
+    ASSERT_TRUE(KeyParser::ParseKey(key, &key_event));
+    EXPECT_TRUE(keymap.GetCommand(key_event, &command));
+    EXPECT_EQ(command, ConversionState::CONVERT_NEXT);
+  }
+  key_event.Clear();
+  key_event.set_key_code(0x3042);
+  EXPECT_TRUE(keymap.GetCommand(key_event, &command));
+  EXPECT_EQ(command, ConversionState::COMMIT);
+  key_event.add_modifier_keys(commands::KeyEvent::KEY_DOWN);
+  key_event.set_key_code('b');
+  EXPECT_TRUE(keymap.GetCommand(key_event, &command));
+  EXPECT_EQ(command, ConversionState::CANCEL);
+
+  // Keys without rules.
+  for (const char *key : {"b", "Shift a", "Ctrl Henkan", "Alt Right"}) {
+    SCOPED_TRACE(key);
+    ASSERT_TRUE(KeyParser::ParseKey(key, &key_event));
+    EXPECT_FALSE(keymap.GetCommand(key_event, &command));
+  }
+
+  keymap.Clear();
+  ASSERT_TRUE(KeyParser::ParseKey("a", &key_event));
+  EXPECT_FALSE(keymap.GetCommand(key_event, &command));
+}
+
 TEST_F(KeyMapTest, GetCommand_overlay) {
   config::Config config;
   config.set_session_keymap(config::Config::MSIME);
@@ -667,6 +714,26 @@ TEST_F(KeyMapTest, InputModeChangeIsNotEnabledOnChromeOsIssue13947207) {
   }
 }
 
+TEST_F(KeyMapTest, GetSharedKeyMapManager) {
+  config::Config msime = GetDefaultConfig(config::Config::MSIME);
+  const std::shared_ptr<const KeyMapManager> manager =
+      KeyMapManager::GetSharedKeyMapManager(msime);
+  ASSERT_NE(manager, nullptr);
+  EXPECT_EQ(KeyMapManager::GetSharedKeyMapManager(msime), manager);
+
+  // Fields unrelated to the keymap don't matter.
+  msime.set_use_auto_conversion(!msime.use_auto_conversion());
+  EXPECT_EQ(KeyMapManager::GetSharedKeyMapManager(msime), manager);
+
+  config::Config overlay = GetDefaultConfig(config::Config::MSIME);
+  overlay.add_overlay_keymaps(
+      config::Config::OVERLAY_HENKAN_MUHENKAN_TO_IME_ON_OFF);
+  EXPECT_NE(KeyMapManager::GetSharedKeyMapManager(overlay), manager);
+  EXPECT_NE(KeyMapManager::GetSharedKeyMapManager(
+                GetDefaultConfig(config::Config::KOTOERI)),
+            manager);
+}
+
 TEST_F(KeyMapTest, IsSameKeyMapManagerApplicable) {
   {
     // Current: CHROMEOS + []
@@ -0,0 +1,132 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/internal/output_delta.h"
+
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace session {
+
+namespace {
+
+bool IsSameStatus(const commands::Status &lhs, const commands::Status &rhs) {
+  return lhs.has_activated() == rhs.has_activated() &&
+         lhs.activated() == rhs.activated() &&
+         lhs.has_mode() == rhs.has_mode() && lhs.mode() == rhs.mode() &&
+         lhs.has_comeback_mode() == rhs.has_comeback_mode() &&
+         lhs.comeback_mode() == rhs.comeback_mode();
+}
+
+}  // namespace
+
+commands::Output::UnchangedFields OutputDeltaEncoder::GetUnchangedFields(
+    const bool preedit_changed, const bool candidates_changed) const {
+  commands::Output::UnchangedFields unchanged;
+  if (!preedit_changed && previous_fields_.preedit()) {
+    unchanged.set_preedit(true);
+  }
+  if (!candidates_changed) {
+    if (previous_fields_.candidates()) {
+      unchanged.set_candidates(true);
+    }
+    if (previous_fields_.all_candidate_words()) {
+      unchanged.set_all_candidate_words(true);
+    }
+    if (previous_fields_.incognito_candidate_words()) {
+      unchanged.set_incognito_candidate_words(true);
+    }
+  }
+  return unchanged;
+}
+
+void OutputDeltaEncoder::Encode(commands::Output *output) {
+  const commands::Output::UnchangedFields &unchanged =
+      output->unchanged_fields();
+  const bool had_status = previous_fields_.status();
+  previous_fields_.Clear();
+  if (output->has_preedit() || unchanged.preedit()) {
+    previous_fields_.set_preedit(true);
+  }
+  if (output->has_candidates() || unchanged.candidates()) {
+    previous_fields_.set_candidates(true);
+  }
+  if (output->has_all_candidate_words() || unchanged.all_candidate_words()) {
+    previous_fields_.set_all_candidate_words(true);
+  }
+  if (output->has_incognito_candidate_words() ||
+      unchanged.incognito_candidate_words()) {
+    previous_fields_.set_incognito_candidate_words(true);
+  }
+
+  if (!output->has_status()) {
+    previous_status_.Clear();
+  } else if (had_status && IsSameStatus(output->status(), previous_status_)) {
+    output->clear_status();
+    output->mutable_unchanged_fields()->set_status(true);
+    previous_fields_.set_status(true);
+  } else {
+    previous_status_ = output->status();
+    previous_fields_.set_status(true);
+  }
+}
+
+void OutputDeltaEncoder::Reset() {
+  previous_fields_.Clear();
+  previous_status_.Clear();
+}
+
+void ApplyOutputDelta(const commands::Output &previous,
+                      commands::Output *output) {
+  if (!output->has_unchanged_fields()) {
+    return;
+  }
+  const commands::Output::UnchangedFields &unchanged =
+      output->unchanged_fields();
+  if (unchanged.preedit()) {
+    *output->mutable_preedit() = previous.preedit();
+  }
+  if (unchanged.candidates()) {
+    *output->mutable_candidates() = previous.candidates();
+  }
+  if (unchanged.status()) {
+    *output->mutable_status() = previous.status();
+  }
+  if (unchanged.all_candidate_words()) {
+    *output->mutable_all_candidate_words() = previous.all_candidate_words();
+  }
+  if (unchanged.incognito_candidate_words()) {
+    *output->mutable_incognito_candidate_words() =
+        previous.incognito_candidate_words();
+  }
+  output->clear_unchanged_fields();
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,81 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Omits the fields of the outputs which are unchanged from the previous output
+// of the session, for the clients with Capability.output_delta.
+
+#ifndef MOZC_SESSION_INTERNAL_OUTPUT_DELTA_H_
+#define MOZC_SESSION_INTERNAL_OUTPUT_DELTA_H_
+
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace session {
+
+class OutputDeltaEncoder final {
+ public:
+  OutputDeltaEncoder() = default;
+
+  OutputDeltaEncoder(const OutputDeltaEncoder &) = delete;
+  OutputDeltaEncoder &operator=(const OutputDeltaEncoder &) = delete;
+
+  // Returns the fields which the next output doesn't need to build, given
+  // whether the preedit and the candidates may have changed since the previous
+  // output was built. These are the unchanged fields which the client has from
+  // the previous output. The candidates stand for the candidate window and the
+  // candidate word lists.
+  commands::Output::UnchangedFields GetUnchangedFields(
+      bool preedit_changed, bool candidates_changed) const;
+
+  // Clears the status of |output| and marks it in output->unchanged_fields() if
+  // it is the same as in the previous output passed to this method. Then
+  // records the fields which the client has after |output|, that is, the
+  // fields present in |output| or marked in output->unchanged_fields().
+  void Encode(commands::Output *output);
+
+  // Forgets the previous output, so that the next output is sent in full.
+  void Reset();
+
+ private:
+  // The fields which the client has after the previous output.
+  commands::Output::UnchangedFields previous_fields_;
+  // The status is compared by value, as it is built on every output anyway.
+  commands::Status previous_status_;
+};
+
+// Restores the fields of |output| omitted by OutputDeltaEncoder from
+// |previous|, which is the previous output of the session restored by this
+// function. This is the counterpart for the clients.
+void ApplyOutputDelta(const commands::Output &previous,
+                      commands::Output *output);
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_INTERNAL_OUTPUT_DELTA_H_
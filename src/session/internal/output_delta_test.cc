@@ -0,0 +1,171 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/internal/output_delta.h"
+
+#include "protocol/commands.pb.h"
+#include "testing/gunit.h"
+#include "testing/testing_util.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+commands::Output MakeOutput(const char *preedit, const int num_candidates) {
+  commands::Output output;
+  output.set_consumed(true);
+  output.mutable_status()->set_activated(true);
+  output.mutable_status()->set_mode(commands::HIRAGANA);
+  if (preedit != nullptr) {
+    commands::Preedit::Segment *segment =
+        output.mutable_preedit()->add_segment();
+    segment->set_value(preedit);
+    segment->set_value_length(1);
+    segment->set_annotation(commands::Preedit::Segment::UNDERLINE);
+    output.mutable_preedit()->set_cursor(1);
+  }
+  for (int i = 0; i < num_candidates; ++i) {
+    commands::CandidateWord *word =
+        output.mutable_all_candidate_words()->add_candidates();
+    word->set_id(i);
+    word->set_index(i);
+    word->set_value("candidate");
+  }
+  return output;
+}
+
+// Builds the output as Session::Output() does, leaving the fields in
+// |unchanged| unbuilt.
+commands::Output BuildOutput(
+    const char *preedit, const int num_candidates,
+    const commands::Output::UnchangedFields &unchanged) {
+  commands::Output output = MakeOutput(preedit, num_candidates);
+  if (unchanged.preedit()) {
+    output.clear_preedit();
+    output.mutable_unchanged_fields()->set_preedit(true);
+  }
+  if (unchanged.all_candidate_words()) {
+    output.clear_all_candidate_words();
+    output.mutable_unchanged_fields()->set_all_candidate_words(true);
+  }
+  return output;
+}
+
+TEST(OutputDeltaTest, GetUnchangedFields) {
+  OutputDeltaEncoder encoder;
+  // Nothing is omitted before the first output.
+  EXPECT_FALSE(encoder.GetUnchangedFields(false, false).has_preedit());
+
+  commands::Output output = MakeOutput("あ", 3);
+  encoder.Encode(&output);
+  // The first output is sent in full.
+  EXPECT_TRUE(output.has_preedit());
+  EXPECT_TRUE(output.has_status());
+  EXPECT_TRUE(output.has_all_candidate_words());
+  EXPECT_FALSE(output.has_unchanged_fields());
+
+  commands::Output::UnchangedFields unchanged =
+      encoder.GetUnchangedFields(false, true);
+  EXPECT_TRUE(unchanged.preedit());
+  EXPECT_FALSE(unchanged.candidates());
+  EXPECT_FALSE(unchanged.all_candidate_words());
+  output = BuildOutput("あ", 4, unchanged);
+  encoder.Encode(&output);
+  EXPECT_FALSE(output.has_preedit());
+  EXPECT_FALSE(output.has_status());
+  EXPECT_TRUE(output.has_all_candidate_words());
+  EXPECT_TRUE(output.consumed());
+  EXPECT_TRUE(output.unchanged_fields().preedit());
+  EXPECT_TRUE(output.unchanged_fields().status());
+  EXPECT_FALSE(output.unchanged_fields().all_candidate_words());
+
+  // The client still has the preedit omitted above.
+  unchanged = encoder.GetUnchangedFields(false, false);
+  EXPECT_TRUE(unchanged.preedit());
+  EXPECT_TRUE(unchanged.all_candidate_words());
+  // The candidate window was not in the previous output.
+  EXPECT_FALSE(unchanged.candidates());
+
+  // A cleared field is not omitted next time.
+  output = MakeOutput(nullptr, 4);
+  encoder.Encode(&output);
+  EXPECT_FALSE(output.unchanged_fields().preedit());
+  EXPECT_FALSE(encoder.GetUnchangedFields(false, false).preedit());
+
+  // A changed status is sent.
+  output = MakeOutput(nullptr, 4);
+  output.mutable_status()->set_mode(commands::FULL_KATAKANA);
+  encoder.Encode(&output);
+  EXPECT_TRUE(output.has_status());
+  EXPECT_FALSE(output.unchanged_fields().status());
+
+  encoder.Reset();
+  EXPECT_FALSE(encoder.GetUnchangedFields(false, false).has_preedit());
+  EXPECT_FALSE(
+      encoder.GetUnchangedFields(false, false).has_all_candidate_words());
+  output = MakeOutput(nullptr, 4);
+  encoder.Encode(&output);
+  EXPECT_TRUE(output.has_all_candidate_words());
+  EXPECT_TRUE(output.has_status());
+  EXPECT_FALSE(output.has_unchanged_fields());
+}
+
+TEST(OutputDeltaTest, ApplyOutputDelta) {
+  struct Step {
+    const char *preedit;
+    int num_candidates;
+    bool preedit_changed;
+    bool candidates_changed;
+  };
+  constexpr Step kSteps[] = {
+      {"あ", 3, true, true},       {"あ", 3, false, false},
+      {"あい", 3, true, false},    {nullptr, 0, true, true},
+      {nullptr, 0, false, false}, {"う", 5, true, true},
+  };
+
+  OutputDeltaEncoder encoder;
+  commands::Output previous;
+  for (const Step &step : kSteps) {
+    const commands::Output expected =
+        MakeOutput(step.preedit, step.num_candidates);
+    commands::Output output =
+        BuildOutput(step.preedit, step.num_candidates,
+                    encoder.GetUnchangedFields(step.preedit_changed,
+                                               step.candidates_changed));
+    encoder.Encode(&output);
+    EXPECT_LE(output.ByteSizeLong(), expected.ByteSizeLong());
+    ApplyOutputDelta(previous, &output);
+    EXPECT_PROTO_EQ(expected, output);
+    previous = output;
+  }
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,113 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/lattice_prefetcher.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
+#include "base/latency_trace.h"
+#include "base/thread.h"
+#include "config/config_handler.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+namespace session {
+
+void LatticePrefetcher::Task::Run() {
+  // The prefetch is not a part of the key event path.
+  const ScopedLatencyTraceSuppressor suppressor;
+  ConversionRequest conversion_request(
+      nullptr, request ? request.get() : &commands::Request::default_instance(),
+      &commands::Context::default_instance(),
+      config ? config.get() : &config::ConfigHandler::DefaultConfig());
+  conversion_request.set_request_type(request_type);
+  converter->PrefetchLattice(conversion_request, key, &segments);
+}
+
+LatticePrefetcher::LatticePrefetcher()
+    : thread_([this] { ThreadMain(); }) {}
+
+LatticePrefetcher::~LatticePrefetcher() {
+  {
+    absl::MutexLock l(&mutex_);
+    terminating_ = true;
+  }
+  thread_.Join();
+}
+
+void LatticePrefetcher::Start(std::unique_ptr<Task> task) {
+  // The previous tasks are destroyed after the lock is released.
+  std::unique_ptr<Task> finished;
+  absl::MutexLock l(&mutex_);
+  std::swap(queued_, task);
+  finished = std::move(finished_);
+}
+
+std::unique_ptr<LatticePrefetcher::Task> LatticePrefetcher::Take() {
+  // The dropped task is destroyed after the lock is released.
+  std::unique_ptr<Task> queued;
+  absl::MutexLock l(&mutex_);
+  queued = std::move(queued_);
+  canceled_ = true;
+  return std::move(finished_);
+}
+
+void LatticePrefetcher::WaitForTesting() {
+  absl::MutexLock l(&mutex_);
+  mutex_.Await(absl::Condition(this, &LatticePrefetcher::IsIdle));
+}
+
+void LatticePrefetcher::ThreadMain() {
+  while (true) {
+    std::unique_ptr<Task> task;
+    {
+      absl::MutexLock l(&mutex_);
+      mutex_.Await(absl::Condition(this, &LatticePrefetcher::HasWork));
+      if (terminating_) {
+        return;
+      }
+      task = std::move(queued_);
+      running_ = true;
+      canceled_ = false;
+    }
+    task->Run();
+    absl::MutexLock l(&mutex_);
+    running_ = false;
+    if (!canceled_) {
+      finished_ = std::move(task);
+    }
+  }
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,113 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_SESSION_LATTICE_PREFETCHER_H_
+#define MOZC_SESSION_LATTICE_PREFETCHER_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "base/thread.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+namespace session {
+
+// Builds the lattice for the composition likely to come next on a persistent
+// background thread, so that the suggestion for the actual next key extends
+// it instead of looking up the dictionaries again. Only
+// ConverterInterface::PrefetchLattice() runs on the thread, which is free of
+// side effects, so the suggestions are the same with or without prefetch.
+//
+// At most one task runs at a time. The keystroke path never waits for it:
+// Take() drops a task that is still running, which is discarded when done.
+class LatticePrefetcher {
+ public:
+  // The inputs and the result of one prefetch. The task owns or shares
+  // everything it uses, as it may outlive the command and the session it comes
+  // from. The default instances are used if the request or the config is null.
+  struct Task {
+    std::string key;
+    std::shared_ptr<const commands::Request> request;
+    std::shared_ptr<const config::Config> config;
+    ConversionRequest::RequestType request_type = ConversionRequest::SUGGESTION;
+    // The history segments and the lattice cache to extend.
+    Segments segments;
+    // Keeps the converter and its data alive until the task is destroyed.
+    std::shared_ptr<const ConverterInterface> converter;
+
+    void Run();
+  };
+
+  LatticePrefetcher();
+  LatticePrefetcher(const LatticePrefetcher &) = delete;
+  LatticePrefetcher &operator=(const LatticePrefetcher &) = delete;
+  // Waits for the running task, if any.
+  ~LatticePrefetcher();
+
+  // Runs |task| on the background thread. A task queued but not started yet,
+  // or finished but not taken, is dropped.
+  void Start(std::unique_ptr<Task> task);
+
+  // Returns the task finished since the last Start(), or nullptr if it was
+  // not finished yet. The queued or running task is dropped either way.
+  std::unique_ptr<Task> Take();
+
+  // Blocks until no task is queued or running.
+  void WaitForTesting();
+
+ private:
+  void ThreadMain();
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return terminating_ || queued_ != nullptr;
+  }
+  bool IsIdle() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return queued_ == nullptr && !running_;
+  }
+
+  absl::Mutex mutex_;
+  std::unique_ptr<Task> queued_ ABSL_GUARDED_BY(mutex_);
+  std::unique_ptr<Task> finished_ ABSL_GUARDED_BY(mutex_);
+  bool running_ ABSL_GUARDED_BY(mutex_) = false;
+  // Set by Take() to discard the running task.
+  bool canceled_ ABSL_GUARDED_BY(mutex_) = false;
+  bool terminating_ ABSL_GUARDED_BY(mutex_) = false;
+  Thread thread_;
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_LATTICE_PREFETCHER_H_
@@ -0,0 +1,101 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/lattice_prefetcher.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+using ::testing::_;
+
+std::unique_ptr<LatticePrefetcher::Task> MakeTask(
+    std::shared_ptr<const ConverterInterface> converter) {
+  auto task = std::make_unique<LatticePrefetcher::Task>();
+  task->key = "key";
+  task->request_type = ConversionRequest::PREDICTION;
+  task->converter = std::move(converter);
+  return task;
+}
+
+TEST(LatticePrefetcherTest, TakeFinishedTask) {
+  auto converter = std::make_shared<MockConverter>();
+  EXPECT_CALL(*converter, PrefetchLattice(_, "key", _))
+      .WillOnce([](const ConversionRequest &request, absl::string_view key,
+                   Segments *segments) {
+        EXPECT_EQ(request.request_type(), ConversionRequest::PREDICTION);
+        segments->add_segment()->set_key(key);
+      });
+
+  LatticePrefetcher prefetcher;
+  prefetcher.Start(MakeTask(converter));
+  prefetcher.WaitForTesting();
+  std::unique_ptr<LatticePrefetcher::Task> task = prefetcher.Take();
+  ASSERT_NE(task, nullptr);
+  ASSERT_EQ(task->segments.segments_size(), 1);
+  EXPECT_EQ(task->segments.segment(0).key(), "key");
+
+  // The task is taken only once.
+  EXPECT_EQ(prefetcher.Take(), nullptr);
+}
+
+TEST(LatticePrefetcherTest, TakeDoesNotWaitForRunningTask) {
+  auto converter = std::make_shared<MockConverter>();
+  absl::Notification started;
+  absl::Notification release;
+  EXPECT_CALL(*converter, PrefetchLattice(_, "key", _))
+      .WillOnce([&](const ConversionRequest &, absl::string_view, Segments *) {
+        started.Notify();
+        release.WaitForNotification();
+      });
+
+  LatticePrefetcher prefetcher;
+  prefetcher.Start(MakeTask(converter));
+  started.WaitForNotification();
+  // Returns while the task is still running, which is then discarded.
+  EXPECT_EQ(prefetcher.Take(), nullptr);
+  release.Notify();
+  prefetcher.WaitForTesting();
+  EXPECT_EQ(prefetcher.Take(), nullptr);
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
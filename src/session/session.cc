@@ -38,12 +38,14 @@
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "base/clock.h"
+#include "base/latency_trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/key_event_util.h"
@@ -213,7 +215,9 @@ ImeContext::State GetEffectiveStateForTestSendKey(const commands::KeyEvent &key,
 
 // TODO(komatsu): Remove these argument by using/making singletons.
 Session::Session(EngineInterface *engine)
-    : engine_(engine), context_(new ImeContext) {
+    : engine_(engine),
+      converter_(engine->GetSharedConverter()),
+      context_(new ImeContext) {
   InitContext(context_.get());
 }
 
@@ -224,7 +228,7 @@ void Session::InitContext(ImeContext *context) const {
       &composer::Table::GetDefaultTable(), &context->GetRequest(),
       &context->GetConfig()));
   context->set_converter(std::make_unique<SessionConverter>(
-      engine_->GetConverter(), &context->GetRequest(), &context->GetConfig()));
+      converter_.get(), &context->GetRequest(), &context->GetConfig()));
 #ifdef _WIN32
   // On Windows session is started with direct mode.
   // FIXME(toshiyuki): Ditto for Mac after verifying on Mac.
@@ -267,7 +271,10 @@ void Session::PopUndoContext() {
   undo_contexts_.pop_back();
 }
 
-void Session::ClearUndoContext() { undo_contexts_.clear(); }
+void Session::ClearUndoContext() {
+  undo_contexts_.clear();
+  MaybeSwitchConverter();
+}
 
 bool Session::HasUndoContext() const { return !undo_contexts_.empty(); }
 
@@ -397,6 +404,9 @@ bool Session::SendCommand(commands::Command *command) {
     case commands::SessionCommand::UPDATE_COMPOSITION:
       result = UpdateComposition(command);
       break;
+    case commands::SessionCommand::GET_LATENCY_STATS:
+      result = GetLatencyStats(command);
+      break;
     default:
       LOG(WARNING) << "Unknown command" << *command;
       result = DoNothing(command);
@@ -503,6 +513,7 @@ bool Session::TestSendKey(commands::Command *command) {
 }
 
 bool Session::SendKey(commands::Command *command) {
+  MOZC_LATENCY_TRACE("Session::SendKey");
   UpdateTime();
   UpdatePreferences(command);
   TransformInput(command->mutable_input());
@@ -1013,16 +1024,24 @@ void Session::UpdatePreferences(commands::Command *command) {
 
   // Update config values modified temporarily.
   // TODO(team): Stop using config for temporary modification.
-  if (config.has_selection_shortcut()) {
+  // The converter is updated only on changes, as its mutable accessor marks
+  // the output dirty.
+  if (config.has_selection_shortcut() &&
+      config.selection_shortcut() !=
+          context_->converter().selection_shortcut()) {
     context_->mutable_converter()->set_selection_shortcut(
         config.selection_shortcut());
   }
 
 #if (defined(TARGET_OS_IPHONE) && TARGET_OS_IPHONE) || defined(__linux__) || \
     defined(__wasm__)
-  context_->mutable_converter()->set_use_cascading_window(false);
+  if (context_->converter().use_cascading_window()) {
+    context_->mutable_converter()->set_use_cascading_window(false);
+  }
 #else   // TARGET_OS_IPHONE || __linux__ || __wasm__
-  if (config.has_use_cascading_window()) {
+  if (config.has_use_cascading_window() &&
+      config.use_cascading_window() !=
+          context_->converter().use_cascading_window()) {
     context_->mutable_converter()->set_use_cascading_window(
         config.use_cascading_window());
   }
@@ -1186,6 +1205,30 @@ void Session::SetTable(const composer::Table *table) {
   context_->mutable_composer()->SetTable(table);
 }
 
+void Session::SetConverter(
+    std::shared_ptr<const ConverterInterface> converter) {
+  if (converter == converter_) {
+    pending_converter_.reset();
+    return;
+  }
+  pending_converter_ = std::move(converter);
+  MaybeSwitchConverter();
+}
+
+void Session::MaybeSwitchConverter() {
+  if (!pending_converter_ || HasUndoContext() ||
+      context_->converter().IsActive() ||
+      (context_->state() != ImeContext::PRECOMPOSITION &&
+       context_->state() != ImeContext::DIRECT)) {
+    return;
+  }
+  // The previous converter is released here, and destroyed once the other
+  // sessions release it too.
+  converter_ = std::move(pending_converter_);
+  pending_converter_.reset();
+  context_->mutable_converter()->SetConverter(converter_.get());
+}
+
 void Session::SetConfig(const config::Config *config) {
   ClearUndoContext();
   context_->SetConfig(config);
@@ -1551,6 +1594,7 @@ bool Session::InsertCharacter(commands::Command *command) {
   }
 
   context_->mutable_composer()->InsertCharacterKeyEvent(key);
+  RecordInsertedKey(key);
   ClearUndoContext();
   if (context_->mutable_composer()->ShouldCommit()) {
     CommitCompositionDirectly(command);
@@ -2019,6 +2063,171 @@ bool Session::Suggest(const commands::Input &input) {
                                                 input.context());
 }
 
+namespace {
+
+// Limits on the key statistics kept for PrepareLatticePrefetch().
+constexpr size_t kMaxRecordedKeys = 128;
+constexpr size_t kMaxNextKeysPerKey = 16;
+
+// Identifies the key as the composer sees it: the key code in the lower 32
+// bits and the code point of the key string in the upper 32 bits. Returns 0
+// for the keys which don't fit, e.g., the key string of several characters.
+uint64_t GetInsertedKeyId(const commands::KeyEvent &key) {
+  uint64_t key_string_id = 0;
+  if (const absl::string_view key_string = key.key_string();
+      !key_string.empty()) {
+    if (Util::CharsLen(key_string) != 1) {
+      return 0;
+    }
+    key_string_id = Util::Utf8ToCodepoint(key_string);
+  }
+  return key_string_id << 32 | key.key_code();
+}
+
+commands::KeyEvent GetInsertedKey(uint64_t key_id) {
+  commands::KeyEvent key;
+  key.set_key_code(static_cast<uint32_t>(key_id));
+  if (const char32_t key_string_id = key_id >> 32; key_string_id != 0) {
+    key.set_key_string(Util::CodepointToUtf8(key_string_id));
+  }
+  return key;
+}
+
+}  // namespace
+
+void Session::set_lattice_prefetch_enabled(bool enabled) {
+  lattice_prefetch_enabled_ = enabled;
+  if (!enabled) {
+    next_keys_.clear();
+    last_inserted_key_id_ = 0;
+  }
+}
+
+void Session::RecordInsertedKey(const commands::KeyEvent &key) {
+  if (!lattice_prefetch_enabled_) {
+    return;
+  }
+  const uint64_t key_id = GetInsertedKeyId(key);
+  if (key_id != 0 && last_inserted_key_id_ != 0 &&
+      (next_keys_.size() < kMaxRecordedKeys ||
+       next_keys_.contains(last_inserted_key_id_))) {
+    std::vector<NextKey> &next_keys = next_keys_[last_inserted_key_id_];
+    auto it = absl::c_find_if(next_keys, [key_id](const NextKey &next_key) {
+      return next_key.key_id == key_id;
+    });
+    if (it != next_keys.end()) {
+      ++it->count;
+    } else if (next_keys.size() < kMaxNextKeysPerKey) {
+      next_keys.push_back({key_id, 1});
+    }
+  }
+  last_inserted_key_id_ = key_id;
+}
+
+std::vector<commands::KeyEvent> Session::GetLikelyNextKeys(
+    size_t max_keys) const {
+  std::vector<commands::KeyEvent> keys;
+  if (const auto it = next_keys_.find(last_inserted_key_id_);
+      it != next_keys_.end()) {
+    std::vector<const NextKey *> next_keys;
+    for (const NextKey &next_key : it->second) {
+      next_keys.push_back(&next_key);
+    }
+    absl::c_stable_sort(next_keys, [](const NextKey *lhs, const NextKey *rhs) {
+      return lhs->count > rhs->count;
+    });
+    for (const NextKey *next_key : next_keys) {
+      if (keys.size() >= max_keys) {
+        break;
+      }
+      keys.push_back(GetInsertedKey(next_key->key_id));
+    }
+    return keys;
+  }
+  // Nothing learned yet. Vowels are the most frequent romaji keys, but they
+  // only make sense when the previous key was a plain ASCII key.
+  if (last_inserted_key_id_ != 0 && last_inserted_key_id_ >> 32 == 0) {
+    for (const char c : absl::string_view("aiueo").substr(0, max_keys)) {
+      keys.emplace_back().set_key_code(c);
+    }
+  }
+  return keys;
+}
+
+bool Session::PrepareLatticePrefetch(LatticePrefetcher::Task *task) {
+  if (!lattice_prefetch_enabled_ ||
+      context_->state() != ImeContext::COMPOSITION) {
+    return false;
+  }
+  // The lattice keeps only the nodes for one key, so only the most likely
+  // next key is speculated.
+  const std::vector<commands::KeyEvent> keys = GetLikelyNextKeys(1);
+  if (keys.empty()) {
+    return false;
+  }
+  composer::Composer composer = context_->composer();
+  if (!composer.InsertCharacterKeyEvent(keys.front()) ||
+      composer.ShouldCommit()) {
+    return false;
+  }
+  if (!context_->mutable_converter()->PrepareLatticePrefetch(composer, task)) {
+    return false;
+  }
+  task->converter = converter_;
+  return true;
+}
+
+void Session::AdoptPrefetchedLattice(const Segments &segments) {
+  context_->mutable_converter()->AdoptPrefetchedLattice(segments);
+}
+
+Session::Snapshot Session::CreateSnapshot() const {
+  Snapshot snapshot;
+  snapshot.state = context_->state() == ImeContext::CONVERSION
+                       ? ImeContext::COMPOSITION
+                       : context_->state();
+  snapshot.composer = context_->composer().SerializeAsString();
+  context_->converter().GetHistorySegments(&snapshot.history_segments);
+  snapshot.client_capability = context_->client_capability();
+  snapshot.application_info = context_->application_info();
+  snapshot.create_time = context_->create_time();
+  snapshot.last_command_time = context_->last_command_time();
+  return snapshot;
+}
+
+void Session::RestoreSnapshot(const Snapshot &snapshot) {
+  ClearUndoContext();
+  context_->set_state(snapshot.state);
+  if (!context_->mutable_composer()->ParseFromString(snapshot.composer)) {
+    LOG(WARNING) << "Failed to restore the composition";
+    context_->mutable_composer()->Reset();
+    context_->set_state(ImeContext::PRECOMPOSITION);
+  }
+  context_->mutable_converter()->SetHistorySegments(snapshot.history_segments);
+  *context_->mutable_client_capability() = snapshot.client_capability;
+  *context_->mutable_application_info() = snapshot.application_info;
+  context_->set_create_time(snapshot.create_time);
+  context_->set_last_command_time(snapshot.last_command_time);
+}
+
+size_t Session::EstimateMemoryUsage() const {
+  // Roughly a chunk of the composition with its strings per character.
+  constexpr size_t kComposedCharMemoryUsage = 128;
+  // The undo contexts share the composer and the segments with context_
+  // until either is modified, so only the contexts themselves are counted.
+  // ImeContext keeps its estimate until it is modified, so the segments and
+  // the protos of an unchanged session are not walked again.
+  size_t size = sizeof(*this) +
+                (undo_contexts_.size() + 1) * sizeof(ImeContext) +
+                sizeof(composer::Composer) +
+                context_->composer().GetLength() * kComposedCharMemoryUsage +
+                context_->EstimateMemoryUsage();
+  for (const auto &[key_id, next_keys] : next_keys_) {
+    size += sizeof(key_id) + next_keys.size() * sizeof(NextKey);
+  }
+  return size;
+}
+
 bool Session::ConvertToTransliteration(
     commands::Command *command,
     const transliteration::TransliterationType type) {
@@ -2361,6 +2570,25 @@ bool Session::StopKeyToggling(commands::Command *command) {
   return DoNothing(command);
 }
 
+bool Session::GetLatencyStats(commands::Command *command) {
+  commands::Output::LatencyStats *stats =
+      command->mutable_output()->mutable_latency_stats();
+  for (const LatencyHistogram::Snapshot &snapshot :
+       LatencyTrace::GetSnapshots()) {
+    commands::Output::LatencyStats::Stage *stage = stats->add_stages();
+    stage->set_name(snapshot.name);
+    stage->set_count(snapshot.count);
+    stage->set_total_usec(snapshot.total_usec);
+    stage->set_max_usec(snapshot.max_usec);
+    for (const uint64_t bucket : snapshot.buckets) {
+      stage->add_buckets(bucket);
+    }
+  }
+  // The client doesn't need to do anything with the output.
+  command->mutable_output()->set_consumed(false);
+  return true;
+}
+
 bool Session::Convert(commands::Command *command) {
   command->mutable_output()->set_consumed(true);
   const std::string composition = context_->composer().GetQueryForConversion();
@@ -2731,6 +2959,16 @@ bool Session::PredictAndConvert(commands::Command *command) {
   return true;
 }
 
+void Session::EncodeOutputDelta(commands::Command *command) {
+  if (!context_->client_capability().output_delta() ||
+      command->input().full_output()) {
+    output_delta_encoder_.Reset();
+  }
+  if (context_->client_capability().output_delta()) {
+    output_delta_encoder_.Encode(command->mutable_output());
+  }
+}
+
 void Session::OutputFromState(commands::Command *command) {
   if (context_->state() == ImeContext::PRECOMPOSITION) {
     OutputMode(command);
@@ -2749,8 +2987,19 @@ void Session::OutputFromState(commands::Command *command) {
 
 void Session::Output(commands::Command *command) {
   OutputMode(command);
-  context_->mutable_converter()->PopOutput(context_->composer(),
-                                           command->mutable_output());
+  SessionConverterInterface *converter = context_->mutable_converter();
+  // The fields are built from the current state below, so they are dirty
+  // again only if the state changes after this.
+  commands::Output::UnchangedFields unchanged;
+  if (context_->client_capability().output_delta() &&
+      !command->input().full_output()) {
+    unchanged = output_delta_encoder_.GetUnchangedFields(
+        context_->IsOutputFieldDirty(ImeContext::OUTPUT_PREEDIT),
+        context_->IsOutputFieldDirty(ImeContext::OUTPUT_CANDIDATES));
+  }
+  context_->ClearDirtyOutputFields();
+  converter->PopOutput(context_->composer(), unchanged,
+                       command->mutable_output());
 }
 
 void Session::OutputMode(commands::Command *command) const {
@@ -38,6 +38,7 @@
       'type': 'static_library',
       'sources': [
         '<(gen_out_dir)/../dictionary/pos_matcher_impl.inc',
+        'lattice_prefetcher.cc',
         'session.cc',
         'session_converter.cc',
       ],
@@ -66,7 +67,9 @@
       'hard_dependency': 1,
       'sources': [
         'internal/candidate_list.cc',
+        'internal/command_arena.cc',
         'internal/ime_context.cc',
+        'internal/output_delta.cc',
         'internal/session_output.cc',
         'internal/key_event_transformer.cc',
       ],
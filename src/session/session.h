@@ -33,18 +33,25 @@
 #define MOZC_SESSION_SESSION_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/time/time.h"
 #include "composer/composer.h"
 #include "composer/table.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
 #include "engine/engine_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/keymap.h"
+#include "session/internal/output_delta.h"
+#include "session/lattice_prefetcher.h"
 #include "session/session_interface.h"
 #include "testing/friend_test.h"
 #include "transliteration/transliteration.h"
@@ -228,6 +235,9 @@ class Session : public SessionInterface {
   // Stops key toggling in the composer.
   bool StopKeyToggling(mozc::commands::Command *command);
 
+  // Fills the per-stage latency histograms of the process in the output.
+  bool GetLatencyStats(mozc::commands::Command *command);
+
   // Send a command to the composer to append a special string.
   bool SendComposerCommand(
       mozc::composer::Composer::InternalCommand composer_command,
@@ -244,6 +254,12 @@ class Session : public SessionInterface {
 
   void SetTable(const mozc::composer::Table *table) override;
 
+  // Switches to `converter`, e.g., after the engine is reloaded with new data.
+  // The session keeps the current converter until it is back in
+  // PRECOMPOSITION with no suggestion or undo context, which refer to the data
+  // of the current converter.
+  void SetConverter(std::shared_ptr<const ConverterInterface> converter);
+
   // Set client capability for this session.  Used by unittest.
   void set_client_capability(
       const mozc::commands::Capability &capability) override;
@@ -267,6 +283,47 @@ class Session : public SessionInterface {
 
   const ImeContext &context() const;
 
+  // Enables PrepareLatticePrefetch(). The session records the inserted keys
+  // only while it is enabled, and forgets them when it is disabled.
+  void set_lattice_prefetch_enabled(bool enabled);
+
+  // Fills |task| to build the lattice for the key likely to be typed next on
+  // another thread. Returns false if no suggestion is shown. The lattice of
+  // this session moves to the task; give it back with
+  // AdoptPrefetchedLattice() before the next command.
+  bool PrepareLatticePrefetch(LatticePrefetcher::Task *task);
+  void AdoptPrefetchedLattice(const Segments &segments);
+
+  // Compact state of an idle session: the composition and the conversion
+  // history. SessionHandler keeps it in place of an evicted session and
+  // restores a session from it on the next command.
+  struct Snapshot {
+    ImeContext::State state = ImeContext::NONE;
+    // Composer::SerializeAsString(), which is much smaller than a copy of
+    // the composer with its chunks and its cached queries.
+    std::string composer;
+    Segments history_segments;
+    commands::Capability client_capability;
+    commands::ApplicationInfo application_info;
+    absl::Time create_time = absl::InfinitePast();
+    absl::Time last_command_time = absl::InfinitePast();
+  };
+  // A conversion in progress is restored as its composition.
+  Snapshot CreateSnapshot() const;
+  // Restores the state of |snapshot| to this session. The config, the request,
+  // the key map and the table are not restored and must be set before.
+  void RestoreSnapshot(const Snapshot &snapshot);
+
+  // Returns the approximate size in bytes of the memory held by this session.
+  size_t EstimateMemoryUsage() const;
+
+  // Omits the fields of the output unchanged from the previous output if the
+  // client has Capability.output_delta, unless the input asks for the full
+  // output. The preedit and the candidates which didn't change are already
+  // left unbuilt by Output(). Called for each output of this session sent to
+  // the client.
+  void EncodeOutputDelta(commands::Command *command);
+
  private:
   FRIEND_TEST(SessionTest, OutputInitialComposition);
   FRIEND_TEST(SessionTest, IsFullWidthInsertSpace);
@@ -279,13 +336,39 @@ class Session : public SessionInterface {
   //      history, user dictionary, etc.
   mozc::EngineInterface *engine_;
 
+  // The converter of context_ and the undo contexts, and the one to switch to
+  // once the session is idle. Keeps the data of the converter alive after the
+  // engine is reloaded.
+  std::shared_ptr<const ConverterInterface> converter_;
+  std::shared_ptr<const ConverterInterface> pending_converter_;
+
   std::unique_ptr<ImeContext> context_;
 
   // Undo stack. *begin is the oldest, and *back is the newest.
   std::deque<std::unique_ptr<ImeContext>> undo_contexts_;
 
+  // Keys inserted into the composition in this session, counted by the key
+  // inserted just before. Used to guess the next key for
+  // PrepareLatticePrefetch(). A key is identified by its key code and the code
+  // point of its key string, if any. See GetInsertedKeyId().
+  struct NextKey {
+    uint64_t key_id = 0;
+    int count = 0;
+  };
+  bool lattice_prefetch_enabled_ = false;
+  absl::flat_hash_map<uint64_t, std::vector<NextKey>> next_keys_;
+  uint64_t last_inserted_key_id_ = 0;  // 0 if none.
+
+  OutputDeltaEncoder output_delta_encoder_;
+
+  void RecordInsertedKey(const commands::KeyEvent &key);
+  std::vector<commands::KeyEvent> GetLikelyNextKeys(size_t max_keys) const;
+
   void InitContext(ImeContext *context) const;
 
+  // Switches to pending_converter_ if nothing refers to converter_.
+  void MaybeSwitchConverter();
+
   void PushUndoContext();
   void PopUndoContext();
   // Clear the undo context.
@@ -44,6 +44,7 @@
       ],
       'dependencies': [
         '<(mozc_oss_src_dir)/base/absl.gyp:absl_strings',
+        '<(mozc_oss_src_dir)/base/absl.gyp:absl_synchronization',
         '<(mozc_oss_src_dir)/base/base.gyp:base',
         '<(mozc_oss_src_dir)/composer/composer.gyp:key_event_util',
         '<(mozc_oss_src_dir)/composer/composer.gyp:key_parser',
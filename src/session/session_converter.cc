@@ -44,6 +44,7 @@
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "base/latency_trace.h"
 #include "base/text_normalizer.h"
 #include "base/util.h"
 #include "base/vlog.h"
@@ -136,6 +137,22 @@ void InitSegmentsFromString(std::string key, std::string preedit,
   c->content_key = std::move(key);
 }
 
+// Returns the approximate size in bytes of the memory held by |segments|.
+size_t EstimateSegmentsMemoryUsage(const Segments &segments) {
+  size_t size = 0;
+  for (const Segment &segment : segments) {
+    size += sizeof(Segment) + segment.key().size();
+    for (size_t i = 0; i < segment.candidates_size(); ++i) {
+      const Segment::Candidate &candidate = segment.candidate(i);
+      size += sizeof(Segment::Candidate) + candidate.key.size() +
+              candidate.value.size() + candidate.content_key.size() +
+              candidate.content_value.size();
+    }
+    size += segment.meta_candidates_size() * sizeof(Segment::Candidate);
+  }
+  return size;
+}
+
 }  // namespace
 
 SessionConverter::SessionConverter(const ConverterInterface *converter,
@@ -179,6 +196,7 @@ bool SessionConverter::Convert(const composer::Composer &composer) {
 bool SessionConverter::ConvertWithPreferences(
     const composer::Composer &composer,
     const ConversionPreferences &preferences) {
+  MOZC_LATENCY_TRACE("SessionConverter::ConvertWithPreferences");
   DCHECK(CheckState(COMPOSITION | SUGGESTION | CONVERSION));
 
   ConversionRequest conversion_request(&composer, request_, config_);
@@ -440,6 +458,7 @@ bool SessionConverter::Suggest(const composer::Composer &composer,
 bool SessionConverter::SuggestWithPreferences(
     const composer::Composer &composer, const commands::Context &context,
     const ConversionPreferences &preferences) {
+  MOZC_LATENCY_TRACE("SessionConverter::SuggestWithPreferences");
   DCHECK(CheckState(COMPOSITION | SUGGESTION));
   candidate_list_visible_ = false;
 
@@ -453,51 +472,9 @@ bool SessionConverter::SuggestWithPreferences(
   }
 
   ConversionRequest conversion_request(&composer, request_, &context, config_);
-  // Initialize the conversion request and segments for suggestion.
-  SetConversionPreferences(preferences, &segments_, &conversion_request);
-
-  segments_.clear_conversion_segments();
-
-  const size_t cursor = composer.GetCursor();
-
-  // We have four (2x2) conditions for
-  // (use_prediction_candidate, use_partial_composition):
-  // - (false, false): Original suggestion behavior on desktop.
-  // - (false, true): Never happens.
-  // - (true, false): Mobile suggestion with richer candidates through
-  //                  prediction API.
-  // - (true, true): Mobile suggestion with richer candidates through
-  //                  prediction API, using partial composition text.
-  bool use_prediction_candidate = request_->mixed_conversion();
-  bool use_partial_composition = (cursor != composer.GetLength() &&
-                                  cursor != 0 && request_->mixed_conversion());
-  // Setup request based on the above two flags.
-  SetUseActualConverterForRealtimeConversion(*request_, &conversion_request);
-  if (use_partial_composition) {
-    // Auto partial suggestion should be activated only when we use all the
-    // composition.
-    // Note: For now, use_partial_composition is only for mobile typing.
-    SetRequestType(ConversionRequest::PARTIAL_PREDICTION, &conversion_request);
-  } else {
-    conversion_request.set_create_partial_candidates(
-        request_->auto_partial_suggestion());
-    if (use_prediction_candidate) {
-      SetRequestType(ConversionRequest::PREDICTION, &conversion_request);
-    } else {
-      SetRequestType(ConversionRequest::SUGGESTION, &conversion_request);
-    }
-  }
-  // Start actual suggestion/prediction.
-  bool result;
-  if (use_partial_composition) {
-    result = converter_->StartPartialPrediction(conversion_request, &segments_);
-  } else {
-    if (use_prediction_candidate) {
-      result = converter_->StartPrediction(conversion_request, &segments_);
-    } else {
-      result = converter_->StartSuggestion(conversion_request, &segments_);
-    }
-  }
+  bool result =
+      StartSuggestionForRequest(preferences, &conversion_request, &segments_);
+  request_type_ = conversion_request.request_type();
   if (!result) {
     MOZC_VLOG(1)
         << "Start(Partial?)(Suggestion|Prediction)ForRequest() returns no "
@@ -514,7 +491,8 @@ bool SessionConverter::SuggestWithPreferences(
     const ConversionRequest incognito_conversion_request =
         CreateIncognitoConversionRequest(conversion_request, incognito_config);
     incognito_segments_.Clear();
-    if (use_partial_composition) {
+    if (conversion_request.request_type() ==
+        ConversionRequest::PARTIAL_PREDICTION) {
       result = converter_->StartPartialSuggestion(incognito_conversion_request,
                                                   &incognito_segments_);
     } else {
@@ -532,7 +510,8 @@ bool SessionConverter::SuggestWithPreferences(
 
   // Copy current suggestions so that we can merge
   // prediction/suggestions later
-  previous_suggestions_ = segments_.conversion_segment(0);
+  previous_suggestions_ =
+      std::make_shared<const Segment>(segments_.conversion_segment(0));
 
   // Overwrite the request type to SUGGESTION.
   // Without this logic, a candidate gets focused that is unexpected behavior.
@@ -547,10 +526,113 @@ bool SessionConverter::SuggestWithPreferences(
   return true;
 }
 
+void SessionConverter::SetSuggestionRequestType(
+    const composer::Composer &composer,
+    ConversionRequest *conversion_request) const {
+  const size_t cursor = composer.GetCursor();
+
+  // We have four (2x2) conditions for
+  // (use_prediction_candidate, use_partial_composition):
+  // - (false, false): Original suggestion behavior on desktop.
+  // - (false, true): Never happens.
+  // - (true, false): Mobile suggestion with richer candidates through
+  //                  prediction API.
+  // - (true, true): Mobile suggestion with richer candidates through
+  //                  prediction API, using partial composition text.
+  const bool use_prediction_candidate = request_->mixed_conversion();
+  const bool use_partial_composition =
+      (cursor != composer.GetLength() && cursor != 0 &&
+       request_->mixed_conversion());
+  if (use_partial_composition) {
+    // Auto partial suggestion should be activated only when we use all the
+    // composition.
+    // Note: For now, use_partial_composition is only for mobile typing.
+    conversion_request->set_request_type(ConversionRequest::PARTIAL_PREDICTION);
+  } else {
+    conversion_request->set_create_partial_candidates(
+        request_->auto_partial_suggestion());
+    if (use_prediction_candidate) {
+      conversion_request->set_request_type(ConversionRequest::PREDICTION);
+    } else {
+      conversion_request->set_request_type(ConversionRequest::SUGGESTION);
+    }
+  }
+}
+
+bool SessionConverter::StartSuggestionForRequest(
+    const ConversionPreferences &preferences,
+    ConversionRequest *conversion_request, Segments *segments) const {
+  // Initialize the conversion request and segments for suggestion.
+  SetConversionPreferences(preferences, segments, conversion_request);
+  segments->clear_conversion_segments();
+
+  // Setup request based on the composition.
+  SetUseActualConverterForRealtimeConversion(*request_, conversion_request);
+  SetSuggestionRequestType(conversion_request->composer(), conversion_request);
+
+  switch (conversion_request->request_type()) {
+    case ConversionRequest::PARTIAL_PREDICTION:
+      return converter_->StartPartialPrediction(*conversion_request, segments);
+    case ConversionRequest::PREDICTION:
+      return converter_->StartPrediction(*conversion_request, segments);
+    default:
+      return converter_->StartSuggestion(*conversion_request, segments);
+  }
+}
+
+bool SessionConverter::PrepareLatticePrefetch(
+    const composer::Composer &composer, LatticePrefetcher::Task *task) {
+  // The lattice is cached only for the suggestion of the whole composition.
+  if (!CheckState(SUGGESTION) ||
+      composer.GetInputFieldType() == commands::Context::PASSWORD) {
+    return false;
+  }
+  ConversionRequest conversion_request(
+      &composer, request_, &commands::Context::default_instance(), config_);
+  SetSuggestionRequestType(composer, &conversion_request);
+  if (conversion_request.request_type() ==
+      ConversionRequest::PARTIAL_PREDICTION) {
+    return false;
+  }
+  // The request and the config are shared by the caller, which owns them.
+  task->key = composer.GetQueryForPrediction();
+  task->request_type = conversion_request.request_type();
+
+  // The history segments are copied, not shared, as the task runs on another
+  // thread. They are read through the const instance, which doesn't copy the
+  // segments shared with the undo contexts.
+  const Segments &segments = segments_;
+  task->segments.Clear();
+  task->segments.set_max_history_segments_size(
+      segments.max_history_segments_size());
+  task->segments.set_resized(segments.resized());
+  for (const Segment &segment : segments.history_segments()) {
+    *task->segments.add_segment() = segment;
+  }
+  // The lattice belongs to the task until AdoptPrefetchedLattice().
+  task->segments.ShareCachedLattice(segments_);
+  segments_.ClearCachedLattice();
+  return true;
+}
+
+void SessionConverter::AdoptPrefetchedLattice(const Segments &segments) {
+  // ImmutableConverter clears the lattice if the history doesn't match, and
+  // keeps only the nodes for the common prefix if the key doesn't.
+  segments_.ShareCachedLattice(segments);
+}
+
 bool SessionConverter::Predict(const composer::Composer &composer) {
   return PredictWithPreferences(composer, conversion_preferences_);
 }
 
+const Segment &SessionConverter::previous_suggestions() const {
+  if (previous_suggestions_ == nullptr) {
+    static const Segment *kEmptySegment = new Segment();
+    return *kEmptySegment;
+  }
+  return *previous_suggestions_;
+}
+
 bool SessionConverter::IsEmptySegment(const Segment &segment) const {
   return ((segment.candidates_size() == 0) &&
           (segment.meta_candidates_size() == 0));
@@ -559,6 +641,7 @@ bool SessionConverter::IsEmptySegment(const Segment &segment) const {
 bool SessionConverter::PredictWithPreferences(
     const composer::Composer &composer,
     const ConversionPreferences &preferences) {
+  MOZC_LATENCY_TRACE("SessionConverter::PredictWithPreferences");
   // TODO(komatsu): DCHECK should be
   // DCHECK(CheckState(COMPOSITION | SUGGESTION | PREDICTION));
   DCHECK(CheckState(COMPOSITION | SUGGESTION | CONVERSION | PREDICTION));
@@ -571,10 +654,10 @@ bool SessionConverter::PredictWithPreferences(
   SetUseActualConverterForRealtimeConversion(*request_, &conversion_request);
 
   const bool predict_first =
-      !CheckState(PREDICTION) && IsEmptySegment(previous_suggestions_);
+      !CheckState(PREDICTION) && IsEmptySegment(previous_suggestions());
 
   const bool predict_expand =
-      (CheckState(PREDICTION) && !IsEmptySegment(previous_suggestions_) &&
+      (CheckState(PREDICTION) && !IsEmptySegment(previous_suggestions()) &&
        candidate_list_.size() > 0 && candidate_list_.focused() &&
        candidate_list_.focused_index() == candidate_list_.last_index());
 
@@ -596,7 +679,7 @@ bool SessionConverter::PredictWithPreferences(
 
   // Merge suggestions and prediction
   std::string preedit = composer.GetStringForPreedit();
-  PrependCandidates(previous_suggestions_, std::move(preedit), &segments_);
+  PrependCandidates(previous_suggestions(), std::move(preedit), &segments_);
 
   segment_index_ = 0;
   state_ = PREDICTION;
@@ -612,7 +695,7 @@ void SessionConverter::MaybeExpandPrediction(
   DCHECK(CheckState(PREDICTION | CONVERSION));
 
   // Expand the current suggestions and fill with Prediction results.
-  if (!CheckState(PREDICTION) || IsEmptySegment(previous_suggestions_) ||
+  if (!CheckState(PREDICTION) || IsEmptySegment(previous_suggestions()) ||
       !candidate_list_.focused() ||
       candidate_list_.focused_index() != candidate_list_.last_index()) {
     return;
@@ -656,6 +739,19 @@ void SessionConverter::Reset() {
   ResetState();
 }
 
+void SessionConverter::SetConverter(const ConverterInterface *converter) {
+  DCHECK(!IsActive());
+  // Doesn't call the previous converter, which may be released soon. The
+  // segments, including the lattices cached in them, are built from the data
+  // of the previous converter. The result is kept, as it is not sent yet.
+  converter_ = converter;
+  ResetState();
+  segments_.Clear();
+  segments_.ClearCachedLattice();
+  incognito_segments_.Clear();
+  incognito_segments_.ClearCachedLattice();
+}
+
 void SessionConverter::Commit(const composer::Composer &composer,
                               const commands::Context &context) {
   DCHECK(CheckState(PREDICTION | CONVERSION));
@@ -1075,9 +1171,11 @@ void SessionConverter::SetCandidateListVisible(bool visible) {
   candidate_list_visible_ = visible;
 }
 
-void SessionConverter::PopOutput(const composer::Composer &composer,
-                                 commands::Output *output) {
-  FillOutput(composer, output);
+void SessionConverter::PopOutput(
+    const composer::Composer &composer,
+    const commands::Output::UnchangedFields &unchanged,
+    commands::Output *output) {
+  FillOutput(composer, unchanged, output);
   updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
   ResetResult();
 }
@@ -1113,15 +1211,27 @@ void MaybeFillConfig(Segment::Candidate::Command command,
 
 void SessionConverter::FillOutput(const composer::Composer &composer,
                                   commands::Output *output) const {
+  FillOutput(composer, commands::Output::UnchangedFields::default_instance(),
+             output);
+}
+
+void SessionConverter::FillOutput(
+    const composer::Composer &composer,
+    const commands::Output::UnchangedFields &unchanged,
+    commands::Output *output) const {
   if (!output) {
     LOG(ERROR) << "output is nullptr.";
     return;
   }
+  // The result is filled only once after it is updated, so it is never marked
+  // as unchanged.
   if (result_.has_value()) {
     FillResult(output->mutable_result());
   }
   if (CheckState(COMPOSITION)) {
-    if (!composer.Empty()) {
+    if (unchanged.preedit()) {
+      output->mutable_unchanged_fields()->set_preedit(true);
+    } else if (!composer.Empty()) {
       session::SessionOutput::FillPreedit(composer, output->mutable_preedit());
     }
   }
@@ -1133,7 +1243,9 @@ void SessionConverter::FillOutput(const composer::Composer &composer,
   }
 
   // Composition on Suggestion
-  if (CheckState(SUGGESTION)) {
+  if (unchanged.preedit()) {
+    output->mutable_unchanged_fields()->set_preedit(true);
+  } else if (CheckState(SUGGESTION)) {
     // When the suggestion comes from zero query suggestion, the
     // composer is empty.  In that case, preedit is not rendered.
     if (!composer.Empty()) {
@@ -1146,14 +1258,28 @@ void SessionConverter::FillOutput(const composer::Composer &composer,
   // Candidate list
   if (CheckState(SUGGESTION | PREDICTION | CONVERSION) &&
       candidate_list_visible_) {
-    FillCandidates(output->mutable_candidates());
+    if (unchanged.candidates()) {
+      output->mutable_unchanged_fields()->set_candidates(true);
+    } else {
+      FillCandidates(output->mutable_candidates());
+    }
   }
 
   // All candidate words
   if (CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
-    FillAllCandidateWords(output->mutable_all_candidate_words());
+    if (unchanged.all_candidate_words()) {
+      output->mutable_unchanged_fields()->set_all_candidate_words(true);
+    } else {
+      FillAllCandidateWords(output->mutable_all_candidate_words());
+    }
     if (request_->fill_incognito_candidate_words()) {
-      FillIncognitoCandidateWords(output->mutable_incognito_candidate_words());
+      if (unchanged.incognito_candidate_words()) {
+        output->mutable_unchanged_fields()->set_incognito_candidate_words(
+            true);
+      } else {
+        FillIncognitoCandidateWords(
+            output->mutable_incognito_candidate_words());
+      }
     }
   }
 
@@ -1185,8 +1311,10 @@ SessionConverter *SessionConverter::Clone() const {
   // moment it's ok because the current design guarantees that the converter is
   // singleton. However, we should refactor such bad design; see also the
   // comment right above.
-  session_converter->segments_ = segments_;
-  session_converter->incognito_segments_ = incognito_segments_;
+  // The segments are shared copy-on-write, so cloning for the undo stack
+  // doesn't copy the candidates.
+  session_converter->segments_.ShareSegments(segments_);
+  session_converter->incognito_segments_.ShareSegments(incognito_segments_);
   session_converter->segment_index_ = segment_index_;
   session_converter->previous_suggestions_ = previous_suggestions_;
   session_converter->conversion_preferences_ = conversion_preferences();
@@ -1207,12 +1335,28 @@ SessionConverter *SessionConverter::Clone() const {
   return session_converter;
 }
 
+void SessionConverter::GetHistorySegments(Segments *segments) const {
+  segments->ShareSegments(segments_);
+  segments->clear_conversion_segments();
+}
+
+void SessionConverter::SetHistorySegments(const Segments &segments) {
+  segments_.ShareSegments(segments);
+  segments_.clear_conversion_segments();
+}
+
+size_t SessionConverter::EstimateMemoryUsage() const {
+  return sizeof(*this) + EstimateSegmentsMemoryUsage(segments_) +
+         EstimateSegmentsMemoryUsage(incognito_segments_) +
+         result_.ByteSizeLong();
+}
+
 void SessionConverter::ResetResult() { result_.Clear(); }
 
 void SessionConverter::ResetState() {
   state_ = COMPOSITION;
   segment_index_ = 0;
-  previous_suggestions_.clear();
+  previous_suggestions_.reset();
   candidate_list_visible_ = false;
   candidate_list_.Clear();
   selected_candidate_indices_.clear();
@@ -35,6 +35,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -45,6 +46,7 @@
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "session/internal/candidate_list.h"
+#include "session/lattice_prefetcher.h"
 #include "session/session_converter_interface.h"
 #include "transliteration/transliteration.h"
 
@@ -116,12 +118,22 @@ class SessionConverter : public SessionConverterInterface {
       const composer::Composer &composer,
       const ConversionPreferences &preferences) override;
 
+  // Fills |task| to build the lattice for the suggestion of |composer| on
+  // another thread. The cached lattice moves to the task until it is given
+  // back by AdoptPrefetchedLattice().
+  bool PrepareLatticePrefetch(const composer::Composer &composer,
+                              LatticePrefetcher::Task *task) override;
+  void AdoptPrefetchedLattice(const Segments &segments) override;
+
   // Clears conversion segments, but keep the context.
   void Cancel() override;
 
   // Clears conversion segments and the context.
   void Reset() override;
 
+  // Switches to |converter|, clearing the segments and the context.
+  void SetConverter(const ConverterInterface *converter) override;
+
   // Fixes the conversion with the current status.
   void Commit(const composer::Composer &composer,
               const commands::Context &context) override;
@@ -225,6 +237,7 @@ class SessionConverter : public SessionConverterInterface {
 
   // Fills protocol buffers and update the internal status.
   void PopOutput(const composer::Composer &composer,
+                 const commands::Output::UnchangedFields &unchanged,
                  commands::Output *output) override;
 
   // Fills protocol buffers
@@ -250,11 +263,21 @@ class SessionConverter : public SessionConverterInterface {
   // Currently, converter_ is not copied.
   SessionConverter *Clone() const override;
 
+  // Shares the history segments with |segments| (copy-on-write).
+  void GetHistorySegments(Segments *segments) const override;
+  void SetHistorySegments(const Segments &segments) override;
+
+  size_t EstimateMemoryUsage() const override;
+
+  config::Config::SelectionShortcut selection_shortcut() const override {
+    return selection_shortcut_;
+  }
   void set_selection_shortcut(
       config::Config::SelectionShortcut selection_shortcut) override {
     selection_shortcut_ = selection_shortcut;
   }
 
+  bool use_cascading_window() const override { return use_cascading_window_; }
   void set_use_cascading_window(bool use_cascading_window) override {
     use_cascading_window_ = use_cascading_window;
   }
@@ -337,6 +360,11 @@ class SessionConverter : public SessionConverterInterface {
   void SegmentFocusInternal(size_t segment_index);
   void ResizeSegmentWidth(const composer::Composer &composer, int delta);
 
+  // Fills the output except for the fields in |unchanged|, which are marked in
+  // output->unchanged_fields() instead.
+  void FillOutput(const composer::Composer &composer,
+                  const commands::Output::UnchangedFields &unchanged,
+                  commands::Output *output) const;
   void FillConversion(commands::Preedit *preedit) const;
   void FillResult(commands::Result *result) const;
   void FillCandidates(commands::Candidates *candidates) const;
@@ -346,6 +374,8 @@ class SessionConverter : public SessionConverterInterface {
   void FillIncognitoCandidateWords(commands::CandidateList *candidates) const;
 
   bool IsEmptySegment(const Segment &segment) const;
+  // Returns the previous suggestions, or an empty segment if there is none.
+  const Segment &previous_suggestions() const;
 
   // Handles selected_indices for usage stats.
   void InitializeSelectedCandidateIndices();
@@ -363,6 +393,17 @@ class SessionConverter : public SessionConverterInterface {
   // Creates a config for incognito mode from the current config.
   config::Config CreateIncognitoConfig();
 
+  // Sets the request type of suggestion for the cursor position of
+  // |composer|.
+  void SetSuggestionRequestType(const composer::Composer &composer,
+                                ConversionRequest *conversion_request) const;
+
+  // Runs the suggestion or prediction for |conversion_request| on |segments|
+  // without touching the state of this converter.
+  bool StartSuggestionForRequest(const ConversionPreferences &preferences,
+                                 ConversionRequest *conversion_request,
+                                 Segments *segments) const;
+
   const ConverterInterface *converter_;
   // Conversion stats used by converter_.
   Segments segments_;
@@ -374,8 +415,9 @@ class SessionConverter : public SessionConverterInterface {
   Segments incognito_segments_;
   size_t segment_index_;
 
-  // Previous suggestions to be merged with the current predictions.
-  Segment previous_suggestions_;
+  // Previous suggestions to be merged with the current predictions. Shared
+  // with the clones as it is never modified in place.
+  std::shared_ptr<const Segment> previous_suggestions_;
 
   // A part of Output protobuf to be returned to the client side.
   commands::Result result_;
@@ -41,6 +41,7 @@
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/lattice_prefetcher.h"
 #include "transliteration/transliteration.h"
 
 namespace mozc {
@@ -136,12 +137,24 @@ class SessionConverterInterface {
       const composer::Composer &composer,
       const ConversionPreferences &preferences) = 0;
 
+  // Prepare |task| to build the lattice for the suggestion of a speculated
+  // composition on another thread. Returns false if no suggestion is shown.
+  virtual bool PrepareLatticePrefetch(const composer::Composer &composer,
+                                      LatticePrefetcher::Task *task) = 0;
+  // Give back the lattice built by the task prepared above.
+  virtual void AdoptPrefetchedLattice(const Segments &segments) = 0;
+
   // Clear conversion segments, but keep the context.
   virtual void Cancel() = 0;
 
   // Clear conversion segments and the context.
   virtual void Reset() = 0;
 
+  // Switches to |converter|. The segments, including the context, are
+  // cleared as they come from the previous converter. Must not be called
+  // while a suggestion, prediction or conversion is shown.
+  virtual void SetConverter(const ConverterInterface *converter) = 0;
+
   // Fix the conversion with the current status.
   virtual void Commit(const composer::Composer &composer,
                       const commands::Context &context) = 0;
@@ -213,8 +226,11 @@ class SessionConverterInterface {
   // Operation for the candidate list.
   virtual void SetCandidateListVisible(bool visible) = 0;
 
-  // Fill protocol buffers and update internal status.
+  // Fill protocol buffers and update internal status. The fields in
+  // |unchanged| are not filled but marked in output->unchanged_fields(), as the
+  // client has them from the previous output.
   virtual void PopOutput(const composer::Composer &composer,
+                         const commands::Output::UnchangedFields &unchanged,
                          commands::Output *output) = 0;
 
   // Fill protocol buffers
@@ -236,9 +252,19 @@ class SessionConverterInterface {
   // Callee object doesn't have the ownership of the cloned instance.
   virtual SessionConverterInterface *Clone() const = 0;
 
+  // Copy the history segments to |segments|, and replace the history segments
+  // with |segments|. Used to keep the context of an evicted session.
+  virtual void GetHistorySegments(Segments *segments) const = 0;
+  virtual void SetHistorySegments(const Segments &segments) = 0;
+
+  // Return the approximate size in bytes of the memory held by this instance.
+  virtual size_t EstimateMemoryUsage() const = 0;
+
+  virtual config::Config::SelectionShortcut selection_shortcut() const = 0;
   virtual void set_selection_shortcut(
       config::Config::SelectionShortcut selection_shortcut) = 0;
 
+  virtual bool use_cascading_window() const = 0;
   virtual void set_use_cascading_window(bool use_cascading_window) = 0;
 };
 
@@ -49,6 +49,7 @@
 #include "composer/composer.h"
 #include "composer/table.h"
 #include "converter/converter_mock.h"
+#include "converter/lattice.h"
 #include "converter/segments.h"
 #include "converter/segments_matchers.h"
 #include "data_manager/testing/mock_data_manager.h"
@@ -58,6 +59,7 @@
 #include "request/conversion_request.h"
 #include "request/request_test_util.h"
 #include "session/internal/candidate_list.h"
+#include "session/lattice_prefetcher.h"
 #include "session/session_converter_interface.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
@@ -132,6 +134,10 @@ class SessionConverterTest : public testing::TestWithTempUserProfile {
     return converter.segments_;
   }
 
+  static Lattice *GetCachedLattice(SessionConverter *converter) {
+    return converter->segments_.mutable_cached_lattice();
+  }
+
   static void SetSegments(const Segments &src, SessionConverter *converter) {
     CHECK(converter);
     converter->segments_ = src;
@@ -2193,6 +2199,43 @@ TEST_F(SessionConverterTest, SuggestAndPredict) {
   }
 }
 
+TEST_F(SessionConverterTest, PrepareAndAdoptLatticePrefetch) {
+  MockConverter mock_converter;
+  SessionConverter converter(&mock_converter, request_.get(), config_.get());
+  Segments segments;
+  {
+    Segment *segment = segments.add_segment();
+    segment->set_key(kChars_Mo);
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->value = kChars_Mozukusu;
+    candidate->content_key = kChars_Mozukusu;
+  }
+  composer_->InsertCharacterPreedit(kChars_Mo);
+
+  // Nothing is prefetched while no suggestion is shown.
+  LatticePrefetcher::Task task;
+  EXPECT_FALSE(converter.PrepareLatticePrefetch(*composer_, &task));
+
+  EXPECT_CALL(mock_converter, StartSuggestion(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  ASSERT_TRUE(converter.Suggest(*composer_, Context::default_instance()));
+  const Lattice *lattice = GetCachedLattice(&converter);
+
+  // The lattice moves to the task.
+  ASSERT_TRUE(converter.PrepareLatticePrefetch(*composer_, &task));
+  EXPECT_EQ(task.key, composer_->GetQueryForPrediction());
+  EXPECT_EQ(task.request_type, ConversionRequest::SUGGESTION);
+  EXPECT_EQ(task.segments.conversion_segments_size(), 0);
+  EXPECT_EQ(task.segments.mutable_cached_lattice(), lattice);
+  EXPECT_NE(GetCachedLattice(&converter), lattice);
+
+  // And comes back, without changing the suggestion.
+  converter.AdoptPrefetchedLattice(task.segments);
+  EXPECT_EQ(GetCachedLattice(&converter), lattice);
+  EXPECT_TRUE(converter.IsActive());
+  EXPECT_TRUE(IsCandidateListVisible(converter));
+}
+
 TEST_F(SessionConverterTest, SuggestFillIncognitoCandidateWords) {
   Segments segments;
   {  // Initialize mock segments for suggestion
@@ -2503,7 +2546,7 @@ TEST_F(SessionConverterTest, OutputAllCandidateWords) {
     EXPECT_FALSE(IsCandidateListVisible(converter));
 
     output.Clear();
-    converter.PopOutput(*composer_, &output);
+    converter.PopOutput(*composer_, {}, &output);
     EXPECT_FALSE(output.has_result());
     EXPECT_TRUE(output.has_preedit());
     EXPECT_FALSE(output.has_candidates());
@@ -2525,7 +2568,7 @@ TEST_F(SessionConverterTest, OutputAllCandidateWords) {
     EXPECT_TRUE(IsCandidateListVisible(converter));
 
     output.Clear();
-    converter.PopOutput(*composer_, &output);
+    converter.PopOutput(*composer_, {}, &output);
     EXPECT_FALSE(output.has_result());
     EXPECT_TRUE(output.has_preedit());
     EXPECT_TRUE(output.has_candidates());
@@ -2547,7 +2590,7 @@ TEST_F(SessionConverterTest, OutputAllCandidateWords) {
     EXPECT_FALSE(IsCandidateListVisible(converter));
 
     output.Clear();
-    converter.PopOutput(*composer_, &output);
+    converter.PopOutput(*composer_, {}, &output);
     EXPECT_FALSE(output.has_result());
     EXPECT_TRUE(output.has_preedit());
     EXPECT_FALSE(output.has_candidates());
@@ -37,14 +37,17 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/log/log.h"
 #include "absl/random/random.h"
+#include "absl/status/status.h"
 #include "absl/time/time.h"
 #include "base/clock.h"
+#include "base/latency_trace.h"
 #include "base/stopwatch.h"
 #include "base/version.h"
 #include "base/vlog.h"
@@ -84,6 +87,12 @@ ABSL_FLAG(int32_t, max_session_size, 64,
           "if size of sessions reaches to \"max_session_size\", "
           "oldest session is removed");
 
+ABSL_FLAG(int32_t, session_memory_budget_kb, 0,
+          "memory budget (KiB) of sessions. "
+          "if positive, the least recently used sessions are evicted to "
+          "compact snapshots when the estimated memory usage of the sessions "
+          "exceeds the budget, and \"max_session_size\" can be up to 65536");
+
 // TODO(b/275437228): Convert this to `absl::Duration`.
 ABSL_FLAG(int32_t, create_session_min_interval, 0,
           "minimum interval (sec) for create session");
@@ -104,6 +113,14 @@ ABSL_FLAG(int32_t, last_create_session_timeout, 300,
 
 ABSL_FLAG(bool, restricted, false, "Launch server with restricted setting");
 
+ABSL_FLAG(bool, speculative_prefetch, false,
+          "build the conversion lattice for the likely next key "
+          "between key events");
+
+ABSL_FLAG(std::string, latency_stats_file, "",
+          "if not empty, the per-stage latency histograms are written to this "
+          "file when the user data is synced");
+
 namespace mozc {
 namespace {
 
@@ -146,7 +163,7 @@ SessionHandler::SessionHandler(std::unique_ptr<EngineInterface> engine)
   table_manager_ = std::make_unique<composer::TableManager>();
   request_ = std::make_unique<commands::Request>();
   config_ = config::ConfigHandler::GetConfig();
-  key_map_manager_ = std::make_unique<keymap::KeyMapManager>(*config_);
+  key_map_manager_ = keymap::KeyMapManager::GetSharedKeyMapManager(*config_);
 
   if (absl::GetFlag(FLAGS_restricted)) {
     MOZC_VLOG(1) << "Server starts with restricted mode";
@@ -162,9 +179,18 @@ SessionHandler::SessionHandler(std::unique_ptr<EngineInterface> engine)
     absl::SetFlag(&FLAGS_last_command_timeout, 60);
   }
 
-  // Allow [2..128] sessions.
-  max_session_size_ = std::clamp(absl::GetFlag(FLAGS_max_session_size), 2, 128);
+  // Allow [2..128] sessions, or [2..65536] sessions with the memory budget.
+  session_memory_budget_ =
+      std::max(absl::GetFlag(FLAGS_session_memory_budget_kb), 0) * size_t{1024};
+  max_session_size_ =
+      std::clamp(absl::GetFlag(FLAGS_max_session_size), 2,
+                 session_memory_budget_ > 0 ? 65536 : 128);
   session_map_ = std::make_unique<SessionMap>(max_session_size_);
+  if (session_memory_budget_ > 0) {
+    live_sessions_ = std::make_unique<LiveSessionMap>(max_session_size_);
+  }
+
+  SetSpeculativePrefetchEnabled(absl::GetFlag(FLAGS_speculative_prefetch));
 
   if (!engine_) {
     return;
@@ -191,9 +217,9 @@ void SessionHandler::UpdateSessions(const config::Config &config,
   // Since sessions internally use config_, request_ and key_map_manager_,
   // they are moved to prev_ variables to avoid releasing until sessions switch
   // those values.
-  std::unique_ptr<const config::Config> prev_config = std::move(config_);
-  std::unique_ptr<const commands::Request> prev_request = std::move(request_);
-  std::unique_ptr<keymap::KeyMapManager> prev_key_map_manager;
+  std::shared_ptr<const config::Config> prev_config = std::move(config_);
+  std::shared_ptr<const commands::Request> prev_request = std::move(request_);
+  std::shared_ptr<const keymap::KeyMapManager> prev_key_map_manager;
 
   config_ = std::make_unique<config::Config>(config);
   request_ = std::make_unique<commands::Request>(request);
@@ -203,7 +229,8 @@ void SessionHandler::UpdateSessions(const config::Config &config,
   if (!keymap::KeyMapManager::IsSameKeyMapManagerApplicable(*prev_config,
                                                             *config_)) {
     prev_key_map_manager = std::move(key_map_manager_);
-    key_map_manager_ = std::make_unique<keymap::KeyMapManager>(*config_);
+    key_map_manager_ =
+        keymap::KeyMapManager::GetSharedKeyMapManager(*config_);
   }
 
   for (SessionElement &element : *session_map_) {
@@ -226,6 +253,14 @@ bool SessionHandler::SyncData(commands::Command *command) {
   MOZC_VLOG(1) << "Syncing user data";
   engine_->Sync();
   engine_->Wait();
+  if (const std::string latency_stats_file =
+          absl::GetFlag(FLAGS_latency_stats_file);
+      !latency_stats_file.empty()) {
+    if (absl::Status s = LatencyTrace::WriteSummaryToFile(latency_stats_file);
+        !s.ok()) {
+      LOG(ERROR) << "Cannot write the latency stats: " << s;
+    }
+  }
   return true;
 }
 
@@ -306,11 +341,19 @@ bool SessionHandler::SetRequest(commands::Command *command) {
 }
 
 bool SessionHandler::EvalCommand(commands::Command *command) {
+  MOZC_LATENCY_TRACE("SessionHandler::EvalCommand");
   if (!is_available_) {
     LOG(ERROR) << "SessionHandler is not available.";
     return false;
   }
 
+  // Takes the lattice back from the prefetch before the command uses it.
+  FinishPrefetch();
+
+  // Swaps in the new data if it is built. This is cheap, as the data is
+  // built in background and the sessions switch to it when they are idle.
+  MaybeReloadEngine(command);
+
   bool eval_succeeded = false;
   Stopwatch stopwatch;
   stopwatch.Start();
@@ -404,6 +447,11 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     observer_handler_->EvalCommandHandler(*command);
   }
 
+  if (prefetcher_ && eval_succeeded &&
+      command->input().type() == commands::Input::SEND_KEY) {
+    StartPrefetch(command->input().id());
+  }
+
   stopwatch.Stop();
   UsageStats::UpdateTiming(
       "ElapsedTimeUSec",
@@ -412,9 +460,142 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   return is_available_;
 }
 
+void SessionHandler::SetSpeculativePrefetchEnabled(bool enabled) {
+  if (enabled == (prefetcher_ != nullptr)) {
+    return;
+  }
+  for (SessionElement &element : *session_map_) {
+    if (element.value) {
+      element.value->set_lattice_prefetch_enabled(enabled);
+    }
+  }
+  if (enabled) {
+    prefetcher_ = std::make_unique<session::LatticePrefetcher>();
+    return;
+  }
+  FinishPrefetch();
+  // Waits for the running task, which builds at most one lattice.
+  prefetcher_.reset();
+}
+
+void SessionHandler::StartPrefetch(SessionID id) {
+  std::unique_ptr<session::Session> *session =
+      session_map_->MutableLookupWithoutInsert(id);
+  if (session == nullptr || !*session) {
+    return;
+  }
+  // The task shares the request and the config the session refers to.
+  const session::ImeContext &context = (*session)->context();
+  if (&context.GetRequest() != request_.get() ||
+      &context.GetConfig() != config_.get()) {
+    return;
+  }
+  auto task = std::make_unique<session::LatticePrefetcher::Task>();
+  if (!(*session)->PrepareLatticePrefetch(task.get())) {
+    return;
+  }
+  task->request = request_;
+  task->config = config_;
+  prefetcher_->Start(std::move(task));
+  prefetch_session_id_ = id;
+}
+
+void SessionHandler::FinishPrefetch() {
+  if (prefetch_session_id_ == 0) {
+    return;
+  }
+  // Doesn't wait for the running task. The session builds a new lattice
+  // instead if the task is not finished yet.
+  std::unique_ptr<session::LatticePrefetcher::Task> task = prefetcher_->Take();
+  std::unique_ptr<session::Session> *session =
+      session_map_->MutableLookupWithoutInsert(prefetch_session_id_);
+  if (task && session != nullptr && *session) {
+    (*session)->AdoptPrefetchedLattice(task->segments);
+  }
+  prefetch_session_id_ = 0;
+}
+
+session::Session *SessionHandler::GetSession(SessionID id) {
+  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
+  if (session == nullptr) {
+    return nullptr;
+  }
+  if (!*session) {
+    const auto it = session_snapshots_.find(id);
+    if (it == session_snapshots_.end()) {
+      return nullptr;
+    }
+    *session = NewSession();
+    (*session)->SetConfig(config_.get());
+    (*session)->SetKeyMapManager(key_map_manager_.get());
+    (*session)->SetRequest(request_.get());
+    if (const composer::Table *table =
+            table_manager_->GetTable(*request_, *config_);
+        table != nullptr) {
+      (*session)->SetTable(table);
+    }
+    // The composition is rebuilt on the table set above.
+    (*session)->RestoreSnapshot(it->second);
+    session_snapshots_.erase(it);
+    UsageStats::IncrementCount("SessionRehydrated");
+  }
+  (*session)->SetConverter(engine_->GetSharedConverter());
+  return session->get();
+}
+
+void SessionHandler::UpdateSessionMemoryUsage(
+    SessionID id, const session::Session &session) {
+  if (session_memory_budget_ == 0) {
+    return;
+  }
+  const size_t memory_usage = session.EstimateMemoryUsage();
+  if (size_t *prev_memory_usage = live_sessions_->MutableLookup(id);
+      prev_memory_usage != nullptr) {
+    session_memory_usage_ -= *prev_memory_usage;
+    *prev_memory_usage = memory_usage;
+  } else {
+    live_sessions_->Insert(id, memory_usage);
+  }
+  session_memory_usage_ += memory_usage;
+
+  // Evicts the least recently used sessions but the current one.
+  while (session_memory_usage_ > session_memory_budget_) {
+    const LiveSessionMap::Element *oldest = live_sessions_->Tail();
+    if (oldest == nullptr || oldest->key == id) {
+      break;
+    }
+    EvictSession(oldest->key);
+  }
+}
+
+void SessionHandler::EvictSession(SessionID id) {
+  std::unique_ptr<session::Session> *session =
+      session_map_->MutableLookupWithoutInsert(id);
+  if (session != nullptr && *session) {
+    session_snapshots_.insert_or_assign(id, (*session)->CreateSnapshot());
+    session->reset();
+    UsageStats::IncrementCount("SessionEvicted");
+    MOZC_VLOG(1) << "SessionID " << id << " is evicted";
+  }
+  ForgetSessionMemoryUsage(id);
+}
+
+void SessionHandler::ForgetSessionMemoryUsage(SessionID id) {
+  if (live_sessions_ == nullptr) {
+    return;
+  }
+  if (const size_t *memory_usage = live_sessions_->LookupWithoutInsert(id);
+      memory_usage != nullptr) {
+    session_memory_usage_ -= *memory_usage;
+    live_sessions_->Erase(id);
+  }
+}
+
 std::unique_ptr<session::Session> SessionHandler::NewSession() {
   // Session doesn't take the ownership of engine.
-  return std::make_unique<session::Session>(engine_.get());
+  auto session = std::make_unique<session::Session>(engine_.get());
+  session->set_lattice_prefetch_enabled(prefetcher_ != nullptr);
+  return session;
 }
 
 void SessionHandler::AddObserver(session::SessionObserverInterface *observer) {
@@ -432,45 +613,46 @@ void SessionHandler::MaybeUpdateConfig(commands::Command *command) {
 
 bool SessionHandler::SendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = GetSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendKey(command);
+  session->SendKey(command);
+  session->EncodeOutputDelta(command);
+  UpdateSessionMemoryUsage(id, *session);
   MaybeUpdateConfig(command);
   return true;
 }
 
 bool SessionHandler::TestSendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = GetSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->TestSendKey(command);
+  session->TestSendKey(command);
+  session->EncodeOutputDelta(command);
+  UpdateSessionMemoryUsage(id, *session);
   return true;
 }
 
 bool SessionHandler::SendCommand(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = GetSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendCommand(command);
+  session->SendCommand(command);
+  session->EncodeOutputDelta(command);
+  UpdateSessionMemoryUsage(id, *session);
   MaybeUpdateConfig(command);
   return true;
 }
 
 void SessionHandler::MaybeReloadEngine(commands::Command *command) {
-  if (session_map_->Size() > 0) {
-    // Some sessions still use the current engine_.
-    return;
-  }
-
   EngineReloadResponse engine_reload_response;
   if (!engine_->MaybeReloadEngine(&engine_reload_response)) {
     // Engine is not reloaded. output.engine_reload_response must be empty.
@@ -480,7 +662,11 @@ void SessionHandler::MaybeReloadEngine(commands::Command *command) {
   LOG(INFO) << "Engine reloaded";
   *command->mutable_output()->mutable_engine_reload_response() =
       engine_reload_response;
-  table_manager_->ClearCaches();
+
+  if (session_map_->Size() == 0) {
+    // The tables are not owned by the sessions.
+    table_manager_->ClearCaches();
+  }
 }
 
 bool SessionHandler::GetServerVersion(mozc::commands::Command *command) const {
@@ -519,15 +705,15 @@ bool SessionHandler::CreateSession(commands::Command *command) {
       return false;
     }
 
+    const SessionID oldest_id = oldest_element->key;
     oldest_element->value.reset();
-    session_map_->Erase(oldest_element->key);
-    MOZC_VLOG(1) << "Session is FULL, oldest SessionID " << oldest_element->key
+    session_snapshots_.erase(oldest_id);
+    ForgetSessionMemoryUsage(oldest_id);
+    session_map_->Erase(oldest_id);
+    MOZC_VLOG(1) << "Session is FULL, oldest SessionID " << oldest_id
                  << " is removed";
   }
 
-  // CreateSession is called on a relatively safer timing to reload engine_.
-  MaybeReloadEngine(command);
-
   std::unique_ptr<session::Session> session = NewSession();
   if (!session) {
     LOG(ERROR) << "Cannot allocate new Session";
@@ -546,6 +732,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   SessionElement *element = session_map_->Insert(new_id);
   element->value = std::move(session);
   command->mutable_output()->set_id(new_id);
+  UpdateSessionMemoryUsage(new_id, *element->value);
 
   // The created session has not been fully initialized yet.
   // SetConfig() will complete the initialization by setting information
@@ -608,18 +795,31 @@ bool SessionHandler::Cleanup(commands::Command *command) {
   std::vector<SessionID> remove_ids;
   for (const SessionElement &element : *session_map_) {
     const session::Session *session = element.value.get();
-    if (!IsApplicationAlive(session)) {
-      MOZC_VLOG(2) << "Application is not alive. Removing: " << element.key;
+    absl::Time create_session_time, last_command_time;
+    if (session != nullptr) {
+      if (!IsApplicationAlive(session)) {
+        MOZC_VLOG(2) << "Application is not alive. Removing: " << element.key;
+        remove_ids.push_back(element.key);
+        continue;
+      }
+      create_session_time = session->create_session_time();
+      last_command_time = session->last_command_time();
+    } else if (const auto it = session_snapshots_.find(element.key);
+               it != session_snapshots_.end()) {
+      // The session is evicted.
+      create_session_time = it->second.create_time;
+      last_command_time = it->second.last_command_time;
+    } else {
       remove_ids.push_back(element.key);
-    } else if (session->last_command_time() == absl::InfinitePast()) {
+      continue;
+    }
+    if (last_command_time == absl::InfinitePast()) {
       // no command is executed
-      if ((current_time - session->create_session_time()) >=
-          create_session_timeout) {
+      if ((current_time - create_session_time) >= create_session_timeout) {
         remove_ids.push_back(element.key);
       }
     } else {  // some commands are executed already
-      if ((current_time - session->last_command_time()) >=
-          last_command_timeout) {
+      if ((current_time - last_command_time) >= last_command_timeout) {
         remove_ids.push_back(element.key);
       }
     }
@@ -717,11 +917,13 @@ SessionID SessionHandler::CreateNewSessionID() {
 
 bool SessionHandler::DeleteSessionID(SessionID id) {
   std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  if (session == nullptr || (!*session && !session_snapshots_.contains(id))) {
     LOG_IF(WARNING, id != 0) << "cannot find SessionID " << id;
     return false;
   }
   session->reset();
+  session_snapshots_.erase(id);
+  ForgetSessionMemoryUsage(id);
 
   session_map_->Erase(id);  // remove from LRU
 
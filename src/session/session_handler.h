@@ -32,10 +32,12 @@
 #ifndef MOZC_SESSION_SESSION_HANDLER_H_
 #define MOZC_SESSION_SESSION_HANDLER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -47,6 +49,7 @@
 #include "protocol/config.pb.h"
 #include "session/common.h"
 #include "session/internal/keymap.h"
+#include "session/lattice_prefetcher.h"
 #include "session/session.h"
 #include "session/session_handler_interface.h"
 #include "session/session_observer_handler.h"
@@ -85,6 +88,11 @@ class SessionHandler : public SessionHandlerInterface {
 
   const EngineInterface &engine() const { return *engine_; }
 
+  // Enables or disables the speculative prefetch of the conversion lattice
+  // between SEND_KEY commands. Disabling it (e.g. under load) stops the
+  // background thread. The initial value is given by --speculative_prefetch.
+  void SetSpeculativePrefetchEnabled(bool enabled);
+
  private:
   FRIEND_TEST(SessionHandlerTest, KeyMapTest);
   FRIEND_TEST(SessionHandlerTest, EngineUpdateSuccessfulScenarioTest);
@@ -94,6 +102,8 @@ class SessionHandler : public SessionHandlerInterface {
   using SessionMap =
       mozc::storage::LruCache<SessionID, std::unique_ptr<session::Session>>;
   using SessionElement = SessionMap::Element;
+  // Estimated memory usage of the sessions not evicted.
+  using LiveSessionMap = mozc::storage::LruCache<SessionID, size_t>;
 
   // Updates the config, if the |command| contains the config.
   void MaybeUpdateConfig(commands::Command *command);
@@ -133,13 +143,39 @@ class SessionHandler : public SessionHandlerInterface {
   bool ReloadSupplementalModel(commands::Command *command);
   bool GetServerVersion(commands::Command *command) const;
 
-  // Replaces engine_ with a new instance if it is ready.
+  // Reloads engine_ with the new data if it is ready. The existing sessions
+  // switch to the new data once they are idle. See GetSession().
   void MaybeReloadEngine(commands::Command *command);
 
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
+  // Returns the session of |id|, restoring it from the snapshot if it is
+  // evicted, and lets it switch to the current converter of engine_. Returns
+  // nullptr if the session is not available.
+  session::Session *GetSession(SessionID id);
+  // Updates the memory usage of the session |id| after a command, and evicts
+  // the least recently used sessions to snapshots while the sessions exceed
+  // --session_memory_budget_kb.
+  void UpdateSessionMemoryUsage(SessionID id, const session::Session &session);
+  void EvictSession(SessionID id);
+  void ForgetSessionMemoryUsage(SessionID id);
+
+  // Builds the lattice for the likely next key of the session |id| on the
+  // background thread of prefetcher_, with the converter of the session.
+  void StartPrefetch(SessionID id);
+  // Gives the lattice back to the session of the last StartPrefetch(), or
+  // drops the prefetch if it is still running.
+  void FinishPrefetch();
+
   std::unique_ptr<SessionMap> session_map_;
+  // Snapshots of the evicted sessions. Their values in session_map_ are null.
+  absl::flat_hash_map<SessionID, session::Session::Snapshot>
+      session_snapshots_;
+  // Only used with the memory budget.
+  std::unique_ptr<LiveSessionMap> live_sessions_;
+  size_t session_memory_usage_ = 0;
+  size_t session_memory_budget_ = 0;
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   std::optional<SessionWatchDog> session_watch_dog_;
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
@@ -154,12 +190,19 @@ class SessionHandler : public SessionHandlerInterface {
   std::unique_ptr<user_dictionary::UserDictionarySessionHandler>
       user_dictionary_session_handler_;
   std::unique_ptr<composer::TableManager> table_manager_;
-  std::unique_ptr<const commands::Request> request_;
-  std::unique_ptr<const config::Config> config_;
-  std::unique_ptr<keymap::KeyMapManager> key_map_manager_;
+  // Immutable snapshots, replaced as a whole. Shared with the prefetch.
+  std::shared_ptr<const commands::Request> request_;
+  std::shared_ptr<const config::Config> config_;
+  // Shared with the other SessionHandlers with the same keymap settings.
+  std::shared_ptr<const keymap::KeyMapManager> key_map_manager_;
   std::unique_ptr<engine::SupplementalModelInterface> supplemental_model_;
 
   absl::BitGen bitgen_;
+
+  SessionID prefetch_session_id_ = 0;
+  // Null if the speculative prefetch is disabled. Declared last so that its
+  // thread is joined before the sessions and the engine are destroyed.
+  std::unique_ptr<session::LatticePrefetcher> prefetcher_;
 };
 
 }  // namespace mozc
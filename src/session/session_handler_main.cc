@@ -33,6 +33,11 @@
 // session_handler_main --input input.txt --profile /tmp/mozc
 //                      --dictionary oss --engine desktop
 //
+// To compare the heap allocations with and without the command arena used by
+// the server:
+// session_handler_main --input session/session_handler_main_sample.tsv
+//                      --show_allocations [--use_arena]
+//
 /* Example of input.txt (tsv format)
 # Enable IME
 SEND_KEY        ON
@@ -52,9 +57,14 @@ SHOW_LOG_BY_VALUE       ございます
 SHOW_LOG_BY_VALUE       ございました
 */
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -63,11 +73,16 @@ SHOW_LOG_BY_VALUE       ございました
 #include "absl/strings/str_cat.h"
 #include "base/file_stream.h"
 #include "base/init_mozc.h"
+#include "base/latency_trace.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
+#include "absl/base/config.h"
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/numbers.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "data_manager/oss/oss_data_manager.h"
 #include "engine/engine.h"
 #include "protocol/candidates.pb.h"
@@ -79,6 +94,84 @@ ABSL_FLAG(std::string, profile, "", "User profile directory");
 ABSL_FLAG(std::string, engine, "", "Conversion engine: 'mobile' or 'desktop'");
 ABSL_FLAG(std::string, dictionary, "",
           "Dictionary: 'google', 'android' or 'oss'");
+ABSL_FLAG(bool, use_arena, false,
+          "Allocate the commands on a reused arena as the server does");
+ABSL_FLAG(bool, show_allocations, false,
+          "Count the heap allocations after the flags are parsed and show the "
+          "number at exit");
+ABSL_FLAG(std::string, startup_benchmark_keys, "",
+          "If set, converts these keys right after the engine is created and "
+          "shows the time to the first conversion and the initialization "
+          "cost of each component");
+
+namespace {
+
+// Heap allocations counted by the replaced operator new below. They are
+// counted only with --show_allocations or during BenchmarkSendKeys(), so that
+// the other runs pay a single relaxed load per allocation.
+std::atomic<bool> g_count_allocations = false;
+std::atomic<int64_t> g_allocations = 0;
+std::atomic<int64_t> g_allocated_bytes = 0;
+
+// Counts the heap allocations while alive.
+class ScopedAllocationCounting {
+ public:
+  ScopedAllocationCounting()
+      : was_counting_(g_count_allocations.exchange(true)) {}
+
+  ScopedAllocationCounting(const ScopedAllocationCounting &) = delete;
+  ScopedAllocationCounting &operator=(const ScopedAllocationCounting &) =
+      delete;
+
+  ~ScopedAllocationCounting() { g_count_allocations = was_counting_; }
+
+ private:
+  const bool was_counting_;
+};
+
+void CountAllocation(size_t size) {
+  if (g_count_allocations.load(std::memory_order_relaxed)) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
+// Reports an allocation failure as the default operator new does.
+[[noreturn]] void ThrowBadAlloc() {
+#ifdef ABSL_HAVE_EXCEPTIONS
+  throw std::bad_alloc();
+#else   // ABSL_HAVE_EXCEPTIONS
+  std::abort();
+#endif  // ABSL_HAVE_EXCEPTIONS
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+  CountAllocation(size);
+  if (size == 0) {
+    size = 1;
+  }
+  // Like the default operator new, retries while the new handler frees memory.
+  while (true) {
+    if (void *ptr = std::malloc(size); ptr != nullptr) {
+      return ptr;
+    }
+    const std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      ThrowBadAlloc();
+    }
+    handler();
+  }
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  CountAllocation(size);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
 
 namespace mozc {
 void Show(const commands::Output &output) {
@@ -110,6 +203,92 @@ void ShowLog(const commands::Output &output, const int cand_id) {
   }
 }
 
+// Sends `keys` `iterations` times from an empty context and shows the
+// latency, the heap allocations and the size of the serialized output per key
+// event.
+// `options` are the Input messages in text format merged into each SEND_KEY,
+// e.g. "capability { output_delta: true }".
+void BenchmarkSendKeys(session::SessionHandlerInterpreter &handler,
+                       const std::string &keys, const int iterations,
+                       absl::Span<const std::string> options) {
+  absl::Duration total = absl::ZeroDuration();
+  absl::Duration max = absl::ZeroDuration();
+  absl::Duration serialization = absl::ZeroDuration();
+  int64_t output_bytes = 0;
+  int64_t allocations = 0;
+  std::string serialized;
+  const ScopedAllocationCounting allocation_counting;
+  for (int i = 0; i < iterations; ++i) {
+    handler.Eval({"RESET_CONTEXT"}).IgnoreError();
+    absl::Duration elapsed = absl::ZeroDuration();
+    for (const char key : keys) {
+      std::vector<std::string> args = {
+          options.empty() ? "SEND_KEY" : "SEND_KEY_WITH_OPTION",
+          std::string(1, key)};
+      args.insert(args.end(), options.begin(), options.end());
+      const int64_t allocations_before = g_allocations;
+      const Stopwatch stopwatch = Stopwatch::StartNew();
+      const absl::Status status = handler.Eval(args);
+      elapsed += stopwatch.GetElapsed();
+      allocations += g_allocations - allocations_before;
+      if (!status.ok()) {
+        std::cout << "ERROR: " << status.message() << std::endl;
+        return;
+      }
+
+      const Stopwatch serialization_stopwatch = Stopwatch::StartNew();
+      handler.LastOutput().SerializeToString(&serialized);
+      serialization += serialization_stopwatch.GetElapsed();
+      output_bytes += serialized.size();
+    }
+    total += elapsed;
+    max = std::max(max, elapsed);
+  }
+  const int64_t num_keys = static_cast<int64_t>(keys.size()) * iterations;
+  std::cout << "keys: " << keys << " iterations: " << iterations
+            << " avg/key: " << absl::FormatDuration(total / num_keys)
+            << " max/iteration: " << absl::FormatDuration(max)
+            << " allocations/key: " << allocations / num_keys
+            << " output bytes/key: " << output_bytes / num_keys
+            << " serialization/key: "
+            << absl::FormatDuration(serialization / num_keys) << std::endl;
+}
+
+// Converts `keys` on the fresh `handler` and shows the time from the start of
+// the engine creation to the end of the first conversion, followed by the
+// latencies recorded so far, which include the initialization of each
+// component, e.g. "Modules::Init" and "MergerRewriter::BuildTriggerFilter".
+void BenchmarkStartup(session::SessionHandlerInterpreter &handler,
+                      const std::string &keys, const Stopwatch &stopwatch,
+                      const absl::Duration engine_creation) {
+  const absl::Duration before_conversion = stopwatch.GetElapsed();
+  for (const std::vector<std::string> &args :
+       std::vector<std::vector<std::string>>{
+           {"SEND_KEY", "ON"}, {"SEND_KEYS", keys}, {"SEND_KEY", "Space"}}) {
+    if (const absl::Status status = handler.Eval(args); !status.ok()) {
+      std::cout << "ERROR: " << status.message() << std::endl;
+      return;
+    }
+  }
+  const absl::Duration total = stopwatch.GetElapsed();
+  handler.Eval({"RESET_CONTEXT"}).IgnoreError();
+  std::cout << "keys: " << keys
+            << " engine creation: " << absl::FormatDuration(engine_creation)
+            << " first conversion: "
+            << absl::FormatDuration(total - before_conversion)
+            << " time to first conversion: " << absl::FormatDuration(total)
+            << std::endl;
+  for (const LatencyHistogram::Snapshot &snapshot :
+       LatencyTrace::GetSnapshots()) {
+    if (snapshot.count == 0) {
+      continue;
+    }
+    std::cout << snapshot.name << ": count: " << snapshot.count << " total: "
+              << absl::FormatDuration(absl::Microseconds(snapshot.total_usec))
+              << std::endl;
+  }
+}
+
 void ParseLine(session::SessionHandlerInterpreter &handler, std::string line) {
   std::vector<std::string> args = handler.Parse(line);
   if (args.empty()) {
@@ -169,6 +348,18 @@ void ParseLine(session::SessionHandlerInterpreter &handler, std::string line) {
     return;
   }
 
+  if (command == "BENCHMARK_SEND_KEYS") {
+    int iterations;
+    if (args.size() >= 3 && !args[1].empty() &&
+        absl::SimpleAtoi(args[2], &iterations) && iterations > 0) {
+      BenchmarkSendKeys(handler, args[1], iterations,
+                        absl::MakeConstSpan(args).subspan(3));
+    } else {
+      std::cout << "ERROR: " << line << std::endl;
+    }
+    return;
+  }
+
   const absl::Status status = handler.Eval(args);
   if (!status.ok()) {
     std::cout << "ERROR: " << line << std::endl;
@@ -206,16 +397,24 @@ absl::StatusOr<std::unique_ptr<Engine>> CreateEngine(
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv);
+  g_count_allocations = absl::GetFlag(FLAGS_show_allocations);
   if (!absl::GetFlag(FLAGS_profile).empty()) {
     mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_profile));
   }
+  const mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
   auto engine = mozc::CreateEngine(absl::GetFlag(FLAGS_engine),
                                    absl::GetFlag(FLAGS_dictionary));
   if (!engine.ok()) {
     std::cout << "engine init error" << std::endl;
     return 1;
   }
+  const absl::Duration engine_creation = stopwatch.GetElapsed();
   mozc::session::SessionHandlerInterpreter handler(*std::move(engine));
+  handler.UseCommandArena(absl::GetFlag(FLAGS_use_arena));
+  if (const std::string keys = absl::GetFlag(FLAGS_startup_benchmark_keys);
+      !keys.empty()) {
+    mozc::BenchmarkStartup(handler, keys, stopwatch, engine_creation);
+  }
 
   std::string line;
   if (!absl::GetFlag(FLAGS_input).empty()) {
@@ -228,5 +427,10 @@ int main(int argc, char **argv) {
   while (std::getline(std::cin, line)) {
     mozc::ParseLine(handler, line);
   }
+
+  if (absl::GetFlag(FLAGS_show_allocations)) {
+    std::cout << "allocations: " << g_allocations
+              << " allocated bytes: " << g_allocated_bytes << std::endl;
+  }
   return 0;
 }
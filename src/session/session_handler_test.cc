@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <iterator>
 #include <memory>
 #include <optional>
@@ -73,6 +74,7 @@
 
 
 ABSL_DECLARE_FLAG(int32_t, max_session_size);
+ABSL_DECLARE_FLAG(int32_t, session_memory_budget_kb);
 ABSL_DECLARE_FLAG(int32_t, create_session_min_interval);
 ABSL_DECLARE_FLAG(int32_t, last_command_timeout);
 ABSL_DECLARE_FLAG(int32_t, last_create_session_timeout);
@@ -130,6 +132,15 @@ bool IsGoodSession(SessionHandlerInterface &handler, uint64_t id) {
   return (command.output().error_code() == commands::Output::SESSION_SUCCESS);
 }
 
+bool SendKey(SessionHandlerInterface &handler, uint64_t id, char key_code) {
+  commands::Command command;
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->set_type(commands::Input::SEND_KEY);
+  command.mutable_input()->mutable_key()->set_key_code(key_code);
+  handler.EvalCommand(&command);
+  return (command.output().error_code() == commands::Output::SESSION_SUCCESS);
+}
+
 constexpr absl::string_view kMockMagicNumber = "MOCK";
 constexpr absl::string_view kOssMagicNumber = "\xEFMOZC\x0D\x0A";
 }  // namespace
@@ -267,6 +278,62 @@ TEST_F(SessionHandlerTest, MaxSessionSizeTest) {
   Clock::SetClockForUnitTest(nullptr);
 }
 
+TEST_F(SessionHandlerTest, SessionMemoryBudgetTest) {
+  // The budget is smaller than a session, so all the sessions but the last
+  // used one are evicted.
+  absl::SetFlag(&FLAGS_session_memory_budget_kb, 1);
+  absl::SetFlag(&FLAGS_max_session_size, 256);
+  SessionHandler handler(CreateMockDataEngine());
+
+  auto send_key = [&handler](uint64_t id, absl::string_view key) {
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(id);
+    input->set_type(commands::Input::SEND_KEY);
+    if (key == "ON") {
+      input->mutable_key()->set_special_key(commands::KeyEvent::ON);
+    } else {
+      input->mutable_key()->set_key_code(key[0]);
+    }
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    return command.output();
+  };
+
+  uint64_t id1 = 0;
+  EXPECT_TRUE(CreateSession(handler, &id1));
+  send_key(id1, "ON");
+  send_key(id1, "k");
+  EXPECT_EQ(send_key(id1, "a").preedit().segment(0).value(), "か");
+  EXPECT_COUNT_STATS("SessionEvicted", 0);
+
+  uint64_t id2 = 0;
+  EXPECT_TRUE(CreateSession(handler, &id2));
+  EXPECT_COUNT_STATS("SessionEvicted", 1);
+
+  // The composition is restored from the snapshot.
+  const commands::Output output = send_key(id1, "i");
+  ASSERT_EQ(output.preedit().segment_size(), 1);
+  EXPECT_EQ(output.preedit().segment(0).value(), "かい");
+  EXPECT_COUNT_STATS("SessionRehydrated", 1);
+  EXPECT_COUNT_STATS("SessionEvicted", 2);
+
+  // Evicted sessions can be deleted.
+  EXPECT_TRUE(DeleteSession(handler, id2));
+  EXPECT_FALSE(IsGoodSession(handler, id2));
+  EXPECT_TRUE(IsGoodSession(handler, id1));
+
+  // More than 128 sessions are allowed with the memory budget.
+  std::vector<uint64_t> ids;
+  for (int i = 0; i < 200; ++i) {
+    uint64_t id = 0;
+    EXPECT_TRUE(CreateSession(handler, &id));
+    ids.push_back(id);
+  }
+  for (const uint64_t id : ids) {
+    EXPECT_TRUE(IsGoodSession(handler, id));
+  }
+}
+
 TEST_F(SessionHandlerTest, CreateSession_ConfigTest) {
   // Setting ATOK to ConfigHandler before all other initializations.
   //  Not using SET_CONFIG command
@@ -544,6 +611,60 @@ TEST_F(SessionHandlerTest, ConfigTest) {
   EXPECT_COUNT_STATS("SessionAllEvent", 3);
 }
 
+TEST_F(SessionHandlerTest, OutputDeltaTest) {
+  SessionHandler handler(CreateMockDataEngine());
+  uint64_t id = 0;
+  EXPECT_TRUE(CreateSession(handler, &id));
+
+  auto send_key = [&handler, id](const commands::KeyEvent &key,
+                                 bool full_output = false) {
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(id);
+    input->set_type(commands::Input::SEND_KEY);
+    input->mutable_capability()->set_output_delta(true);
+    input->set_full_output(full_output);
+    *input->mutable_key() = key;
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    return command.output();
+  };
+  commands::KeyEvent key;
+  key.set_special_key(commands::KeyEvent::ON);
+  send_key(key);
+
+  key.Clear();
+  key.set_key_code('a');
+  commands::Output output = send_key(key);
+  EXPECT_EQ(output.preedit().segment(0).value(), "あ");
+  EXPECT_FALSE(output.unchanged_fields().preedit());
+
+  // A key which does nothing doesn't change the preedit, so it is not built
+  // again.
+  commands::KeyEvent no_op_key;
+  no_op_key.set_special_key(commands::KeyEvent::F12);
+  output = send_key(no_op_key);
+  EXPECT_TRUE(output.consumed());
+  EXPECT_FALSE(output.has_preedit());
+  EXPECT_TRUE(output.unchanged_fields().preedit());
+  EXPECT_TRUE(output.unchanged_fields().status());
+
+  // Moving the cursor updates the composer, so the preedit is built again even
+  // if it is the same.
+  key.Clear();
+  key.set_special_key(commands::KeyEvent::RIGHT);
+  output = send_key(key);
+  EXPECT_EQ(output.preedit().segment(0).value(), "あ");
+  EXPECT_FALSE(output.unchanged_fields().preedit());
+  EXPECT_TRUE(output.unchanged_fields().status());
+
+  // The client can ask for the full output to resync.
+  output = send_key(no_op_key, true);
+  EXPECT_EQ(output.preedit().segment(0).value(), "あ");
+  EXPECT_FALSE(output.has_unchanged_fields());
+  output = send_key(no_op_key);
+  EXPECT_TRUE(output.unchanged_fields().preedit());
+}
+
 TEST_F(SessionHandlerTest, UpdateComposition) {
   config::Config config;
   config::ConfigHandler::GetConfig(&config);
@@ -766,25 +887,54 @@ TEST_F(SessionHandlerTest, EngineReloadSessionExistsTest) {
   ASSERT_EQ(SendMockEngineReloadRequest(*handler_, mock_request_),
             EngineReloadResponse::ACCEPTED);
 
-  // Another session is created. Since the handler already holds one session
-  // (id1), new data manager is not used.
+  // Another session is created. The engine reloads the new data manager even
+  // though the handler holds a session (id1), which switches to the new data
+  // on its next command as it is idle.
   uint64_t id2 = 0;
   ASSERT_TRUE(CreateSession(*handler_, &id2));
+  // New data is reloaded, but the engine is the same object.
   EXPECT_EQ(&handler_->engine(), old_engine_ptr);
-  EXPECT_EQ(handler_->GetDataVersion(), initial_version);
-  EXPECT_NE(handler_->GetDataVersion(), mock_version_);
+  EXPECT_EQ(handler_->GetDataVersion(), mock_version_);
+  EXPECT_TRUE(IsGoodSession(*handler_, id1));
+  EXPECT_TRUE(IsGoodSession(*handler_, id2));
 
-  // All the sessions were deleted.
   ASSERT_TRUE(DeleteSession(*handler_, id1));
+  EXPECT_TRUE(IsGoodSession(*handler_, id2));
   ASSERT_TRUE(DeleteSession(*handler_, id2));
+}
 
-  // A new session is created. Since the handler holds no session, engine
-  // reloads the new data manager.
-  uint64_t id3 = 0;
-  ASSERT_TRUE(CreateSession(*handler_, &id3));
-  // New data is reloaded, but the engine is the same object.
-  EXPECT_EQ(&handler_->engine(), old_engine_ptr);
-  EXPECT_EQ(handler_->GetDataVersion(), mock_version_);
+// Reloads the engine repeatedly while the sessions created with each data
+// are composing, and deletes the oldest session after each reload. The
+// composing sessions keep the data they started with.
+TEST_F(SessionHandlerTest, EngineReloadWithSessionsStressTest) {
+  constexpr int kReloadCount = 8;
+  constexpr int kLiveSessionCount = 3;
+
+  std::deque<uint64_t> ids;
+  for (int i = 0; i < kReloadCount; ++i) {
+    const bool use_oss = i % 2 == 1;
+    ASSERT_EQ(SendMockEngineReloadRequest(
+                  *handler_, use_oss ? oss_request_ : mock_request_),
+              EngineReloadResponse::ACCEPTED);
+
+    uint64_t id = 0;
+    ASSERT_TRUE(CreateSession(*handler_, &id));
+    EXPECT_EQ(handler_->GetDataVersion(),
+              use_oss ? oss_version_ : mock_version_);
+    ids.push_back(id);
+
+    for (const uint64_t live_id : ids) {
+      EXPECT_TRUE(SendKey(*handler_, live_id, 'a'));
+      EXPECT_TRUE(IsGoodSession(*handler_, live_id));
+    }
+    if (ids.size() > kLiveSessionCount) {
+      ASSERT_TRUE(DeleteSession(*handler_, ids.front()));
+      ids.pop_front();
+    }
+  }
+  for (const uint64_t id : ids) {
+    ASSERT_TRUE(DeleteSession(*handler_, id));
+  }
 }
 
 TEST_F(SessionHandlerTest, GetServerVersionTest) {
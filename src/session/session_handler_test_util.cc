@@ -44,6 +44,7 @@
 #include "storage/registry.h"
 
 ABSL_DECLARE_FLAG(int32_t, max_session_size);
+ABSL_DECLARE_FLAG(int32_t, session_memory_budget_kb);
 ABSL_DECLARE_FLAG(int32_t, create_session_min_interval);
 ABSL_DECLARE_FLAG(int32_t, watch_dog_interval);
 ABSL_DECLARE_FLAG(int32_t, last_command_timeout);
@@ -103,6 +104,8 @@ bool IsGoodSession(SessionHandlerInterface *handler, uint64_t id) {
 
 void SessionHandlerTestBase::SetUp() {
   flags_max_session_size_backup_ = absl::GetFlag(FLAGS_max_session_size);
+  flags_session_memory_budget_kb_backup_ =
+      absl::GetFlag(FLAGS_session_memory_budget_kb);
   flags_create_session_min_interval_backup_ =
       absl::GetFlag(FLAGS_create_session_min_interval);
   flags_watch_dog_interval_backup_ = absl::GetFlag(FLAGS_watch_dog_interval);
@@ -121,6 +124,8 @@ void SessionHandlerTestBase::TearDown() {
   ConfigHandler::SetConfig(config_backup_);
 
   absl::SetFlag(&FLAGS_max_session_size, flags_max_session_size_backup_);
+  absl::SetFlag(&FLAGS_session_memory_budget_kb,
+                flags_session_memory_budget_kb_backup_);
   absl::SetFlag(&FLAGS_create_session_min_interval,
                 flags_create_session_min_interval_backup_);
   absl::SetFlag(&FLAGS_watch_dog_interval, flags_watch_dog_interval_backup_);
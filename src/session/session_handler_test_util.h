@@ -71,6 +71,7 @@ class SessionHandlerTestBase : public ::mozc::testing::TestWithTempUserProfile {
  private:
   config::Config config_backup_;
   int32_t flags_max_session_size_backup_;
+  int32_t flags_session_memory_budget_kb_backup_;
   int32_t flags_create_session_min_interval_backup_;
   int32_t flags_watch_dog_interval_backup_;
   int32_t flags_last_command_timeout_backup_;
@@ -32,6 +32,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -64,6 +65,7 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/request_test_util.h"
+#include "session/internal/command_arena.h"
 #include "session/session_handler.h"
 #include "session/session_handler_interface.h"
 #include "session/session_usage_observer.h"
@@ -253,11 +255,21 @@ bool SessionHandlerTool::ReloadSupplementalModel(absl::string_view model_path) {
   return EvalCommand(&input, &output);
 }
 
+void SessionHandlerTool::UseCommandArena(bool use) {
+  if (use) {
+    command_arena_.emplace();
+  } else {
+    command_arena_.reset();
+  }
+}
+
 bool SessionHandlerTool::EvalCommandInternal(commands::Input *input,
                                              commands::Output *output,
                                              bool allow_callback) {
   input->set_id(id_);
-  commands::Command command;
+  Command heap_command;
+  Command &command =
+      command_arena_.has_value() ? *command_arena_->NewCommand() : heap_command;
   *command.mutable_input() = *input;
   bool result = handler_->EvalCommand(&command);
   if (result && output != nullptr) {
@@ -266,14 +278,21 @@ bool SessionHandlerTool::EvalCommandInternal(commands::Input *input,
 
   // If callback is allowed and the callback field exists, evaluate the callback
   // command.
+  std::optional<commands::Input> input2;
   if (result && allow_callback && command.output().has_callback() &&
       command.output().callback().has_session_command()) {
-    commands::Input input2;
-    input2.set_type(commands::Input::SEND_COMMAND);
-    *input2.mutable_command() = command.output().callback().session_command();
-    input2.mutable_command()->set_text(callback_text_);
+    input2.emplace();
+    input2->set_type(commands::Input::SEND_COMMAND);
+    *input2->mutable_command() = command.output().callback().session_command();
+    input2->mutable_command()->set_text(callback_text_);
+  }
+  if (command_arena_.has_value()) {
+    // |command| is destroyed here.
+    command_arena_->Reset();
+  }
+  if (input2.has_value()) {
     // Disallow further recursion.
-    result = EvalCommandInternal(&input2, output, false);
+    result = EvalCommandInternal(&*input2, output, false);
   }
   callback_text_.clear();
   return result;
@@ -873,5 +892,9 @@ void SessionHandlerInterpreter::ReloadSupplementalModel(
   client_->ReloadSupplementalModel(model_path);
 }
 
+void SessionHandlerInterpreter::UseCommandArena(bool use) {
+  client_->UseCommandArena(use);
+}
+
 }  // namespace session
 }  // namespace mozc
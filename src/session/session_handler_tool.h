@@ -32,6 +32,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -43,6 +44,7 @@
 #include "protocol/candidates.pb.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/internal/command_arena.h"
 #include "session/session_handler_interface.h"
 #include "session/session_observer_interface.h"
 
@@ -88,6 +90,9 @@ class SessionHandlerTool {
   void SetCallbackText(absl::string_view text);
   bool ReloadSupplementalModel(absl::string_view model_path);
 
+  // Allocates the commands on a reused arena as SessionServer does.
+  void UseCommandArena(bool use);
+
  private:
   bool EvalCommand(commands::Input *input, commands::Output *output);
   bool EvalCommandInternal(commands::Input *input, commands::Output *output,
@@ -98,6 +103,7 @@ class SessionHandlerTool {
   UserDataManagerInterface *data_manager_;
   std::unique_ptr<SessionHandlerInterface> handler_;
   std::string callback_text_;
+  std::optional<CommandArena> command_arena_;
 };
 
 class SessionHandlerInterpreter final {
@@ -123,6 +129,7 @@ class SessionHandlerInterpreter final {
   absl::Status Eval(absl::Span<const std::string> args);
   void SetRequest(const commands::Request &request);
   void ReloadSupplementalModel(absl::string_view model_path);
+  void UseCommandArena(bool use);
 
  private:
   std::unique_ptr<SessionHandlerTool> client_;
@@ -36,6 +36,7 @@
 #include <memory>
 #include <string>
 
+#include "absl/cleanup/cleanup.h"
 #include "absl/log/log.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -44,6 +45,7 @@
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
 #include "protocol/commands.pb.h"
+#include "session/internal/command_arena.h"
 #include "session/session_handler.h"
 #include "session/session_usage_observer.h"
 
@@ -93,28 +95,31 @@ bool SessionServer::Process(absl::string_view request, std::string *response) {
     return false;  // shutdown the server if handler doesn't exist
   }
 
-  commands::Command command;
-  if (!command.mutable_input()->ParseFromArray(request.data(),
-                                               request.size())) {
+  // The command and its output are allocated on the arena reused across the
+  // requests, as the candidate lists consist of many small messages.
+  absl::Cleanup reset_arena = [this] { command_arena_.Reset(); };
+  commands::Command *command = command_arena_.NewCommand();
+  if (!command->mutable_input()->ParseFromArray(request.data(),
+                                                request.size())) {
     LOG(WARNING) << "Invalid request";
     response->clear();
     return true;
   }
 
-  if (!session_handler_->EvalCommand(&command)) {
+  if (!session_handler_->EvalCommand(command)) {
     LOG(WARNING) << "EvalCommand() returned false. Exiting the loop.";
     response->clear();
     return false;
   }
 
-  if (!command.output().SerializeToString(response)) {
+  if (!command->output().SerializeToString(response)) {
     LOG(WARNING) << "SerializeToString() failed";
     response->clear();
     return true;
   }
 
   // debug message
-  MOZC_VLOG(2) << command;
+  MOZC_VLOG(2) << *command;
 
   return true;
 }
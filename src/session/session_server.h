@@ -37,6 +37,7 @@
 
 #include "absl/strings/string_view.h"
 #include "ipc/ipc.h"
+#include "session/internal/command_arena.h"
 #include "session/session_handler_interface.h"
 #include "session/session_usage_observer.h"
 
@@ -65,6 +66,8 @@ class SessionServer : public IPCServer {
  private:
   std::unique_ptr<session::SessionUsageObserver> usage_observer_;
   std::unique_ptr<SessionHandlerInterface> session_handler_;
+  // Process() is called only from the server thread.
+  session::CommandArena command_arena_;
 };
 
 }  // namespace mozc
@@ -36,12 +36,14 @@
 #include <string>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "base/latency_trace.h"
 #include "base/strings/assign.h"
 #include "base/strings/unicode.h"
 #include "base/vlog.h"
@@ -49,6 +51,7 @@
 #include "composer/key_parser.h"
 #include "composer/table.h"
 #include "config/config_handler.h"
+#include "converter/converter_interface.h"
 #include "converter/converter_mock.h"
 #include "converter/segments.h"
 #include "data_manager/testing/mock_data_manager.h"
@@ -65,6 +68,7 @@
 #include "rewriter/transliteration_rewriter.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/keymap.h"
+#include "session/lattice_prefetcher.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
@@ -774,6 +778,52 @@ TEST_F(SessionTest, TestSendKey) {
   EXPECT_TRUE(command.output().consumed());
 }
 
+TEST_F(SessionTest, SetConverterWaitsForIdle) {
+  MockEngine engine;
+  MockConverter converter;
+  EXPECT_CALL(engine, GetConverter()).WillRepeatedly(Return(&converter));
+
+  Session session(&engine);
+  InitSessionToConversionWithAiueo(&session, &converter);
+
+  // The conversion in progress keeps the current converter.
+  MockConverter new_converter;
+  session.SetConverter(std::shared_ptr<const ConverterInterface>(
+      std::shared_ptr<void>(), &new_converter));
+  EXPECT_EQ(session.context().state(), ImeContext::CONVERSION);
+
+  EXPECT_CALL(converter, FinishConversion(_, _));
+  EXPECT_CALL(new_converter, FinishConversion(_, _)).Times(0);
+  commands::Command command;
+  EXPECT_TRUE(session.Commit(&command));
+  EXPECT_TRUE(command.output().has_result());
+  Mock::VerifyAndClearExpectations(&converter);
+  Mock::VerifyAndClearExpectations(&new_converter);
+
+  // The next composition uses the new converter.
+  EXPECT_CALL(converter, StartSuggestion(_, _)).Times(0);
+  EXPECT_CALL(new_converter, StartSuggestion(_, _)).WillOnce(Return(false));
+  command.Clear();
+  SendKey("a", &session, &command);
+  EXPECT_EQ(session.context().state(), ImeContext::COMPOSITION);
+}
+
+TEST_F(SessionTest, LatticePrefetchDisabledByDefault) {
+  MockEngine engine;
+  MockConverter converter;
+  EXPECT_CALL(engine, GetConverter()).WillRepeatedly(Return(&converter));
+
+  Session session(&engine);
+  InitSessionToPrecomposition(&session);
+  commands::Command command;
+  InsertCharacterChars("kaka", &session, &command);
+  EXPECT_EQ(session.context().state(), ImeContext::COMPOSITION);
+
+  // No key is recorded to guess the next one.
+  LatticePrefetcher::Task task;
+  EXPECT_FALSE(session.PrepareLatticePrefetch(&task));
+}
+
 TEST_F(SessionTest, UpdateComposition) {
   MockEngine engine;
   MockConverter converter;
@@ -867,6 +917,39 @@ TEST_F(SessionTest, SendCommand) {
   EXPECT_FALSE(command.output().consumed());
 }
 
+TEST_F(SessionTest, GetLatencyStats) {
+  MockConverter converter;
+  MockEngine engine;
+  EXPECT_CALL(engine, GetConverter()).WillRepeatedly(Return(&converter));
+
+  LatencyTrace::ClearAll();
+  Session session(&engine);
+  InitSessionToPrecomposition(&session);
+  commands::Command command;
+  SendKey("a", &session, &command);
+  SendKey("i", &session, &command);
+
+  SendCommand(commands::SessionCommand::GET_LATENCY_STATS, &session, &command);
+  EXPECT_TRUE(command.output().has_consumed());
+  EXPECT_FALSE(command.output().consumed());
+  ASSERT_TRUE(command.output().has_latency_stats());
+#ifndef MOZC_NO_LATENCY_TRACE
+  const auto &stages = command.output().latency_stats().stages();
+  const auto it = absl::c_find_if(
+      stages, [](const commands::Output::LatencyStats::Stage &stage) {
+        return stage.name() == "Session::SendKey";
+      });
+  ASSERT_NE(it, stages.end());
+  EXPECT_EQ(it->count(), 2);
+  EXPECT_EQ(it->buckets_size(), LatencyHistogram::kNumBuckets);
+  uint64_t total = 0;
+  for (const uint64_t bucket : it->buckets()) {
+    total += bucket;
+  }
+  EXPECT_EQ(total, 2);
+#endif  // MOZC_NO_LATENCY_TRACE
+}
+
 TEST_F(SessionTest, SwitchInputMode) {
   MockConverter converter;
   MockEngine engine;
@@ -121,6 +121,7 @@
       'target_name': 'session_converter_test',
       'type': 'executable',
       'sources': [
+        'lattice_prefetcher_test.cc',
         'session_converter_test.cc',
       ],
       'dependencies': [
@@ -200,8 +201,10 @@
       'type': 'executable',
       'sources': [
         'internal/candidate_list_test.cc',
+        'internal/command_arena_test.cc',
         'internal/ime_context_test.cc',
         'internal/keymap_test.cc',
+        'internal/output_delta_test.cc',
         'internal/session_output_test.cc',
         'internal/key_event_transformer_test.cc',
       ],
@@ -30,6 +30,7 @@
 #include "storage/lru_storage.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -50,6 +51,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "base/bits.h"
 #include "base/clock.h"
 #include "base/file_stream.h"
@@ -399,7 +401,29 @@ void LruStorage::Close() {
 
 const char *LruStorage::Lookup(const absl::string_view key,
                                uint32_t *last_access_time) const {
-  const uint64_t fp = FingerprintWithSeed(key, seed_);
+  return LookupFingerprint(GetFingerprint(key), last_access_time);
+}
+
+uint64_t LruStorage::GetFingerprint(const absl::string_view key) const {
+  return FingerprintWithSeed(key, seed_);
+}
+
+void LruStorage::LookupFingerprints(
+    absl::Span<const uint64_t> fingerprints, absl::Span<const char *> values,
+    absl::Span<uint32_t> last_access_times) const {
+  DCHECK_EQ(fingerprints.size(), values.size());
+  DCHECK_EQ(fingerprints.size(), last_access_times.size());
+  for (const uint64_t fp : fingerprints) {
+    lru_map_.prefetch(fp);
+  }
+  for (size_t i = 0; i < fingerprints.size(); ++i) {
+    last_access_times[i] = 0;
+    values[i] = LookupFingerprint(fingerprints[i], &last_access_times[i]);
+  }
+}
+
+const char *LruStorage::LookupFingerprint(const uint64_t fp,
+                                          uint32_t *last_access_time) const {
   const auto it = lru_map_.find(fp);
   if (it == lru_map_.end()) {
     return nullptr;
@@ -39,6 +39,7 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/mmap.h"
 
 namespace mozc {
@@ -67,6 +68,17 @@ class LruStorage {
     return Lookup(key, &last_access_time);
   }
 
+  // Returns the fingerprint of |key| for LookupFingerprints().
+  uint64_t GetFingerprint(absl::string_view key) const;
+
+  // Looks up elements by the fingerprints of their keys at once.  The hash
+  // table slots of all the fingerprints are prefetched before any of them is
+  // probed, so the cache misses overlap.  |values[i]| is set to nullptr if the
+  // element of |fingerprints[i]| is not found.
+  void LookupFingerprints(absl::Span<const uint64_t> fingerprints,
+                          absl::Span<const char *> values,
+                          absl::Span<uint32_t> last_access_times) const;
+
   // A safer lookup for string values (the pointers returned by above Lookup()'s
   // are not null terminated.)
   absl::string_view LookupAsString(const absl::string_view key) const {
@@ -160,6 +172,8 @@ class LruStorage {
   // Initializes this LRU from memory buffer.
   bool Open(char *ptr, size_t ptr_size);
 
+  const char *LookupFingerprint(uint64_t fp, uint32_t *last_access_time) const;
+
   // Deletes the element from |fp| or |it|.
   bool Delete(uint64_t fp);
   bool Delete(std::list<char *>::iterator it);
@@ -43,6 +43,7 @@
 #include "absl/log/check.h"
 #include "absl/random/random.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "base/clock_mock.h"
 #include "base/file/temp_dir.h"
 #include "base/file_util.h"
@@ -557,5 +558,39 @@ TEST_F(LruStorageTest, OldDataAreNotLookedUp) {
   EXPECT_TRUE(storage.Touch("4444"));
 }
 
+TEST_F(LruStorageTest, LookupFingerprints) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1));
+
+  constexpr size_t kValueSize = 4;
+  constexpr size_t kNumElements = 4;
+  LruStorage storage;
+  TempFile file(testing::MakeTempFileOrDie());
+  ASSERT_TRUE(storage.OpenOrCreate(file.path().c_str(), kValueSize,
+                                   kNumElements, kSeed));
+  EXPECT_TRUE(storage.Insert("1111", "aaaa"));
+  clock->Advance(absl::Seconds(1));
+  EXPECT_TRUE(storage.Insert("2222", "bbbb"));
+
+  const std::vector<uint64_t> fingerprints = {
+      storage.GetFingerprint("2222"),
+      storage.GetFingerprint("3333"),
+      storage.GetFingerprint("1111"),
+  };
+  std::vector<const char *> values(fingerprints.size());
+  std::vector<uint32_t> last_access_times(fingerprints.size());
+  storage.LookupFingerprints(fingerprints, absl::MakeSpan(values),
+                             absl::MakeSpan(last_access_times));
+
+  uint32_t last_access_time = 0;
+  EXPECT_EQ(values[0], storage.Lookup("2222", &last_access_time));
+  EXPECT_EQ(last_access_times[0], last_access_time);
+  EXPECT_EQ(last_access_times[0], 2);
+  EXPECT_EQ(values[1], nullptr);
+  EXPECT_EQ(last_access_times[1], 0);
+  EXPECT_EQ(values[2], storage.Lookup("1111", &last_access_time));
+  EXPECT_EQ(last_access_times[2], last_access_time);
+  EXPECT_EQ(last_access_times[2], 1);
+}
+
 }  // namespace storage
 }  // namespace mozc